@@ -0,0 +1,223 @@
+/*
+*  BigEndian.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#pragma once
+#include <string.h>
+#include <stdint.h>
+#include <string>
+#include <type_traits>
+#include "common.h"
+
+#ifdef _MSC_VER
+#	include <stdlib.h> // _byteswap_ushort, _byteswap_ulong, _byteswap_uint64
+#	define STRONGRID_BSWAP_CONSTEXPR inline
+#else
+#	define STRONGRID_BSWAP_CONSTEXPR constexpr
+#endif
+
+namespace strongridbase
+{
+	// Byte swaps - the builtins compile to a single bswap/rev, which the compiler folds into the load where it can (movbe)
+	constexpr uint8_t ByteSwap( uint8_t val ) { return val; }
+#ifdef _MSC_VER
+	inline uint16_t ByteSwap( uint16_t val ) { return _byteswap_ushort(val); }
+	inline uint32_t ByteSwap( uint32_t val ) { return _byteswap_ulong(val); }
+	inline uint64_t ByteSwap( uint64_t val ) { return _byteswap_uint64(val); }
+#else
+	constexpr uint16_t ByteSwap( uint16_t val ) { return __builtin_bswap16(val); }
+	constexpr uint32_t ByteSwap( uint32_t val ) { return __builtin_bswap32(val); }
+	constexpr uint64_t ByteSwap( uint64_t val ) { return __builtin_bswap64(val); }
+#endif
+
+	// Converts an unsigned word between network (big endian) and host byte order
+	template<typename Word>
+	STRONGRID_BSWAP_CONSTEXPR Word NetToHost( Word val )
+	{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+		return val;
+#else
+		return ByteSwap(val);
+#endif
+	}
+
+	// The unsigned word a field of type T is swapped as, picked at compile time by size
+	template<int Size> struct BigEndianWord;
+	template<> struct BigEndianWord<1> { typedef uint8_t Type; };
+	template<> struct BigEndianWord<2> { typedef uint16_t Type; };
+	template<> struct BigEndianWord<4> { typedef uint32_t Type; };
+	template<> struct BigEndianWord<8> { typedef uint64_t Type; };
+
+	// Loads/stores a big endian field at any alignment. memcpy of a fixed size compiles to a plain (unaligned) move.
+	template<typename T>
+	inline T LoadBigEndian( const char* src )
+	{
+		static_assert(std::is_arithmetic<T>::value, "Only integer and floating point fields can be read");
+		typedef typename BigEndianWord<sizeof(T)>::Type Word;
+		Word word;
+		memcpy(&word, src, sizeof(word));
+		word = NetToHost(word);
+		T val;
+		memcpy(&val, &word, sizeof(val));
+		return val;
+	}
+
+	template<typename T>
+	inline void StoreBigEndian( char* dest, T val )
+	{
+		static_assert(std::is_arithmetic<T>::value, "Only integer and floating point fields can be written");
+		typedef typename BigEndianWord<sizeof(T)>::Type Word;
+		Word word;
+		memcpy(&word, &val, sizeof(word));
+		word = NetToHost(word);
+		memcpy(dest, &word, sizeof(word));
+	}
+
+
+	// Cursor reading big endian fields from a frame buffer. With CheckBounds, reads past 'length' throw instead
+	// of touching memory beyond the buffer; without, the caller has validated the frame size beforehand.
+	template<bool CheckBounds>
+	class BasicBigEndianReader
+	{
+	public:
+		BasicBigEndianReader( const char* data, int length, int offset = 0 ) : m_data(data), m_length(length), m_offset(offset)
+		{
+		}
+
+		template<typename T> T Read()
+		{
+			Require(sizeof(T));
+			T val = LoadBigEndian<T>(m_data + m_offset);
+			m_offset += sizeof(T);
+			return val;
+		}
+
+		// Fixed length text field - the string ends at the first zero byte, if any
+		std::string ReadString( int fieldLength )
+		{
+			Require(fieldLength);
+			const char* src = m_data + m_offset;
+			const char* end = (const char*)memchr(src, 0, fieldLength);
+			m_offset += fieldLength;
+			return std::string(src, end ? end : src + fieldLength);
+		}
+
+		// Raw bytes of a field, left in the frame buffer
+		const char* ReadBytes( int numBytes )
+		{
+			Require(numBytes);
+			const char* src = m_data + m_offset;
+			m_offset += numBytes;
+			return src;
+		}
+
+		void Skip( int numBytes )
+		{
+			Require(numBytes);
+			m_offset += numBytes;
+		}
+
+		// Throws like a read when fewer than numBytes are left - for counts read off the wire, before anything
+		// is allocated for the items they count
+		void RequireRemaining( uint64_t numBytes ) const
+		{
+			if( CheckBounds && numBytes > (uint64_t)(m_length - m_offset) ) throw Exception("Frame is truncated");
+		}
+
+		int Offset() const { return m_offset; }
+		int Length() const { return m_length; }
+
+	private:
+		void Require( int numBytes ) const
+		{
+			if( CheckBounds && (numBytes < 0 || numBytes > m_length - m_offset) ) throw Exception("Frame is truncated");
+		}
+
+	private:
+		const char* m_data;
+		int m_length;
+		int m_offset;
+	};
+
+	// Cursor writing big endian fields to a frame buffer, bounds checked like the reader
+	template<bool CheckBounds>
+	class BasicBigEndianWriter
+	{
+	public:
+		BasicBigEndianWriter( char* data, int length, int offset = 0 ) : m_data(data), m_length(length), m_offset(offset)
+		{
+		}
+
+		template<typename T> void Write( T val )
+		{
+			Require(m_offset, sizeof(T));
+			StoreBigEndian<T>(m_data + m_offset, val);
+			m_offset += sizeof(T);
+		}
+
+		// Overwrites a field written earlier (e.g. FRAMESIZE) without moving the cursor
+		template<typename T> void WriteAt( int offset, T val )
+		{
+			Require(offset, sizeof(T));
+			StoreBigEndian<T>(m_data + offset, val);
+		}
+
+		// Fixed length text field - truncated or zero padded to fieldLength
+		void WriteString( const std::string& val, int fieldLength )
+		{
+			WriteString(val.data(), (int)val.length(), fieldLength);
+		}
+
+		void WriteString( const char* val, int valLength, int fieldLength )
+		{
+			Require(m_offset, fieldLength);
+			const int copyLength = valLength < fieldLength ? valLength : fieldLength;
+			memcpy(m_data + m_offset, val, copyLength);
+			memset(m_data + m_offset + copyLength, 0, fieldLength - copyLength);
+			m_offset += fieldLength;
+		}
+
+		void Skip( int numBytes )
+		{
+			Require(m_offset, numBytes);
+			m_offset += numBytes;
+		}
+
+		char* Data() const { return m_data; }
+		int Offset() const { return m_offset; }
+
+	private:
+		void Require( int offset, int numBytes ) const
+		{
+			if( CheckBounds && (numBytes < 0 || offset < 0 || numBytes > m_length - offset) ) throw Exception("Frame buffer is too small");
+		}
+
+	private:
+		char* m_data;
+		int m_length;
+		int m_offset;
+	};
+
+	typedef BasicBigEndianReader<true> BigEndianReader;
+	typedef BasicBigEndianReader<false> UncheckedBigEndianReader;
+	typedef BasicBigEndianWriter<true> BigEndianWriter;
+	typedef BasicBigEndianWriter<false> UncheckedBigEndianWriter;
+}
@@ -0,0 +1,197 @@
+/*
+*  C37118ConfigStorage.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+
+#include "C37118ConfigStorage.h"
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace strongridbase;
+
+// Block size used until the reader tells what to expect
+static const size_t DEFAULT_BLOCK_SIZE = 4096;
+
+// Smallest interning table, in slots
+static const size_t MIN_TABLE_SIZE = 256;
+
+struct C37118ConfigStorage::Block
+{
+	Block* Previous;
+	char* Data;
+	size_t Capacity;
+	size_t Used;
+};
+
+// Kept at the start of the first block
+struct C37118ConfigStorage::Shared
+{
+	std::atomic<int> RefCount;
+	Block* Newest;
+	size_t Capacity;
+};
+
+static size_t AlignUp( size_t val, size_t alignment )
+{
+	return (val + alignment - 1) & ~(alignment - 1);
+}
+
+
+C37118ConfigStorage::C37118ConfigStorage( const C37118ConfigStorage& other ) : m_shared(other.m_shared)
+{
+	if( m_shared ) ++m_shared->RefCount;
+}
+
+C37118ConfigStorage& C37118ConfigStorage::operator=( const C37118ConfigStorage& other )
+{
+	Shared* shared = other.m_shared;
+	if( shared ) ++shared->RefCount;
+	Release();
+	m_shared = shared;
+	return *this;
+}
+
+C37118ConfigStorage::~C37118ConfigStorage()
+{
+	Release();
+}
+
+size_t C37118ConfigStorage::Capacity() const
+{
+	return m_shared ? m_shared->Capacity : 0;
+}
+
+void* C37118ConfigStorage::Allocate( size_t numBytes, size_t alignment, size_t minBlockSize )
+{
+	Block* block = m_shared ? m_shared->Newest : 0;
+	size_t offset = block ? AlignUp(block->Used, alignment) : 0;
+	if( block == 0 || offset + numBytes > block->Capacity )
+	{
+		// Each block is at least as large as the ones before together, so a growing configuration takes few blocks
+		size_t capacity = std::max(numBytes, minBlockSize);
+		if( m_shared ) capacity = std::max(capacity, m_shared->Capacity);
+		const size_t headerSize = AlignUp(sizeof(Block) + (m_shared ? 0 : sizeof(Shared)), alignof(max_align_t));
+		char* mem = (char*)malloc(headerSize + capacity);
+		if( mem == 0 ) throw Exception("Out of memory for the configuration");
+
+		block = (Block*)mem;
+		block->Data = mem + headerSize;
+		block->Capacity = capacity;
+		block->Used = 0;
+		if( m_shared == 0 )
+		{
+			m_shared = new (mem + sizeof(Block)) Shared();
+			m_shared->RefCount = 1;
+			m_shared->Capacity = 0;
+			block->Previous = 0;
+		}
+		else
+			block->Previous = m_shared->Newest;
+		m_shared->Newest = block;
+		m_shared->Capacity += capacity;
+		offset = 0;
+	}
+
+	block->Used = offset + numBytes;
+	return block->Data + offset;
+}
+
+void C37118ConfigStorage::Release()
+{
+	if( m_shared == 0 ) return;
+	if( --m_shared->RefCount == 0 )
+	{
+		// The oldest block, which holds the shared state, is freed last
+		Block* block = m_shared->Newest;
+		while( block != 0 )
+		{
+			Block* previous = block->Previous;
+			free(block);
+			block = previous;
+		}
+	}
+	m_shared = 0;
+}
+
+
+C37118ConfigBuilder::C37118ConfigBuilder( C37118ConfigStorage* storage ) : m_storage(storage)
+{
+	Clear();
+}
+
+void C37118ConfigBuilder::Reserve( size_t numBytes )
+{
+	m_blockSize = numBytes > 0 ? numBytes : DEFAULT_BLOCK_SIZE;
+}
+
+void C37118ConfigBuilder::Clear()
+{
+	m_blockSize = DEFAULT_BLOCK_SIZE;
+	m_table.clear();
+	m_numNames = 0;
+}
+
+C37118Name C37118ConfigBuilder::AddName( const char* text, size_t length )
+{
+	const char* end = (const char*)memchr(text, 0, length);
+	if( end ) length = end - text;
+	if( length == 0 ) return C37118Name();
+
+	// FNV-1a
+	uint32_t hash = 2166136261u;
+	for( size_t i = 0; i < length; ++i )
+		hash = (hash ^ (uint8_t)text[i]) * 16777619u;
+
+	// Empty slots have an empty name - those are never stored
+	if( (m_numNames + 1) * 2 > m_table.size() ) GrowTable();
+	const size_t mask = m_table.size() - 1;
+	for( size_t i = hash & mask; ; i = (i + 1) & mask )
+	{
+		Slot& slot = m_table[i];
+		if( slot.Name.m_length == 0 )
+		{
+			char* copy = (char*)m_storage->Allocate(length + 1, 1, m_blockSize);
+			memcpy(copy, text, length);
+			copy[length] = 0;
+			slot.Hash = hash;
+			slot.Name = C37118Name(copy, (uint32_t)length);
+			++m_numNames;
+			return slot.Name;
+		}
+		if( slot.Hash == hash && slot.Name.m_length == length && memcmp(slot.Name.m_text, text, length) == 0 )
+			return slot.Name;
+	}
+}
+
+void C37118ConfigBuilder::GrowTable()
+{
+	std::vector<Slot> table(std::max(m_table.size() * 2, MIN_TABLE_SIZE));
+	const size_t mask = table.size() - 1;
+	for( std::vector<Slot>::const_iterator iter = m_table.begin(); iter != m_table.end(); ++iter )
+	{
+		if( iter->Name.m_length == 0 ) continue;
+		size_t i = iter->Hash & mask;
+		while( table[i].Name.m_length != 0 ) i = (i + 1) & mask;
+		table[i] = *iter;
+	}
+	m_table.swap(table);
+}
@@ -0,0 +1,138 @@
+/*
+*  C37118ConfigStorage.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include "common.h"
+
+namespace strongridbase
+{
+	// Memory of a parsed configuration: the PMU records, their channel arrays and the channel names are placed in a
+	// few large blocks instead of one allocation each, and freed together. Copies of a configuration share the
+	// blocks (reference counted) - the content is immutable once the configuration has been read.
+	class C37118ConfigStorage
+	{
+	public:
+		C37118ConfigStorage() : m_shared(0) {}
+		C37118ConfigStorage( const C37118ConfigStorage& other );
+		C37118ConfigStorage& operator=( const C37118ConfigStorage& other );
+		~C37118ConfigStorage();
+
+		size_t Capacity() const; // bytes held by the blocks
+
+	private:
+		friend class C37118ConfigBuilder;
+		struct Block;
+		struct Shared;
+
+		void* Allocate( size_t numBytes, size_t alignment, size_t minBlockSize );
+		void Release();
+
+	private:
+		Shared* m_shared; // 0 while empty
+	};
+
+	// Immutable array in the storage of a configuration
+	template<typename T>
+	class C37118Array
+	{
+	public:
+		typedef const T* const_iterator;
+
+		C37118Array() : m_data(0), m_size(0) {}
+		C37118Array( const T* data, size_t size ) : m_data(data), m_size(size) {}
+
+		size_t size() const { return m_size; }
+		bool empty() const { return m_size == 0; }
+		const T& operator[]( size_t idx ) const { return m_data[idx]; }
+		const T* data() const { return m_data; }
+		const_iterator begin() const { return m_data; }
+		const_iterator end() const { return m_data + m_size; }
+
+	private:
+		const T* m_data;
+		size_t m_size;
+	};
+
+	// Station or channel name in the storage of a configuration, zero terminated. Equal names of a configuration
+	// share their text.
+	class C37118Name
+	{
+	public:
+		C37118Name() : m_text(""), m_length(0) {}
+
+		const char* c_str() const { return m_text; }
+		size_t length() const { return m_length; }
+		bool empty() const { return m_length == 0; }
+
+	private:
+		friend class C37118ConfigBuilder;
+		C37118Name( const char* text, uint32_t length ) : m_text(text), m_length(length) {}
+
+		const char* m_text;
+		uint32_t m_length;
+	};
+
+	// Fills a configuration storage while a configuration is read (or put together to be written)
+	class C37118ConfigBuilder
+	{
+	public:
+		explicit C37118ConfigBuilder( C37118ConfigStorage* storage );
+
+		void Reserve( size_t numBytes ); // expected size of what follows - ideally all of it lands in one block
+		void Clear(); // forget the names added so far, e.g. when the storage is replaced
+
+		// Default constructed elements, to be filled before the array is handed out
+		template<typename T> T* NewArray( size_t count )
+		{
+			static_assert(std::is_trivially_destructible<T>::value, "Storage is freed without running destructors");
+			T* items = (T*)m_storage->Allocate(count * sizeof(T), alignof(T), m_blockSize);
+			for( size_t i = 0; i < count; ++i ) new (items + i) T();
+			return items;
+		}
+
+		// Text of at most 'length' bytes, ending at the first zero byte if any (fixed length name fields)
+		C37118Name AddName( const char* text, size_t length );
+		C37118Name AddName( const std::string& text ) { return AddName(text.c_str(), text.length()); }
+
+	private:
+		struct Slot
+		{
+			uint32_t Hash;
+			C37118Name Name;
+		};
+		void GrowTable();
+
+	private:
+		C37118ConfigStorage* m_storage;
+		size_t m_blockSize;
+		std::vector<Slot> m_table; // interned names, open addressing
+		size_t m_numNames;
+	};
+}
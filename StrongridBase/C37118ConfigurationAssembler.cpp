@@ -0,0 +1,193 @@
+/*
+*  C37118ConfigurationAssembler.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+
+#include "common.h"
+#include "C37118Protocol.h"
+#include <algorithm>
+
+using namespace strongridbase;
+
+// Bytes moved at a time into a PMU record split between frames, as long as its size is unknown
+static const int PENDING_STEP_SIZE = 256;
+
+// SYNC, FRAMESIZE, IDCODE, SOC, FRACSEC, CONT_IDX / CHK
+static const int CFG3_PAYLOAD_OFFSET = 16;
+static const int CFG3_FOOTER_SIZE = 2;
+
+
+C37118ConfigurationAssembler_Ver3::C37118ConfigurationAssembler_Ver3() : m_builder(&m_config.Storage)
+{
+	Reset();
+}
+
+void C37118ConfigurationAssembler_Ver3::Reset()
+{
+	m_config = C37118PdcConfiguration_Ver3();
+	m_builder.Clear();
+	m_pmus = 0;
+	m_stage = ParseStage::TimeBaseAndNumPmu;
+	std::vector<C37118PmuConfiguration_Ver3>().swap(m_continuedPmus);
+	m_numPmu = 0;
+	m_numPmuRead = 0;
+	m_lastFrame = false;
+	m_nextFrameIndex = -1;
+	m_pending.clear();
+}
+
+bool C37118ConfigurationAssembler_Ver3::AddFrame(const char* frame, int length, C37118PdcConfiguration_Ver3* completed)
+{
+	BigEndianReader in(frame, length);
+	C37118FrameHeader header = C37118Protocol::ReadFrameHeader(in);
+	if( header.Sync.FrameType != CONFIGURATION_FRAME_3 ) throw Exception("Not a configuration frame 3");
+	if( header.FrameSize < CFG3_PAYLOAD_OFFSET + CFG3_FOOTER_SIZE ) throw Exception("Configuration frame 3 is truncated");
+	C37118ContIdx contIdx = C37118ContIdx::CreateByC37118Raw(in.Read<uint16_t>());
+
+	// CONT_IDX 0 (only frame) or 1 starts a configuration, the following ones count up to the last (0xFFFF)
+	const int frameIndex = contIdx.GetCurrentFrameIndex();
+	if( frameIndex == 0 ) {
+		Reset();
+		m_config.HeaderCommon = header;
+		m_config.ContinuationIndex = contIdx;
+
+		// The parsed configuration takes about twice the bytes of the frames - further frames add larger blocks
+		m_builder.Reserve(3 * (size_t)header.FrameSize);
+	}
+	else if( m_nextFrameIndex < 0 || (frameIndex != m_nextFrameIndex && contIdx.GetRawC37118Value() != 0xFFFF) ) {
+		Reset();
+		return false;
+	}
+
+	const char* data = frame + CFG3_PAYLOAD_OFFSET;
+	const char* end = frame + header.FrameSize - CFG3_FOOTER_SIZE;
+	m_lastFrame = contIdx.IsLastFrame();
+	try
+	{
+		// Finish the item the previous frame ended in the middle of
+		while( !m_pending.empty() && data < end )
+		{
+			int size = NextItemSize(m_pending.data(), (int)m_pending.size());
+			int take = size > 0 ? size - (int)m_pending.size() : PENDING_STEP_SIZE;
+			take = std::min(take, (int)(end - data));
+			m_pending.insert(m_pending.end(), data, data + take);
+			data += take;
+
+			size = NextItemSize(m_pending.data(), (int)m_pending.size());
+			if( size > 0 && size <= (int)m_pending.size() ) {
+				data -= (int)m_pending.size() - size; // hand back what a step took beyond the item
+				ReadItem(m_pending.data(), size, (int)(end - data));
+				m_pending.clear();
+			}
+		}
+
+		// Items entirely inside this frame are read in place
+		if( m_pending.empty() ) {
+			while( data < end ) {
+				const int size = NextItemSize(data, (int)(end - data));
+				if( size == 0 || size > end - data ) break;
+				ReadItem(data, size, (int)(end - data - size));
+				data += size;
+			}
+			m_pending.assign(data, end);
+		}
+	}
+	catch( ... )
+	{
+		Reset();
+		throw;
+	}
+
+	if( !contIdx.IsLastFrame() ) {
+		m_nextFrameIndex = frameIndex + 1;
+		return false;
+	}
+
+	const bool isComplete = m_stage == ParseStage::Complete && m_pending.empty();
+	m_config.FooterCrc16 = LoadBigEndian<uint16_t>(end);
+	if( isComplete ) std::swap(*completed, m_config);
+	Reset();
+	if( !isComplete ) throw Exception("Configuration frame 3 does not hold the entire configuration");
+	return true;
+}
+
+int C37118ConfigurationAssembler_Ver3::NextItemSize(const char* data, int length) const
+{
+	switch( m_stage )
+	{
+	case ParseStage::TimeBaseAndNumPmu: return 4 + 2;
+	case ParseStage::PmuRecord: return C37118Protocol::PmuConfigurationSize_Ver3(data, length);
+	case ParseStage::DataRate: return 2;
+	default: throw Exception("Configuration frame 3 has data after DATA_RATE");
+	}
+}
+
+void C37118ConfigurationAssembler_Ver3::ReadItem(const char* data, int size, int bytesAfter)
+{
+	BigEndianReader in(data, size);
+	switch( m_stage )
+	{
+	case ParseStage::TimeBaseAndNumPmu:
+		// Read TIME_BASE / NUM_PMU
+		m_config.TimeBase = C37118Protocol::ReadTimeBaseField(in);
+		m_numPmu = in.Read<uint16_t>();
+
+		// NUM_PMU comes off the wire: the PMUs are only allocated up front when the rest of this frame can hold
+		// their records and DATA_RATE. Those of a continued configuration are collected as they arrive instead.
+		if( m_lastFrame ) {
+			if( (int64_t)m_numPmu * C37118Protocol::MIN_PMU_CONFIGURATION_SIZE_VER3 + 2 > bytesAfter )
+				throw Exception("Configuration frame 3 is truncated");
+			m_pmus = m_builder.NewArray<C37118PmuConfiguration_Ver3>(m_numPmu);
+			m_config.PMUs = C37118Array<C37118PmuConfiguration_Ver3>(m_pmus, m_numPmu);
+		}
+		m_stage = m_numPmu > 0 ? ParseStage::PmuRecord : ParseStage::DataRate;
+		break;
+
+	case ParseStage::PmuRecord:
+		if( m_pmus != 0 ) {
+			C37118Protocol::ReadPmuConfiguration_Ver3(in, m_builder, &m_pmus[m_numPmuRead]);
+		}
+		else {
+			m_continuedPmus.push_back(C37118PmuConfiguration_Ver3());
+			C37118Protocol::ReadPmuConfiguration_Ver3(in, m_builder, &m_continuedPmus.back());
+		}
+		if( ++m_numPmuRead == m_numPmu ) {
+			if( m_pmus == 0 ) {
+				// All records are in - move them to the storage in one array
+				m_pmus = m_builder.NewArray<C37118PmuConfiguration_Ver3>(m_numPmu);
+				std::copy(m_continuedPmus.begin(), m_continuedPmus.end(), m_pmus);
+				m_config.PMUs = C37118Array<C37118PmuConfiguration_Ver3>(m_pmus, m_numPmu);
+				std::vector<C37118PmuConfiguration_Ver3>().swap(m_continuedPmus);
+			}
+			m_stage = ParseStage::DataRate;
+		}
+		break;
+
+	case ParseStage::DataRate:
+		// Read DATA_RATE
+		m_config.DataRate = C37118DataRate::CreateByRawC37118Format(in.Read<int16_t>());
+		m_stage = ParseStage::Complete;
+		break;
+
+	default:
+		break;
+	}
+}
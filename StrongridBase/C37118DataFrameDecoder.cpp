@@ -0,0 +1,361 @@
+/*
+*  C37118DataFrameDecoder.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include "common.h"
+#include "C37118Protocol.h"
+#include "SimdKernels.h"
+
+using namespace strongridbase;
+
+
+// ------------------------------------------------------------------------------------------------------------------------
+// PMU block kernels - one instantiation per combination of the four FORMAT bits
+// ------------------------------------------------------------------------------------------------------------------------
+
+
+// Blocks shorter than one AVX2 vector are converted in the kernel: for them the call into SimdKernels costs more
+// than the conversion. The result is the same either way.
+static const int MIN_SIMD_COUNT = 8;
+
+template<typename A, typename B>
+static inline void DecodePairs(const char* src, int numPairs, float* outA, float* outB)
+{
+	for( int i = 0; i < numPairs; ++i )
+	{
+		outA[i] = (float)LoadBigEndian<A>(src + i*(sizeof(A) + sizeof(B)));
+		outB[i] = (float)LoadBigEndian<B>(src + i*(sizeof(A) + sizeof(B)) + sizeof(A));
+	}
+}
+
+template<typename T, typename Out>
+static inline void DecodeValues(const char* src, int count, Out* out)
+{
+	for( int i = 0; i < count; ++i )
+		out[i] = (Out)LoadBigEndian<T>(src + i*sizeof(T));
+}
+
+template<bool PhasorIsPolar, bool PhasorIsFloat, bool AnalogIsFloat, bool FreqIsFloat>
+static void DecodePmuBlock(const char* src, const C37118PmuDecodeBlock& block, C37118PdcFlatDataFrame* outFrame)
+{
+	// The frame size has been checked against the configuration before the plan runs
+	UncheckedBigEndianReader in(src, block.ByteLength);
+
+	// Read STAT
+	outFrame->Stat[block.PmuIndex] = C37118PmuDataFrameStat(in.Read<uint16_t>());
+
+	// Read PHASORS - the block is swapped/widened in bulk, polar values are then converted in place
+	float* real = outFrame->PhasorReal.data() + block.PhasorOutOffset;
+	float* imag = outFrame->PhasorImag.data() + block.PhasorOutOffset;
+	if( block.NumPhasors < MIN_SIMD_COUNT ) {
+		if( PhasorIsFloat ) DecodePairs<float, float>(src + in.Offset(), block.NumPhasors, real, imag);
+		else if( PhasorIsPolar ) DecodePairs<uint16_t, int16_t>(src + in.Offset(), block.NumPhasors, real, imag);
+		else DecodePairs<int16_t, int16_t>(src + in.Offset(), block.NumPhasors, real, imag);
+	}
+	else if( PhasorIsFloat )
+		SimdKernels::DecodeFloatPairs(src + in.Offset(), block.NumPhasors, real, imag);
+	else if( PhasorIsPolar )
+		SimdKernels::DecodeUInt16Int16Pairs(src + in.Offset(), block.NumPhasors, real, imag);
+	else
+		SimdKernels::DecodeInt16Pairs(src + in.Offset(), block.NumPhasors, real, imag);
+	in.Skip(block.NumPhasors * (PhasorIsFloat ? 8 : 4));
+
+	if( PhasorIsPolar )
+	{
+		// Integer angles are in 10^-4 radians
+		if( !PhasorIsFloat )
+			for( int i = 0; i < block.NumPhasors; ++i )
+				imag[i] *= 1.0e-4f;
+
+		// Short blocks are left to the batch of the whole frame (PolarBatchIndices)
+		if( !block.KeepPolar && block.NumPhasors >= MIN_SIMD_COUNT )
+			SimdKernels::PolarToRect(real, imag, block.NumPhasors);
+	}
+
+	// Read FREQ / DFREQ
+	if( FreqIsFloat ) {
+		outFrame->Frequency[block.PmuIndex] = in.Read<float>();
+		outFrame->DeltaFrequency[block.PmuIndex] = in.Read<float>();
+	}
+	else {
+		outFrame->Frequency[block.PmuIndex] = in.Read<int16_t>();
+		outFrame->DeltaFrequency[block.PmuIndex] = (float)in.Read<int16_t>() / 100.0f;
+	}
+
+	// Read ANALOG
+	float* analog = outFrame->AnalogValues.data() + block.AnalogOutOffset;
+	if( block.NumAnalogs < MIN_SIMD_COUNT ) {
+		if( AnalogIsFloat ) DecodeValues<float>(src + in.Offset(), block.NumAnalogs, analog);
+		else DecodeValues<int16_t>(src + in.Offset(), block.NumAnalogs, analog);
+	}
+	else if( AnalogIsFloat )
+		SimdKernels::DecodeFloats(src + in.Offset(), block.NumAnalogs, analog);
+	else
+		SimdKernels::DecodeInt16s(src + in.Offset(), block.NumAnalogs, analog);
+	in.Skip(block.NumAnalogs * (AnalogIsFloat ? 4 : 2));
+
+	// Read DIGITAL - kept as packed words
+	uint16_t* digWords = outFrame->DigitalWords.data() + block.DigitalOutOffset;
+	if( block.NumDigWords < MIN_SIMD_COUNT )
+		DecodeValues<uint16_t>(src + in.Offset(), block.NumDigWords, digWords);
+	else
+		SimdKernels::DecodeUInt16s(src + in.Offset(), block.NumDigWords, digWords);
+}
+
+// Kernel table, indexed by the FORMAT field: bit0 = polar, bit1 = float phasor, bit2 = float analog, bit3 = float freq
+static const C37118PmuDecodeBlock::DecodeKernel s_decodeKernels[16] =
+{
+	DecodePmuBlock<false, false, false, false>, DecodePmuBlock<true, false, false, false>,
+	DecodePmuBlock<false, true,  false, false>, DecodePmuBlock<true, true,  false, false>,
+	DecodePmuBlock<false, false, true,  false>, DecodePmuBlock<true, false, true,  false>,
+	DecodePmuBlock<false, true,  true,  false>, DecodePmuBlock<true, true,  true,  false>,
+	DecodePmuBlock<false, false, false, true >, DecodePmuBlock<true, false, false, true >,
+	DecodePmuBlock<false, true,  false, true >, DecodePmuBlock<true, true,  false, true >,
+	DecodePmuBlock<false, false, true,  true >, DecodePmuBlock<true, false, true,  true >,
+	DecodePmuBlock<false, true,  true,  true >, DecodePmuBlock<true, true,  true,  true >
+};
+
+
+// ------------------------------------------------------------------------------------------------------------------------
+// Plan compilation
+// ------------------------------------------------------------------------------------------------------------------------
+
+
+void C37118Protocol::BuildDecodePlan(C37118PdcDataDecodeInfo* decodeInfo)
+{
+	decodeInfo->DecodePlan.clear();
+	decodeInfo->PolarBatchIndices.clear();
+	uint64_t layoutHash = 14695981039346656037ULL; // FNV-1a
+
+	int byteOffset = 14; // SYNC + FRAMESIZE + IDCODE + SOC + FRACSEC
+	int phasorOffset = 0, analogOffset = 0, digitalOffset = 0;
+	for( int iPmu = 0; iPmu < (int)decodeInfo->PMUs.size(); ++iPmu )
+	{
+		const C37118PmuDataDecodeInfo& pmu = decodeInfo->PMUs[iPmu];
+		const C37118PmuFormat& fmt = pmu.DataFormat;
+
+		C37118PmuDecodeBlock block;
+		block.PmuIndex = iPmu;
+		block.ByteOffset = byteOffset;
+		block.NumPhasors = pmu.numPhasors;
+		block.NumAnalogs = pmu.numAnalogs;
+		block.NumDigWords = DigitalWordCount(pmu.numDigitals);
+		block.PhasorOutOffset = phasorOffset;
+		block.AnalogOutOffset = analogOffset;
+		block.DigitalOutOffset = digitalOffset;
+		block.KeepPolar = fmt.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle && decodeInfo->KeepPolarPhasors;
+		block.Kernel = s_decodeKernels[
+			(fmt.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle ? 1 : 0) |
+			(fmt.Bit1_0xPhasorsIsInt_1xPhasorFloat ? 2 : 0) |
+			(fmt.Bit2_0xAnalogIsInt_1xAnalogIsFloat ? 4 : 0) |
+			(fmt.Bit3_0xFreqIsInt_1xFreqIsFloat ? 8 : 0) ];
+
+		// STAT + PHASORS + FREQ/DFREQ + ANALOG + DIGITAL
+		block.ByteLength = 2
+			+ block.NumPhasors * (fmt.Bit1_0xPhasorsIsInt_1xPhasorFloat ? 8 : 4)
+			+ (fmt.Bit3_0xFreqIsInt_1xFreqIsFloat ? 8 : 4)
+			+ block.NumAnalogs * (fmt.Bit2_0xAnalogIsInt_1xAnalogIsFloat ? 4 : 2)
+			+ block.NumDigWords * 2;
+
+		decodeInfo->DecodePlan.push_back(block);
+
+		if( fmt.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle && !block.KeepPolar && block.NumPhasors < MIN_SIMD_COUNT )
+			for( int i = 0; i < block.NumPhasors; ++i )
+				decodeInfo->PolarBatchIndices.push_back(phasorOffset + i);
+
+		const uint64_t layout[4] = { (uint64_t)pmu.numPhasors, (uint64_t)pmu.numAnalogs, (uint64_t)pmu.numDigitals, block.KeepPolar ? 1ULL : 0ULL };
+		for( int i = 0; i < 4; ++i )
+			layoutHash = (layoutHash ^ layout[i]) * 1099511628211ULL;
+
+		byteOffset += block.ByteLength;
+		phasorOffset += block.NumPhasors;
+		analogOffset += block.NumAnalogs;
+		digitalOffset += block.NumDigWords;
+	}
+
+	decodeInfo->DataFrameSize = byteOffset + 2; // CRC16
+	decodeInfo->DecodeLayoutHash = layoutHash;
+	BuildProjectionPlan(decodeInfo);
+}
+
+void C37118Protocol::BuildProjectionPlan(C37118PdcDataDecodeInfo* decodeInfo)
+{
+	decodeInfo->ProjectionPlan.clear();
+	decodeInfo->ProjectionPolarIndices.clear();
+
+	int outIndex = 0;
+	for( std::vector<C37118ChannelSelector>::const_iterator iter = decodeInfo->Projection.begin(); iter != decodeInfo->Projection.end(); ++iter )
+	{
+		if( iter->PmuIndex < 0 || iter->PmuIndex >= (int)decodeInfo->PMUs.size() ) throw Exception("Projection: invalid PMU index");
+		const C37118PmuDecodeBlock& block = decodeInfo->DecodePlan[iter->PmuIndex];
+		const C37118PmuFormat& fmt = decodeInfo->PMUs[iter->PmuIndex].DataFormat;
+		const bool phasorIsFloat = fmt.Bit1_0xPhasorsIsInt_1xPhasorFloat;
+		const bool freqIsFloat = fmt.Bit3_0xFreqIsInt_1xFreqIsFloat;
+		const bool analogIsFloat = fmt.Bit2_0xAnalogIsInt_1xAnalogIsFloat;
+
+		// Field offsets within the PMU block: STAT, PHASORS, FREQ, DFREQ, ANALOG, DIGITAL
+		const int phasorStart = block.ByteOffset + 2;
+		const int freqStart = phasorStart + block.NumPhasors * (phasorIsFloat ? 8 : 4);
+		const int analogStart = freqStart + (freqIsFloat ? 8 : 4);
+		const int digitalStart = analogStart + block.NumAnalogs * (analogIsFloat ? 4 : 2);
+
+		C37118ProjectionStep step;
+		step.OutIndex = outIndex;
+		step.BitMask = 0;
+		switch( iter->Kind )
+		{
+		case CHANNEL_PHASOR:
+			if( iter->ChannelIndex < 0 || iter->ChannelIndex >= block.NumPhasors ) throw Exception("Projection: invalid phasor index");
+			step.ByteOffset = phasorStart + iter->ChannelIndex * (phasorIsFloat ? 8 : 4);
+			if( phasorIsFloat ) step.Op = C37118ProjectionStep::FLOAT_PAIR;
+			else if( fmt.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle ) step.Op = C37118ProjectionStep::UINT16_INT16_PAIR;
+			else step.Op = C37118ProjectionStep::INT16_PAIR;
+			if( fmt.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle && !block.KeepPolar ) decodeInfo->ProjectionPolarIndices.push_back(outIndex);
+			outIndex += 2;
+			break;
+
+		case CHANNEL_ANALOG:
+			if( iter->ChannelIndex < 0 || iter->ChannelIndex >= block.NumAnalogs ) throw Exception("Projection: invalid analog index");
+			step.ByteOffset = analogStart + iter->ChannelIndex * (analogIsFloat ? 4 : 2);
+			step.Op = analogIsFloat ? C37118ProjectionStep::FLOAT : C37118ProjectionStep::INT16;
+			outIndex += 1;
+			break;
+
+		case CHANNEL_DIGITAL:
+			if( iter->ChannelIndex < 0 || iter->ChannelIndex >= decodeInfo->PMUs[iter->PmuIndex].numDigitals ) throw Exception("Projection: invalid digital index");
+			step.ByteOffset = digitalStart + (iter->ChannelIndex / 16) * 2;
+			step.Op = C37118ProjectionStep::DIGITAL_BIT;
+			step.BitMask = (uint16_t)(1 << (iter->ChannelIndex % 16));
+			outIndex += 1;
+			break;
+
+		case CHANNEL_FREQUENCY:
+			step.ByteOffset = freqStart;
+			step.Op = freqIsFloat ? C37118ProjectionStep::FLOAT : C37118ProjectionStep::INT16;
+			outIndex += 1;
+			break;
+
+		case CHANNEL_DELTA_FREQUENCY:
+			step.ByteOffset = freqStart + (freqIsFloat ? 4 : 2);
+			step.Op = freqIsFloat ? C37118ProjectionStep::FLOAT : C37118ProjectionStep::INT16_DIV100;
+			outIndex += 1;
+			break;
+
+		case CHANNEL_STAT:
+			step.ByteOffset = block.ByteOffset;
+			step.Op = C37118ProjectionStep::UINT16;
+			outIndex += 1;
+			break;
+
+		default:
+			throw Exception("Projection: invalid channel kind");
+		}
+		decodeInfo->ProjectionPlan.push_back(step);
+	}
+
+	decodeInfo->NumProjectedValues = outIndex;
+}
+
+bool C37118Protocol::DataFrameMatchesConfig(const char* data, int length, const C37118PdcDataDecodeInfo* config)
+{
+	// Dataframes do not carry CFGCNT - a PDC flags a configuration change in the STAT word of every PMU instead
+	if( length < config->DataFrameSize || LoadBigEndian<uint16_t>(data + 2) != config->DataFrameSize ) return false;
+	for( std::vector<C37118PmuDecodeBlock>::const_iterator block = config->DecodePlan.begin(); block != config->DecodePlan.end(); ++block )
+	{
+		if( C37118PmuDataFrameStat(LoadBigEndian<uint16_t>(data + block->ByteOffset)).getConfigChangeFlag() ) return false;
+	}
+	return true;
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------
+// Projected decoding - only the bytes of the selected channels are read
+// ------------------------------------------------------------------------------------------------------------------------
+
+
+void C37118Protocol::ReadProjectedDataFrame(char* data, int length, const C37118PdcDataDecodeInfo* config, C37118PdcProjectedDataFrame* outFrame, int* offset)
+{
+	if( (int)outFrame->Values.size() != config->NumProjectedValues || outFrame->PolarMag.size() != config->ProjectionPolarIndices.size() )
+		throw Exception("Dataframe storage does not match config");
+
+	// Read header
+	const int offsetAtStart = *offset;
+	outFrame->HeaderCommon = ReadFrameHeader(data, length, offset);
+	if( outFrame->HeaderCommon.FrameSize != config->DataFrameSize || length < config->DataFrameSize )
+		throw Exception("Dataframe size does not match config");
+
+	const char* frame = data + offsetAtStart;
+	float* values = outFrame->Values.data();
+	for( std::vector<C37118ProjectionStep>::const_iterator step = config->ProjectionPlan.begin(); step != config->ProjectionPlan.end(); ++step )
+	{
+		UncheckedBigEndianReader in(frame, config->DataFrameSize, step->ByteOffset);
+		float* out = values + step->OutIndex;
+		switch( step->Op )
+		{
+		case C37118ProjectionStep::FLOAT_PAIR:
+			out[0] = in.Read<float>();
+			out[1] = in.Read<float>();
+			break;
+		case C37118ProjectionStep::INT16_PAIR:
+			out[0] = in.Read<int16_t>();
+			out[1] = in.Read<int16_t>();
+			break;
+		case C37118ProjectionStep::UINT16_INT16_PAIR:
+			out[0] = in.Read<uint16_t>();
+			out[1] = in.Read<int16_t>() * 1.0e-4f;
+			break;
+		case C37118ProjectionStep::FLOAT:
+			out[0] = in.Read<float>();
+			break;
+		case C37118ProjectionStep::INT16:
+			out[0] = in.Read<int16_t>();
+			break;
+		case C37118ProjectionStep::INT16_DIV100:
+			out[0] = (float)in.Read<int16_t>() / 100.0f;
+			break;
+		case C37118ProjectionStep::UINT16:
+			out[0] = in.Read<uint16_t>();
+			break;
+		case C37118ProjectionStep::DIGITAL_BIT:
+			out[0] = (in.Read<uint16_t>() & step->BitMask) ? 1.0f : 0.0f;
+			break;
+		}
+	}
+
+	// Polar phasors are gathered and converted in one batch
+	const int numPolar = config->ProjectionPolarIndices.size();
+	if( numPolar > 0 )
+	{
+		for( int i = 0; i < numPolar; ++i ) {
+			outFrame->PolarMag[i] = values[config->ProjectionPolarIndices[i]];
+			outFrame->PolarAngle[i] = values[config->ProjectionPolarIndices[i] + 1];
+		}
+		SimdKernels::PolarToRect(outFrame->PolarMag.data(), outFrame->PolarAngle.data(), numPolar);
+		for( int i = 0; i < numPolar; ++i ) {
+			values[config->ProjectionPolarIndices[i]] = outFrame->PolarMag[i];
+			values[config->ProjectionPolarIndices[i] + 1] = outFrame->PolarAngle[i];
+		}
+	}
+
+	// Read crc16 information
+	outFrame->CRC16 = LoadBigEndian<uint16_t>(frame + config->DataFrameSize - 2);
+	*offset = offsetAtStart + config->DataFrameSize;
+}
@@ -23,7 +23,6 @@
 #include <bitset>
 #include "common.h"
 #include "C37118Protocol.h"
-#include "EncDec.h"
 
 
 using namespace strongridbase;
@@ -355,60 +354,138 @@ int16_t C37118PmuDataFrameAnalog::getValueAsInt16() const
 
 
 // ------------------------------------------------------------------------------------------------------------------------
-// C37118PmuDataFrameDigital
+// Digital channels
 // ------------------------------------------------------------------------------------------------------------------------
 
 
-C37118PmuDataFrameDigitalHelper C37118PmuDataFrameDigitalHelper::CreateByBoolArray(std::vector<bool> digBits)
+void strongridbase::ExpandDigitalBits( const uint16_t* words, int numDigitals, uint8_t* out )
 {
-	C37118PmuDataFrameDigitalHelper helper;
-	for( std::vector<bool>::const_iterator iter = digBits.begin(); iter != digBits.end(); ++iter )
-		helper.m_digValues.push_back(*iter);
-	return helper;
+	// A word at a time - channels come in whole words
+	for( int i = 0; i + 16 <= numDigitals; i += 16 )
+	{
+		uint16_t word = words[i >> 4];
+		for( int bit = 0; bit < 16; ++bit ) out[i + bit] = (uint8_t)((word >> bit) & 0x1);
+	}
+	for( int i = numDigitals & ~15; i < numDigitals; ++i ) out[i] = DigitalBit(words, i) ? 1 : 0;
 }
 
-C37118PmuDataFrameDigitalHelper C37118PmuDataFrameDigitalHelper::CreateByUint16Arr(std::vector<uint16_t> digWordArray)
-{
-	C37118PmuDataFrameDigitalHelper helper;
-	for( std::vector<uint16_t>::const_iterator iter = digWordArray.begin(); iter != digWordArray.end(); ++iter )
-		helper.PushDigWord(*iter);
-	return helper;
-}
 
-void C37118PmuDataFrameDigitalHelper::PushDigWord(uint16_t word)
-{
-	for( int i = 0; i < 16; ++i )
-		m_digValues.push_back( (word & (0x1 << i)) >> i );
-}
+// ------------------------------------------------------------------------------------------------------------------------
+// C37118PdcFlatDataFrame
+// ------------------------------------------------------------------------------------------------------------------------
 
-void C37118PmuDataFrameDigitalHelper::PushDigValue( bool bit )
+
+C37118PdcFlatDataFrame C37118PdcFlatDataFrame::CreateByDecodeInfo(const C37118PdcDataDecodeInfo& config)
 {
-	m_digValues.push_back(bit);
+	C37118PdcFlatDataFrame frame;
+	const int numPmus = config.PMUs.size();
+
+	frame.Stat.resize(numPmus);
+	frame.Frequency.resize(numPmus);
+	frame.DeltaFrequency.resize(numPmus);
+	frame.NumDigitalValues.resize(numPmus);
+	frame.PhasorIsPolar.resize(numPmus);
+	frame.PhasorOffset.resize(numPmus + 1);
+	frame.AnalogOffset.resize(numPmus + 1);
+	frame.DigitalWordOffset.resize(numPmus + 1);
+
+	// Lay out the PMUs back-to-back in the value arrays
+	frame.PhasorOffset[0] = frame.AnalogOffset[0] = frame.DigitalWordOffset[0] = 0;
+	for( int iPmu = 0; iPmu < numPmus; ++iPmu )
+	{
+		const C37118PmuDataDecodeInfo& pmu = config.PMUs[iPmu];
+		frame.NumDigitalValues[iPmu] = pmu.numDigitals;
+		frame.PhasorIsPolar[iPmu] = (config.KeepPolarPhasors && pmu.DataFormat.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle) ? 1 : 0;
+		frame.PhasorOffset[iPmu+1] = frame.PhasorOffset[iPmu] + pmu.numPhasors;
+		frame.AnalogOffset[iPmu+1] = frame.AnalogOffset[iPmu] + pmu.numAnalogs;
+		frame.DigitalWordOffset[iPmu+1] = frame.DigitalWordOffset[iPmu] + DigitalWordCount(pmu.numDigitals);
+	}
+
+	frame.PhasorReal.resize(frame.PhasorOffset[numPmus]);
+	frame.PhasorImag.resize(frame.PhasorOffset[numPmus]);
+	frame.AnalogValues.resize(frame.AnalogOffset[numPmus]);
+	frame.DigitalWords.resize(frame.DigitalWordOffset[numPmus]);
+	frame.PolarMag.resize(config.PolarBatchIndices.size());
+	frame.PolarAngle.resize(config.PolarBatchIndices.size());
+	frame.DecodeLayoutHash = config.DecodeLayoutHash;
+	frame.CRC16 = 0;
+	frame.Timestamps = C37118FrameTimestamps();
+
+	return frame;
 }
 
-std::vector<bool> C37118PmuDataFrameDigitalHelper::ToBoolArray() const
+bool C37118PdcFlatDataFrame::MatchesDecodeInfo(const C37118PdcDataDecodeInfo& config) const
 {
-	return m_digValues;
+	if( config.PMUs.size() != Stat.size() || PhasorOffset.size() != Stat.size() + 1 ) return false;
+
+	// With a compiled plan the layout hash stands in for the per PMU comparison - it runs for every frame. The
+	// totals bound every offset of the plan, so even a hash collision cannot write past the value arrays.
+	if( !config.DecodePlan.empty() && config.DecodePlan.size() == config.PMUs.size() )
+	{
+		const C37118PmuDecodeBlock& last = config.DecodePlan.back();
+		return DecodeLayoutHash == config.DecodeLayoutHash
+			&& (int)PhasorReal.size() == last.PhasorOutOffset + last.NumPhasors
+			&& (int)AnalogValues.size() == last.AnalogOutOffset + last.NumAnalogs
+			&& (int)DigitalWords.size() == last.DigitalOutOffset + last.NumDigWords
+			&& PolarMag.size() == config.PolarBatchIndices.size();
+	}
+
+	for( int iPmu = 0; iPmu < NumPmus(); ++iPmu )
+	{
+		const C37118PmuDataDecodeInfo& pmu = config.PMUs[iPmu];
+		if( NumPhasors(iPmu) != pmu.numPhasors || NumAnalogs(iPmu) != pmu.numAnalogs || NumDigitals(iPmu) != pmu.numDigitals )
+			return false;
+		if( (PhasorIsPolar[iPmu] != 0) != (config.KeepPolarPhasors && pmu.DataFormat.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle) )
+			return false;
+	}
+	return true;
 }
 
-std::vector<uint16_t> C37118PmuDataFrameDigitalHelper::ToDigWord() const
+C37118PdcDataFrame C37118PdcFlatDataFrame::ToPdcDataFrame() const
 {
-	std::vector<uint16_t> output;
+	C37118PdcDataFrame output;
+	output.HeaderCommon = HeaderCommon;
+	output.CRC16 = CRC16;
 
-	int counter = 0;
-	while( counter < m_digValues.size() )
+	for( int iPmu = 0; iPmu < NumPmus(); ++iPmu )
 	{
-		uint16_t digword = 0;
+		C37118PmuDataFrame pmu;
+		pmu.Stat = Stat[iPmu];
+		pmu.Frequency = Frequency[iPmu];
+		pmu.DeltaFrequency = DeltaFrequency[iPmu];
 
-		// Travese in blocks of 16 bits - set bits which correlate to a "true" value in the dig value array
-		for( int i = 0; i < 16 && counter < m_digValues.size(); ++i, ++counter )
+		for( int i = PhasorOffset[iPmu]; i < PhasorOffset[iPmu+1]; ++i )
 		{
-			digword |= ((m_digValues[counter] & 0x1) << i);
+			if( PhasorIsPolar[iPmu] )
+				pmu.PhasorValues.push_back(C37118PmuDataFramePhasorRealImag::CreateByPolarMag(PhasorReal[i], PhasorImag[i]));
+			else
+				pmu.PhasorValues.push_back(C37118PmuDataFramePhasorRealImag::CreateByRealImag(PhasorReal[i], PhasorImag[i]));
 		}
 
-		// Add word to output
-		output.push_back(digword);
+		for( int i = AnalogOffset[iPmu]; i < AnalogOffset[iPmu+1]; ++i )
+			pmu.AnalogValues.push_back(C37118PmuDataFrameAnalog::CreateByFloat(AnalogValues[i]));
+
+		pmu.DigitalWords.assign(DigitalWords.begin() + DigitalWordOffset[iPmu], DigitalWords.begin() + DigitalWordOffset[iPmu+1]);
+
+		output.pmuDataFrame.push_back(pmu);
 	}
 
 	return output;
 }
+
+
+// ------------------------------------------------------------------------------------------------------------------------
+// C37118PdcProjectedDataFrame
+// ------------------------------------------------------------------------------------------------------------------------
+
+
+C37118PdcProjectedDataFrame C37118PdcProjectedDataFrame::CreateByDecodeInfo(const C37118PdcDataDecodeInfo& config)
+{
+	C37118PdcProjectedDataFrame frame;
+	frame.Values.resize(config.NumProjectedValues);
+	frame.PolarMag.resize(config.ProjectionPolarIndices.size());
+	frame.PolarAngle.resize(config.ProjectionPolarIndices.size());
+	frame.CRC16 = 0;
+	frame.Timestamps = C37118FrameTimestamps();
+	return frame;
+}
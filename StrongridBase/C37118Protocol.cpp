@@ -22,43 +22,60 @@
 
 #include "common.h"
 #include "C37118Protocol.h"
-#include "EncDec.h"
+#include "SimdKernels.h"
 
 using namespace strongridbase;
 
+// FRAMESIZE is 16 bits - the writers refuse to build anything longer
+static const int MAX_FRAME_SIZE = 0xFFFF;
 
-void C37118Protocol::WriteFrameHeader(char* data, const C37118FrameHeader* frameHeader, int* offset)
+// End of the space a writer may fill: the caller's buffer of 'length' bytes, and no more than one frame
+static int WriterLength( int length, int offset )
+{
+	return offset + MAX_FRAME_SIZE < length ? offset + MAX_FRAME_SIZE : length;
+}
+
+
+void C37118Protocol::WriteFrameHeader(char* data, int length, const C37118FrameHeader* frameHeader, int* offset)
+{
+	BigEndianWriter out(data, WriterLength(length, *offset), *offset);
+	WriteFrameHeader(out, frameHeader);
+	*offset = out.Offset();
+}
+
+void C37118Protocol::WriteFrameHeader(BigEndianWriter& out, const C37118FrameHeader* frameHeader)
 {
 	// Write SYNC field
-	WriteSyncField(data, &frameHeader->Sync, offset );
+	WriteSyncField(out, &frameHeader->Sync);
 
 	// Skip FRAMESIZE until the end
-	*offset += 2;
+	out.Skip(2);
 
 	// Write IDCODE
-	EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)frameHeader->IdCode), offset );
+	out.Write<uint16_t>((uint16_t)frameHeader->IdCode);
 
 	// Write SOC
-	EncDec::put_U32(data, EncDec::ToNetByteOrder((uint32_t)frameHeader->SOC), offset );
+	out.Write<uint32_t>((uint32_t)frameHeader->SOC);
 
 	// Write FRACSEC
-	WriteFracSecField(data, &frameHeader->FracSec, offset );
+	WriteFracSecField(out, &frameHeader->FracSec);
 }
 
-void C37118Protocol::WriteConfigurationFrame(char* data, const C37118PdcConfiguration* pdcconfig, int* offset)
+void C37118Protocol::WriteConfigurationFrame(char* data, int length, const C37118PdcConfiguration* pdcconfig, int* offset)
 {
-	int offsetAtStart = *offset;
+	const int offsetAtStart = *offset;
+	BigEndianWriter out(data, WriterLength(length, offsetAtStart), offsetAtStart);
 
 	// Write HEADER
-	WriteFrameHeader(data, &pdcconfig->HeaderCommon, offset);
+	WriteFrameHeader(out, &pdcconfig->HeaderCommon);
 
 	// Write TIME_BASE
-	WriteTimeBaseField(data, &pdcconfig->TimeBase, offset );
+	WriteTimeBaseField(out, &pdcconfig->TimeBase);
 
 	// Write NUM_PMU
-	EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)pdcconfig->PMUs.size()), offset );
+	out.Write<uint16_t>((uint16_t)pdcconfig->PMUs.size());
 
-	for( std::vector<C37118PmuConfiguration>::const_iterator iter = pdcconfig->PMUs.begin(); iter != pdcconfig->PMUs.end(); ++iter )
+	for( C37118Array<C37118PmuConfiguration>::const_iterator iter = pdcconfig->PMUs.begin(); iter != pdcconfig->PMUs.end(); ++iter )
 	{
 		const int tmpMinDigNames = ((iter->digitalChnNames.size() + 15) / 16) * 16;
 
@@ -69,79 +86,81 @@ void C37118Protocol::WriteConfigurationFrame(char* data, const C37118PdcConfigur
 
 
 		// Write STN - station name
-		EncDec::put_String(data, iter->StationName, 16, offset );
+		out.WriteString(iter->StationName.c_str(), (int)iter->StationName.length(), 16);
 
 		// Write IDCODE
-		EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)iter->IdCode), offset );
+		out.Write<uint16_t>((uint16_t)iter->IdCode);
 
 		// Write FORMAT
-		WriteC37118PmuFormat(data, &iter->DataFormat, offset );
+		WriteC37118PmuFormat(out, &iter->DataFormat);
 
 		uint32_t tmp = (iter->digitalChnNames.size() + 15) / 16;
 
 		// Write PHNMR/ANNMR/CHNAM - Number of phasors/analog/digwords
-		EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)iter->phasorChnNames.size()), offset );
-		EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)iter->analogChnNames.size()), offset );
-		EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)tmp), offset );
+		out.Write<uint16_t>((uint16_t)iter->phasorChnNames.size());
+		out.Write<uint16_t>((uint16_t)iter->analogChnNames.size());
+		out.Write<uint16_t>((uint16_t)tmp);
 
 		// Write phasors names
-		for( std::vector<std::string>::const_iterator phNamIter = iter->phasorChnNames.begin(); phNamIter != iter->phasorChnNames.end(); ++phNamIter )
-			EncDec::put_String(data, *phNamIter, 16, offset );
+		for( C37118Array<C37118Name>::const_iterator phNamIter = iter->phasorChnNames.begin(); phNamIter != iter->phasorChnNames.end(); ++phNamIter )
+			out.WriteString(phNamIter->c_str(), (int)phNamIter->length(), 16);
 
 		// Write analog names
-		for( std::vector<std::string>::const_iterator angNamIter = iter->analogChnNames.begin(); angNamIter != iter->analogChnNames.end(); ++angNamIter )
-			EncDec::put_String(data, *angNamIter, 16, offset );
+		for( C37118Array<C37118Name>::const_iterator angNamIter = iter->analogChnNames.begin(); angNamIter != iter->analogChnNames.end(); ++angNamIter )
+			out.WriteString(angNamIter->c_str(), (int)angNamIter->length(), 16);
 
 		// Write digital names (in blocks of 16)
 		int digNamesWritten = 0;
-		for( std::vector<std::string>::const_iterator digNamIter = iter->digitalChnNames.begin(); digNamIter != iter->digitalChnNames.end(); ++digNamIter ) {
-			EncDec::put_String(data, *digNamIter, 16, offset );
+		for( C37118Array<C37118Name>::const_iterator digNamIter = iter->digitalChnNames.begin(); digNamIter != iter->digitalChnNames.end(); ++digNamIter ) {
+			out.WriteString(digNamIter->c_str(), (int)digNamIter->length(), 16);
 			digNamesWritten++;
 		}
 		for( ; digNamesWritten < tmpMinDigNames; ++digNamesWritten )
-			EncDec::put_String(data, "", 16, offset );
+			out.WriteString("", 16);
 
 		// Write PHUNIT/ANUNIT/DIGUNIT
-		for( std::vector<C37118PhasorUnit>::const_iterator iterUnit = iter->PhasorUnit.begin(); iterUnit != iter->PhasorUnit.end(); ++iterUnit )
-			WriteC37118PhasorUnit( data, &(*iterUnit), offset );
+		for( C37118Array<C37118PhasorUnit>::const_iterator iterUnit = iter->PhasorUnit.begin(); iterUnit != iter->PhasorUnit.end(); ++iterUnit )
+			WriteC37118PhasorUnit(out, &(*iterUnit));
 
-		for( std::vector<C37118AnalogUnit>::const_iterator iterUnit = iter->AnalogUnit.begin(); iterUnit != iter->AnalogUnit.end(); ++iterUnit )
-			WriteC37118AnalogUnit(data, &(*iterUnit), offset );
+		for( C37118Array<C37118AnalogUnit>::const_iterator iterUnit = iter->AnalogUnit.begin(); iterUnit != iter->AnalogUnit.end(); ++iterUnit )
+			WriteC37118AnalogUnit(out, &(*iterUnit));
 
-		for( std::vector<C37118DigitalUnit>::const_iterator iterUnit = iter->DigitalUnit.begin(); iterUnit != iter->DigitalUnit.end(); ++iterUnit )
-			WriteC37118DigitalUnit(data, &(*iterUnit), offset );
+		for( C37118Array<C37118DigitalUnit>::const_iterator iterUnit = iter->DigitalUnit.begin(); iterUnit != iter->DigitalUnit.end(); ++iterUnit )
+			WriteC37118DigitalUnit(out, &(*iterUnit));
 
 		// Write FNOM
-		WriteNomFreqField(data, &iter->NomFreqCode, offset );
+		WriteNomFreqField(out, &iter->NomFreqCode);
 
 		// Write CFGCNT
-		EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)iter->ConfChangeCnt), offset );
+		out.Write<uint16_t>((uint16_t)iter->ConfChangeCnt);
 	}
 
 	// Write DATA_RATE
-	EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)pdcconfig->DataRate.RawDataRate()), offset );
+	out.Write<uint16_t>((uint16_t)pdcconfig->DataRate.RawDataRate());
 
 
-	WriteFooter(data, offsetAtStart, offset);
+	WriteFooter(out, offsetAtStart);
+	*offset = out.Offset();
 }
 
-void C37118Protocol::WriteConfigurationFrame_Ver3( char* data, const C37118PdcConfiguration_Ver3* pdcconfig, int* offset)
+void C37118Protocol::WriteConfigurationFrame_Ver3( char* data, int length, const C37118PdcConfiguration_Ver3* pdcconfig, int* offset)
 {
-	int offsetAtStart = *offset;
+	const int offsetAtStart = *offset;
+	BigEndianWriter out(data, WriterLength(length, offsetAtStart), offsetAtStart);
 
 	// Write HEADER
-	WriteFrameHeader(data, &pdcconfig->HeaderCommon, offset);
+	WriteFrameHeader(out, &pdcconfig->HeaderCommon);
 
 	// Write CONT_IDX
-	EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)pdcconfig->ContinuationIndex.GetRawC37118Value()), offset);
+	out.Write<uint16_t>((uint16_t)pdcconfig->ContinuationIndex.GetRawC37118Value());
 
 	// Write TIME_BASE
-	WriteTimeBaseField(data, &pdcconfig->TimeBase, offset );
+	WriteTimeBaseField(out, &pdcconfig->TimeBase);
 
 	// Write NUM_PMU
-	EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)pdcconfig->PMUs.size()), offset );
+	out.Write<uint16_t>((uint16_t)pdcconfig->PMUs.size());
 
-	for( std::vector<C37118PmuConfiguration_Ver3>::const_iterator iter = pdcconfig->PMUs.begin(); iter != pdcconfig->PMUs.end(); ++iter )
+	for( C37118Array<C37118PmuConfiguration_Ver3>::const_iterator iter = pdcconfig->PMUs.begin(); iter != pdcconfig->PMUs.end(); ++iter )
 	{
 		const int tmpMinDigNames = ((iter->digitalChnNames.size() + 15) / 16) * 16;
 
@@ -152,92 +171,94 @@ void C37118Protocol::WriteConfigurationFrame_Ver3( char* data, const C37118PdcCo
 
 		// Write STN - station name
 		if( iter->StationName.length() > 255 ) throw Exception("StationName too long. Must be <= 255");
-		EncDec::put_U8(data, (uint8_t)iter->StationName.length(), offset );
-		EncDec::put_String(data, iter->StationName, iter->StationName.length(), offset );
+		out.Write<uint8_t>((uint8_t)iter->StationName.length());
+		out.WriteString(iter->StationName.c_str(), (int)iter->StationName.length(), (int)iter->StationName.length());
 
 		// Write IDCODE
-		EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)iter->IdCode), offset );
+		out.Write<uint16_t>((uint16_t)iter->IdCode);
 
 		// Write G_PMU_ID (16 bytes of raw data)
 		for( int i=0; i < 16; ++i)
-			EncDec::put_U8( data, iter->GlobalPmuId[i], offset );
+			out.Write<uint8_t>(iter->GlobalPmuId[i]);
 
 		// Write FORMAT
-		WriteC37118PmuFormat(data, &iter->DataFormat, offset );
+		WriteC37118PmuFormat(out, &iter->DataFormat);
 
 		uint32_t tmp = (iter->digitalChnNames.size() + 15) / 16;
 
 		// Write PHNMR/ANNMR/CHNAM - Number of phasors/analog/digwords
-		EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)iter->phasorChnNames.size()), offset );
-		EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)iter->analogChnNames.size()), offset );
-		EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)tmp), offset );
+		out.Write<uint16_t>((uint16_t)iter->phasorChnNames.size());
+		out.Write<uint16_t>((uint16_t)iter->analogChnNames.size());
+		out.Write<uint16_t>((uint16_t)tmp);
 
 		// Write phasors names
-		for( std::vector<std::string>::const_iterator phNamIter = iter->phasorChnNames.begin(); phNamIter != iter->phasorChnNames.end(); ++phNamIter ) {
-			EncDec::put_U8(data, (*phNamIter).length(), offset );
-			EncDec::put_String(data, *phNamIter, phNamIter->size(), offset );
+		for( C37118Array<C37118Name>::const_iterator phNamIter = iter->phasorChnNames.begin(); phNamIter != iter->phasorChnNames.end(); ++phNamIter ) {
+			out.Write<uint8_t>((*phNamIter).length());
+			out.WriteString(phNamIter->c_str(), (int)phNamIter->length(), (int)phNamIter->length());
 		}
 
 		// Write analog names
-		for( std::vector<std::string>::const_iterator angNamIter = iter->analogChnNames.begin(); angNamIter != iter->analogChnNames.end(); ++angNamIter ) {
-			EncDec::put_U8(data, (*angNamIter).length(), offset );
-			EncDec::put_String(data, *angNamIter, angNamIter->length(), offset );
+		for( C37118Array<C37118Name>::const_iterator angNamIter = iter->analogChnNames.begin(); angNamIter != iter->analogChnNames.end(); ++angNamIter ) {
+			out.Write<uint8_t>((*angNamIter).length());
+			out.WriteString(angNamIter->c_str(), (int)angNamIter->length(), (int)angNamIter->length());
 		}
 
 		// Write digital names (in blocks of 16)
 		int digNamesWritten = 0;
-		for( std::vector<std::string>::const_iterator digNamIter = iter->digitalChnNames.begin(); digNamIter != iter->digitalChnNames.end(); ++digNamIter ) {
-			EncDec::put_U8(data, (*digNamIter).length(), offset );
-			EncDec::put_String(data, *digNamIter, digNamIter->length(), offset );
+		for( C37118Array<C37118Name>::const_iterator digNamIter = iter->digitalChnNames.begin(); digNamIter != iter->digitalChnNames.end(); ++digNamIter ) {
+			out.Write<uint8_t>((*digNamIter).length());
+			out.WriteString(digNamIter->c_str(), (int)digNamIter->length(), (int)digNamIter->length());
 			digNamesWritten++;
 		}
 		for( ; digNamesWritten < tmpMinDigNames; ++digNamesWritten )
-			EncDec::put_U8(data, (unsigned char)0, offset );
+			out.Write<uint8_t>((unsigned char)0);
 
 		// Write PHUNIT/ANUNIT/DIGUNIT
-		for( std::vector<C37118PhasorScale_Ver3>::const_iterator phScaleIter = iter->PhasorScales.begin(); phScaleIter != iter->PhasorScales.end(); ++phScaleIter)
-			WriteC37118PhasorScale_Ver3( data, &(*phScaleIter), offset );
+		for( C37118Array<C37118PhasorScale_Ver3>::const_iterator phScaleIter = iter->PhasorScales.begin(); phScaleIter != iter->PhasorScales.end(); ++phScaleIter)
+			WriteC37118PhasorScale_Ver3(out, &(*phScaleIter));
 
-		for( std::vector<C37118AnalogScale_Ver3>::const_iterator angScaleIter = iter->AnalogScales.begin(); angScaleIter != iter->AnalogScales.end(); ++angScaleIter )
-			WriteC37118AnalogScale_Ver3(data, &(*angScaleIter), offset );
+		for( C37118Array<C37118AnalogScale_Ver3>::const_iterator angScaleIter = iter->AnalogScales.begin(); angScaleIter != iter->AnalogScales.end(); ++angScaleIter )
+			WriteC37118AnalogScale_Ver3(out, &(*angScaleIter));
 
-		for( std::vector<C37118DigitalUnit>::const_iterator digUnitIter = iter->DigitalUnits.begin(); digUnitIter != iter->DigitalUnits.end(); ++digUnitIter )
-			WriteC37118DigitalUnit(data, &(*digUnitIter), offset );
+		for( C37118Array<C37118DigitalUnit>::const_iterator digUnitIter = iter->DigitalUnits.begin(); digUnitIter != iter->DigitalUnits.end(); ++digUnitIter )
+			WriteC37118DigitalUnit(out, &(*digUnitIter));
 
 		// Write PMU_LAT / PMU_LON / PMU_ELEV
-		EncDec::put_Single(data, EncDec::ToNetByteOrder(iter->POS_LAT), offset);
-		EncDec::put_Single(data, EncDec::ToNetByteOrder(iter->POS_LON), offset);
-		EncDec::put_Single(data, EncDec::ToNetByteOrder(iter->POS_ELEV), offset);
+		out.Write<float>(iter->POS_LAT);
+		out.Write<float>(iter->POS_LON);
+		out.Write<float>(iter->POS_ELEV);
 
 		// Write SVC_CLASS
-		EncDec::put_U8(data, iter->ServiceClass, offset);
+		out.Write<uint8_t>(iter->ServiceClass);
 
 		// Write WINDOW (signed integer)
-		EncDec::put_S32(data, EncDec::ToNetByteOrder(iter->PhasorMeasurementWindow), offset );
+		out.Write<int32_t>(iter->PhasorMeasurementWindow);
 
 		// Write GRP_DLY
-		EncDec::put_S32(data, EncDec::ToNetByteOrder(iter->PhasorMeasurementGroupDelayMs), offset );
+		out.Write<int32_t>(iter->PhasorMeasurementGroupDelayMs);
 
 		// Write FNOM
-		WriteNomFreqField(data, &iter->NomFreqCode, offset );
+		WriteNomFreqField(out, &iter->NomFreqCode);
 
 		// Write CFGCNT
-		EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)iter->ConfChangeCnt), offset );
+		out.Write<uint16_t>((uint16_t)iter->ConfChangeCnt);
 	}
 
 	// Write DATA_RATE
-	EncDec::put_U16(data, EncDec::ToNetByteOrder((uint16_t)pdcconfig->DataRate.RawDataRate()), offset );
+	out.Write<uint16_t>((uint16_t)pdcconfig->DataRate.RawDataRate());
 
 
-	WriteFooter(data, offsetAtStart, offset);
+	WriteFooter(out, offsetAtStart);
+	*offset = out.Offset();
 }
 
-void C37118Protocol::WriteDataFrame(char* data, const C37118PdcDataDecodeInfo* config, const C37118PdcDataFrame* dataFrame, int* offset)
+void C37118Protocol::WriteDataFrame(char* data, int length, const C37118PdcDataDecodeInfo* config, const C37118PdcDataFrame* dataFrame, int* offset)
 {
-	int offsetAtStart = 0;
+	const int offsetAtStart = *offset;
+	BigEndianWriter out(data, WriterLength(length, offsetAtStart), offsetAtStart);
 
 	// Write header
-	WriteFrameHeader(data, &dataFrame->HeaderCommon, offset );
+	WriteFrameHeader(out, &dataFrame->HeaderCommon);
 
 	// Per  PMU
 	if( dataFrame->pmuDataFrame.size() != config->PMUs.size() ) throw Exception("Invalid dataframe - does not match config: Invalid pmu count");
@@ -248,7 +269,7 @@ void C37118Protocol::WriteDataFrame(char* data, const C37118PdcDataDecodeInfo* c
 		const C37118PmuDataFrame* pmuData = &dataFrame->pmuDataFrame[iPmu];
 
 		// Write STAT
-		EncDec::put_U16( data, EncDec::ToNetByteOrder((uint16_t)pmuData->Stat.ToRaw()), offset );
+		out.Write<uint16_t>((uint16_t)pmuData->Stat.ToRaw());
 
 		// Write PHASORS
 		if( pmuData->PhasorValues.size() != pmuConfig->numPhasors ) throw Exception("Invalid dataframe - does not match config: Invalid phasor count");
@@ -260,15 +281,15 @@ void C37118Protocol::WriteDataFrame(char* data, const C37118PdcDataDecodeInfo* c
 				{
 					float real, imag;
 					iterPhasor->getRealImagAsFloat(&real, &imag);
-					EncDec::put_Single(data, EncDec::ToNetByteOrder(real), offset);
-					EncDec::put_Single(data, EncDec::ToNetByteOrder(imag), offset);
+					out.Write<float>(real);
+					out.Write<float>(imag);
 				}
 				else // mag + angle
 				{
 					float mag, angle;
 					iterPhasor->getMagAngleAsFloat(&mag, &angle);
-					EncDec::put_Single(data, EncDec::ToNetByteOrder(mag), offset);
-					EncDec::put_Single(data, EncDec::ToNetByteOrder(angle), offset);
+					out.Write<float>(mag);
+					out.Write<float>(angle);
 				}
 			}
 			else // int16
@@ -277,16 +298,16 @@ void C37118Protocol::WriteDataFrame(char* data, const C37118PdcDataDecodeInfo* c
 				{
 					int16_t real, imag;
 					iterPhasor->getRealImagAsInt16(&real, &imag);
-					EncDec::put_S16(data, EncDec::ToNetByteOrder(real), offset);
-					EncDec::put_S16(data, EncDec::ToNetByteOrder(imag), offset);
+					out.Write<int16_t>(real);
+					out.Write<int16_t>(imag);
 				}
 				else // mag + angle
 				{
 					uint16_t mag;
 					int16_t angle;
 					iterPhasor->getMagAngleAsInt16(&mag, &angle);
-					EncDec::put_U16(data, EncDec::ToNetByteOrder(mag), offset);
-					EncDec::put_S16(data, EncDec::ToNetByteOrder(angle), offset);
+					out.Write<uint16_t>(mag);
+					out.Write<int16_t>(angle);
 				}
 			}
 		}
@@ -294,13 +315,13 @@ void C37118Protocol::WriteDataFrame(char* data, const C37118PdcDataDecodeInfo* c
 		// Write FREQ/DFREQ
 		if( pmuConfig->DataFormat.Bit3_0xFreqIsInt_1xFreqIsFloat == 0 ) // Freq is int
 		{
-			EncDec::put_S16(data, EncDec::ToNetByteOrder((int16_t)pmuData->Frequency), offset);
-			EncDec::put_S16(data, EncDec::ToNetByteOrder((int16_t)(pmuData->DeltaFrequency * 100.0f)), offset);
+			out.Write<int16_t>((int16_t)pmuData->Frequency);
+			out.Write<int16_t>((int16_t)(pmuData->DeltaFrequency * 100.0f));
 		}
 		else															// Freq is float
 		{
-			EncDec::put_Single(data, EncDec::ToNetByteOrder(pmuData->Frequency), offset);
-			EncDec::put_Single(data, EncDec::ToNetByteOrder(pmuData->DeltaFrequency), offset);
+			out.Write<float>(pmuData->Frequency);
+			out.Write<float>(pmuData->DeltaFrequency);
 		}
 
 		// Write ANALOG
@@ -310,166 +331,179 @@ void C37118Protocol::WriteDataFrame(char* data, const C37118PdcDataDecodeInfo* c
 			if( pmuConfig->DataFormat.Bit2_0xAnalogIsInt_1xAnalogIsFloat == true ) // FLOAT
 			{
 				float val = iterAnalog->getValueAsFloat();
-				EncDec::put_Single(data, EncDec::ToNetByteOrder(val), offset);
+				out.Write<float>(val);
 			}
 			else																  // INT16
 			{
 				int16_t val = iterAnalog->getValueAsInt16();
-				EncDec::put_S16(data, EncDec::ToNetByteOrder(val), offset);
+				out.Write<int16_t>(val);
 			}
 		}
 
 		// Write DIGITAL
-		if( pmuData->DigitalValues.size() != pmuConfig->numDigitals ) throw Exception("Invalid dataframe - does not match config: Invalid digital count");
-		C37118PmuDataFrameDigitalHelper digHelper = C37118PmuDataFrameDigitalHelper::CreateByBoolArray(pmuData->DigitalValues);
-		std::vector<uint16_t> digWordArray = digHelper.ToDigWord();
-		for( std::vector<uint16_t>::const_iterator iter = digWordArray.begin(); iter != digWordArray.end(); ++iter )
+		if( pmuData->DigitalWords.size() != DigitalWordCount(pmuConfig->numDigitals) ) throw Exception("Invalid dataframe - does not match config: Invalid digital count");
+		for( std::vector<uint16_t>::const_iterator iter = pmuData->DigitalWords.begin(); iter != pmuData->DigitalWords.end(); ++iter )
 		{
-			EncDec::put_U16(data, EncDec::ToNetByteOrder( (uint16_t)*iter ), offset );
+			out.Write<uint16_t>((uint16_t)*iter);
 		}
 	}
 
 	// Write update framesize and write crc16
-	WriteFooter(data, offsetAtStart, offset );
+	WriteFooter(out, offsetAtStart);
+	*offset = out.Offset();
 }
 
-void C37118Protocol::WriteFooter(char* data, int offsetAtStart, int* offset )
+void C37118Protocol::WriteFooter(BigEndianWriter& out, int offsetAtStart)
 {
 	// Update "framesize"
-	EncDec::put_U16(data+2, EncDec::ToNetByteOrder((uint16_t)(*offset+2)), &offsetAtStart);
+	const int frameSize = out.Offset() - offsetAtStart + 2;
+	out.WriteAt<uint16_t>(offsetAtStart + 2, (uint16_t)frameSize);
 
 	// Write CRC16
-	EncDec::put_U16(data, EncDec::ToNetByteOrder(CalcCrc16(data,*offset)), offset );
+	out.Write<uint16_t>(CalcCrc16(out.Data() + offsetAtStart, frameSize - 2));
 }
 
-void C37118Protocol::WriteHeaderFrame(char* data, const C37118PdcHeaderFrame* headerFrame, int* offset)
+void C37118Protocol::WriteHeaderFrame(char* data, int length, const C37118PdcHeaderFrame* headerFrame, int* offset)
 {
-	int offsetAtStart = *offset;
+	const int offsetAtStart = *offset;
+	BigEndianWriter out(data, WriterLength(length, offsetAtStart), offsetAtStart);
 
 	// Write frame header
-	WriteFrameHeader(data, &headerFrame->Header, offset );
+	WriteFrameHeader(out, &headerFrame->Header);
 
 	// Write header message data
-	EncDec::put_String(data, headerFrame->HeaderMessage, headerFrame->HeaderMessage.length(), offset);
+	out.WriteString(headerFrame->HeaderMessage, headerFrame->HeaderMessage.length());
 
 	// Update framesize and write CRC field
-	WriteFooter(data, offsetAtStart, offset );
+	WriteFooter(out, offsetAtStart);
+	*offset = out.Offset();
 }
 
-void C37118Protocol::WriteCommandFrame(char* data, const C37118CommandFrame* cmdFrame, int* offset)
+void C37118Protocol::WriteCommandFrame(char* data, int length, const C37118CommandFrame* cmdFrame, int* offset)
 {
-	int offsetAtStart = *offset;
+	const int offsetAtStart = *offset;
+	BigEndianWriter out(data, WriterLength(length, offsetAtStart), offsetAtStart);
 
 	// Write frame header
-	WriteFrameHeader(data, &cmdFrame->Header, offset);
+	WriteFrameHeader(out, &cmdFrame->Header);
 
 	// Write CMD field
-	EncDec::put_U16( data, EncDec::ToNetByteOrder( (uint16_t)cmdFrame->CmdType ), offset );
+	out.Write<uint16_t>((uint16_t)cmdFrame->CmdType);
 
 	// Write EXTFRAME data - null
 	// ...
 
 	// Update framesize and write CRC field
-	WriteFooter(data, offsetAtStart, offset );
+	WriteFooter(out, offsetAtStart);
+	*offset = out.Offset();
 }
 
-void C37118Protocol::WriteSyncField(char* data,const C37118SyncField* syncField, int* offset)
+void C37118Protocol::WriteSyncField(BigEndianWriter& out, const C37118SyncField* syncField)
 {
-	EncDec::put_U8(data, syncField->LeadIn, offset ); // Should always be 0xAA
+	out.Write<uint8_t>(syncField->LeadIn); // Should always be 0xAA
 
 	uint8_t rawTypeVer =
 		((syncField->FrameType << 4) & 0x70) |
 		(syncField->Version << 0);
-	EncDec::put_U8(data, rawTypeVer, offset );
+	out.Write<uint8_t>(rawTypeVer);
 }
 
-void C37118Protocol::WriteFracSecField(char* data, const C37118FracSec* fracSecField, int* offset)
+void C37118Protocol::WriteFracSecField(BigEndianWriter& out, const C37118FracSec* fracSecField)
 {
 	uint32_t composedFracSec = (fracSecField->TimeQuality << 24) | (fracSecField->FractionOfSecond & 0x00FFFFFF);
-	EncDec::put_U32(data, EncDec::ToNetByteOrder(composedFracSec), offset );
+	out.Write<uint32_t>(composedFracSec);
 }
 
-void C37118Protocol::WriteNomFreqField(char* data, const C37118NomFreq* nomFreqField, int* offset)
+void C37118Protocol::WriteNomFreqField(BigEndianWriter& out, const C37118NomFreq* nomFreqField)
 {
 	uint16_t composedNomFreqField = nomFreqField->Bit0_1xFreqIs50_0xFreqIs60 ? 0x1 : 0x0;
-	EncDec::put_U16(data, EncDec::ToNetByteOrder(composedNomFreqField), offset );
+	out.Write<uint16_t>(composedNomFreqField);
 }
 
-void C37118Protocol::WriteTimeBaseField(char* data,  const C37118TimeBase* timeBaseField , int* offset)
+void C37118Protocol::WriteTimeBaseField(BigEndianWriter& out, const C37118TimeBase* timeBaseField)
 {
 	uint32_t composedTimeBaseField =
 		(timeBaseField->Flags << 24) |
 		(timeBaseField->TimeBase & 0x00FFFFFF);
-	EncDec::put_U32(data, EncDec::ToNetByteOrder(composedTimeBaseField), offset);
+	out.Write<uint32_t>(composedTimeBaseField);
 }
 
-void C37118Protocol::WriteC37118PmuFormat(char* data, const C37118PmuFormat* pmuFormat, int* offset )
+void C37118Protocol::WriteC37118PmuFormat(BigEndianWriter& out, const C37118PmuFormat* pmuFormat)
 {
 	uint16_t composedFormat =
 		((pmuFormat->Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle ? 1 : 0) << 0) |
 		((pmuFormat->Bit1_0xPhasorsIsInt_1xPhasorFloat ? 1 : 0) << 1) |
 		((pmuFormat->Bit2_0xAnalogIsInt_1xAnalogIsFloat ? 1 : 0) << 2) |
 		((pmuFormat->Bit3_0xFreqIsInt_1xFreqIsFloat ? 1 : 0) << 3);
-	EncDec::put_U16(data, EncDec::ToNetByteOrder(composedFormat), offset );
+	out.Write<uint16_t>(composedFormat);
 }
 
-void C37118Protocol::WriteC37118PhasorUnit(char* data, const C37118PhasorUnit* phasorUnit , int* offset)
+void C37118Protocol::WriteC37118PhasorUnit(BigEndianWriter& out, const C37118PhasorUnit* phasorUnit)
 {
 	uint32_t composedUnit = (phasorUnit->Type << 24) | (phasorUnit->PhasorScalar & 0x00FFFFFF);
-	EncDec::put_U32(data, EncDec::ToNetByteOrder(composedUnit), offset );
+	out.Write<uint32_t>(composedUnit);
 }
 
-void C37118Protocol::WriteC37118AnalogUnit(char* data, const C37118AnalogUnit* analogUnit, int* offset )
+void C37118Protocol::WriteC37118AnalogUnit(BigEndianWriter& out, const C37118AnalogUnit* analogUnit)
 {
 	uint32_t composedUnit = (analogUnit->Type_X << 24) | (analogUnit->AnalogScalar & 0x00FFFFFF);
-	EncDec::put_U32(data, EncDec::ToNetByteOrder(composedUnit), offset );
+	out.Write<uint32_t>(composedUnit);
 }
 
-void C37118Protocol::WriteC37118DigitalUnit(char* data, const C37118DigitalUnit* digUnit, int* offset )
+void C37118Protocol::WriteC37118DigitalUnit(BigEndianWriter& out, const C37118DigitalUnit* digUnit)
 {
-	EncDec::put_U16(data, EncDec::ToNetByteOrder(digUnit->DigNormalStatus), offset );
-	EncDec::put_U16(data, EncDec::ToNetByteOrder(digUnit->DigValidInputs), offset );
+	out.Write<uint16_t>(digUnit->DigNormalStatus);
+	out.Write<uint16_t>(digUnit->DigValidInputs);
 }
 
-void C37118Protocol::WriteC37118PhasorScale_Ver3(char* data, const C37118PhasorScale_Ver3* phScale, int* offset)
+void C37118Protocol::WriteC37118PhasorScale_Ver3(BigEndianWriter& out, const C37118PhasorScale_Ver3* phScale)
 {
 	// Assemble and write FIRST "LONG WORD"
 	uint32_t firstLongWord = 0;
 	firstLongWord |= (phScale->PhasorBits & 0x000000FF); // Write the phasors bits
 	firstLongWord |= (phScale->VoltOrCurrent & 0x1) << (16+3);
 	firstLongWord |= ((uint8_t)phScale->PhasorComponentCode & 0x7) << (16);
-	EncDec::put_U32(data, EncDec::ToNetByteOrder((uint32_t)firstLongWord), offset);
+	out.Write<uint32_t>((uint32_t)firstLongWord);
 
 	// Write SECOND & THIRD "Long word"
-	EncDec::put_Single(data, EncDec::ToNetByteOrder(phScale->ScaleFactorOne_Y), offset);
-	EncDec::put_Single(data, EncDec::ToNetByteOrder(phScale->ScaleFactorTwo_Angle), offset);
+	out.Write<float>(phScale->ScaleFactorOne_Y);
+	out.Write<float>(phScale->ScaleFactorTwo_Angle);
 }
 
-void C37118Protocol::WriteC37118AnalogScale_Ver3(char* data, const C37118AnalogScale_Ver3* angScale, int* offset)
+void C37118Protocol::WriteC37118AnalogScale_Ver3(BigEndianWriter& out, const C37118AnalogScale_Ver3* angScale)
 {
-	EncDec::put_Single(data, EncDec::ToNetByteOrder(angScale->Scale), offset );
-	EncDec::put_Single(data, EncDec::ToNetByteOrder(angScale->Offset), offset );
+	out.Write<float>(angScale->Scale);
+	out.Write<float>(angScale->Offset);
 }
 
 C37118FrameHeader C37118Protocol::ReadFrameHeader(char* data, int length, int* offset)
+{
+	BigEndianReader in(data, length, *offset);
+	C37118FrameHeader output = ReadFrameHeader(in);
+	*offset = in.Offset();
+	return output;
+}
+
+C37118FrameHeader C37118Protocol::ReadFrameHeader(BigEndianReader& in)
 {
 	C37118FrameHeader output;
+	const int offsetAtStart = in.Offset();
 
 	// Read SYNC field
-	output.Sync = ReadSyncField(data, offset );
+	output.Sync = ReadSyncField(in);
 
 	// Read FRAMESIZE - validate against "length"
-	output.FrameSize = EncDec::ToHostByteOrder(EncDec::get_U16(data,offset));
-	if( length + *offset < output.FrameSize ) throw Exception("Input databuffer is too short to describe the entire header");
+	output.FrameSize = in.Read<uint16_t>();
+	if( output.FrameSize > in.Length() - offsetAtStart ) throw Exception("Input databuffer is too short to describe the entire header");
 
 	// Read IDCODE
-	output.IdCode = EncDec::ToHostByteOrder(EncDec::get_U16(data,offset));
+	output.IdCode = in.Read<uint16_t>();
 
 	// Read SOC
-	output.SOC = EncDec::ToHostByteOrder(EncDec::get_U32(data,offset) );
+	output.SOC = in.Read<uint32_t>();
 
 	// Read FRACSEC
-	output.FracSec = ReadFracSecField(data,offset);
+	output.FracSec = ReadFracSecField(in);
 
 	return output;
 }
@@ -477,191 +511,227 @@ C37118FrameHeader C37118Protocol::ReadFrameHeader(char* data, int length, int* o
 C37118PdcConfiguration C37118Protocol::ReadConfigurationFrame(char* data, int length)
 {
 	C37118PdcConfiguration output;
-	int offset = 0;
+	C37118ConfigBuilder builder(&output.Storage);
+	BigEndianReader in(data, length);
 
 	// Read frame header
-	output.HeaderCommon = ReadFrameHeader(data, length, &offset );
+	output.HeaderCommon = ReadFrameHeader(in);
 
 	// Read TIME_BASE
-	output.TimeBase = ReadTimeBaseField(data, &offset );
+	output.TimeBase = ReadTimeBaseField(in);
 
-	// Read NUM_PMU
-	int numPmu = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
+	// Read NUM_PMU - the records and DATA_RATE must fit in the frame before the PMUs are allocated
+	int numPmu = in.Read<uint16_t>();
+	in.RequireRemaining((uint64_t)numPmu * MIN_PMU_CONFIGURATION_SIZE + 2 + 2);
 
-	// Read STN
+	// The parsed PMUs take at most about twice the bytes of their records - reserve it all in one block
+	builder.Reserve(numPmu * sizeof(C37118PmuConfiguration) + 3 * (size_t)length);
+	C37118PmuConfiguration* pmus = builder.NewArray<C37118PmuConfiguration>(numPmu);
 	for( int ipmu = 0; ipmu < numPmu; ++ipmu )
-	{
-		C37118PmuConfiguration pmuCfg;
-
-		// Read STN
-		pmuCfg.StationName = EncDec::get_String(data, 16, &offset);
-
-		// Read IDCODE
-		pmuCfg.IdCode = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
-
-		// Read FORMAT
-		pmuCfg.DataFormat = ReadC37118PmuFormat(data, &offset);
-
-		// Read PHNMR / ANNMR / DGNMR
-		uint32_t numPhasors = EncDec::ToHostByteOrder( EncDec::get_U16(data, &offset));
-		uint32_t numAnalog = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
-		uint32_t numDigWords = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
-
-		// Read CHNAM - phasors
-		for( int i = 0; i < numPhasors; ++i )
-			pmuCfg.phasorChnNames.push_back( EncDec::get_String(data,16,&offset) );
-
-		// Read CHNAM - analog
-		for( int i = 0; i < numAnalog; ++i )
-			pmuCfg.analogChnNames.push_back( EncDec::get_String(data,16,&offset) );
-
-		// Read CHNAM - dig chns
-		for( int i = 0; i < numDigWords * 16; ++i )
-			pmuCfg.digitalChnNames.push_back( EncDec::get_String(data, 16, &offset ) );
-
-		// Read PHUNIT
-		for( int i = 0; i < numPhasors; ++i )
-			pmuCfg.PhasorUnit.push_back( ReadC37118PhasorUnit(data, &offset) );
-
-		// Read ANUNIT
-		for( int i = 0; i < numAnalog; ++i )
-			pmuCfg.AnalogUnit.push_back( ReadC37118AnalogUnit(data, &offset) );
-
-		// Read DIGUINT
-		for( int i = 0; i < numDigWords; ++i )
-			pmuCfg.DigitalUnit.push_back( ReadC37118DigitalUnit(data, &offset) );
-
-		// Read FNOM
-		pmuCfg.NomFreqCode = ReadNomFreqField(data, &offset);
-
-		// Read CFGCNT
-		pmuCfg.ConfChangeCnt = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
-
-		// Add PMU to the list
-		output.PMUs.push_back(pmuCfg);
-	}
+		ReadPmuConfiguration(in, builder, &pmus[ipmu]);
+	output.PMUs = C37118Array<C37118PmuConfiguration>(pmus, numPmu);
 
 	// Read DATA_RATE
-	output.DataRate = C37118DataRate ::CreateByRawC37118Format(EncDec::ToHostByteOrder(EncDec::get_S16(data, &offset)));
+	output.DataRate = C37118DataRate ::CreateByRawC37118Format(in.Read<int16_t>());
 
 
 	// Read CRC16
-	output.FooterCrc16 = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
+	output.FooterCrc16 = in.Read<uint16_t>();
 
 	return output;
 }
 
-C37118PdcConfiguration_Ver3 C37118Protocol::ReadConfigurationFrame_Ver3(char* data, int length)
+void C37118Protocol::ReadPmuConfiguration(BigEndianReader& in, C37118ConfigBuilder& builder, C37118PmuConfiguration* pmuCfg)
 {
-	C37118PdcConfiguration_Ver3 output;
-	int offset = 0;
-
-	// Read frame header
-	output.HeaderCommon = ReadFrameHeader(data, length, &offset );
-
-	// Read CONT_IDX
-	output.ContinuationIndex = C37118ContIdx::CreateByC37118Raw(EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset)));
-
-	// Read TIME_BASE
-	output.TimeBase = ReadTimeBaseField(data, &offset );
-
-	// Read NUM_PMU
-	int numPmu = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
-
 	// Read STN
-	for( int ipmu = 0; ipmu < numPmu; ++ipmu )
-	{
-		C37118PmuConfiguration_Ver3 pmuCfg;
-
-		// Read STN
-		int tmp = EncDec::get_U8(data,&offset);
-		pmuCfg.StationName = EncDec::get_String(data, tmp, &offset);
+	pmuCfg->StationName = builder.AddName(in.ReadBytes(16), 16);
 
-		// Read IDCODE
-		pmuCfg.IdCode = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
+	// Read IDCODE
+	pmuCfg->IdCode = in.Read<uint16_t>();
+
+	// Read FORMAT
+	pmuCfg->DataFormat = ReadC37118PmuFormat(in);
+
+	// Read PHNMR / ANNMR / DGNMR
+	uint32_t numPhasors = in.Read<uint16_t>();
+	uint32_t numAnalog = in.Read<uint16_t>();
+	uint32_t numDigWords = in.Read<uint16_t>();
+
+	// CHNAM, PHUNIT, ANUNIT, DIGUNIT, FNOM and CFGCNT must be in the frame before the arrays are allocated
+	in.RequireRemaining(16 * ((uint64_t)numPhasors + numAnalog + 16 * numDigWords) + 4 * ((uint64_t)numPhasors + numAnalog + numDigWords) + 2 + 2);
+
+	// Read CHNAM - phasors
+	C37118Name* phasorNames = builder.NewArray<C37118Name>(numPhasors);
+	for( int i = 0; i < numPhasors; ++i )
+		phasorNames[i] = builder.AddName(in.ReadBytes(16), 16);
+	pmuCfg->phasorChnNames = C37118Array<C37118Name>(phasorNames, numPhasors);
+
+	// Read CHNAM - analog
+	C37118Name* analogNames = builder.NewArray<C37118Name>(numAnalog);
+	for( int i = 0; i < numAnalog; ++i )
+		analogNames[i] = builder.AddName(in.ReadBytes(16), 16);
+	pmuCfg->analogChnNames = C37118Array<C37118Name>(analogNames, numAnalog);
+
+	// Read CHNAM - dig chns
+	C37118Name* digitalNames = builder.NewArray<C37118Name>(numDigWords * 16);
+	for( int i = 0; i < numDigWords * 16; ++i )
+		digitalNames[i] = builder.AddName(in.ReadBytes(16), 16);
+	pmuCfg->digitalChnNames = C37118Array<C37118Name>(digitalNames, numDigWords * 16);
+
+	// Read PHUNIT
+	C37118PhasorUnit* phasorUnits = builder.NewArray<C37118PhasorUnit>(numPhasors);
+	for( int i = 0; i < numPhasors; ++i )
+		phasorUnits[i] = ReadC37118PhasorUnit(in);
+	pmuCfg->PhasorUnit = C37118Array<C37118PhasorUnit>(phasorUnits, numPhasors);
+
+	// Read ANUNIT
+	C37118AnalogUnit* analogUnits = builder.NewArray<C37118AnalogUnit>(numAnalog);
+	for( int i = 0; i < numAnalog; ++i )
+		analogUnits[i] = ReadC37118AnalogUnit(in);
+	pmuCfg->AnalogUnit = C37118Array<C37118AnalogUnit>(analogUnits, numAnalog);
+
+	// Read DIGUINT
+	C37118DigitalUnit* digitalUnits = builder.NewArray<C37118DigitalUnit>(numDigWords);
+	for( int i = 0; i < numDigWords; ++i )
+		digitalUnits[i] = ReadC37118DigitalUnit(in);
+	pmuCfg->DigitalUnit = C37118Array<C37118DigitalUnit>(digitalUnits, numDigWords);
+
+	// Read FNOM
+	pmuCfg->NomFreqCode = ReadNomFreqField(in);
+
+	// Read CFGCNT
+	pmuCfg->ConfChangeCnt = in.Read<uint16_t>();
+}
 
-		// Read G_PMU_ID
-		for( int i = 0; i < 16; ++i )
-			pmuCfg.GlobalPmuId[i] = EncDec::get_U8(data,&offset);
+C37118PdcConfiguration_Ver3 C37118Protocol::ReadConfigurationFrame_Ver3(char* data, int length)
+{
+	// A single frame is parsed in place by the assembler - continuation frames have to go through one
+	C37118ConfigurationAssembler_Ver3 assembler;
+	C37118PdcConfiguration_Ver3 output;
+	if( !assembler.AddFrame(data, length, &output) )
+		throw Exception("Configuration frame 3 is continued in further frames");
 
-		// Read FORMAT
-		pmuCfg.DataFormat = ReadC37118PmuFormat(data, &offset);
+	return output;
+}
 
-		// Read PHNMR / ANNMR / DGNMR
-		uint32_t numPhasors = EncDec::ToHostByteOrder( EncDec::get_U16(data, &offset));
-		uint32_t numAnalog = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
-		uint32_t numDigWords = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
+void C37118Protocol::ReadPmuConfiguration_Ver3(BigEndianReader& in, C37118ConfigBuilder& builder, C37118PmuConfiguration_Ver3* pmuCfg)
+{
+	// Read STN
+	int tmp = in.Read<uint8_t>();
+	pmuCfg->StationName = builder.AddName(in.ReadBytes(tmp), tmp);
 
-		// Read CHNAM - phasors
-		for( int i = 0; i < numPhasors; ++i ) {
-			int nameLength = EncDec::get_U8(data,&offset);
-			pmuCfg.phasorChnNames.push_back( EncDec::get_String(data,nameLength,&offset) );
-		}
+	// Read IDCODE
+	pmuCfg->IdCode = in.Read<uint16_t>();
+
+	// Read G_PMU_ID
+	for( int i = 0; i < 16; ++i )
+		pmuCfg->GlobalPmuId[i] = in.Read<uint8_t>();
+
+	// Read FORMAT
+	pmuCfg->DataFormat = ReadC37118PmuFormat(in);
+
+	// Read PHNMR / ANNMR / DGNMR
+	uint32_t numPhasors = in.Read<uint16_t>();
+	uint32_t numAnalog = in.Read<uint16_t>();
+	uint32_t numDigWords = in.Read<uint16_t>();
+
+	// CHNAM (a length byte each at least), PHSCALE, ANSCALE, DIGUNIT and the fields after them must be in the
+	// record before the arrays are allocated
+	in.RequireRemaining(((uint64_t)numPhasors + numAnalog + 16 * numDigWords) + 12 * (uint64_t)numPhasors + 8 * (uint64_t)numAnalog + 4 * (uint64_t)numDigWords
+		+ 12 + 1 + 4 + 4 + 2 + 2);
+
+	// Read CHNAM - phasors
+	C37118Name* phasorNames = builder.NewArray<C37118Name>(numPhasors);
+	for( int i = 0; i < numPhasors; ++i ) {
+		int nameLength = in.Read<uint8_t>();
+		phasorNames[i] = builder.AddName(in.ReadBytes(nameLength), nameLength);
+	}
+	pmuCfg->phasorChnNames = C37118Array<C37118Name>(phasorNames, numPhasors);
 
-		// Read CHNAM - analog
-		for( int i = 0; i < numAnalog; ++i ) {
-			int nameLength = EncDec::get_U8(data,&offset);
-			pmuCfg.analogChnNames.push_back( EncDec::get_String(data,nameLength,&offset) );
-		}
+	// Read CHNAM - analog
+	C37118Name* analogNames = builder.NewArray<C37118Name>(numAnalog);
+	for( int i = 0; i < numAnalog; ++i ) {
+		int nameLength = in.Read<uint8_t>();
+		analogNames[i] = builder.AddName(in.ReadBytes(nameLength), nameLength);
+	}
+	pmuCfg->analogChnNames = C37118Array<C37118Name>(analogNames, numAnalog);
 
-		// Read CHNAM - dig chns
-		for( int i = 0; i < numDigWords * 16; ++i ) {
-			int nameLength = EncDec::get_U8(data,&offset);
-			pmuCfg.digitalChnNames.push_back( EncDec::get_String(data,nameLength, &offset ) );
-		}
+	// Read CHNAM - dig chns
+	C37118Name* digitalNames = builder.NewArray<C37118Name>(numDigWords * 16);
+	for( int i = 0; i < numDigWords * 16; ++i ) {
+		int nameLength = in.Read<uint8_t>();
+		digitalNames[i] = builder.AddName(in.ReadBytes(nameLength), nameLength);
+	}
+	pmuCfg->digitalChnNames = C37118Array<C37118Name>(digitalNames, numDigWords * 16);
 
-		// Read PHSCALE
-		for( int i = 0; i < numPhasors; ++i )
-			pmuCfg.PhasorScales.push_back(ReadC37118PhasorScale_Ver3(data, &offset));
+	// Read PHSCALE
+	C37118PhasorScale_Ver3* phasorScales = builder.NewArray<C37118PhasorScale_Ver3>(numPhasors);
+	for( int i = 0; i < numPhasors; ++i )
+		phasorScales[i] = ReadC37118PhasorScale_Ver3(in);
+	pmuCfg->PhasorScales = C37118Array<C37118PhasorScale_Ver3>(phasorScales, numPhasors);
 
-		// Read ANGSCALE
-		for( int i = 0; i < numAnalog; ++i )
-			pmuCfg.AnalogScales.push_back( ReadC37118AnalogScale_Ver3(data, &offset));
+	// Read ANGSCALE
+	C37118AnalogScale_Ver3* analogScales = builder.NewArray<C37118AnalogScale_Ver3>(numAnalog);
+	for( int i = 0; i < numAnalog; ++i )
+		analogScales[i] = ReadC37118AnalogScale_Ver3(in);
+	pmuCfg->AnalogScales = C37118Array<C37118AnalogScale_Ver3>(analogScales, numAnalog);
 
-		// Read DIGUINT
-		for( int i = 0; i < numDigWords; ++i )
-			pmuCfg.DigitalUnits.push_back(ReadC37118DigitalUnit(data, &offset));
+	// Read DIGUINT
+	C37118DigitalUnit* digitalUnits = builder.NewArray<C37118DigitalUnit>(numDigWords);
+	for( int i = 0; i < numDigWords; ++i )
+		digitalUnits[i] = ReadC37118DigitalUnit(in);
+	pmuCfg->DigitalUnits = C37118Array<C37118DigitalUnit>(digitalUnits, numDigWords);
 
-		// Read PMU_LAT/PMU_LON/PMU_ELEV
-		pmuCfg.POS_LAT = EncDec::ToHostByteOrder(EncDec::get_Single(data,&offset));
-		pmuCfg.POS_LON = EncDec::ToHostByteOrder(EncDec::get_Single(data,&offset));
-		pmuCfg.POS_ELEV = EncDec::ToHostByteOrder(EncDec::get_Single(data,&offset));
+	// Read PMU_LAT/PMU_LON/PMU_ELEV
+	pmuCfg->POS_LAT = in.Read<float>();
+	pmuCfg->POS_LON = in.Read<float>();
+	pmuCfg->POS_ELEV = in.Read<float>();
 
-		// Read SVC_CLASS
-		pmuCfg.ServiceClass = EncDec::get_U8(data,&offset);
+	// Read SVC_CLASS
+	pmuCfg->ServiceClass = in.Read<uint8_t>();
 
-		// Read WINDOW
-		pmuCfg.PhasorMeasurementWindow = EncDec::ToHostByteOrder(EncDec::get_S32(data,&offset));
+	// Read WINDOW
+	pmuCfg->PhasorMeasurementWindow = in.Read<int32_t>();
 
-		// Read GRP_DLY
-		pmuCfg.PhasorMeasurementGroupDelayMs = EncDec::ToHostByteOrder(EncDec::get_S32(data,&offset));
+	// Read GRP_DLY
+	pmuCfg->PhasorMeasurementGroupDelayMs = in.Read<int32_t>();
 
-		// Read FNOM
-		pmuCfg.NomFreqCode = ReadNomFreqField(data, &offset);
+	// Read FNOM
+	pmuCfg->NomFreqCode = ReadNomFreqField(in);
 
-		// Read CFGCNT
-		pmuCfg.ConfChangeCnt = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
+	// Read CFGCNT
+	pmuCfg->ConfChangeCnt = in.Read<uint16_t>();
+}
 
-		// Add PMU to the list
-		output.PMUs.push_back(pmuCfg);
+int C37118Protocol::PmuConfigurationSize_Ver3(const char* data, int length)
+{
+	// STN, IDCODE, G_PMU_ID, FORMAT, PHNMR/ANNMR/DGNMR
+	if( length < 1 ) return 0;
+	int pos = 1 + (uint8_t)data[0] + 2 + 16 + 2;
+	if( length < pos + 6 ) return 0;
+	const int numPhasors = LoadBigEndian<uint16_t>(data + pos);
+	const int numAnalog = LoadBigEndian<uint16_t>(data + pos + 2);
+	const int numDigWords = LoadBigEndian<uint16_t>(data + pos + 4);
+	pos += 6;
+
+	// CHNAM - length prefixed, so every name has to be walked
+	const int numNames = numPhasors + numAnalog + numDigWords * 16;
+	for( int i = 0; i < numNames; ++i ) {
+		if( pos >= length ) return 0;
+		pos += 1 + (uint8_t)data[pos];
 	}
 
-	// Read DATA_RATE
-	output.DataRate = C37118DataRate ::CreateByRawC37118Format(EncDec::ToHostByteOrder(EncDec::get_S16(data, &offset)));
-
-
-	// Read CRC16
-	output.FooterCrc16 = EncDec::ToHostByteOrder(EncDec::get_U16(data, &offset));
-
-	return output;
+	// PHSCALE, ANSCALE, DIGUNIT, PMU_LAT/PMU_LON/PMU_ELEV, SVC_CLASS, WINDOW, GRP_DLY, FNOM, CFGCNT
+	return pos + numPhasors * 12 + numAnalog * 8 + numDigWords * 4 + 12 + 1 + 4 + 4 + 2 + 2;
 }
 
 C37118PdcDataFrame C37118Protocol::ReadDataFrame(char* data, int length, const C37118PdcDataDecodeInfo* config, int* offset)
 {
 	C37118PdcDataFrame dataFrame;
+	BigEndianReader in(data, length, *offset);
 
 	// Read header
-	dataFrame.HeaderCommon = ReadFrameHeader(data, length, offset);
+	dataFrame.HeaderCommon = ReadFrameHeader(in);
 
 	// Per pmu
 	for( std::vector<C37118PmuDataDecodeInfo>::const_iterator iterPmuCfg = config->PMUs.begin(); iterPmuCfg != config->PMUs.end(); ++iterPmuCfg )
@@ -669,7 +739,7 @@ C37118PdcDataFrame C37118Protocol::ReadDataFrame(char* data, int length, const C
 		C37118PmuDataFrame pmuDataFrame;
 
 		// Read STAT
-		pmuDataFrame.Stat = C37118PmuDataFrameStat(EncDec::ToHostByteOrder((uint16_t)EncDec::get_U16(data,offset)));
+		pmuDataFrame.Stat = C37118PmuDataFrameStat(in.Read<uint16_t>());
 
 		// Read PHASORS
 		for( int i = 0; i < iterPmuCfg->numPhasors; ++i )
@@ -678,14 +748,14 @@ C37118PdcDataFrame C37118Protocol::ReadDataFrame(char* data, int length, const C
 			{
 				if( iterPmuCfg->DataFormat.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle == false ) // RECT
 				{
-					float real = EncDec::ToHostByteOrder(EncDec::get_Single(data,offset));
-					float imag = EncDec::ToHostByteOrder(EncDec::get_Single(data,offset));
+					float real = in.Read<float>();
+					float imag = in.Read<float>();
 					pmuDataFrame.PhasorValues.push_back( C37118PmuDataFramePhasorRealImag::CreateByRealImag(real,imag) );
 				}
 				else																			 // mag+angle
 				{
-					float mag = EncDec::ToHostByteOrder(EncDec::get_Single(data,offset));
-					float angle = EncDec::ToHostByteOrder(EncDec::get_Single(data,offset));
+					float mag = in.Read<float>();
+					float angle = in.Read<float>();
 					pmuDataFrame.PhasorValues.push_back( C37118PmuDataFramePhasorRealImag::CreateByPolarMag(mag, angle));
 				}
 			}
@@ -693,14 +763,14 @@ C37118PdcDataFrame C37118Protocol::ReadDataFrame(char* data, int length, const C
 			{
 				if( iterPmuCfg->DataFormat.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle == false ) // RECT
 				{
-					int16_t real = EncDec::ToHostByteOrder(EncDec::get_S16(data,offset));
-					int16_t imag = EncDec::ToHostByteOrder(EncDec::get_S16(data,offset));
+					int16_t real = in.Read<int16_t>();
+					int16_t imag = in.Read<int16_t>();
 					pmuDataFrame.PhasorValues.push_back( C37118PmuDataFramePhasorRealImag::CreateByRealImag(real,imag) );
 				}
 				else																			 // mag+angle
 				{
-					uint16_t mag = EncDec::ToHostByteOrder(EncDec::get_U16(data,offset));
-					int16_t angle = EncDec::ToHostByteOrder(EncDec::get_S16(data,offset));
+					uint16_t mag = in.Read<uint16_t>();
+					int16_t angle = in.Read<int16_t>();
 					pmuDataFrame.PhasorValues.push_back( C37118PmuDataFramePhasorRealImag::CreateByPolarMag(mag, angle));
 				}
 			}
@@ -708,12 +778,12 @@ C37118PdcDataFrame C37118Protocol::ReadDataFrame(char* data, int length, const C
 
 		// Read FREQ / DFREQ
 		if( iterPmuCfg->DataFormat.Bit3_0xFreqIsInt_1xFreqIsFloat == 0 )  {
-			pmuDataFrame.Frequency = EncDec::ToHostByteOrder( EncDec::get_S16(data,offset) ); // freq is int
-			pmuDataFrame.DeltaFrequency = (float)EncDec::ToHostByteOrder(EncDec::get_S16(data,offset)) / 100.0f; // dfreq is int
+			pmuDataFrame.Frequency = in.Read<int16_t>(); // freq is int
+			pmuDataFrame.DeltaFrequency = (float)in.Read<int16_t>() / 100.0f; // dfreq is int
 		}
 		else {
-			pmuDataFrame.Frequency = EncDec::ToHostByteOrder( EncDec::get_Single(data,offset) ); // freq is float
-			pmuDataFrame.DeltaFrequency = EncDec::ToHostByteOrder( EncDec::get_Single(data,offset) ); // dfreq is float
+			pmuDataFrame.Frequency = in.Read<float>(); // freq is float
+			pmuDataFrame.DeltaFrequency = in.Read<float>(); // dfreq is float
 		}
 
 		// Read ANALOG
@@ -721,48 +791,83 @@ C37118PdcDataFrame C37118Protocol::ReadDataFrame(char* data, int length, const C
 		{
 			if( iterPmuCfg->DataFormat.Bit2_0xAnalogIsInt_1xAnalogIsFloat == false )  // Analog is int
 			{
-				pmuDataFrame.AnalogValues.push_back( C37118PmuDataFrameAnalog::CreateByInt16( EncDec::ToHostByteOrder(EncDec::get_S16(data,offset))));
+				pmuDataFrame.AnalogValues.push_back( C37118PmuDataFrameAnalog::CreateByInt16( in.Read<int16_t>()));
 			}
 			else // Analog is float
 			{
-				pmuDataFrame.AnalogValues.push_back( C37118PmuDataFrameAnalog::CreateByFloat( EncDec::ToHostByteOrder(EncDec::get_Single(data,offset))));
+				pmuDataFrame.AnalogValues.push_back( C37118PmuDataFrameAnalog::CreateByFloat( in.Read<float>()));
 			}
 		}
 
-		// Read DIGITAL
-		const int numDigWords = (iterPmuCfg->numDigitals + 15) / 16;
-		std::vector<uint16_t> digWords;
+		// Read DIGITAL - kept as the packed status words
+		const int numDigWords = DigitalWordCount(iterPmuCfg->numDigitals);
+		pmuDataFrame.DigitalWords.resize(numDigWords);
 		for( int iDigWord = 0; iDigWord < numDigWords; ++iDigWord )
-			digWords.push_back( EncDec::ToHostByteOrder( EncDec::get_U16(data, offset) ));
-
-		// Push each individual value unto dataframe
-		std::vector<bool> digVals = C37118PmuDataFrameDigitalHelper::CreateByUint16Arr(digWords).ToBoolArray();
-		for( std::vector<bool>::const_iterator iterDigVal = digVals.begin(); iterDigVal != digVals.end(); ++iterDigVal )
-			pmuDataFrame.DigitalValues.push_back(*iterDigVal);
+			pmuDataFrame.DigitalWords[iDigWord] = in.Read<uint16_t>();
 
 		// Add PMU dataframe to PDC dataframe
 		dataFrame.pmuDataFrame.push_back(pmuDataFrame);
 	}
 
 	// Read crc16 information
-	dataFrame.CRC16 = EncDec::ToHostByteOrder(EncDec::get_U16(data,offset));
+	dataFrame.CRC16 = in.Read<uint16_t>();
+	*offset = in.Offset();
 
 	return dataFrame;
 }
 
+void C37118Protocol::ReadDataFrame(char* data, int length, const C37118PdcDataDecodeInfo* config, C37118PdcFlatDataFrame* outFrame, int* offset)
+{
+	// The output frame must have been allocated for this configuration, and the plan compiled for it
+	if( outFrame->MatchesDecodeInfo(*config) == false ) throw Exception("Dataframe storage does not match config");
+	if( config->DecodePlan.size() != config->PMUs.size() ) throw Exception("Decode plan has not been built for config");
+
+	// Read header
+	const int offsetAtStart = *offset;
+	outFrame->HeaderCommon = ReadFrameHeader(data, length, offset);
+	if( outFrame->HeaderCommon.FrameSize != config->DataFrameSize || length < config->DataFrameSize )
+		throw Exception("Dataframe size does not match config");
+
+	// Run the decode plan - one FORMAT specialised kernel per PMU block
+	const char* frame = data + offsetAtStart;
+	for( std::vector<C37118PmuDecodeBlock>::const_iterator iter = config->DecodePlan.begin(); iter != config->DecodePlan.end(); ++iter )
+		iter->Kernel(frame + iter->ByteOffset, *iter, outFrame);
+
+	// Polar phasors of the short blocks are gathered and converted in one batch
+	const int numPolar = config->PolarBatchIndices.size();
+	if( numPolar > 0 )
+	{
+		for( int i = 0; i < numPolar; ++i ) {
+			outFrame->PolarMag[i] = outFrame->PhasorReal[config->PolarBatchIndices[i]];
+			outFrame->PolarAngle[i] = outFrame->PhasorImag[config->PolarBatchIndices[i]];
+		}
+		SimdKernels::PolarToRect(outFrame->PolarMag.data(), outFrame->PolarAngle.data(), numPolar);
+		for( int i = 0; i < numPolar; ++i ) {
+			outFrame->PhasorReal[config->PolarBatchIndices[i]] = outFrame->PolarMag[i];
+			outFrame->PhasorImag[config->PolarBatchIndices[i]] = outFrame->PolarAngle[i];
+		}
+	}
+
+	// Read crc16 information
+	outFrame->CRC16 = LoadBigEndian<uint16_t>(frame + config->DataFrameSize - 2);
+	*offset = offsetAtStart + config->DataFrameSize;
+}
+
 C37118PdcHeaderFrame C37118Protocol::ReadHeaderFrame(char* data, int length, int* offset)
 {
 	C37118PdcHeaderFrame headerFrame;
+	BigEndianReader in(data, length, *offset);
 
 	// Read frame header
-	headerFrame.Header = ReadFrameHeader(data, length, offset);
+	headerFrame.Header = ReadFrameHeader(in);
 
 	// Read message payload
 	const int messagePayloadLength = headerFrame.Header.FrameSize - 16;
-	headerFrame.HeaderMessage = EncDec::get_String(data, messagePayloadLength, offset);
+	headerFrame.HeaderMessage = in.ReadString(messagePayloadLength);
 
 	// Read CRC16
-	headerFrame.FooterCrc16 = EncDec::ToHostByteOrder(EncDec::get_U16(data, offset));
+	headerFrame.FooterCrc16 = in.Read<uint16_t>();
+	*offset = in.Offset();
 
 	return headerFrame;
 }
@@ -770,63 +875,65 @@ C37118PdcHeaderFrame C37118Protocol::ReadHeaderFrame(char* data, int length, int
 C37118CommandFrame C37118Protocol::ReadCommandFrame(char* data, int bufferSize, int* offset)
 {
 	C37118CommandFrame cmdFrame;
+	BigEndianReader in(data, bufferSize, *offset);
 
 	// Read header
-	cmdFrame.Header = ReadFrameHeader(data, bufferSize, offset);
+	cmdFrame.Header = ReadFrameHeader(in);
 
 	// Read CMD
-	cmdFrame.CmdType = (C37118CmdType)EncDec::ToHostByteOrder(EncDec::get_U16(data,offset));
+	cmdFrame.CmdType = (C37118CmdType)in.Read<uint16_t>();
 
 	// Read (extframe)
 	const int extFrameBytes = cmdFrame.Header.FrameSize - 18;
-	*offset += extFrameBytes; // skip it
+	in.Skip(extFrameBytes);
 
 	// Read CRC
-	cmdFrame.CRC16 = EncDec::ToHostByteOrder(EncDec::get_U16(data,offset));
+	cmdFrame.CRC16 = in.Read<uint16_t>();
+	*offset = in.Offset();
 
 	return cmdFrame;
 }
 
-C37118SyncField C37118Protocol::ReadSyncField(char* data, int* offset)
+C37118SyncField C37118Protocol::ReadSyncField(BigEndianReader& in)
 {
 	C37118SyncField sync;
-	sync.LeadIn = EncDec::get_U8(data, offset);
-	uint8_t rawVerType = EncDec::get_U8(data, offset);
+	sync.LeadIn = in.Read<uint8_t>();
+	uint8_t rawVerType = in.Read<uint8_t>();
 	sync.Version = rawVerType & 0xF;
 	sync.FrameType = (C37118HdrFrameType)((rawVerType & 0x70) >> 4);
 	return sync;
 }
 
-C37118FracSec C37118Protocol::ReadFracSecField(char* data,int* offset)
+C37118FracSec C37118Protocol::ReadFracSecField(BigEndianReader& in)
 {
 	C37118FracSec fracSec;
-	uint32_t raw = EncDec::ToHostByteOrder(EncDec::get_U32(data, offset));
+	uint32_t raw = in.Read<uint32_t>();
 	fracSec.TimeQuality = (raw & 0xFF000000) >> 24;
 	fracSec.FractionOfSecond = (raw & 0x00FFFFFF);
 	return fracSec;
 }
 
-C37118NomFreq C37118Protocol::ReadNomFreqField(char* data, int* offset)
+C37118NomFreq C37118Protocol::ReadNomFreqField(BigEndianReader& in)
 {
 	C37118NomFreq nomFreq;
-	uint16_t raw = EncDec::ToHostByteOrder(EncDec::get_U16(data, offset));
+	uint16_t raw = in.Read<uint16_t>();
 	nomFreq.Bit0_1xFreqIs50_0xFreqIs60 = raw & 0x1;
 	return nomFreq;
 }
 
-C37118TimeBase C37118Protocol::ReadTimeBaseField(char* data,int* offset)
+C37118TimeBase C37118Protocol::ReadTimeBaseField(BigEndianReader& in)
 {
 	C37118TimeBase timebase;
-	uint32_t raw = EncDec::ToHostByteOrder(EncDec::get_U32(data, offset));
+	uint32_t raw = in.Read<uint32_t>();
 	timebase.Flags = (raw & 0xFF000000) >> 24;
 	timebase.TimeBase = (raw & 0x00FFFFFF);
 	return timebase;
 }
 
-C37118PmuFormat C37118Protocol::ReadC37118PmuFormat(char* data, int* offset )
+C37118PmuFormat C37118Protocol::ReadC37118PmuFormat(BigEndianReader& in)
 {
 	C37118PmuFormat pmuf;
-	uint16_t rawformat = EncDec::ToHostByteOrder(EncDec::get_U16(data, offset));
+	uint16_t rawformat = in.Read<uint16_t>();
 	pmuf.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle	= (rawformat & (1 << 0)) != 0;
 	pmuf.Bit1_0xPhasorsIsInt_1xPhasorFloat				= (rawformat & (1 << 1)) != 0;
 	pmuf.Bit2_0xAnalogIsInt_1xAnalogIsFloat				= (rawformat & (1 << 2)) != 0;
@@ -834,58 +941,56 @@ C37118PmuFormat C37118Protocol::ReadC37118PmuFormat(char* data, int* offset )
 	return pmuf;
 }
 
-C37118PhasorUnit C37118Protocol::ReadC37118PhasorUnit(char* data,int* offset)
+C37118PhasorUnit C37118Protocol::ReadC37118PhasorUnit(BigEndianReader& in)
 {
 	C37118PhasorUnit phunit;
-	uint32_t raw = EncDec::ToHostByteOrder(EncDec::get_U32(data, offset));
+	uint32_t raw = in.Read<uint32_t>();
 	phunit.Type = (raw & 0xFF000000) >> 24;
 	phunit.PhasorScalar = (raw & 0x00FFFFFF);
 	return phunit;
 }
 
-C37118AnalogUnit C37118Protocol::ReadC37118AnalogUnit(char* data, int* offset )
+C37118AnalogUnit C37118Protocol::ReadC37118AnalogUnit(BigEndianReader& in)
 {
 	C37118AnalogUnit anunit;
-	uint32_t raw = EncDec::ToHostByteOrder(EncDec::get_U32(data, offset));
+	uint32_t raw = in.Read<uint32_t>();
 	anunit.Type_X = (raw & 0xFF000000) >> 24;
 	anunit.AnalogScalar = (raw & 0x00FFFFFF); // TODO: REVIEW - UNSIGNED / SIGNED
 	return anunit;
 }
 
-C37118DigitalUnit C37118Protocol::ReadC37118DigitalUnit(char* data,int* offset )
+C37118DigitalUnit C37118Protocol::ReadC37118DigitalUnit(BigEndianReader& in)
 {
 	C37118DigitalUnit digUnit;
-	digUnit.DigNormalStatus = EncDec::ToHostByteOrder(EncDec::get_U16(data, offset));
-	digUnit.DigValidInputs = EncDec::ToHostByteOrder(EncDec::get_U16(data, offset));
+	digUnit.DigNormalStatus = in.Read<uint16_t>();
+	digUnit.DigValidInputs = in.Read<uint16_t>();
 	return digUnit;
 }
 
-C37118PhasorScale_Ver3 C37118Protocol::ReadC37118PhasorScale_Ver3(char* data, int* offset)
+C37118PhasorScale_Ver3 C37118Protocol::ReadC37118PhasorScale_Ver3(BigEndianReader& in)
 {
 	C37118PhasorScale_Ver3 tmp;
 
-	uint32_t longWordOne = EncDec::ToHostByteOrder(EncDec::get_U32(data, offset));
-	uint32_t longWordTwo = EncDec::ToHostByteOrder(EncDec::get_U32(data, offset));
-	uint32_t longWordThree = EncDec::ToHostByteOrder(EncDec::get_U32(data, offset));
+	uint32_t longWordOne = in.Read<uint32_t>();
 
 	// First long word: bitmapped flags
 	tmp.PhasorBits = longWordOne & 0x0000FFFF;
 	tmp.VoltOrCurrent = ((longWordOne &  0x00FF0000) >> 16) & 0x8;
 	tmp.PhasorComponentCode = (PhasorComponentCodeEnum)(((longWordOne & 0x00FF0000) >> 16) & 0x7);
 
-	// Second long word: scaling information
-	tmp.ScaleFactorOne_Y = *(float*)(&longWordTwo);
-	tmp.ScaleFactorTwo_Angle =  *(float*)(&longWordThree);
+	// Second and third long word: scaling information
+	tmp.ScaleFactorOne_Y = in.Read<float>();
+	tmp.ScaleFactorTwo_Angle = in.Read<float>();
 
 	// Return the phasor scaling structure
 	return tmp;
 }
 
-C37118AnalogScale_Ver3 C37118Protocol::ReadC37118AnalogScale_Ver3(char* data, int* offset)
+C37118AnalogScale_Ver3 C37118Protocol::ReadC37118AnalogScale_Ver3(BigEndianReader& in)
 {
 	C37118AnalogScale_Ver3 tmp;
-	tmp.Scale = EncDec::ToHostByteOrder(EncDec::get_Single(data,offset));
-	tmp.Offset = EncDec::ToHostByteOrder(EncDec::get_Single(data,offset));
+	tmp.Scale = in.Read<float>();
+	tmp.Offset = in.Read<float>();
 	return tmp;
 }
 
@@ -894,7 +999,7 @@ C37118PdcDataDecodeInfo C37118Protocol::CreateDecodeInfoByPdcConfig(const C37118
 	C37118PdcDataDecodeInfo output;
 	output.timebase = pdccfg.TimeBase;
 
-	for( std::vector<C37118PmuConfiguration>::const_iterator iter = pdccfg.PMUs.begin(); iter != pdccfg.PMUs.end(); ++iter )
+	for( C37118Array<C37118PmuConfiguration>::const_iterator iter = pdccfg.PMUs.begin(); iter != pdccfg.PMUs.end(); ++iter )
 	{
 		C37118PmuDataDecodeInfo pmu;
 		pmu.DataFormat = iter->DataFormat;
@@ -904,6 +1009,8 @@ C37118PdcDataDecodeInfo C37118Protocol::CreateDecodeInfoByPdcConfig(const C37118
 		output.PMUs.push_back(pmu);
 	}
 
+	output.KeepPolarPhasors = false;
+	BuildDecodePlan(&output);
 	return output;
 }
 
@@ -912,7 +1019,7 @@ C37118PdcDataDecodeInfo C37118Protocol::CreateDecodeInfoByPdcConfig(const C37118
 	C37118PdcDataDecodeInfo output;
 	output.timebase = pdccfg.TimeBase;
 
-	for( std::vector<C37118PmuConfiguration_Ver3>::const_iterator iter = pdccfg.PMUs.begin(); iter != pdccfg.PMUs.end(); ++iter )
+	for( C37118Array<C37118PmuConfiguration_Ver3>::const_iterator iter = pdccfg.PMUs.begin(); iter != pdccfg.PMUs.end(); ++iter )
 	{
 		C37118PmuDataDecodeInfo pmu;
 		pmu.DataFormat = iter->DataFormat;
@@ -922,9 +1029,19 @@ C37118PdcDataDecodeInfo C37118Protocol::CreateDecodeInfoByPdcConfig(const C37118
 		output.PMUs.push_back(pmu);
 	}
 
+	output.KeepPolarPhasors = false;
+	BuildDecodePlan(&output);
 	return output;
 }
 
+static C37118Array<C37118Name> CopyNames(const C37118Array<C37118Name>& names, C37118ConfigBuilder& builder)
+{
+	C37118Name* copy = builder.NewArray<C37118Name>(names.size());
+	for( size_t i = 0; i < names.size(); ++i )
+		copy[i] = builder.AddName(names[i].c_str(), names[i].length());
+	return C37118Array<C37118Name>(copy, names.size());
+}
+
 C37118PdcConfiguration C37118Protocol::DowngradePdcConfig(const C37118PdcConfiguration_Ver3* pdccfg)
 {
 	C37118PdcConfiguration oldPdcCfg;
@@ -933,38 +1050,45 @@ C37118PdcConfiguration C37118Protocol::DowngradePdcConfig(const C37118PdcConfigu
 	oldPdcCfg.TimeBase = pdccfg->TimeBase;
 	oldPdcCfg.DataRate = pdccfg->DataRate;
 
-	for( std::vector<C37118PmuConfiguration_Ver3>::const_iterator iter = pdccfg->PMUs.begin(); iter != pdccfg->PMUs.end(); ++iter )
-	{
-		// Add to list
-		C37118PmuConfiguration oldPmuCfg = DowngradePmuConfig(&(*iter));
-		oldPdcCfg.PMUs.push_back(oldPmuCfg);
-	}
+	C37118ConfigBuilder builder(&oldPdcCfg.Storage);
+	builder.Reserve(pdccfg->Storage.Capacity());
+	C37118PmuConfiguration* pmus = builder.NewArray<C37118PmuConfiguration>(pdccfg->PMUs.size());
+	for( size_t i = 0; i < pdccfg->PMUs.size(); ++i )
+		pmus[i] = DowngradePmuConfig(&pdccfg->PMUs[i], builder);
+	oldPdcCfg.PMUs = C37118Array<C37118PmuConfiguration>(pmus, pdccfg->PMUs.size());
 
 	return oldPdcCfg;
 }
 
-C37118PmuConfiguration C37118Protocol::DowngradePmuConfig(const C37118PmuConfiguration_Ver3* pdccfg)
+// The names and arrays of the result are placed in the storage of the builder
+C37118PmuConfiguration C37118Protocol::DowngradePmuConfig(const C37118PmuConfiguration_Ver3* pdccfg, C37118ConfigBuilder& builder)
 {
 	C37118PmuConfiguration oldPmuCfg;
-	oldPmuCfg.StationName = pdccfg->StationName;
+	oldPmuCfg.StationName = builder.AddName(pdccfg->StationName.c_str(), pdccfg->StationName.length());
 	oldPmuCfg.IdCode = pdccfg->IdCode;
 	oldPmuCfg.DataFormat = pdccfg->DataFormat;
-	oldPmuCfg.phasorChnNames = pdccfg->phasorChnNames;
-	oldPmuCfg.analogChnNames = pdccfg->analogChnNames;
-	oldPmuCfg.digitalChnNames = pdccfg->digitalChnNames;
 
+	oldPmuCfg.phasorChnNames = CopyNames(pdccfg->phasorChnNames, builder);
+	oldPmuCfg.analogChnNames = CopyNames(pdccfg->analogChnNames, builder);
+	oldPmuCfg.digitalChnNames = CopyNames(pdccfg->digitalChnNames, builder);
 
 	// Phasor scalar / unit conversion
-	for( std::vector<C37118PhasorScale_Ver3>::const_iterator unitIter = pdccfg->PhasorScales.begin(); unitIter != pdccfg->PhasorScales.end(); ++unitIter )
-		oldPmuCfg.PhasorUnit.push_back( C37118PhasorUnit(unitIter->VoltOrCurrent, unitIter->ScaleFactorOne_Y) );
+	C37118PhasorUnit* phasorUnits = builder.NewArray<C37118PhasorUnit>(pdccfg->PhasorScales.size());
+	for( size_t i = 0; i < pdccfg->PhasorScales.size(); ++i )
+		phasorUnits[i] = C37118PhasorUnit(pdccfg->PhasorScales[i].VoltOrCurrent, pdccfg->PhasorScales[i].ScaleFactorOne_Y);
+	oldPmuCfg.PhasorUnit = C37118Array<C37118PhasorUnit>(phasorUnits, pdccfg->PhasorScales.size());
 
 	// Analog scalar
-	for( std::vector<C37118AnalogScale_Ver3>::const_iterator unitIter = pdccfg->AnalogScales.begin(); unitIter != pdccfg->AnalogScales.end(); ++unitIter )
-		oldPmuCfg.AnalogUnit.push_back( C37118AnalogUnit( 0, unitIter->Scale )  );
+	C37118AnalogUnit* analogUnits = builder.NewArray<C37118AnalogUnit>(pdccfg->AnalogScales.size());
+	for( size_t i = 0; i < pdccfg->AnalogScales.size(); ++i )
+		analogUnits[i] = C37118AnalogUnit(0, pdccfg->AnalogScales[i].Scale);
+	oldPmuCfg.AnalogUnit = C37118Array<C37118AnalogUnit>(analogUnits, pdccfg->AnalogScales.size());
 
 	// Digital unit
-	for( std::vector<C37118DigitalUnit>::const_iterator unitIter = pdccfg->DigitalUnits.begin(); unitIter != pdccfg->DigitalUnits.end(); ++unitIter )
-		oldPmuCfg.DigitalUnit.push_back(*unitIter);
+	C37118DigitalUnit* digitalUnits = builder.NewArray<C37118DigitalUnit>(pdccfg->DigitalUnits.size());
+	for( size_t i = 0; i < pdccfg->DigitalUnits.size(); ++i )
+		digitalUnits[i] = pdccfg->DigitalUnits[i];
+	oldPmuCfg.DigitalUnit = C37118Array<C37118DigitalUnit>(digitalUnits, pdccfg->DigitalUnits.size());
 
 
 	// etc
@@ -974,23 +1098,49 @@ C37118PmuConfiguration C37118Protocol::DowngradePmuConfig(const C37118PmuConfigu
 	return oldPmuCfg;
 }
 
-uint16_t C37118Protocol::CalcCrc16(char* data, int length)
-{
-  unsigned short crc = 0xFFFF; /*0xFFFF -> 0x0 -> 0xFFFF;*/
-  unsigned short temp;
-  unsigned short quick;
-  unsigned int crcIdx;
-  unsigned char *bufPtr = (unsigned char *)data;
-
-  for(crcIdx = 0; crcIdx < length ;crcIdx++){
-    temp = (crc >> 8) ^ bufPtr[crcIdx];
-    crc <<= 8;
-    quick = temp ^ (temp >> 4);
-    crc ^= quick;
-    quick <<= 5;
-    crc ^= quick;
-    quick <<= 7;
-    crc ^= quick;
-  }
-  return crc;
+// CRC-CCITT (polynomial 0x1021, initial value 0xFFFF, no reflection) computed with slicing-by-8:
+// s_crcTable[k][b] is the crc contribution of byte b followed by k zero bytes, so 8 bytes are folded in per step.
+struct Crc16Tables
+{
+	uint16_t T[8][256];
+
+	Crc16Tables()
+	{
+		for( int b = 0; b < 256; ++b )
+		{
+			uint16_t crc = (uint16_t)(b << 8);
+			for( int bit = 0; bit < 8; ++bit )
+				crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x1021) : (uint16_t)(crc << 1);
+			T[0][b] = crc;
+		}
+		for( int k = 1; k < 8; ++k )
+			for( int b = 0; b < 256; ++b )
+				T[k][b] = (uint16_t)((T[k-1][b] << 8) ^ T[0][T[k-1][b] >> 8]);
+	}
+};
+static const Crc16Tables s_crcTables;
+
+uint16_t C37118Protocol::CalcCrc16(const char* data, int length)
+{
+	const uint16_t (*T)[256] = s_crcTables.T;
+	const unsigned char* bufPtr = (const unsigned char*)data;
+	uint16_t crc = 0xFFFF;
+
+	for( ; length >= 8; length -= 8, bufPtr += 8 )
+	{
+		crc = T[7][bufPtr[0] ^ (crc >> 8)] ^ T[6][bufPtr[1] ^ (crc & 0xFF)] ^
+			T[5][bufPtr[2]] ^ T[4][bufPtr[3]] ^ T[3][bufPtr[4]] ^ T[2][bufPtr[5]] ^ T[1][bufPtr[6]] ^ T[0][bufPtr[7]];
+	}
+	for( ; length > 0; --length, ++bufPtr )
+		crc = (uint16_t)((crc << 8) ^ T[0][(crc >> 8) ^ *bufPtr]);
+
+	return crc;
+}
+
+bool C37118Protocol::CheckCrc16(const char* frame, int frameSize)
+{
+	// The last two bytes of every frame hold the CRC of everything before them
+	if( frameSize < 2 ) return false;
+	uint16_t received = (uint16_t)(((unsigned char)frame[frameSize-2] << 8) | (unsigned char)frame[frameSize-1]);
+	return CalcCrc16(frame, frameSize - 2) == received;
 }
@@ -26,6 +26,8 @@
 #include <vector>
 #include <cfloat>
 #include <math.h>
+#include "BigEndian.h"
+#include "C37118ConfigStorage.h"
 
 namespace strongridbase
 {
@@ -55,6 +57,14 @@ namespace strongridbase
 		void GetParsedQuality( int* outLeapSecOffset, bool* outLeapSecPending, float* outTimeClockMaxErrorSec, bool* outIsRealiable ) const;
 	};
 
+	// Local times of a received dataframe, in nanoseconds since 1970 (0 if not known)
+	struct C37118FrameTimestamps
+	{
+		int64_t ArrivalNs; // kernel receive timestamp of the socket read that completed the frame
+		int64_t DecodedNs; // decoding finished
+		int64_t DeliveredNs; // handed to the application
+	};
+
 	struct C37118NomFreq
 	{
 		bool Bit0_1xFreqIs50_0xFreqIs60;
@@ -122,6 +132,10 @@ namespace strongridbase
 			*outValidBit = (DigValidInputs & mask) != 0;
 		}
 
+		// Whole-word masks over a digital status word of the dataframe
+		uint16_t ValidBits( uint16_t word ) const { return word & DigValidInputs; }
+		uint16_t AbnormalBits( uint16_t word ) const { return (word ^ DigNormalStatus) & DigValidInputs; } // valid inputs not in their normal state
+
 		void SetValidBit( int idx, bool val )
 		{
 			uint16_t mask = (0x1 << idx);
@@ -189,17 +203,18 @@ namespace strongridbase
 		float Offset;
 	};
 
+	// Names and arrays live in the Storage of the C37118PdcConfiguration
 	struct C37118PmuConfiguration
 	{
-		std::string StationName;
+		C37118Name StationName;
 		uint16_t IdCode;
 		C37118PmuFormat DataFormat;
-		std::vector<std::string> phasorChnNames;
-		std::vector<std::string> analogChnNames;
-		std::vector<std::string> digitalChnNames;
-		std::vector<C37118PhasorUnit> PhasorUnit;
-		std::vector<C37118AnalogUnit> AnalogUnit;
-		std::vector<C37118DigitalUnit> DigitalUnit; // 16 chn names per unit
+		C37118Array<C37118Name> phasorChnNames;
+		C37118Array<C37118Name> analogChnNames;
+		C37118Array<C37118Name> digitalChnNames;
+		C37118Array<C37118PhasorUnit> PhasorUnit;
+		C37118Array<C37118AnalogUnit> AnalogUnit;
+		C37118Array<C37118DigitalUnit> DigitalUnit; // 16 chn names per unit
 		C37118NomFreq NomFreqCode;
 		uint16_t ConfChangeCnt;
 	};
@@ -231,23 +246,25 @@ namespace strongridbase
 	{
 		C37118FrameHeader HeaderCommon;
 		C37118TimeBase TimeBase;
-		std::vector<C37118PmuConfiguration> PMUs;
+		C37118Array<C37118PmuConfiguration> PMUs;
 		C37118DataRate DataRate;
 		uint16_t FooterCrc16;
+		C37118ConfigStorage Storage; // holds the PMUs with their names and arrays - shared by copies
 	};
 
+	// Names and arrays live in the Storage of the C37118PdcConfiguration_Ver3
 	struct C37118PmuConfiguration_Ver3
 	{
-		std::string StationName;
+		C37118Name StationName;
 		uint16_t IdCode;
 		char GlobalPmuId[16];
 		C37118PmuFormat DataFormat;
-		std::vector<std::string> phasorChnNames;
-		std::vector<std::string> analogChnNames;
-		std::vector<std::string> digitalChnNames;
-		std::vector<C37118PhasorScale_Ver3> PhasorScales;
-		std::vector<C37118AnalogScale_Ver3> AnalogScales;
-		std::vector<C37118DigitalUnit> DigitalUnits;
+		C37118Array<C37118Name> phasorChnNames;
+		C37118Array<C37118Name> analogChnNames;
+		C37118Array<C37118Name> digitalChnNames;
+		C37118Array<C37118PhasorScale_Ver3> PhasorScales;
+		C37118Array<C37118AnalogScale_Ver3> AnalogScales;
+		C37118Array<C37118DigitalUnit> DigitalUnits;
 		float POS_LAT;
 		float POS_LON;
 		float POS_ELEV;
@@ -278,9 +295,10 @@ namespace strongridbase
 		C37118FrameHeader HeaderCommon;
 		C37118ContIdx ContinuationIndex;
 		C37118TimeBase TimeBase;
-		std::vector<C37118PmuConfiguration_Ver3> PMUs;
+		C37118Array<C37118PmuConfiguration_Ver3> PMUs;
 		C37118DataRate DataRate;
 		uint16_t FooterCrc16;
+		C37118ConfigStorage Storage; // holds the PMUs with their names and arrays - shared by copies
 	};
 
 	struct C37118PmuDataFrameStat
@@ -347,20 +365,15 @@ namespace strongridbase
 		float Value;
 	};
 
-	struct C37118PmuDataFrameDigitalHelper
+	// Digital channels stay packed as received: channel 'i' is bit i % 16 of status word i / 16
+	inline int DigitalWordCount( int numDigitals ) { return (numDigitals + 15) / 16; }
+	inline bool DigitalBit( const uint16_t* words, int channel ) { return ((words[channel >> 4] >> (channel & 15)) & 0x1) != 0; }
+	inline void SetDigitalBit( uint16_t* words, int channel, bool value )
 	{
-	public:
-		static C37118PmuDataFrameDigitalHelper CreateByBoolArray(std::vector<bool> digBits);
-		static C37118PmuDataFrameDigitalHelper CreateByUint16Arr(std::vector<uint16_t> digWordArray);
-		void PushDigWord( uint16_t word);
-		void PushDigValue( bool bit );
-
-		std::vector<bool> ToBoolArray() const;
-		std::vector<uint16_t> ToDigWord() const;
-
-	private:
-		std::vector<bool> m_digValues;
-	};
+		uint16_t mask = (uint16_t)(0x1 << (channel & 15));
+		words[channel >> 4] = value ? (words[channel >> 4] | mask) : (words[channel >> 4] & ~mask);
+	}
+	void ExpandDigitalBits( const uint16_t* words, int numDigitals, uint8_t* out ); // one byte (0 or 1) per channel
 
 
 	struct C37118PmuDataFrame
@@ -370,7 +383,10 @@ namespace strongridbase
 		float Frequency;
 		float DeltaFrequency;
 		std::vector<C37118PmuDataFrameAnalog> AnalogValues;
-		std::vector<bool> DigitalValues;
+		std::vector<uint16_t> DigitalWords; // packed, see DigitalBit
+
+		int NumDigitals() const { return 16 * (int)DigitalWords.size(); }
+		bool DigitalValue(int digIdx) const { return DigitalBit(DigitalWords.data(), digIdx); }
 	};
 
 	struct C37118PdcDataFrame
@@ -415,62 +431,245 @@ namespace strongridbase
 		C37118PmuFormat DataFormat;
 	};
 
+	struct C37118PdcFlatDataFrame;
+	struct C37118PdcProjectedDataFrame;
+
+	// Channel selection for projected decoding (see C37118PdcDataDecodeInfo::Projection)
+	enum C37118ChannelKind
+	{
+		CHANNEL_PHASOR = 0, // two values: real/imaginary (magnitude/angle if polar phasors are kept)
+		CHANNEL_ANALOG = 1,
+		CHANNEL_DIGITAL = 2, // 0 or 1
+		CHANNEL_FREQUENCY = 3,
+		CHANNEL_DELTA_FREQUENCY = 4,
+		CHANNEL_STAT = 5 // the raw STAT word
+	};
+
+	struct C37118ChannelSelector
+	{
+		int PmuIndex;
+		C37118ChannelKind Kind;
+		int ChannelIndex; // ignored for FREQUENCY, DELTA_FREQUENCY and STAT
+	};
+
+	// Decode step for one selected channel: where to read it and how
+	struct C37118ProjectionStep
+	{
+		enum Operation
+		{
+			FLOAT_PAIR, INT16_PAIR, UINT16_INT16_PAIR, // phasors, the polar integer angle is scaled by 10^-4
+			FLOAT, INT16, INT16_DIV100, UINT16, // analogs, freq/dfreq and STAT
+			DIGITAL_BIT
+		};
+
+		int ByteOffset; // counted from the start of the frame
+		Operation Op;
+		int OutIndex; // index in C37118PdcProjectedDataFrame::Values
+		uint16_t BitMask; // DIGITAL_BIT only
+	};
+
+	// Decode step for one PMU block of a dataframe. The block layout is fixed by the configuration,
+	// so the byte offset and the FORMAT-specialised kernel are resolved once when the plan is built.
+	struct C37118PmuDecodeBlock
+	{
+		typedef void (*DecodeKernel)(const char* src, const C37118PmuDecodeBlock& block, C37118PdcFlatDataFrame* outFrame);
+
+		int PmuIndex;
+		int ByteOffset; // offset of STAT, counted from the start of the frame
+		int ByteLength;
+		int NumPhasors;
+		int NumAnalogs;
+		int NumDigWords;
+		int PhasorOutOffset; // index into the flat frame value arrays
+		int AnalogOutOffset;
+		int DigitalOutOffset;
+		bool KeepPolar; // polar phasors are stored as magnitude/angle instead of being converted
+		DecodeKernel Kernel;
+	};
+
 	struct C37118PdcDataDecodeInfo
 	{
 		C37118TimeBase timebase;
 		std::vector<C37118PmuDataDecodeInfo> PMUs;
+
+		// Keep phasors of polar PMUs as magnitude/angle (default false => all phasors rectangular).
+		// The plan must be rebuilt (BuildDecodePlan) after changing it.
+		bool KeepPolarPhasors;
+
+		// Compiled by CreateDecodeInfoByPdcConfig (see C37118Protocol::BuildDecodePlan)
+		std::vector<C37118PmuDecodeBlock> DecodePlan;
+		int DataFrameSize; // expected FRAMESIZE of a dataframe, in bytes
+		std::vector<int> PolarBatchIndices; // phasors of polar PMUs too short for a vector, converted once per frame
+		uint64_t DecodeLayoutHash; // channel counts and polar flags of all PMUs, see C37118PdcFlatDataFrame::MatchesDecodeInfo
+
+		// Optional subset of channels to decode with ReadProjectedDataFrame. BuildDecodePlan compiles it to
+		// ProjectionPlan; phasors converted from polar to rectangular are listed in ProjectionPolarIndices.
+		std::vector<C37118ChannelSelector> Projection;
+		std::vector<C37118ProjectionStep> ProjectionPlan;
+		std::vector<int> ProjectionPolarIndices;
+		int NumProjectedValues;
+	};
+
+	// Dataframe stored as flat arrays (structure-of-arrays) indexed by PMU offset.
+	// The storage is sized once from the decode info, and then reused for every frame
+	// so that steady-state decoding does not allocate.
+	struct C37118PdcFlatDataFrame
+	{
+		static C37118PdcFlatDataFrame CreateByDecodeInfo(const C37118PdcDataDecodeInfo& config);
+
+		bool MatchesDecodeInfo(const C37118PdcDataDecodeInfo& config) const;
+		C37118PdcDataFrame ToPdcDataFrame() const;
+
+		int NumPmus() const { return (int)Stat.size(); }
+		int NumPhasors(int pmuIdx) const { return PhasorOffset[pmuIdx+1] - PhasorOffset[pmuIdx]; }
+		int NumAnalogs(int pmuIdx) const { return AnalogOffset[pmuIdx+1] - AnalogOffset[pmuIdx]; }
+		int NumDigitals(int pmuIdx) const { return NumDigitalValues[pmuIdx]; }
+		bool DigitalValue(int pmuIdx, int digIdx) const { return DigitalBit(DigitalWords.data() + DigitalWordOffset[pmuIdx], digIdx); }
+
+		C37118FrameHeader HeaderCommon;
+
+		// Per PMU (one entry each)
+		std::vector<C37118PmuDataFrameStat> Stat;
+		std::vector<float> Frequency;
+		std::vector<float> DeltaFrequency;
+		std::vector<int> NumDigitalValues;
+		std::vector<uint8_t> PhasorIsPolar; // 1 => PhasorReal holds the magnitude and PhasorImag the angle (radians)
+
+		// Start index of each PMU in the value arrays below (NumPmus + 1 entries)
+		std::vector<int> PhasorOffset;
+		std::vector<int> AnalogOffset;
+		std::vector<int> DigitalWordOffset;
+
+		// Values of all PMUs
+		std::vector<float> PhasorReal;
+		std::vector<float> PhasorImag;
+		std::vector<float> AnalogValues;
+		std::vector<uint16_t> DigitalWords; // packed, see DigitalBit
+
+		// Scratch for the batched polar -> rectangular conversion, and the layout the storage was sized for
+		std::vector<float> PolarMag;
+		std::vector<float> PolarAngle;
+		uint64_t DecodeLayoutHash;
+
+		uint16_t CRC16;
+		C37118FrameTimestamps Timestamps;
+	};
+
+
+	// Dataframe decoded through a projection: only the selected channels, packed in selection order.
+	struct C37118PdcProjectedDataFrame
+	{
+		static C37118PdcProjectedDataFrame CreateByDecodeInfo(const C37118PdcDataDecodeInfo& config);
+
+		C37118FrameHeader HeaderCommon;
+		std::vector<float> Values;
+
+		// Scratch for the batched polar -> rectangular conversion
+		std::vector<float> PolarMag;
+		std::vector<float> PolarAngle;
+
+		uint16_t CRC16;
+		C37118FrameTimestamps Timestamps;
 	};
 
 
 	class C37118Protocol
 	{
 	public:
-		static void WriteConfigurationFrame(char* data, const C37118PdcConfiguration* pdcconfig, int* offset);
-		static void WriteConfigurationFrame_Ver3( char* data, const C37118PdcConfiguration_Ver3* pdcConfg, int* offset);
-		static void WriteFrameHeader(char* data, const C37118FrameHeader* frameHeader, int* offset);
-		static void WriteDataFrame(char* data, const C37118PdcDataDecodeInfo* config, const C37118PdcDataFrame* dataFrame, int* offset);
-		static void WriteHeaderFrame(char* data, const C37118PdcHeaderFrame* headerFrame, int* offset);
-		static void WriteCommandFrame(char* data, const C37118CommandFrame* cmdFrame, int* offset);
-
-		static void WriteSyncField(char* data,const C37118SyncField* syncField, int* offset);
-		static void WriteFracSecField(char* data, const C37118FracSec* fracSecField, int* offset);
-		static void WriteNomFreqField(char* data, const C37118NomFreq* nomFreqField, int* offset);
-		static void WriteTimeBaseField(char* data,  const C37118TimeBase* timeBaseField , int* offset);
-		static void WriteC37118PmuFormat(char* data, const C37118PmuFormat* pmuFormat, int* offset );
-		static void WriteC37118PhasorUnit(char* data,const C37118PhasorUnit* pmuFormat , int* offset);
-		static void WriteC37118AnalogUnit(char* data,  const C37118AnalogUnit* pmuFormat, int* offset );
-		static void WriteC37118DigitalUnit(char* data, const C37118DigitalUnit* pmuFormat, int* offset );
-		static void WriteC37118PhasorScale_Ver3(char* data, const C37118PhasorScale_Ver3* phScale, int* offset);
-		static void WriteC37118AnalogScale_Ver3(char* data, const C37118AnalogScale_Ver3* phScale, int* offset);
+		static void WriteConfigurationFrame(char* data, int length, const C37118PdcConfiguration* pdcconfig, int* offset);
+		static void WriteConfigurationFrame_Ver3( char* data, int length, const C37118PdcConfiguration_Ver3* pdcConfg, int* offset);
+		static void WriteFrameHeader(char* data, int length, const C37118FrameHeader* frameHeader, int* offset);
+		static void WriteDataFrame(char* data, int length, const C37118PdcDataDecodeInfo* config, const C37118PdcDataFrame* dataFrame, int* offset);
+		static void WriteHeaderFrame(char* data, int length, const C37118PdcHeaderFrame* headerFrame, int* offset);
+		static void WriteCommandFrame(char* data, int length, const C37118CommandFrame* cmdFrame, int* offset);
+
+		static void WriteSyncField(BigEndianWriter& out, const C37118SyncField* syncField);
+		static void WriteFracSecField(BigEndianWriter& out, const C37118FracSec* fracSecField);
+		static void WriteNomFreqField(BigEndianWriter& out, const C37118NomFreq* nomFreqField);
+		static void WriteTimeBaseField(BigEndianWriter& out, const C37118TimeBase* timeBaseField);
+		static void WriteC37118PmuFormat(BigEndianWriter& out, const C37118PmuFormat* pmuFormat);
+		static void WriteC37118PhasorUnit(BigEndianWriter& out, const C37118PhasorUnit* phasorUnit);
+		static void WriteC37118AnalogUnit(BigEndianWriter& out, const C37118AnalogUnit* analogUnit);
+		static void WriteC37118DigitalUnit(BigEndianWriter& out, const C37118DigitalUnit* digUnit);
+		static void WriteC37118PhasorScale_Ver3(BigEndianWriter& out, const C37118PhasorScale_Ver3* phScale);
+		static void WriteC37118AnalogScale_Ver3(BigEndianWriter& out, const C37118AnalogScale_Ver3* angScale);
 
 
 		static C37118PdcConfiguration ReadConfigurationFrame(char* data, int length);
 		static C37118PdcConfiguration_Ver3 ReadConfigurationFrame_Ver3(char* data, int length);
 		static C37118FrameHeader ReadFrameHeader(char* data, int length, int* offset);
 		static C37118PdcDataFrame ReadDataFrame(char* data, int length, const C37118PdcDataDecodeInfo* config, int* offset);
+		static void ReadDataFrame(char* data, int length, const C37118PdcDataDecodeInfo* config, C37118PdcFlatDataFrame* outFrame, int* offset);
+		static void ReadProjectedDataFrame(char* data, int length, const C37118PdcDataDecodeInfo* config, C37118PdcProjectedDataFrame* outFrame, int* offset);
+		static bool DataFrameMatchesConfig(const char* data, int length, const C37118PdcDataDecodeInfo* config); // size fits, no STAT reports a configuration change
 		static C37118PdcHeaderFrame ReadHeaderFrame(char* data, int length, int* offset);
 		static C37118CommandFrame ReadCommandFrame(char* data, int bufferSize, int* offset);
 
-		static C37118SyncField ReadSyncField(char* data, int* offset);
-		static C37118FracSec ReadFracSecField(char* data,int* offset);
-		static C37118NomFreq ReadNomFreqField(char* data, int* offset);
-		static C37118TimeBase ReadTimeBaseField(char* data,int* offset);
-		static C37118PmuFormat ReadC37118PmuFormat(char* data, int* offset );
-		static C37118PhasorUnit ReadC37118PhasorUnit(char* data,int* offset);
-		static C37118AnalogUnit ReadC37118AnalogUnit(char* data, int* offset );
-		static C37118DigitalUnit ReadC37118DigitalUnit(char* data,int* offset );
-		static C37118PhasorScale_Ver3 ReadC37118PhasorScale_Ver3(char* data, int* offset);
-		static C37118AnalogScale_Ver3 ReadC37118AnalogScale_Ver3(char* data, int* offset);
+		static C37118FrameHeader ReadFrameHeader(BigEndianReader& in);
+		static C37118SyncField ReadSyncField(BigEndianReader& in);
+		static C37118FracSec ReadFracSecField(BigEndianReader& in);
+		static C37118NomFreq ReadNomFreqField(BigEndianReader& in);
+		static C37118TimeBase ReadTimeBaseField(BigEndianReader& in);
+		static C37118PmuFormat ReadC37118PmuFormat(BigEndianReader& in);
+		static C37118PhasorUnit ReadC37118PhasorUnit(BigEndianReader& in);
+		static C37118AnalogUnit ReadC37118AnalogUnit(BigEndianReader& in);
+		static C37118DigitalUnit ReadC37118DigitalUnit(BigEndianReader& in);
+		static C37118PhasorScale_Ver3 ReadC37118PhasorScale_Ver3(BigEndianReader& in);
+		static C37118AnalogScale_Ver3 ReadC37118AnalogScale_Ver3(BigEndianReader& in);
+		static void ReadPmuConfiguration(BigEndianReader& in, C37118ConfigBuilder& builder, C37118PmuConfiguration* pmuCfg);
+		static void ReadPmuConfiguration_Ver3(BigEndianReader& in, C37118ConfigBuilder& builder, C37118PmuConfiguration_Ver3* pmuCfg);
+		static int PmuConfigurationSize_Ver3(const char* data, int length); // 0 while the channel names are not all in 'length'
+
+		// Size of a PMU record without channels (empty STN for CFG-3), the least NUM_PMU records can take
+		enum { MIN_PMU_CONFIGURATION_SIZE = 16 + 2 + 2 + 6 + 2 + 2 };
+		enum { MIN_PMU_CONFIGURATION_SIZE_VER3 = 1 + 2 + 16 + 2 + 6 + 12 + 1 + 4 + 4 + 2 + 2 };
 
 		// Helper functions
 		static C37118PdcDataDecodeInfo CreateDecodeInfoByPdcConfig(const C37118PdcConfiguration& pdccfg) ;
 		static C37118PdcDataDecodeInfo CreateDecodeInfoByPdcConfig(const C37118PdcConfiguration_Ver3& pdccfg);
+		static void BuildDecodePlan(C37118PdcDataDecodeInfo* decodeInfo);
+		static void BuildProjectionPlan(C37118PdcDataDecodeInfo* decodeInfo);
 		static C37118PdcConfiguration DowngradePdcConfig(const C37118PdcConfiguration_Ver3* pdccfg);
-		static C37118PmuConfiguration DowngradePmuConfig(const C37118PmuConfiguration_Ver3* pdccfg);
+		static C37118PmuConfiguration DowngradePmuConfig(const C37118PmuConfiguration_Ver3* pdccfg, C37118ConfigBuilder& builder);
 
-		static uint16_t CalcCrc16(char* data, int length);
+		static uint16_t CalcCrc16(const char* data, int length);
+		static bool CheckCrc16(const char* frame, int frameSize); // true if the CHK field of the frame matches its content
+
+	private:
+		static void WriteFrameHeader(BigEndianWriter& out, const C37118FrameHeader* frameHeader);
+		static void WriteFooter(BigEndianWriter& out, int offsetAtStart);
+	};
+
+	// Reassembles a CFG-3 sent as continuation frames (CONT_IDX 1, 2, ..., 0xFFFF). Every frame is parsed as it
+	// arrives - TIME_BASE/NUM_PMU, then each PMU record, then DATA_RATE - straight out of the frame buffer. Only
+	// a record split between two frames has its start copied over, so the frames are never joined in memory.
+	class C37118ConfigurationAssembler_Ver3
+	{
+	public:
+		C37118ConfigurationAssembler_Ver3();
+		void Reset();
+
+		// Takes the next CFG-3 frame (CRC already checked). Returns true, with the configuration moved to
+		// 'completed', once the last frame is in. A frame out of sequence drops the partial configuration.
+		bool AddFrame(const char* frame, int length, C37118PdcConfiguration_Ver3* completed);
+		bool InProgress() const { return m_nextFrameIndex >= 0; }
+
+	private:
+		C37118ConfigurationAssembler_Ver3(const C37118ConfigurationAssembler_Ver3&); // the builder refers to m_config
+		enum class ParseStage { TimeBaseAndNumPmu, PmuRecord, DataRate, Complete };
+		int NextItemSize(const char* data, int length) const; // 0 while unknown
+		void ReadItem(const char* data, int size, int bytesAfter); // bytesAfter: left in the current frame after the item
 
 	private:
-		static void WriteFooter(char* data, int offsetAtStart, int* offset);
+		C37118PdcConfiguration_Ver3 m_config;
+		C37118ConfigBuilder m_builder; // fills m_config.Storage
+		C37118PmuConfiguration_Ver3* m_pmus; // m_config.PMUs while they are read, 0 while they are collected in m_continuedPmus
+		std::vector<C37118PmuConfiguration_Ver3> m_continuedPmus; // records of a continued configuration, as they arrive
+		ParseStage m_stage;
+		int m_numPmu;
+		int m_numPmuRead;
+		bool m_lastFrame;
+		int m_nextFrameIndex; // GetCurrentFrameIndex() expected next, -1 when no configuration is in progress
+		std::vector<char> m_pending; // start of an item continued in the next frame
 	};
 }
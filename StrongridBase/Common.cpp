@@ -24,16 +24,36 @@
 #	include <Windows.h>
 #endif
 #include "common.h"
-#include <ctime>        // std::gmtime, std::mktime, std::time_t, std::tm
+#include <chrono>       // std::chrono::system_clock
+#include <ctime>        // gmtime_r/gmtime_s, std::mktime, std::time_t, std::tm
 
 using namespace strongridbase;
 
 std::tm TimeConversionHelper::SecondsSinceEpochToDateTime(uint64_t SecondsSinceEpoch)
 {
-	return *std::gmtime(reinterpret_cast<std::time_t*>(&SecondsSinceEpoch));
+	// Reentrant variants - std::gmtime returns a buffer shared by all threads
+	std::time_t seconds = static_cast<std::time_t>(SecondsSinceEpoch);
+	std::tm result;
+#ifdef _WIN32
+	gmtime_s(&result, &seconds);
+#else
+	gmtime_r(&seconds, &result);
+#endif
+	return result;
 }
 
 uint32_t TimeConversionHelper::GetSocByDateTime(const std::tm* tms)
 {
 	return std::mktime(const_cast<std::tm*>(tms));
 }
+
+int64_t TimeConversionHelper::GetWallClockNs()
+{
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+int64_t TimeConversionHelper::SocToNs(uint32_t soc, uint32_t fractionOfSecond, uint32_t timeBase)
+{
+	int64_t fractionNs = timeBase != 0 ? (int64_t)fractionOfSecond * 1000000000 / timeBase : 0;
+	return (int64_t)soc * 1000000000 + fractionNs;
+}
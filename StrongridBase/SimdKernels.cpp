@@ -0,0 +1,548 @@
+/*
+*  SimdKernels.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <float.h>
+#include <math.h>
+#include "SimdKernels.h"
+#include "BigEndian.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#	define STRONGRID_SIMD_X86
+#	include <immintrin.h>
+#	ifdef _MSC_VER
+#		include <intrin.h>
+#		define STRONGRID_TARGET(isa)
+#	else
+#		define STRONGRID_TARGET(isa) __attribute__((target(isa)))
+#	endif
+#endif
+
+using namespace strongridbase;
+
+
+// ------------------------------------------------------------------------------------------------------------------------
+// Scalar implementation - byte order independent, also handles the tails of the vector loops
+// ------------------------------------------------------------------------------------------------------------------------
+
+
+static void DecodeFloatPairs_Scalar(const char* src, int numPairs, float* outA, float* outB)
+{
+	for( int i = 0; i < numPairs; ++i )
+	{
+		outA[i] = LoadBigEndian<float>(src + i*8);
+		outB[i] = LoadBigEndian<float>(src + i*8 + 4);
+	}
+}
+
+static void DecodeInt16Pairs_Scalar(const char* src, int numPairs, float* outA, float* outB)
+{
+	for( int i = 0; i < numPairs; ++i )
+	{
+		outA[i] = (float)LoadBigEndian<int16_t>(src + i*4);
+		outB[i] = (float)LoadBigEndian<int16_t>(src + i*4 + 2);
+	}
+}
+
+static void DecodeUInt16Int16Pairs_Scalar(const char* src, int numPairs, float* outMag, float* outAngle)
+{
+	for( int i = 0; i < numPairs; ++i )
+	{
+		outMag[i] = (float)LoadBigEndian<uint16_t>(src + i*4);
+		outAngle[i] = (float)LoadBigEndian<int16_t>(src + i*4 + 2);
+	}
+}
+
+static void DecodeFloats_Scalar(const char* src, int count, float* out)
+{
+	for( int i = 0; i < count; ++i )
+		out[i] = LoadBigEndian<float>(src + i*4);
+}
+
+static void DecodeInt16s_Scalar(const char* src, int count, float* out)
+{
+	for( int i = 0; i < count; ++i )
+		out[i] = (float)LoadBigEndian<int16_t>(src + i*2);
+}
+
+static void DecodeUInt16s_Scalar(const char* src, int count, uint16_t* out)
+{
+	for( int i = 0; i < count; ++i )
+		out[i] = LoadBigEndian<uint16_t>(src + i*2);
+}
+
+// sincos constants: pi/2 split in three parts for an exact Cody-Waite reduction, minimax polynomials on [-pi/4, pi/4]
+static const float SINCOS_TWO_OVER_PI = 0.636619772367581343f;
+static const float SINCOS_PIO2_1 = 1.5703125f;
+static const float SINCOS_PIO2_2 = 4.837512969970703125e-4f;
+static const float SINCOS_PIO2_3 = 7.54978995489188216e-8f;
+static const float SINCOS_MAX_ANGLE = 8192.0f;
+static const float SINCOS_ROUND = 12582912.0f;
+static const float SIN_C1 = -1.6666654611e-1f, SIN_C2 = 8.3321608736e-3f, SIN_C3 = -1.9515295891e-4f;
+static const float COS_C1 = 4.166664568298827e-2f, COS_C2 = -1.388731625493765e-3f, COS_C3 = 2.443315711809948e-5f;
+
+static inline void SinCos_Scalar(float x, float* outSin, float* outCos)
+{
+	if( !(fabsf(x) <= SINCOS_MAX_ANGLE) )
+	{
+		*outSin = sinf(x);
+		*outCos = cosf(x);
+		return;
+	}
+
+	// Same operation order as the vector versions. Adding 1.5 * 2^23 rounds to the nearest integer like
+	// cvtps2dq (|x * 2/pi| < 2^22 here) - lrintf does the same, but is a library call
+#if FLT_EVAL_METHOD == 0
+	float qf = (x * SINCOS_TWO_OVER_PI + SINCOS_ROUND) - SINCOS_ROUND;
+	int q = (int)qf;
+#else
+	int q = (int)lrintf(x * SINCOS_TWO_OVER_PI); // excess precision (x87) would defeat the rounding constant
+	float qf = (float)q;
+#endif
+	float r = ((x - qf * SINCOS_PIO2_1) - qf * SINCOS_PIO2_2) - qf * SINCOS_PIO2_3;
+	float z = r * r;
+	float sn = r + (r * z) * (SIN_C1 + z * (SIN_C2 + z * SIN_C3));
+	float cs = (1.0f - 0.5f * z) + (z * z) * (COS_C1 + z * (COS_C2 + z * COS_C3));
+
+	// Quadrant fix-up
+	if( q & 1 ) { float tmp = sn; sn = cs; cs = tmp; }
+	if( q & 2 ) sn = -sn;
+	if( (q + 1) & 2 ) cs = -cs;
+	*outSin = sn;
+	*outCos = cs;
+}
+
+static void PolarToRect_Scalar(float* magToReal, float* angleToImag, int count)
+{
+	for( int i = 0; i < count; ++i )
+	{
+		float sn, cs;
+		SinCos_Scalar(angleToImag[i], &sn, &cs);
+		float mag = magToReal[i];
+		magToReal[i] = mag * cs;
+		angleToImag[i] = mag * sn;
+	}
+}
+
+
+#ifdef STRONGRID_SIMD_X86
+
+// ------------------------------------------------------------------------------------------------------------------------
+// SSE2 implementation
+// ------------------------------------------------------------------------------------------------------------------------
+
+
+STRONGRID_TARGET("sse2") static inline __m128i ByteSwap16_SSE2(__m128i x)
+{
+	return _mm_or_si128(_mm_slli_epi16(x, 8), _mm_srli_epi16(x, 8));
+}
+
+STRONGRID_TARGET("sse2") static inline __m128i ByteSwap32_SSE2(__m128i x)
+{
+	x = ByteSwap16_SSE2(x);
+	x = _mm_shufflelo_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+	return _mm_shufflehi_epi16(x, _MM_SHUFFLE(2, 3, 0, 1));
+}
+
+STRONGRID_TARGET("sse2") static void DecodeFloatPairs_SSE2(const char* src, int numPairs, float* outA, float* outB)
+{
+	int i = 0;
+	for( ; i + 4 <= numPairs; i += 4 )
+	{
+		// a0 b0 a1 b1 | a2 b2 a3 b3
+		__m128 v0 = _mm_castsi128_ps(ByteSwap32_SSE2(_mm_loadu_si128((const __m128i*)(src + i*8))));
+		__m128 v1 = _mm_castsi128_ps(ByteSwap32_SSE2(_mm_loadu_si128((const __m128i*)(src + i*8 + 16))));
+		_mm_storeu_ps(outA + i, _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0)));
+		_mm_storeu_ps(outB + i, _mm_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1)));
+	}
+	DecodeFloatPairs_Scalar(src + i*8, numPairs - i, outA + i, outB + i);
+}
+
+STRONGRID_TARGET("sse2") static void DecodeInt16Pairs_SSE2(const char* src, int numPairs, float* outA, float* outB)
+{
+	int i = 0;
+	for( ; i + 4 <= numPairs; i += 4 )
+	{
+		// After the swap each 32-bit lane holds a in the low half and b in the high half
+		__m128i v = ByteSwap16_SSE2(_mm_loadu_si128((const __m128i*)(src + i*4)));
+		_mm_storeu_ps(outA + i, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_slli_epi32(v, 16), 16)));
+		_mm_storeu_ps(outB + i, _mm_cvtepi32_ps(_mm_srai_epi32(v, 16)));
+	}
+	DecodeInt16Pairs_Scalar(src + i*4, numPairs - i, outA + i, outB + i);
+}
+
+STRONGRID_TARGET("sse2") static void DecodeUInt16Int16Pairs_SSE2(const char* src, int numPairs, float* outMag, float* outAngle)
+{
+	const __m128i lowMask = _mm_set1_epi32(0xFFFF);
+	int i = 0;
+	for( ; i + 4 <= numPairs; i += 4 )
+	{
+		__m128i v = ByteSwap16_SSE2(_mm_loadu_si128((const __m128i*)(src + i*4)));
+		_mm_storeu_ps(outMag + i, _mm_cvtepi32_ps(_mm_and_si128(v, lowMask)));
+		_mm_storeu_ps(outAngle + i, _mm_cvtepi32_ps(_mm_srai_epi32(v, 16)));
+	}
+	DecodeUInt16Int16Pairs_Scalar(src + i*4, numPairs - i, outMag + i, outAngle + i);
+}
+
+STRONGRID_TARGET("sse2") static void DecodeFloats_SSE2(const char* src, int count, float* out)
+{
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+		_mm_storeu_si128((__m128i*)(out + i), ByteSwap32_SSE2(_mm_loadu_si128((const __m128i*)(src + i*4))));
+	DecodeFloats_Scalar(src + i*4, count - i, out + i);
+}
+
+STRONGRID_TARGET("sse2") static void DecodeInt16s_SSE2(const char* src, int count, float* out)
+{
+	int i = 0;
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m128i v = ByteSwap16_SSE2(_mm_loadu_si128((const __m128i*)(src + i*2)));
+		_mm_storeu_ps(out + i, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpacklo_epi16(v, v), 16)));
+		_mm_storeu_ps(out + i + 4, _mm_cvtepi32_ps(_mm_srai_epi32(_mm_unpackhi_epi16(v, v), 16)));
+	}
+	DecodeInt16s_Scalar(src + i*2, count - i, out + i);
+}
+
+STRONGRID_TARGET("sse2") static void DecodeUInt16s_SSE2(const char* src, int count, uint16_t* out)
+{
+	int i = 0;
+	for( ; i + 8 <= count; i += 8 )
+		_mm_storeu_si128((__m128i*)(out + i), ByteSwap16_SSE2(_mm_loadu_si128((const __m128i*)(src + i*2))));
+	DecodeUInt16s_Scalar(src + i*2, count - i, out + i);
+}
+
+STRONGRID_TARGET("sse2") static void PolarToRect_SSE2(float* magToReal, float* angleToImag, int count)
+{
+	const __m128 absMask = _mm_castsi128_ps(_mm_set1_epi32(0x7FFFFFFF));
+	const __m128i one = _mm_set1_epi32(1), two = _mm_set1_epi32(2);
+	int i = 0;
+	for( ; i + 4 <= count; i += 4 )
+	{
+		__m128 mag = _mm_loadu_ps(magToReal + i);
+		__m128 x = _mm_loadu_ps(angleToImag + i);
+
+		// Out of range / NaN lanes take the scalar route
+		if( _mm_movemask_ps(_mm_cmple_ps(_mm_and_ps(x, absMask), _mm_set1_ps(SINCOS_MAX_ANGLE))) != 0xF )
+		{
+			PolarToRect_Scalar(magToReal + i, angleToImag + i, 4);
+			continue;
+		}
+
+		__m128i q = _mm_cvtps_epi32(_mm_mul_ps(x, _mm_set1_ps(SINCOS_TWO_OVER_PI)));
+		__m128 qf = _mm_cvtepi32_ps(q);
+		__m128 r = _mm_sub_ps(x, _mm_mul_ps(qf, _mm_set1_ps(SINCOS_PIO2_1)));
+		r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(SINCOS_PIO2_2)));
+		r = _mm_sub_ps(r, _mm_mul_ps(qf, _mm_set1_ps(SINCOS_PIO2_3)));
+		__m128 z = _mm_mul_ps(r, r);
+
+		__m128 sn = _mm_add_ps(_mm_set1_ps(SIN_C2), _mm_mul_ps(z, _mm_set1_ps(SIN_C3)));
+		sn = _mm_add_ps(_mm_set1_ps(SIN_C1), _mm_mul_ps(z, sn));
+		sn = _mm_add_ps(r, _mm_mul_ps(_mm_mul_ps(r, z), sn));
+		__m128 cs = _mm_add_ps(_mm_set1_ps(COS_C2), _mm_mul_ps(z, _mm_set1_ps(COS_C3)));
+		cs = _mm_add_ps(_mm_set1_ps(COS_C1), _mm_mul_ps(z, cs));
+		cs = _mm_add_ps(_mm_sub_ps(_mm_set1_ps(1.0f), _mm_mul_ps(_mm_set1_ps(0.5f), z)), _mm_mul_ps(_mm_mul_ps(z, z), cs));
+
+		// Quadrant fix-up: swap on odd quadrants, then flip the signs
+		__m128 swap = _mm_castsi128_ps(_mm_cmpeq_epi32(_mm_and_si128(q, one), one));
+		__m128 s = _mm_or_ps(_mm_and_ps(swap, cs), _mm_andnot_ps(swap, sn));
+		__m128 c = _mm_or_ps(_mm_and_ps(swap, sn), _mm_andnot_ps(swap, cs));
+		s = _mm_xor_ps(s, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(q, two), 30)));
+		c = _mm_xor_ps(c, _mm_castsi128_ps(_mm_slli_epi32(_mm_and_si128(_mm_add_epi32(q, one), two), 30)));
+
+		_mm_storeu_ps(magToReal + i, _mm_mul_ps(mag, c));
+		_mm_storeu_ps(angleToImag + i, _mm_mul_ps(mag, s));
+	}
+	PolarToRect_Scalar(magToReal + i, angleToImag + i, count - i);
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------
+// AVX2 implementation
+// ------------------------------------------------------------------------------------------------------------------------
+
+
+STRONGRID_TARGET("avx2") static inline __m256i ByteSwap16_AVX2(__m256i x)
+{
+	const __m256i mask = _mm256_setr_epi8(
+		1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14,
+		1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	return _mm256_shuffle_epi8(x, mask);
+}
+
+STRONGRID_TARGET("avx2") static inline __m256i ByteSwap32_AVX2(__m256i x)
+{
+	const __m256i mask = _mm256_setr_epi8(
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12,
+		3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+	return _mm256_shuffle_epi8(x, mask);
+}
+
+STRONGRID_TARGET("avx2") static void DecodeFloatPairs_AVX2(const char* src, int numPairs, float* outA, float* outB)
+{
+	int i = 0;
+	for( ; i + 8 <= numPairs; i += 8 )
+	{
+		__m256 v0 = _mm256_castsi256_ps(ByteSwap32_AVX2(_mm256_loadu_si256((const __m256i*)(src + i*8))));
+		__m256 v1 = _mm256_castsi256_ps(ByteSwap32_AVX2(_mm256_loadu_si256((const __m256i*)(src + i*8 + 32))));
+
+		// In-lane shuffle gives a0 a1 a4 a5 | a2 a3 a6 a7; the 64-bit permute restores the order
+		__m256 a = _mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(2, 0, 2, 0));
+		__m256 b = _mm256_shuffle_ps(v0, v1, _MM_SHUFFLE(3, 1, 3, 1));
+		a = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(a), _MM_SHUFFLE(3, 1, 2, 0)));
+		b = _mm256_castpd_ps(_mm256_permute4x64_pd(_mm256_castps_pd(b), _MM_SHUFFLE(3, 1, 2, 0)));
+		_mm256_storeu_ps(outA + i, a);
+		_mm256_storeu_ps(outB + i, b);
+	}
+	_mm256_zeroupper(); // the tail is not VEX encoded
+	DecodeFloatPairs_SSE2(src + i*8, numPairs - i, outA + i, outB + i);
+}
+
+STRONGRID_TARGET("avx2") static void DecodeInt16Pairs_AVX2(const char* src, int numPairs, float* outA, float* outB)
+{
+	int i = 0;
+	for( ; i + 8 <= numPairs; i += 8 )
+	{
+		__m256i v = ByteSwap16_AVX2(_mm256_loadu_si256((const __m256i*)(src + i*4)));
+		_mm256_storeu_ps(outA + i, _mm256_cvtepi32_ps(_mm256_srai_epi32(_mm256_slli_epi32(v, 16), 16)));
+		_mm256_storeu_ps(outB + i, _mm256_cvtepi32_ps(_mm256_srai_epi32(v, 16)));
+	}
+	_mm256_zeroupper(); // the tail is not VEX encoded
+	DecodeInt16Pairs_SSE2(src + i*4, numPairs - i, outA + i, outB + i);
+}
+
+STRONGRID_TARGET("avx2") static void DecodeUInt16Int16Pairs_AVX2(const char* src, int numPairs, float* outMag, float* outAngle)
+{
+	const __m256i lowMask = _mm256_set1_epi32(0xFFFF);
+	int i = 0;
+	for( ; i + 8 <= numPairs; i += 8 )
+	{
+		__m256i v = ByteSwap16_AVX2(_mm256_loadu_si256((const __m256i*)(src + i*4)));
+		_mm256_storeu_ps(outMag + i, _mm256_cvtepi32_ps(_mm256_and_si256(v, lowMask)));
+		_mm256_storeu_ps(outAngle + i, _mm256_cvtepi32_ps(_mm256_srai_epi32(v, 16)));
+	}
+	_mm256_zeroupper(); // the tail is not VEX encoded
+	DecodeUInt16Int16Pairs_SSE2(src + i*4, numPairs - i, outMag + i, outAngle + i);
+}
+
+STRONGRID_TARGET("avx2") static void DecodeFloats_AVX2(const char* src, int count, float* out)
+{
+	int i = 0;
+	for( ; i + 8 <= count; i += 8 )
+		_mm256_storeu_si256((__m256i*)(out + i), ByteSwap32_AVX2(_mm256_loadu_si256((const __m256i*)(src + i*4))));
+	_mm256_zeroupper(); // the tail is not VEX encoded
+	DecodeFloats_SSE2(src + i*4, count - i, out + i);
+}
+
+STRONGRID_TARGET("avx2") static void DecodeInt16s_AVX2(const char* src, int count, float* out)
+{
+	const __m128i mask = _mm_setr_epi8(1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14);
+	int i = 0;
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m128i v = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(src + i*2)), mask);
+		_mm256_storeu_ps(out + i, _mm256_cvtepi32_ps(_mm256_cvtepi16_epi32(v)));
+	}
+	_mm256_zeroupper(); // the tail is not VEX encoded
+	DecodeInt16s_Scalar(src + i*2, count - i, out + i);
+}
+
+STRONGRID_TARGET("avx2") static void DecodeUInt16s_AVX2(const char* src, int count, uint16_t* out)
+{
+	int i = 0;
+	for( ; i + 16 <= count; i += 16 )
+		_mm256_storeu_si256((__m256i*)(out + i), ByteSwap16_AVX2(_mm256_loadu_si256((const __m256i*)(src + i*2))));
+	_mm256_zeroupper(); // the tail is not VEX encoded
+	DecodeUInt16s_SSE2(src + i*2, count - i, out + i);
+}
+
+STRONGRID_TARGET("avx2") static void PolarToRect_AVX2(float* magToReal, float* angleToImag, int count)
+{
+	const __m256 absMask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7FFFFFFF));
+	const __m256i one = _mm256_set1_epi32(1), two = _mm256_set1_epi32(2);
+	int i = 0;
+	for( ; i + 8 <= count; i += 8 )
+	{
+		__m256 mag = _mm256_loadu_ps(magToReal + i);
+		__m256 x = _mm256_loadu_ps(angleToImag + i);
+
+		if( _mm256_movemask_ps(_mm256_cmp_ps(_mm256_and_ps(x, absMask), _mm256_set1_ps(SINCOS_MAX_ANGLE), _CMP_LE_OQ)) != 0xFF )
+		{
+			_mm256_zeroupper(); // the scalar route is not VEX encoded
+			PolarToRect_Scalar(magToReal + i, angleToImag + i, 8);
+			continue;
+		}
+
+		__m256i q = _mm256_cvtps_epi32(_mm256_mul_ps(x, _mm256_set1_ps(SINCOS_TWO_OVER_PI)));
+		__m256 qf = _mm256_cvtepi32_ps(q);
+		__m256 r = _mm256_sub_ps(x, _mm256_mul_ps(qf, _mm256_set1_ps(SINCOS_PIO2_1)));
+		r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(SINCOS_PIO2_2)));
+		r = _mm256_sub_ps(r, _mm256_mul_ps(qf, _mm256_set1_ps(SINCOS_PIO2_3)));
+		__m256 z = _mm256_mul_ps(r, r);
+
+		__m256 sn = _mm256_add_ps(_mm256_set1_ps(SIN_C2), _mm256_mul_ps(z, _mm256_set1_ps(SIN_C3)));
+		sn = _mm256_add_ps(_mm256_set1_ps(SIN_C1), _mm256_mul_ps(z, sn));
+		sn = _mm256_add_ps(r, _mm256_mul_ps(_mm256_mul_ps(r, z), sn));
+		__m256 cs = _mm256_add_ps(_mm256_set1_ps(COS_C2), _mm256_mul_ps(z, _mm256_set1_ps(COS_C3)));
+		cs = _mm256_add_ps(_mm256_set1_ps(COS_C1), _mm256_mul_ps(z, cs));
+		cs = _mm256_add_ps(_mm256_sub_ps(_mm256_set1_ps(1.0f), _mm256_mul_ps(_mm256_set1_ps(0.5f), z)), _mm256_mul_ps(_mm256_mul_ps(z, z), cs));
+
+		__m256 swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(q, one), one));
+		__m256 s = _mm256_blendv_ps(sn, cs, swap);
+		__m256 c = _mm256_blendv_ps(cs, sn, swap);
+		s = _mm256_xor_ps(s, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(q, two), 30)));
+		c = _mm256_xor_ps(c, _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(q, one), two), 30)));
+
+		_mm256_storeu_ps(magToReal + i, _mm256_mul_ps(mag, c));
+		_mm256_storeu_ps(angleToImag + i, _mm256_mul_ps(mag, s));
+	}
+	_mm256_zeroupper(); // the tail is not VEX encoded
+	PolarToRect_SSE2(magToReal + i, angleToImag + i, count - i);
+}
+
+#endif
+
+
+// ------------------------------------------------------------------------------------------------------------------------
+// Runtime dispatch
+// ------------------------------------------------------------------------------------------------------------------------
+
+
+struct SimdKernelTable
+{
+	SimdKernels::InstructionSet Isa;
+	void (*DecodeFloatPairs)(const char*, int, float*, float*);
+	void (*DecodeInt16Pairs)(const char*, int, float*, float*);
+	void (*DecodeUInt16Int16Pairs)(const char*, int, float*, float*);
+	void (*DecodeFloats)(const char*, int, float*);
+	void (*DecodeInt16s)(const char*, int, float*);
+	void (*DecodeUInt16s)(const char*, int, uint16_t*);
+	void (*PolarToRect)(float*, float*, int);
+};
+
+static const SimdKernelTable s_scalarKernels = { SimdKernels::SCALAR,
+	DecodeFloatPairs_Scalar, DecodeInt16Pairs_Scalar, DecodeUInt16Int16Pairs_Scalar,
+	DecodeFloats_Scalar, DecodeInt16s_Scalar, DecodeUInt16s_Scalar,
+	PolarToRect_Scalar };
+
+#ifdef STRONGRID_SIMD_X86
+static const SimdKernelTable s_sse2Kernels = { SimdKernels::SSE2,
+	DecodeFloatPairs_SSE2, DecodeInt16Pairs_SSE2, DecodeUInt16Int16Pairs_SSE2,
+	DecodeFloats_SSE2, DecodeInt16s_SSE2, DecodeUInt16s_SSE2,
+	PolarToRect_SSE2 };
+
+static const SimdKernelTable s_avx2Kernels = { SimdKernels::AVX2,
+	DecodeFloatPairs_AVX2, DecodeInt16Pairs_AVX2, DecodeUInt16Int16Pairs_AVX2,
+	DecodeFloats_AVX2, DecodeInt16s_AVX2, DecodeUInt16s_AVX2,
+	PolarToRect_AVX2 };
+#endif
+
+static const SimdKernelTable* KernelTableFor(SimdKernels::InstructionSet isa)
+{
+#ifdef STRONGRID_SIMD_X86
+	if( isa == SimdKernels::AVX2 ) return &s_avx2Kernels;
+	if( isa == SimdKernels::SSE2 ) return &s_sse2Kernels;
+#endif
+	return &s_scalarKernels;
+}
+
+// Resolved once at load time; SelectInstructionSet must not race with decoding threads
+static const SimdKernelTable* s_activeKernels = KernelTableFor(SimdKernels::DetectInstructionSet());
+
+static inline const SimdKernelTable* ActiveKernels()
+{
+	return s_activeKernels;
+}
+
+SimdKernels::InstructionSet SimdKernels::DetectInstructionSet()
+{
+#if defined(STRONGRID_SIMD_X86) && defined(_MSC_VER)
+	int regs[4];
+	__cpuid(regs, 0);
+	int maxLeaf = regs[0];
+	__cpuid(regs, 1);
+	bool hasSse2 = (regs[3] & (1 << 26)) != 0;
+	bool osAvx = (regs[2] & (1 << 27)) != 0 && (regs[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+	bool hasAvx2 = false;
+	if( osAvx && maxLeaf >= 7 )
+	{
+		__cpuidex(regs, 7, 0);
+		hasAvx2 = (regs[1] & (1 << 5)) != 0;
+	}
+	if( hasAvx2 ) return AVX2;
+	if( hasSse2 ) return SSE2;
+	return SCALAR;
+#elif defined(STRONGRID_SIMD_X86)
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports("avx2") ) return AVX2;
+	if( __builtin_cpu_supports("sse2") ) return SSE2;
+	return SCALAR;
+#else
+	return SCALAR;
+#endif
+}
+
+SimdKernels::InstructionSet SimdKernels::ActiveInstructionSet()
+{
+	return ActiveKernels()->Isa;
+}
+
+void SimdKernels::SelectInstructionSet(InstructionSet isa)
+{
+	InstructionSet supported = DetectInstructionSet();
+	if( isa > supported ) isa = supported;
+	s_activeKernels = KernelTableFor(isa);
+}
+
+void SimdKernels::DecodeFloatPairs(const char* src, int numPairs, float* outA, float* outB)
+{
+	ActiveKernels()->DecodeFloatPairs(src, numPairs, outA, outB);
+}
+
+void SimdKernels::DecodeInt16Pairs(const char* src, int numPairs, float* outA, float* outB)
+{
+	ActiveKernels()->DecodeInt16Pairs(src, numPairs, outA, outB);
+}
+
+void SimdKernels::DecodeUInt16Int16Pairs(const char* src, int numPairs, float* outMag, float* outAngle)
+{
+	ActiveKernels()->DecodeUInt16Int16Pairs(src, numPairs, outMag, outAngle);
+}
+
+void SimdKernels::DecodeFloats(const char* src, int count, float* out)
+{
+	ActiveKernels()->DecodeFloats(src, count, out);
+}
+
+void SimdKernels::DecodeInt16s(const char* src, int count, float* out)
+{
+	ActiveKernels()->DecodeInt16s(src, count, out);
+}
+
+void SimdKernels::DecodeUInt16s(const char* src, int count, uint16_t* out)
+{
+	ActiveKernels()->DecodeUInt16s(src, count, out);
+}
+
+void SimdKernels::PolarToRect(float* magToReal, float* angleToImag, int count)
+{
+	ActiveKernels()->PolarToRect(magToReal, angleToImag, count);
+}
@@ -0,0 +1,65 @@
+/*
+*  SimdKernels.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#pragma once
+#include <stdint.h>
+
+namespace strongridbase
+{
+	// Bulk conversion of big-endian value blocks (phasors, analogs, digital words) to host floats/words.
+	// The implementation is selected at runtime: AVX2 or SSE2 on x86, with a portable scalar fallback.
+	class SimdKernels
+	{
+	public:
+		enum InstructionSet
+		{
+			SCALAR = 0,
+			SSE2 = 1,
+			AVX2 = 2
+		};
+
+		// Pairs of big-endian floats (a0 b0 a1 b1 ...) de-interleaved into outA/outB
+		static void DecodeFloatPairs(const char* src, int numPairs, float* outA, float* outB);
+
+		// Pairs of big-endian int16 (a0 b0 a1 b1 ...) de-interleaved and widened to float
+		static void DecodeInt16Pairs(const char* src, int numPairs, float* outA, float* outB);
+
+		// Pairs of big-endian uint16 magnitude + int16 angle, widened to float (angle is not scaled)
+		static void DecodeUInt16Int16Pairs(const char* src, int numPairs, float* outMag, float* outAngle);
+
+		static void DecodeFloats(const char* src, int count, float* out);
+		static void DecodeInt16s(const char* src, int count, float* out);
+		static void DecodeUInt16s(const char* src, int count, uint16_t* out);
+
+		// In-place polar -> rectangular: magToReal[i] = mag*cos(angle), angleToImag[i] = mag*sin(angle).
+		// Uses a polynomial sincos (Cody-Waite reduction to [-pi/4, pi/4], minimax polynomials of degree 7/8).
+		// For |angle| <= 8192 rad the measured error of cos/sin is below 1e-7 absolute (libm cosf: 3e-8), i.e.
+		// relative error of the rectangular components ~1e-7 of the magnitude. Larger angles, infinities and
+		// NaNs are routed to the C library cos/sin. All instruction sets return bit-identical results.
+		static void PolarToRect(float* magToReal, float* angleToImag, int count);
+
+		// Best instruction set supported by the CPU, and the one currently in use
+		static InstructionSet DetectInstructionSet();
+		static InstructionSet ActiveInstructionSet();
+		static void SelectInstructionSet(InstructionSet isa); // clamped to what the CPU supports, not thread-safe
+	};
+}
@@ -66,5 +66,9 @@ namespace strongridbase
 	public:
 		static tm SecondsSinceEpochToDateTime(uint64_t SecondsSinceEpoch);
 		static uint32_t GetSocByDateTime(const tm* tm);
+
+		// Nanoseconds since 1970 - the time base of SOC and of kernel receive timestamps
+		static int64_t GetWallClockNs();
+		static int64_t SocToNs(uint32_t soc, uint32_t fractionOfSecond, uint32_t timeBase);
 	};
 }
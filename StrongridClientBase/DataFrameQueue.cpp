@@ -0,0 +1,149 @@
+/*
+*  DataFrameQueue.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <chrono>
+#include <thread>
+#include "DataFrameQueue.h"
+
+using namespace strongridclientbase;
+
+static uint64_t RoundUpToPowerOfTwo( int capacity )
+{
+	uint64_t numSlots = 2;
+	while( numSlots < (uint64_t)capacity ) numSlots *= 2;
+	return numSlots;
+}
+
+DataFrameQueue::DataFrameQueue( int capacity, QueueOverflowPolicy policy, const C37118PdcDataDecodeInfo& decodeInfo )
+	: m_slots(RoundUpToPowerOfTwo(capacity))
+{
+	const uint64_t numSlots = m_slots.size();
+	for( uint64_t i = 0; i < numSlots; ++i )
+	{
+		m_slots[i].Sequence.store(i, std::memory_order_relaxed);
+		m_slots[i].Frame = C37118PdcFlatDataFrame::CreateByDecodeInfo(decodeInfo);
+	}
+
+	m_mask = numSlots - 1;
+	m_policy = policy;
+	m_enqueuePos = 0;
+	m_dequeuePos.store(0);
+	m_consumerWaiting.store(false);
+	m_numEnqueued.store(0);
+	m_numDropped.store(0);
+	m_numDecodeErrors.store(0);
+	m_maxDepth.store(0);
+}
+
+C37118PdcFlatDataFrame* DataFrameQueue::BeginPush( const std::atomic<bool>& stopFlag )
+{
+	while( !stopFlag.load(std::memory_order_relaxed) )
+	{
+		Slot& slot = m_slots[m_enqueuePos & m_mask];
+		if( slot.Sequence.load(std::memory_order_acquire) == m_enqueuePos )
+			return &slot.Frame;
+
+		// Full (or the consumer is still swapping the slot out)
+		if( m_policy == QueueOverflowPolicy::DROP_NEWEST )
+		{
+			m_numDropped.fetch_add(1, std::memory_order_relaxed);
+			return 0;
+		}
+		else if( m_policy == QueueOverflowPolicy::DROP_OLDEST && TryPop(0) )
+			m_numDropped.fetch_add(1, std::memory_order_relaxed);
+		else
+			std::this_thread::sleep_for(std::chrono::microseconds(100));
+	}
+	return 0;
+}
+
+void DataFrameQueue::CommitPush()
+{
+	m_slots[m_enqueuePos & m_mask].Sequence.store(m_enqueuePos + 1, std::memory_order_release);
+	++m_enqueuePos;
+	m_numEnqueued.fetch_add(1, std::memory_order_relaxed);
+
+	uint32_t depth = (uint32_t)(m_enqueuePos - m_dequeuePos.load(std::memory_order_relaxed));
+	if( depth > m_maxDepth.load(std::memory_order_relaxed) ) m_maxDepth.store(depth, std::memory_order_relaxed);
+
+	// Wake the consumer - the fence pairs with the one in Pop, so either side sees the other's store
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if( m_consumerWaiting.load(std::memory_order_relaxed) )
+	{
+		std::lock_guard<std::mutex> lock(m_waitLock);
+		m_waitCond.notify_one();
+	}
+}
+
+bool DataFrameQueue::TryPop( C37118PdcFlatDataFrame* frame )
+{
+	uint64_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+	while( true )
+	{
+		Slot& slot = m_slots[pos & m_mask];
+		int64_t diff = (int64_t)slot.Sequence.load(std::memory_order_acquire) - (int64_t)(pos + 1);
+		if( diff < 0 ) return false; // empty
+
+		if( diff == 0 && m_dequeuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed) )
+		{
+			// Slot is ours until its sequence is advanced - a null frame discards it
+			if( frame != 0 ) std::swap(*frame, slot.Frame);
+			slot.Sequence.store(pos + m_mask + 1, std::memory_order_release);
+			return true;
+		}
+		if( diff > 0 ) pos = m_dequeuePos.load(std::memory_order_relaxed);
+	}
+}
+
+bool DataFrameQueue::Pop( C37118PdcFlatDataFrame* frame, int timeoutMs )
+{
+	if( TryPop(frame) ) return true;
+
+	// Announce the wait before checking the queue again, so that a push either is seen here or sees the flag
+	std::unique_lock<std::mutex> lock(m_waitLock);
+	m_consumerWaiting.store(true, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	bool popped = m_waitCond.wait_for(lock, std::chrono::milliseconds(timeoutMs), [&]{ return TryPop(frame); });
+	m_consumerWaiting.store(false, std::memory_order_relaxed);
+	return popped;
+}
+
+bool DataFrameQueue::IsEmpty() const
+{
+	uint64_t pos = m_dequeuePos.load(std::memory_order_relaxed);
+	return m_slots[pos & m_mask].Sequence.load(std::memory_order_acquire) != pos + 1;
+}
+
+DataFrameQueueStats DataFrameQueue::GetStats() const
+{
+	DataFrameQueueStats stats;
+	stats.Capacity = (uint32_t)m_slots.size();
+	stats.NumEnqueued = m_numEnqueued.load(std::memory_order_relaxed);
+	stats.NumDropped = m_numDropped.load(std::memory_order_relaxed);
+	stats.NumDecodeErrors = m_numDecodeErrors.load(std::memory_order_relaxed);
+	stats.MaxDepth = m_maxDepth.load(std::memory_order_relaxed);
+
+	// The dequeue position counts frames read and frames dropped as oldest
+	uint64_t numDequeued = m_dequeuePos.load(std::memory_order_relaxed);
+	stats.Depth = numDequeued < stats.NumEnqueued ? (uint32_t)(stats.NumEnqueued - numDequeued) : 0;
+	return stats;
+}
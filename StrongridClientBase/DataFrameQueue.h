@@ -0,0 +1,99 @@
+/*
+*  DataFrameQueue.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <vector>
+#include "../StrongridBase/C37118Protocol.h"
+
+using namespace strongridbase;
+
+namespace strongridclientbase
+{
+	enum class QueueOverflowPolicy
+	{
+		DROP_OLDEST = 0,
+		DROP_NEWEST = 1,
+		BLOCK = 2
+	};
+
+	struct DataFrameQueueStats
+	{
+		uint32_t Capacity; // requested capacity rounded up to a power of two
+		uint32_t Depth;
+		uint32_t MaxDepth;
+		uint64_t NumEnqueued;
+		uint64_t NumDropped;
+		uint64_t NumDecodeErrors; // frames discarded by the producer since they could not be decoded
+	};
+
+	// Bounded lock-free queue of decoded dataframes between the receiver thread (producer) and the reader (consumer).
+	// Every slot holds a preallocated frame: the producer decodes in place and the consumer swaps the frame out,
+	// so no frame data is copied or allocated. Slots carry sequence numbers (Vyukov bounded queue) which lets the
+	// producer discard the oldest frame with the same operation as the consumer when the policy is DROP_OLDEST.
+	class DataFrameQueue
+	{
+	public:
+		DataFrameQueue( int capacity, QueueOverflowPolicy policy, const C37118PdcDataDecodeInfo& decodeInfo );
+
+		// Producer: slot to decode the next frame into, 0 if the frame must be dropped (DROP_NEWEST or stopped)
+		C37118PdcFlatDataFrame* BeginPush( const std::atomic<bool>& stopFlag );
+		void CommitPush();
+		void RecordDecodeError() { m_numDecodeErrors.fetch_add(1, std::memory_order_relaxed); } // instead of CommitPush
+
+		// Consumer: swap the oldest frame into 'frame', waiting up to timeoutMs. False on timeout.
+		bool Pop( C37118PdcFlatDataFrame* frame, int timeoutMs );
+		bool IsEmpty() const;
+
+		DataFrameQueueStats GetStats() const;
+
+	private:
+		struct Slot
+		{
+			std::atomic<uint64_t> Sequence;
+			C37118PdcFlatDataFrame Frame;
+		};
+
+		bool TryPop( C37118PdcFlatDataFrame* frame );
+
+	private:
+		std::vector<Slot> m_slots;
+		uint64_t m_mask;
+		QueueOverflowPolicy m_policy;
+
+		uint64_t m_enqueuePos; // producer only
+		std::atomic<uint64_t> m_dequeuePos;
+
+		// Wakes a waiting consumer - only touched when the consumer announced that it waits
+		std::atomic<bool> m_consumerWaiting;
+		std::mutex m_waitLock;
+		std::condition_variable m_waitCond;
+
+		// Counters
+		std::atomic<uint64_t> m_numEnqueued;
+		std::atomic<uint64_t> m_numDropped;
+		std::atomic<uint64_t> m_numDecodeErrors;
+		std::atomic<uint32_t> m_maxDepth;
+	};
+}
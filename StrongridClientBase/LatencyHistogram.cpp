@@ -0,0 +1,80 @@
+/*
+*  LatencyHistogram.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <limits>
+#include "LatencyHistogram.h"
+
+using namespace strongridclientbase;
+
+LatencyHistogram::LatencyHistogram()
+{
+	Reset();
+}
+
+void LatencyHistogram::Record( int64_t latencyNs )
+{
+	if( latencyNs < 0 )
+	{
+		m_numNegative.fetch_add(1, std::memory_order_relaxed);
+		return;
+	}
+
+	uint64_t us = (uint64_t)latencyNs / 1000;
+	int bucket = 0;
+	while( us != 0 && bucket < LatencyHistogramStats::NUM_BUCKETS - 1 )
+	{
+		us >>= 1;
+		++bucket;
+	}
+	m_buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+	m_sumNs.fetch_add(latencyNs, std::memory_order_relaxed);
+
+	int64_t current = m_minNs.load(std::memory_order_relaxed);
+	while( latencyNs < current && !m_minNs.compare_exchange_weak(current, latencyNs, std::memory_order_relaxed) ) {}
+	current = m_maxNs.load(std::memory_order_relaxed);
+	while( latencyNs > current && !m_maxNs.compare_exchange_weak(current, latencyNs, std::memory_order_relaxed) ) {}
+}
+
+LatencyHistogramStats LatencyHistogram::GetStats() const
+{
+	LatencyHistogramStats stats;
+	stats.NumSamples = 0;
+	for( int i = 0; i < LatencyHistogramStats::NUM_BUCKETS; ++i )
+	{
+		stats.Buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+		stats.NumSamples += stats.Buckets[i];
+	}
+	stats.NumNegative = m_numNegative.load(std::memory_order_relaxed);
+	stats.SumNs = m_sumNs.load(std::memory_order_relaxed);
+	stats.MinNs = stats.NumSamples != 0 ? m_minNs.load(std::memory_order_relaxed) : 0;
+	stats.MaxNs = stats.NumSamples != 0 ? m_maxNs.load(std::memory_order_relaxed) : 0;
+	return stats;
+}
+
+void LatencyHistogram::Reset()
+{
+	for( int i = 0; i < LatencyHistogramStats::NUM_BUCKETS; ++i ) m_buckets[i].store(0, std::memory_order_relaxed);
+	m_numNegative.store(0, std::memory_order_relaxed);
+	m_minNs.store(std::numeric_limits<int64_t>::max(), std::memory_order_relaxed);
+	m_maxNs.store(0, std::memory_order_relaxed);
+	m_sumNs.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,59 @@
+/*
+*  LatencyHistogram.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#pragma once
+#include <atomic>
+#include <stdint.h>
+
+namespace strongridclientbase
+{
+	struct LatencyHistogramStats
+	{
+		static const int NUM_BUCKETS = 32;
+
+		uint64_t NumSamples; // in the buckets
+		uint64_t NumNegative; // not in the buckets: the end came before the start (unsynchronised clocks)
+		int64_t MinNs;
+		int64_t MaxNs;
+		int64_t SumNs;
+		uint64_t Buckets[NUM_BUCKETS]; // 0: below 1 us, i: [2^(i-1), 2^i) us, the last one also holds everything above
+	};
+
+	// Log2 histogram of latencies. Record is made by the thread delivering the frames of a client while any thread
+	// may read or reset it, so the counters are independent atomics: a snapshot taken during a Record may be off by that sample.
+	class LatencyHistogram
+	{
+	public:
+		LatencyHistogram();
+
+		void Record( int64_t latencyNs );
+		LatencyHistogramStats GetStats() const;
+		void Reset();
+
+	private:
+		std::atomic<uint64_t> m_buckets[LatencyHistogramStats::NUM_BUCKETS];
+		std::atomic<uint64_t> m_numNegative;
+		std::atomic<int64_t> m_minNs;
+		std::atomic<int64_t> m_maxNs;
+		std::atomic<int64_t> m_sumNs;
+	};
+}
@@ -0,0 +1,379 @@
+/*
+*  MulticastFeed.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <sstream>
+
+#include "MulticastFeed.h"
+#include "PdcClient.h"
+#include "UdpClient.h"
+#include "../StrongridBase/common.h"
+
+using namespace strongridbase;
+using namespace strongridclientbase;
+
+const int FRAME_HEADER_SIZE = 14;
+const int MAX_DATAGRAM_SIZE = 65536; // holds any frame (FRAMESIZE is 16 bit)
+const int FEED_POLL_MS = 100; // how often the feed thread checks for a stop request
+const int FEED_RECEIVE_BUFFER_SIZE = 4 * 1024 * 1024; // socket buffer, capped by the kernel (net.core.rmem_max)
+const size_t INBOX_SIZE = 1024 * 1024; // frames waiting for a client without receiver
+
+namespace strongridclientbase
+{
+	struct MulticastSubscription
+	{
+		PdcClient* Client;
+		uint16_t IdCode;
+		std::atomic<uint32_t>* DroppedCount;
+		bool Delivering; // the client receiver takes the decoded dataframes
+		bool Failed; // the receiver refused a dataframe - it gets nothing more until SetDelivering
+		MulticastFeed::InboxHandler Handler;
+		void* HandlerContext;
+
+		// Frames back to back, as received from a stream
+		std::vector<char> Inbox;
+		std::deque<int64_t> InboxArrivalNs;
+		std::atomic<int> NumInboxFrames; // read without the feed lock
+	};
+}
+
+static std::mutex s_feedsLock;
+static std::map<std::string, MulticastFeed*> s_feeds;
+
+static int PeekFrameSize( const char* frameStart )
+{
+	// FRAMESIZE directly follows the SYNC word
+	return ((unsigned char)frameStart[2] << 8) | (unsigned char)frameStart[3];
+}
+
+MulticastFeed* MulticastFeed::Acquire( const std::string& groupAddress, int port, const std::string& interfaceAddress )
+{
+	std::stringstream key;
+	key << groupAddress << '|' << port << '|' << interfaceAddress;
+
+	std::lock_guard<std::mutex> lock(s_feedsLock);
+	std::map<std::string, MulticastFeed*>::iterator iter = s_feeds.find(key.str());
+	if( iter != s_feeds.end() )
+	{
+		++iter->second->m_numUsers;
+		return iter->second;
+	}
+
+	MulticastFeed* feed = new MulticastFeed(groupAddress, port, interfaceAddress);
+	feed->m_key = key.str();
+	s_feeds[feed->m_key] = feed;
+	return feed;
+}
+
+void MulticastFeed::Release( MulticastFeed* feed )
+{
+	std::lock_guard<std::mutex> lock(s_feedsLock);
+	if( --feed->m_numUsers > 0 ) return;
+	s_feeds.erase(feed->m_key);
+	delete feed;
+}
+
+MulticastFeed::MulticastFeed( const std::string& groupAddress, int port, const std::string& interfaceAddress )
+{
+	m_numUsers = 1;
+	m_stop = false;
+	m_udpClient = new UdpClient(groupAddress, port);
+	try {
+		m_udpClient->OpenMulticast(interfaceAddress, FEED_RECEIVE_BUFFER_SIZE);
+	}
+	catch( ... ) {
+		delete m_udpClient;
+		throw;
+	}
+	m_batch = new char[MAX_DATAGRAM_SIZE * UdpClient::MAX_BATCH];
+	m_thread = std::thread(&MulticastFeed::ReceiveProc, this);
+}
+
+MulticastFeed::~MulticastFeed()
+{
+	m_stop = true;
+	m_thread.join();
+	delete m_udpClient;
+	delete [] m_batch;
+	for( std::map<uint16_t, Stream*>::iterator iter = m_streams.begin(); iter != m_streams.end(); ++iter )
+		delete iter->second;
+}
+
+MulticastSubscription* MulticastFeed::Subscribe( PdcClient* client, uint16_t idCode, std::atomic<uint32_t>* droppedCount )
+{
+	MulticastSubscription* subscription = new MulticastSubscription();
+	subscription->Client = client;
+	subscription->IdCode = idCode;
+	subscription->DroppedCount = droppedCount;
+	subscription->Delivering = false;
+	subscription->Failed = false;
+	subscription->Handler = 0;
+	subscription->HandlerContext = 0;
+	subscription->NumInboxFrames = 0;
+
+	std::lock_guard<std::mutex> lock(m_lock);
+	Stream*& stream = m_streams[idCode];
+	if( stream == 0 )
+	{
+		stream = new Stream();
+		stream->HasDecodeInfo = false;
+		stream->ConfigurationHash = stream->ConfigurationLength = 0;
+		stream->PendingHash = stream->PendingLength = 0;
+	}
+	stream->Subscriptions.push_back(subscription);
+	return subscription;
+}
+
+void MulticastFeed::Unsubscribe( MulticastSubscription* subscription )
+{
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		std::map<uint16_t, Stream*>::iterator iter = m_streams.find(subscription->IdCode);
+		if( iter != m_streams.end() )
+		{
+			std::vector<MulticastSubscription*>& subscriptions = iter->second->Subscriptions;
+			subscriptions.erase(std::remove(subscriptions.begin(), subscriptions.end(), subscription), subscriptions.end());
+			if( subscriptions.empty() )
+			{
+				delete iter->second;
+				m_streams.erase(iter);
+			}
+		}
+	}
+	delete subscription;
+}
+
+void MulticastFeed::SetDelivering( MulticastSubscription* subscription, bool delivering )
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	subscription->Delivering = delivering;
+	subscription->Failed = false;
+	subscription->Inbox.clear();
+	subscription->InboxArrivalNs.clear();
+	subscription->NumInboxFrames = 0;
+}
+
+void MulticastFeed::SetInboxHandler( MulticastSubscription* subscription, InboxHandler handler, void* context )
+{
+	std::lock_guard<std::mutex> lock(m_lock);
+	subscription->Handler = handler;
+	subscription->HandlerContext = context;
+}
+
+bool MulticastFeed::HasInboxFrames( const MulticastSubscription* subscription ) const
+{
+	return subscription->NumInboxFrames > 0;
+}
+
+int MulticastFeed::TakeFrames( MulticastSubscription* subscription, char* dest, int maxLength, std::vector<int64_t>* arrivalNs, bool wait, int timeoutMs )
+{
+	std::unique_lock<std::mutex> lock(m_lock);
+	std::vector<char>& inbox = subscription->Inbox;
+	if( wait && inbox.empty() )
+	{
+		std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+		while( inbox.empty() )
+		{
+			if( timeoutMs < 0 ) m_inboxReady.wait(lock);
+			else if( m_inboxReady.wait_until(lock, deadline) == std::cv_status::timeout && inbox.empty() )
+				throw SocketTimeout("Unable to read within timeout");
+		}
+	}
+
+	// Whole frames only, each with its own time
+	int numBytes = 0;
+	int numFrames = 0;
+	while( numBytes < (int)inbox.size() )
+	{
+		int frameSize = PeekFrameSize(inbox.data() + numBytes);
+		if( numBytes + frameSize > maxLength ) break;
+		numBytes += frameSize;
+		arrivalNs->push_back(subscription->InboxArrivalNs.front());
+		subscription->InboxArrivalNs.pop_front();
+		++numFrames;
+	}
+	std::memcpy(dest, inbox.data(), numBytes);
+	inbox.erase(inbox.begin(), inbox.begin() + numBytes);
+	subscription->NumInboxFrames -= numFrames;
+	return numBytes;
+}
+
+void MulticastFeed::ReceiveProc()
+{
+	int lengths[UdpClient::MAX_BATCH];
+	int64_t arrivalNs[UdpClient::MAX_BATCH];
+	while( !m_stop )
+	{
+		// Short timeouts so that stop requests are seen
+		int numDatagrams;
+		try {
+			numDatagrams = m_udpClient->RecvBatch(m_batch, MAX_DATAGRAM_SIZE, UdpClient::MAX_BATCH, lengths, arrivalNs, FEED_POLL_MS);
+		}
+		catch( SocketTimeout ) {
+			continue;
+		}
+		catch( Exception ) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(FEED_POLL_MS));
+			continue;
+		}
+
+		bool queued = false;
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			for( int i = 0; i < numDatagrams; ++i )
+				if( Dispatch(m_batch + i * MAX_DATAGRAM_SIZE, lengths[i], arrivalNs[i]) ) queued = true;
+		}
+		if( queued ) m_inboxReady.notify_all();
+	}
+}
+
+bool MulticastFeed::Dispatch( char* data, int length, int64_t arrivalNs )
+{
+	// Exactly one frame per datagram, as with unicast UDP
+	if( length < FRAME_HEADER_SIZE + 2 || (unsigned char)data[0] != 0xAA || PeekFrameSize(data) != length ) return false;
+
+	int offset = 0;
+	C37118FrameHeader header = C37118Protocol::ReadFrameHeader(data, length, &offset);
+	std::map<uint16_t, Stream*>::iterator iter = m_streams.find(header.IdCode);
+	if( iter == m_streams.end() ) return false; // a PDC no client subscribed to
+	Stream& stream = *iter->second;
+
+	if( header.Sync.FrameType == C37118HdrFrameType::DATA_FRAME )
+		DeliverDataFrame(stream, data, length, arrivalNs);
+	else if( header.Sync.FrameType == C37118HdrFrameType::CONFIGURATION_FRAME_2 || header.Sync.FrameType == C37118HdrFrameType::CONFIGURATION_FRAME_3 )
+		UpdateDecodeInfo(stream, header.Sync.FrameType, data, length);
+
+	// Clients without receiver read every frame of their PDC themselves
+	bool queued = false;
+	for( std::vector<MulticastSubscription*>::iterator sub = stream.Subscriptions.begin(); sub != stream.Subscriptions.end(); ++sub )
+		if( !(*sub)->Delivering && QueueToInbox(**sub, data, length, arrivalNs) ) queued = true;
+	return queued;
+}
+
+void MulticastFeed::DeliverDataFrame( Stream& stream, char* data, int length, int64_t arrivalNs )
+{
+	bool delivering = false;
+	for( std::vector<MulticastSubscription*>::iterator sub = stream.Subscriptions.begin(); sub != stream.Subscriptions.end(); ++sub )
+		if( (*sub)->Delivering && !(*sub)->Failed ) delivering = true;
+	if( !delivering || !stream.HasDecodeInfo ) return;
+
+	// Decoded once for all receivers of the stream
+	try {
+		int offset = 0;
+		C37118Protocol::ReadDataFrame(data, length, &stream.DecodeInfo, &stream.Frame, &offset);
+	}
+	catch( Exception ) {
+		return; // does not match the configuration sent to the group
+	}
+	stream.Frame.Timestamps.ArrivalNs = arrivalNs;
+	stream.Frame.Timestamps.DecodedNs = TimeConversionHelper::GetWallClockNs();
+	stream.Frame.Timestamps.DeliveredNs = 0;
+
+	for( std::vector<MulticastSubscription*>::iterator sub = stream.Subscriptions.begin(); sub != stream.Subscriptions.end(); ++sub )
+	{
+		if( !(*sub)->Delivering || (*sub)->Failed ) continue;
+		if( !(*sub)->Client->DeliverSharedFrame(stream.Frame, data, length) ) (*sub)->Failed = true;
+	}
+}
+
+// 64-bit FNV-1a, continued from 'hash' - byte by byte, so it does not depend on where the continuation frames split the body
+static uint64_t HashBytes( uint64_t hash, const char* data, int length )
+{
+	for( int i = 0; i < length; ++i )
+		hash = (hash ^ (uint8_t)data[i]) * 1099511628211ull;
+	return hash;
+}
+
+void MulticastFeed::UpdateDecodeInfo( Stream& stream, C37118HdrFrameType frameType, char* data, int length )
+{
+	// The PDC repeats its configuration - only a changed one is decoded again. The copies differ in time and CRC.
+	// A CFG-3 may come in continuation frames; its body is then that of all of them, following CONT_IDX.
+	if( !C37118Protocol::CheckCrc16(data, length) ) return;
+	const bool isVer3 = frameType == C37118HdrFrameType::CONFIGURATION_FRAME_3;
+	const int bodyOffset = isVer3 ? FRAME_HEADER_SIZE + 2 : FRAME_HEADER_SIZE;
+	if( length < bodyOffset + 2 ) return;
+	C37118ContIdx contIdx = isVer3 ? C37118ContIdx::CreateByC37118Raw(LoadBigEndian<uint16_t>(data + FRAME_HEADER_SIZE)) : C37118ContIdx();
+
+	if( contIdx.GetCurrentFrameIndex() == 0 )
+	{
+		const char type = (char)frameType;
+		stream.PendingHash = HashBytes(14695981039346656037ull, &type, 1);
+		stream.PendingLength = 1;
+	}
+	stream.PendingHash = HashBytes(stream.PendingHash, data + bodyOffset, length - 2 - bodyOffset);
+	stream.PendingLength += length - 2 - bodyOffset;
+
+	// Continuation frames are parsed as they arrive - whether the configuration changed is known with the last
+	C37118PdcConfiguration_Ver3 configVer3;
+	if( !contIdx.IsLastFrame() )
+	{
+		try {
+			stream.Cfg3Assembler.AddFrame(data, length, &configVer3);
+		}
+		catch( Exception ) {
+		}
+		return;
+	}
+	if( stream.HasDecodeInfo && stream.PendingHash == stream.ConfigurationHash && stream.PendingLength == stream.ConfigurationLength )
+	{
+		stream.Cfg3Assembler.Reset();
+		return;
+	}
+
+	C37118PdcDataDecodeInfo decodeInfo;
+	try {
+		if( isVer3 )
+		{
+			// Frames of the sequence were lost - the next copy of the configuration is taken instead
+			if( !stream.Cfg3Assembler.AddFrame(data, length, &configVer3) ) return;
+			decodeInfo = C37118Protocol::CreateDecodeInfoByPdcConfig(configVer3);
+		}
+		else
+			decodeInfo = C37118Protocol::CreateDecodeInfoByPdcConfig(C37118Protocol::ReadConfigurationFrame(data, length));
+	}
+	catch( Exception ) {
+		stream.HasDecodeInfo = false;
+		return;
+	}
+	stream.DecodeInfo = decodeInfo;
+	stream.Frame = C37118PdcFlatDataFrame::CreateByDecodeInfo(stream.DecodeInfo);
+	stream.ConfigurationHash = stream.PendingHash;
+	stream.ConfigurationLength = stream.PendingLength;
+	stream.HasDecodeInfo = true;
+}
+
+bool MulticastFeed::QueueToInbox( MulticastSubscription& subscription, const char* data, int length, int64_t arrivalNs )
+{
+	if( subscription.Inbox.size() + length > INBOX_SIZE )
+	{
+		++*subscription.DroppedCount;
+		return false;
+	}
+	subscription.Inbox.insert(subscription.Inbox.end(), data, data + length);
+	subscription.InboxArrivalNs.push_back(arrivalNs);
+	++subscription.NumInboxFrames;
+
+	if( subscription.Handler != 0 ) subscription.Handler(subscription.HandlerContext);
+	return true;
+}
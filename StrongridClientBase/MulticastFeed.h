@@ -0,0 +1,109 @@
+/*
+*  MulticastFeed.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../StrongridBase/C37118Protocol.h"
+
+using namespace strongridbase;
+
+namespace strongridclientbase
+{
+	class PdcClient;
+	class UdpClient;
+	struct MulticastSubscription; // a client reading the frames of one IDCODE from the feed
+
+	// Membership of a multicast group shared by all clients of the process: one socket and one receive thread,
+	// whose datagrams are demultiplexed by IDCODE to the clients subscribed to it. The dataframes of an IDCODE are
+	// decoded once, with the configuration last sent to the group, and the same frame is handed to the receiver of
+	// every client (PdcClient::DeliverSharedFrame). A client without a receiver gets the frames of its IDCODE in an
+	// inbox instead and reads them like those of any other socket.
+	// Receivers run on the feed thread while it holds the feed lock: they must not use other clients of the group.
+	class MulticastFeed
+	{
+	public:
+		// Feeds are shared by group, port and interface; the last Release leaves the group
+		static MulticastFeed* Acquire( const std::string& groupAddress, int port, const std::string& interfaceAddress );
+		static void Release( MulticastFeed* feed );
+
+		// droppedCount counts the frames lost because the inbox was full
+		MulticastSubscription* Subscribe( PdcClient* client, uint16_t idCode, std::atomic<uint32_t>* droppedCount );
+		void Unsubscribe( MulticastSubscription* subscription );
+
+		// Dataframes go to the client receiver instead of the inbox, which is emptied. Returns once the feed thread
+		// is no longer in a call to the client.
+		void SetDelivering( MulticastSubscription* subscription, bool delivering );
+
+		// Called from the feed thread each time a frame is put in the inbox
+		typedef void (*InboxHandler)(void* context);
+		void SetInboxHandler( MulticastSubscription* subscription, InboxHandler handler, void* context );
+
+		// Moves whole frames from the inbox to dest, up to maxLength bytes, and appends their receive times to arrivalNs.
+		// With 'wait' it waits up to timeoutMs (-1: forever) for the first frame.
+		int TakeFrames( MulticastSubscription* subscription, char* dest, int maxLength, std::vector<int64_t>* arrivalNs, bool wait, int timeoutMs );
+		bool HasInboxFrames( const MulticastSubscription* subscription ) const;
+
+	private:
+		struct Stream
+		{
+			std::vector<MulticastSubscription*> Subscriptions;
+			bool HasDecodeInfo;
+			// Hash and length of the type and body of the configuration DecodeInfo was made from, and the same so far
+			// of the configuration being received - a repeated configuration is recognised without keeping a copy
+			uint64_t ConfigurationHash;
+			uint64_t ConfigurationLength;
+			uint64_t PendingHash;
+			uint64_t PendingLength;
+			C37118ConfigurationAssembler_Ver3 Cfg3Assembler;
+			C37118PdcDataDecodeInfo DecodeInfo;
+			C37118PdcFlatDataFrame Frame; // decoded once for all receivers
+		};
+
+		MulticastFeed( const std::string& groupAddress, int port, const std::string& interfaceAddress );
+		~MulticastFeed();
+
+		void ReceiveProc();
+		bool Dispatch( char* data, int length, int64_t arrivalNs );
+		void DeliverDataFrame( Stream& stream, char* data, int length, int64_t arrivalNs );
+		void UpdateDecodeInfo( Stream& stream, C37118HdrFrameType frameType, char* data, int length );
+		bool QueueToInbox( MulticastSubscription& subscription, const char* data, int length, int64_t arrivalNs );
+
+	private:
+		std::string m_key; // in the feed registry
+		int m_numUsers;
+		UdpClient* m_udpClient;
+		char* m_batch; // one slot per datagram of a receive call
+		std::thread m_thread;
+		std::atomic<bool> m_stop;
+
+		std::mutex m_lock; // streams and subscriptions
+		std::condition_variable m_inboxReady;
+		std::map<uint16_t, Stream*> m_streams;
+	};
+}
@@ -20,6 +20,7 @@
 *
 */
 
+#include <cstring>
 #include <iostream>
 
 #ifdef _WIN32
@@ -35,58 +36,366 @@ using namespace strongridclientbase;
 using namespace strongridbase;
 
 const int BUFFER_SIZE = 4096;
+const int RECV_BUFFER_INITIAL_SIZE = 16384; // grown on demand
+const int RECV_BATCH_SIZE = 65536; // bytes of dataframe datagrams taken per receive call
+const int MAX_FRAME_SIZE = 0xFFFF; // FRAMESIZE is 16 bit
+const int FRAME_HEADER_SIZE = 14;
+const int RECEIVER_POLL_MS = 100; // how often the receiver thread checks for a stop request
+const int ENGINE_MAX_READS = 4; // reads per ServiceSocket call
+const int RECONNECT_TIMEOUT_MS = 5000; // connect timeout of an automatic reconnect attempt
+const int UDP_RECEIVE_BUFFER_SIZE = 4 * 1024 * 1024; // socket buffer for dataframe bursts, capped by the kernel (net.core.rmem_max)
 
 PdcClient::PdcClient( std::string ipAddress, int port, int pdcIdCode )
 {
 	m_tcpClient = new TcpClient(ipAddress,port);
+	m_ipAddress = ipAddress;
+	m_port = port;
+	m_udpClient = 0;
+	m_multicastFeed = 0;
+	m_multicastSubscription = 0;
+	m_transport = TransportMode::TCP;
+	m_localUdpPort = 0;
+	m_readingData = false;
+	m_droppedDatagramCount = 0;
 	m_buffer = new char[BUFFER_SIZE];
+	m_recvBuffer = new char[RECV_BUFFER_INITIAL_SIZE];
+	m_recvCapacity = RECV_BUFFER_INITIAL_SIZE;
+	m_recvBegin = 0;
+	m_recvEnd = 0;
+	m_frame = m_recvBuffer;
+	m_frameSize = 0;
+	m_frameArrivalNs = 0;
+	m_datagramNext = 0;
 	m_pdcIdCode = pdcIdCode;
 
 	m_pdcCfgVer2_isAvailable = false;
 	m_pdcCfgVer3_isAvailable = false;
 	m_headerFrame_isAvailable = false;
 	m_pdcDataFrame_isAvailable = false;
+	m_projectedFrame_isAvailable = false;
+	m_projectionCleared = false;
+	m_keepPolarPhasors = false;
+	m_checkCrc = false;
+	m_crcFailureCount = 0;
+
+	m_frameQueue = 0;
+	m_receiverRunning = false;
+	m_receiverStopping = false;
+	m_receiverStop = false;
+	m_receiverFailed = false;
+	m_receiverConfigChanged = false;
+	m_engine = 0;
+	m_engineConnection = 0;
+	m_frameQueuedHandler = 0;
+	m_frameQueuedContext = 0;
+	m_dataFrameHandler = 0;
+	m_dataFrameContext = 0;
+
+	m_autoReconnect = false;
+	m_reconnectMinDelayMs = 0;
+	m_reconnectMaxDelayMs = 0;
+	m_reconnectDelayMs = 0;
+	m_connectionLost = false;
+	m_reconnecting = false;
+	m_resumePending = false;
+	m_lastConfigVer3 = false;
+	m_streaming = false;
+	m_jitter.seed(std::random_device()());
+	m_reconnectCount = 0;
 }
 
 PdcClient::~PdcClient()
 {
+	StopReceiver();
+	LeaveMulticastFeed();
 	delete [] m_buffer ; m_buffer = 0;
+	delete [] m_recvBuffer ; m_recvBuffer = 0;
 	if( m_tcpClient != 0 ) delete m_tcpClient;
+	delete m_udpClient;
 }
 
 
 void PdcClient::CloseConnection()
 {
+	StopReceiver();
+	LeaveMulticastFeed();
 	m_tcpClient->Close();
+	if( m_udpClient != 0 ) m_udpClient->Close();
+	m_connectionLost = false;
+	m_streaming = false;
 }
 
 int PdcClient::GetSocketDescriptor() const
 {
-	return m_tcpClient->GetSocketDescriptor();
+	// A multicast client has no socket of its own - the frame queued handler tells when a frame was received
+	if( m_transport == TransportMode::UDP_MULTICAST ) return -1;
+	return UsesUdpInput() ? m_udpClient->GetSocketDescriptor() : m_tcpClient->GetSocketDescriptor();
+}
+
+void PdcClient::SetTransport(TransportMode mode, int localUdpPort, const std::string& multicastInterface)
+{
+	AssertReceiverNotRunning();
+	if( m_autoReconnect && mode != TransportMode::TCP ) throw Exception("Automatic reconnect needs the TCP transport");
+
+	CloseConnection();
+	delete m_udpClient; m_udpClient = 0;
+	if( mode == TransportMode::UDP ) m_udpClient = new UdpClient(m_ipAddress, m_port);
+	else if( mode != TransportMode::TCP && mode != TransportMode::UDP_MULTICAST ) m_udpClient = new UdpClient("", 0); // only receives
+	m_transport = mode;
+	m_localUdpPort = localUdpPort;
+	m_multicastInterface = multicastInterface;
+	m_datagramArrivalNs.reserve(UdpClient::MAX_BATCH);
+}
+
+bool PdcClient::UsesUdpInput() const
+{
+	if( m_transport == TransportMode::TCP_COMMAND_UDP_DATA ) return m_readingData;
+	return m_transport != TransportMode::TCP;
+}
+
+void PdcClient::SetReadingData(bool readingData)
+{
+	if( readingData == m_readingData ) return;
+
+	// Responses and dataframes arrive on different sockets - what is buffered came from the other one
+	if( m_transport == TransportMode::TCP_COMMAND_UDP_DATA ) ResetRecvBuffer();
+	m_readingData = readingData;
+}
+
+void PdcClient::Connect(int timeoutMs)
+{
+	// The UDP port is bound first: the PDC may start sending as soon as it is connected
+	if( m_udpClient != 0 ) m_udpClient->Open(m_localUdpPort, UDP_RECEIVE_BUFFER_SIZE);
+	if( m_transport == TransportMode::UDP_MULTICAST ) JoinMulticastFeed();
+	if( m_transport == TransportMode::TCP || m_transport == TransportMode::TCP_COMMAND_UDP_DATA ) m_tcpClient->Connect(timeoutMs);
+	ResetRecvBuffer();
+	m_readingData = false;
+	m_connectionLost = false;
+	m_reconnecting = false;
+	m_resumePending = false;
+	m_reconnectDelayMs = m_reconnectMinDelayMs;
+}
+
+bool PdcClient::BeginConnect()
+{
+	ResetRecvBuffer();
+	m_readingData = false;
+	if( m_udpClient != 0 ) m_udpClient->Open(m_localUdpPort, UDP_RECEIVE_BUFFER_SIZE);
+	if( m_transport == TransportMode::UDP_MULTICAST ) JoinMulticastFeed();
+	if( m_transport != TransportMode::TCP && m_transport != TransportMode::TCP_COMMAND_UDP_DATA ) return true;
+	return m_tcpClient->StartConnect();
 }
 
-void PdcClient::Connect()
+bool PdcClient::ContinueConnect()
 {
-	m_tcpClient->Connect();
+	return m_tcpClient->FinishConnect();
 }
 
-int ReadC37118FrameIntoBuffer( char* buffer, TcpClient* tcpClient, C37118FrameHeader* header, int timeoutMs )
+static int PeekFrameSize( const char* frameStart )
+{
+	// FRAMESIZE directly follows the SYNC word
+	return ((unsigned char)frameStart[2] << 8) | (unsigned char)frameStart[3];
+}
+
+void PdcClient::ReserveRecvSpace( int numBytes )
+{
+	// Makes room for numBytes behind m_recvEnd
+	if( m_recvCapacity - m_recvEnd >= numBytes ) return;
+
+	// Move the unconsumed bytes to the front if that is enough
+	if( m_recvBegin > 0 && m_recvCapacity - (m_recvEnd - m_recvBegin) >= numBytes )
+	{
+		memmove(m_recvBuffer, m_recvBuffer + m_recvBegin, m_recvEnd - m_recvBegin);
+		m_recvEnd -= m_recvBegin;
+		m_recvBegin = 0;
+		return;
+	}
+
+	// Grow - the whole buffer is kept, so m_frame stays valid
+	int capacity = m_recvCapacity * 2;
+	if( capacity < m_recvEnd + numBytes ) capacity = m_recvEnd + numBytes;
+	char* buffer = new char[capacity];
+	memcpy(buffer, m_recvBuffer, m_recvEnd);
+	m_frame = buffer + (m_frame - m_recvBuffer);
+	delete [] m_recvBuffer;
+	m_recvBuffer = buffer;
+	m_recvCapacity = capacity;
+}
+
+void PdcClient::FillRecvBuffer( int numBytes, int timeoutMs )
+{
+	if( m_recvEnd - m_recvBegin >= numBytes ) return;
+	ReserveRecvSpace(numBytes - (m_recvEnd - m_recvBegin));
+
+	// Read whatever is available - a burst of frames is drained in one call
+	while( m_recvEnd - m_recvBegin < numBytes )
+		ReceiveInput(true, timeoutMs);
+}
+
+void PdcClient::ReadFrameIntoBuffer( C37118FrameHeader* header, int timeoutMs )
 {
 	// Read frame header: 14 bytes
-	int numbytes = tcpClient->Recv(buffer, 14, timeoutMs);
-	if( numbytes != 14 ) throw Exception("Datastream too short: Unable to read frame header");
+	FillRecvBuffer(FRAME_HEADER_SIZE, timeoutMs);
+
+	int frameSize = PeekFrameSize(m_recvBuffer + m_recvBegin);
+	if( frameSize < FRAME_HEADER_SIZE + 2 ) throw Exception("Invalid datalength of frame");
+
+	// Read the remainder - the frame is left in place and consumed from the buffer
+	FillRecvBuffer(frameSize, timeoutMs);
+	ConsumeFrame(frameSize, header);
+}
+
+bool PdcClient::TakeBufferedFrame( C37118FrameHeader* header )
+{
+	// Like ReadFrameIntoBuffer, but only if the frame is complete in the buffer already
+	int available = m_recvEnd - m_recvBegin;
+	if( available < FRAME_HEADER_SIZE ) return false;
+
+	int frameSize = PeekFrameSize(m_recvBuffer + m_recvBegin);
+	if( frameSize < FRAME_HEADER_SIZE + 2 ) throw Exception("Invalid datalength of frame");
+	if( available < frameSize ) return false;
+
+	ConsumeFrame(frameSize, header);
+	return true;
+}
+
+int PdcClient::ReceiveAvailable()
+{
+	// Move the partial frame to the front to make room
+	if( m_recvBegin > 0 )
+	{
+		memmove(m_recvBuffer, m_recvBuffer + m_recvBegin, m_recvEnd - m_recvBegin);
+		m_recvEnd -= m_recvBegin;
+		m_recvBegin = 0;
+	}
+
+	// The rest of the partial frame must fit - its size is known once FRAMESIZE is in
+	int frameSize = m_recvEnd >= 4 ? PeekFrameSize(m_recvBuffer) : FRAME_HEADER_SIZE;
+	ReserveRecvSpace(frameSize > m_recvEnd ? frameSize - m_recvEnd : 1);
+
+	return ReceiveInput(false, 0);
+}
+
+int PdcClient::ReceiveInput(bool wait, int timeoutMs)
+{
+	// Appends to the receive buffer, waiting up to timeoutMs for data if 'wait' is set
+	if( m_transport == TransportMode::UDP_MULTICAST ) return ReceiveMulticast(wait, timeoutMs);
+	if( UsesUdpInput() ) return ReceiveDatagrams(wait, timeoutMs);
+
+	char* dest = m_recvBuffer + m_recvEnd;
+	int numBytes = wait ? m_tcpClient->RecvSome(dest, m_recvCapacity - m_recvEnd, timeoutMs) : m_tcpClient->RecvAvailable(dest, m_recvCapacity - m_recvEnd);
+	m_recvEnd += numBytes;
+	return numBytes;
+}
+
+int PdcClient::ReceiveDatagrams(bool wait, int timeoutMs)
+{
+	// While dataframes are read a batch of them is taken per call, in slots of a dataframe - anything larger is
+	// truncated and dropped below. Otherwise one datagram of any size is read.
+	bool configAvailable = m_pdcCfgVer2_isAvailable || m_pdcCfgVer3_isAvailable;
+	int slotSize = MAX_FRAME_SIZE;
+	int maxDatagrams = 1;
+	if( m_readingData && configAvailable && m_datadecodeInfo.DataFrameSize > 0 )
+	{
+		slotSize = m_datadecodeInfo.DataFrameSize;
+		maxDatagrams = RECV_BATCH_SIZE / slotSize;
+		if( maxDatagrams < 1 ) maxDatagrams = 1;
+		if( maxDatagrams > UdpClient::MAX_BATCH ) maxDatagrams = UdpClient::MAX_BATCH;
+	}
+	ReserveRecvSpace(slotSize * maxDatagrams);
+
+	char* slots = m_recvBuffer + m_recvEnd;
+	int lengths[UdpClient::MAX_BATCH];
+	int64_t arrivalNs[UdpClient::MAX_BATCH];
+	int numDatagrams = wait ? m_udpClient->RecvBatch(slots, slotSize, maxDatagrams, lengths, arrivalNs, timeoutMs)
+		: m_udpClient->RecvBatchAvailable(slots, slotSize, maxDatagrams, lengths, arrivalNs);
+
+	// Only the times of the frames still buffered are kept
+	m_datagramArrivalNs.erase(m_datagramArrivalNs.begin(), m_datagramArrivalNs.begin() + m_datagramNext);
+	m_datagramNext = 0;
+
+	// Pack the frames behind each other as if they came from a stream. A datagram that is not exactly one frame
+	// would misalign the frames after it, so it is dropped.
+	int numBytes = 0;
+	for( int i = 0; i < numDatagrams; ++i )
+	{
+		const char* datagram = slots + i * slotSize;
+		if( lengths[i] < FRAME_HEADER_SIZE + 2 || (unsigned char)datagram[0] != 0xAA || PeekFrameSize(datagram) != lengths[i] )
+		{
+			++m_droppedDatagramCount;
+			continue;
+		}
+		if( datagram != slots + numBytes ) memmove(slots + numBytes, datagram, lengths[i]);
+		numBytes += lengths[i];
+		m_datagramArrivalNs.push_back(arrivalNs[i]);
+	}
+	m_recvEnd += numBytes;
+	return numBytes;
+}
+
+int PdcClient::ReceiveMulticast(bool wait, int timeoutMs)
+{
+	// The feed thread has put the frames of the PDC in the inbox, whole and in order
+	if( m_multicastSubscription == 0 ) throw SocketException("Not connected");
+	m_datagramArrivalNs.erase(m_datagramArrivalNs.begin(), m_datagramArrivalNs.begin() + m_datagramNext);
+	m_datagramNext = 0;
+
+	ReserveRecvSpace(MAX_FRAME_SIZE);
+	int numBytes = m_multicastFeed->TakeFrames(m_multicastSubscription, m_recvBuffer + m_recvEnd, m_recvCapacity - m_recvEnd, &m_datagramArrivalNs, wait, timeoutMs);
+	m_recvEnd += numBytes;
+	return numBytes;
+}
+
+void PdcClient::JoinMulticastFeed()
+{
+	StopReceiver();
+	LeaveMulticastFeed();
+	m_multicastFeed = MulticastFeed::Acquire(m_ipAddress, m_port, m_multicastInterface);
+	m_multicastSubscription = m_multicastFeed->Subscribe(this, (uint16_t)m_pdcIdCode, &m_droppedDatagramCount);
+	if( m_frameQueuedHandler != 0 ) m_multicastFeed->SetInboxHandler(m_multicastSubscription, m_frameQueuedHandler, m_frameQueuedContext);
+}
+
+void PdcClient::LeaveMulticastFeed()
+{
+	if( m_multicastFeed == 0 ) return;
+	m_multicastFeed->Unsubscribe(m_multicastSubscription);
+	MulticastFeed::Release(m_multicastFeed);
+	m_multicastFeed = 0;
+	m_multicastSubscription = 0;
+}
+
+void PdcClient::ResetRecvBuffer()
+{
+	m_recvBegin = m_recvEnd = 0;
+	m_datagramArrivalNs.clear();
+	m_datagramNext = 0;
+	m_cfg3Assembler.Reset();
+}
+
+void PdcClient::ConsumeFrame( int frameSize, C37118FrameHeader* header )
+{
+	m_frame = m_recvBuffer + m_recvBegin;
+	m_frameSize = frameSize;
+	m_recvBegin += frameSize;
+	if( m_recvBegin == m_recvEnd ) m_recvBegin = m_recvEnd = 0;
+
+	// Datagrams carry a time each. Stream frames are consumed before the socket is read again, so the last read
+	// is the one that completed this frame.
+	if( UsesUdpInput() && m_datagramNext < m_datagramArrivalNs.size() ) m_frameArrivalNs = m_datagramArrivalNs[m_datagramNext++];
+	else m_frameArrivalNs = m_tcpClient->GetLastReceiveTime();
 
 	// Interpret as header
 	int tmp = 0;
-	*header = C37118Protocol::ReadFrameHeader(buffer, BUFFER_SIZE, &tmp );
-
-	// Read the remainder
-	numbytes += tcpClient->Recv(buffer+numbytes, header->FrameSize - numbytes, timeoutMs);
+	*header = C37118Protocol::ReadFrameHeader(m_frame, m_frameSize, &tmp );
+}
 
-	// Assert - the total number of bytes read should equal "framesize"
-	if( numbytes != header->FrameSize ) throw Exception("Invalid datalength of frame");
+bool PdcClient::HasBufferedFrame() const
+{
+	if( m_receiverRunning ) return m_frameQueue != 0 && !m_frameQueue->IsEmpty();
 
-	return numbytes;
+	int available = m_recvEnd - m_recvBegin;
+	if( available >= FRAME_HEADER_SIZE && available >= PeekFrameSize(m_recvBuffer + m_recvBegin) ) return true;
+	return m_multicastSubscription != 0 && m_multicastFeed->HasInboxFrames(m_multicastSubscription);
 }
 
 C37118FrameHeader PdcClient::CreateGenericHeaderFrame(C37118HdrFrameType cmdType)
@@ -110,16 +419,32 @@ C37118CommandFrame PdcClient::CreateCommandFrame(C37118CmdType cmdType)
 	return cmdframe;
 }
 
-void PdcClient::ReadConfiguration(int timeoutMs)
+void PdcClient::SendCommand(C37118CmdType cmdType)
 {
+	// Requests are answered on the command channel, the data stream arrives on the data channel. A running receiver
+	// owns the input and only reads data.
+	if( !m_receiverRunning )
+	{
+		if( cmdType == C37118CmdType::START_RTD ) SetReadingData(true);
+		else if( cmdType != C37118CmdType::KILL_RTD ) SetReadingData(false);
+	}
+
+	// A spontaneous PDC takes no commands
+	if( m_transport == TransportMode::UDP_SPONTANEOUS || m_transport == TransportMode::UDP_MULTICAST ) return;
+
 	// Create command frame
 	int offset = 0;
-	C37118CommandFrame requestCfg = CreateCommandFrame(C37118CmdType::SEND_CFG2_FRAME);
-	C37118Protocol::WriteCommandFrame(m_buffer,&requestCfg, &offset );
+	C37118CommandFrame cmdFrame = CreateCommandFrame(cmdType);
+	C37118Protocol::WriteCommandFrame(m_buffer, BUFFER_SIZE, &cmdFrame, &offset );
 
 	// Send request to server..
-	m_tcpClient->Send(m_buffer, offset );
+	if( m_transport == TransportMode::UDP ) m_udpClient->Send(m_buffer, offset);
+	else m_tcpClient->Send(m_buffer, offset );
+}
 
+void PdcClient::ReadConfiguration(int timeoutMs)
+{
+	SendCommand(C37118CmdType::SEND_CFG2_FRAME);
 
 	// Read configuration frame
 	ProcessInputStreamUntilTargetFrameType(C37118HdrFrameType::CONFIGURATION_FRAME_2, timeoutMs);
@@ -130,66 +455,141 @@ void PdcClient::HandleConfigurationFrame()
 {
 	// Interpret config frame
 	C37118PdcConfiguration pdcConfig;
-	m_pdcConfig = C37118Protocol::ReadConfigurationFrame(m_buffer,BUFFER_SIZE);
+	m_pdcConfig = C37118Protocol::ReadConfigurationFrame(m_frame,m_frameSize);
 	m_datadecodeInfo = C37118Protocol::CreateDecodeInfoByPdcConfig(m_pdcConfig);
+	ApplyConfiguration();
 	m_pdcCfgVer2_isAvailable = true;
+	m_lastConfigVer3 = false;
 }
 
 void PdcClient::ReadConfigurationVer3(int timeoutMs)
 {
-	// Create command frame
-	int offset = 0;
-	C37118CommandFrame requestCfg = CreateCommandFrame(C37118CmdType::SEND_CFG3_FRAME);
-	C37118Protocol::WriteCommandFrame(m_buffer,&requestCfg, &offset );
-
-	// Send request to server..
-	m_tcpClient->Send(m_buffer, offset );
+	SendCommand(C37118CmdType::SEND_CFG3_FRAME);
 
 	// Read config frame 3
 	ProcessInputStreamUntilTargetFrameType( C37118HdrFrameType::CONFIGURATION_FRAME_3, timeoutMs );
 }
-void PdcClient::HandleConfigurationFrame_Ver3()
+bool PdcClient::HandleConfigurationFrame_Ver3()
 {
-	// Interpret config frame
-	C37118PdcConfiguration pdcConfig;
-	m_pdcConfigVer3 = C37118Protocol::ReadConfigurationFrame_Ver3(m_buffer,BUFFER_SIZE);
+	// Interpret config frame - a large configuration comes in continuation frames, which are parsed as they
+	// arrive and take effect with the last one
+	if( !m_cfg3Assembler.AddFrame(m_frame, m_frameSize, &m_pdcConfigVer3) ) return false;
 	m_datadecodeInfo = C37118Protocol::CreateDecodeInfoByPdcConfig(m_pdcConfigVer3);
+	ApplyConfiguration();
 	m_pdcCfgVer3_isAvailable = true;
+	m_lastConfigVer3 = true;
+	return true;
+}
+
+void PdcClient::ApplyDecodeInfo()
+{
+	// Rebuild the decode plan with the client options, and size the dataframe after it
+	m_datadecodeInfo.KeepPolarPhasors = m_keepPolarPhasors;
+	m_datadecodeInfo.Projection = m_projection;
+	C37118Protocol::BuildDecodePlan(&m_datadecodeInfo);
+	m_currDataFrame = C37118PdcFlatDataFrame::CreateByDecodeInfo(m_datadecodeInfo);
+	m_projectedFrame = C37118PdcProjectedDataFrame::CreateByDecodeInfo(m_datadecodeInfo);
+	m_pdcDataFrame_isAvailable = false;
+	m_projectedFrame_isAvailable = false;
+}
+
+void PdcClient::ApplyConfiguration()
+{
+	// The channel projection survives a configuration frame (e.g. re-read after a reconnect) as long as its channels
+	// still exist. Otherwise the frames are decoded in full from now on, which the next ReadDataFrame reports.
+	try {
+		ApplyDecodeInfo();
+	}
+	catch( Exception ) {
+		if( m_projection.empty() ) throw;
+		m_projection.clear();
+		m_projectionCleared = true;
+		ApplyDecodeInfo();
+	}
+}
+
+void PdcClient::SetChannelProjection(const std::vector<C37118ChannelSelector>& channels)
+{
+	if( m_pdcCfgVer3_isAvailable == false && m_pdcCfgVer2_isAvailable == false ) throw Exception("Configuration must be read first.");
+	AssertReceiverNotRunning();
+
+	// Compile first so that an invalid selection leaves the current one in place
+	C37118PdcDataDecodeInfo decodeInfo = m_datadecodeInfo;
+	decodeInfo.Projection = channels;
+	C37118Protocol::BuildProjectionPlan(&decodeInfo);
+
+	m_projection = channels;
+	m_projectionCleared = false;
+	ApplyDecodeInfo();
+}
+
+void PdcClient::SetKeepPolarPhasors(bool keepPolar)
+{
+	AssertReceiverNotRunning();
+	m_keepPolarPhasors = keepPolar;
+	if( m_pdcCfgVer2_isAvailable || m_pdcCfgVer3_isAvailable ) ApplyDecodeInfo();
+}
+
+void PdcClient::SetCrcCheck(bool enabled)
+{
+	m_checkCrc = enabled;
 }
 
 void PdcClient::ProcessInputStreamUntilTargetFrameType(C37118HdrFrameType targetType,int timeoutMs)
 {
+	// The receiver thread owns the input stream
+	AssertReceiverNotRunning();
+
 	// Keep reading until the correct frame was received
 	while( true )
 	{
-		int offset = 0;
 		C37118FrameHeader frameHeader;
-		ReadC37118FrameIntoBuffer(m_buffer, m_tcpClient, &frameHeader, timeoutMs);
-
-		if( frameHeader.Sync.FrameType == C37118HdrFrameType::HEADER_FRAME )
-			HandleHeaderMessage();
-		else if( frameHeader.Sync.FrameType == C37118HdrFrameType::CONFIGURATION_FRAME_1 ||
-			frameHeader.Sync.FrameType == C37118HdrFrameType::CONFIGURATION_FRAME_2 )
-			HandleConfigurationFrame();
-		else if( frameHeader.Sync.FrameType == C37118HdrFrameType::CONFIGURATION_FRAME_3 )
-			HandleConfigurationFrame_Ver3();
-		else if( frameHeader.Sync.FrameType == C37118HdrFrameType::DATA_FRAME )
-			HandleDataFrame();
+		ReadFrameIntoBuffer(&frameHeader, timeoutMs);
 
 		// Stop processing the inputstream once the target messagetype has been handled.
-		if( frameHeader.Sync.FrameType == targetType) break;
+		if( DispatchFrame(frameHeader) && frameHeader.Sync.FrameType == targetType ) break;
 	}
 }
 
-void PdcClient::ReadHeaderMessage(int timeoutMs)
+bool PdcClient::ReceiveUntilFrameType(C37118HdrFrameType targetType)
 {
-	// Create command frame
-	int offset = 0;
-	C37118CommandFrame requestCfg = CreateCommandFrame(C37118CmdType::SEND_HDR_FRAME);
-	C37118Protocol::WriteCommandFrame(m_buffer,&requestCfg, &offset );
+	AssertReceiverNotRunning();
 
-	// Send request to server..
-	m_tcpClient->Send(m_buffer, offset );
+	// Handle what is buffered, and read more only while the target frame has not been handled
+	while( true )
+	{
+		C37118FrameHeader frameHeader;
+		while( TakeBufferedFrame(&frameHeader) )
+			if( DispatchFrame(frameHeader) && frameHeader.Sync.FrameType == targetType ) return true;
+
+		if( ReceiveAvailable() == 0 ) return false;
+	}
+}
+
+bool PdcClient::DispatchFrame(const C37118FrameHeader& frameHeader)
+{
+	// Drop corrupted frames - the stream stays aligned since the frame was read by its FRAMESIZE
+	if( m_checkCrc && !C37118Protocol::CheckCrc16(m_frame, m_frameSize) )
+	{
+		++m_crcFailureCount;
+		return false;
+	}
+
+	if( frameHeader.Sync.FrameType == C37118HdrFrameType::HEADER_FRAME )
+		HandleHeaderMessage();
+	else if( frameHeader.Sync.FrameType == C37118HdrFrameType::CONFIGURATION_FRAME_1 ||
+		frameHeader.Sync.FrameType == C37118HdrFrameType::CONFIGURATION_FRAME_2 )
+		HandleConfigurationFrame();
+	else if( frameHeader.Sync.FrameType == C37118HdrFrameType::CONFIGURATION_FRAME_3 )
+		return HandleConfigurationFrame_Ver3(); // not handled until the last continuation frame
+	else if( frameHeader.Sync.FrameType == C37118HdrFrameType::DATA_FRAME )
+		HandleDataFrame();
+	return true;
+}
+
+void PdcClient::ReadHeaderMessage(int timeoutMs)
+{
+	SendCommand(C37118CmdType::SEND_HDR_FRAME);
 
 	// Keep reading until the headermessage is handled
 	ProcessInputStreamUntilTargetFrameType(C37118HdrFrameType::HEADER_FRAME, timeoutMs);
@@ -198,30 +598,20 @@ void PdcClient::HandleHeaderMessage()
 {
 	// Interpret config frame
 	int offset = 0;
-	m_headerFrame = C37118Protocol::ReadHeaderFrame(m_buffer,BUFFER_SIZE,&offset);
+	m_headerFrame = C37118Protocol::ReadHeaderFrame(m_frame,m_frameSize,&offset);
 	m_headerFrame_isAvailable = true;
 }
 
 void PdcClient::StartDataStream()
 {
-	// Create command frame
-	int offset = 0;
-	C37118CommandFrame requestCfg = CreateCommandFrame(C37118CmdType::START_RTD);
-	C37118Protocol::WriteCommandFrame(m_buffer,&requestCfg, &offset );
-
-	// Send request to server..
-	m_tcpClient->Send(m_buffer, offset );
+	SendCommand(C37118CmdType::START_RTD);
+	m_streaming = true;
 }
 
 void PdcClient::StopDataStream()
 {
-	// Create command frame
-	int offset = 0;
-	C37118CommandFrame requestCfg = CreateCommandFrame(C37118CmdType::KILL_RTD);
-	C37118Protocol::WriteCommandFrame(m_buffer,&requestCfg, &offset );
-
-	// Send request to server..
-	m_tcpClient->Send(m_buffer, offset );
+	m_streaming = false;
+	SendCommand(C37118CmdType::KILL_RTD);
 }
 
 
@@ -230,41 +620,520 @@ void PdcClient::ReadDataFrame(int timeoutMs)
 	// config must be available
 	if( m_pdcCfgVer3_isAvailable == false && m_pdcCfgVer2_isAvailable == false ) throw Exception("Configuration must be read first.");
 
-	// Read from input stream until the dataframe is received
-	ProcessInputStreamUntilTargetFrameType(C37118HdrFrameType::DATA_FRAME, timeoutMs);
+	// Receiver mode: take the oldest queued dataframe
+	if( m_frameQueue != 0 )
+	{
+		if( m_receiverConfigChanged && m_frameQueue->IsEmpty() ) throw Exception("Receiver stopped: the configuration of the PDC changed");
+		if( m_receiverFailed && m_frameQueue->IsEmpty() ) throw SocketException("Receiver stopped: the connection was lost");
+		if( !m_frameQueue->Pop(&m_currDataFrame, timeoutMs) )
+		{
+			if( m_receiverConfigChanged ) throw Exception("Receiver stopped: the configuration of the PDC changed");
+			if( m_receiverFailed ) throw SocketException("Receiver stopped: the connection was lost");
+			throw SocketTimeout("Unable to read within timeout");
+		}
+		RecordDelivery(&m_currDataFrame.Timestamps, m_currDataFrame.HeaderCommon);
+		m_pdcDataFrame_isAvailable = true;
+		return;
+	}
+
+	// Read from input stream until the dataframe is received - reconnecting first after a lost connection
+	SetReadingData(true);
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+	while( true )
+	{
+		if( m_connectionLost ) WaitForReconnect(deadline);
+		try {
+			ProcessInputStreamUntilTargetFrameType(C37118HdrFrameType::DATA_FRAME, timeoutMs);
+			if( !m_resumePending ) break;
+
+			m_resumePending = false;
+			if( C37118Protocol::DataFrameMatchesConfig(m_frame, m_frameSize, &m_datadecodeInfo) )
+			{
+				m_reconnectDelayMs = m_reconnectMinDelayMs;
+				break;
+			}
+
+			// The PDC was reconfigured while the connection was down - read the configuration again, this frame is lost
+			if( m_lastConfigVer3 ) ReadConfigurationVer3(timeoutMs);
+			else ReadConfiguration(timeoutMs);
+		}
+		catch( SocketTimeout ) {
+			throw;
+		}
+		catch( SocketException ) {
+			if( !HandleConnectionLost() ) throw;
+		}
+	}
 
-	// Interpret dataframe
+	// Interpret dataframe - decoded into the preallocated frame
 	int offset = 0;
-	m_currDataFrame = C37118Protocol::ReadDataFrame(m_buffer,BUFFER_SIZE, &m_datadecodeInfo, &offset);
+	if( !m_projection.empty() )
+	{
+		// Only the selected channels are decoded; the full frame is not available
+		C37118Protocol::ReadProjectedDataFrame(m_frame,m_frameSize, &m_datadecodeInfo, &m_projectedFrame, &offset);
+		StampDecoded(&m_projectedFrame.Timestamps);
+		RecordDelivery(&m_projectedFrame.Timestamps, m_projectedFrame.HeaderCommon);
+		m_projectedFrame_isAvailable = true;
+		m_pdcDataFrame_isAvailable = false;
+		return;
+	}
+	C37118Protocol::ReadDataFrame(m_frame,m_frameSize, &m_datadecodeInfo, &m_currDataFrame, &offset);
+	StampDecoded(&m_currDataFrame.Timestamps);
+	RecordDelivery(&m_currDataFrame.Timestamps, m_currDataFrame.HeaderCommon);
 	m_pdcDataFrame_isAvailable = true;
+
+	if( m_projectionCleared )
+	{
+		m_projectionCleared = false;
+		throw ProjectionCleared("The channel projection does not fit the new configuration and was cleared");
+	}
+}
+
+void PdcClient::StampDecoded(C37118FrameTimestamps* timestamps) const
+{
+	timestamps->ArrivalNs = m_frameArrivalNs;
+	timestamps->DecodedNs = TimeConversionHelper::GetWallClockNs();
+	timestamps->DeliveredNs = 0;
+}
+
+void PdcClient::RecordDelivery(C37118FrameTimestamps* timestamps, const C37118FrameHeader& header)
+{
+	timestamps->DeliveredNs = TimeConversionHelper::GetWallClockNs();
+	m_wireLatency.Record(timestamps->DeliveredNs - timestamps->ArrivalNs);
+	m_measurementLatency.Record(timestamps->DeliveredNs - TimeConversionHelper::SocToNs(header.SOC, header.FracSec.FractionOfSecond, m_datadecodeInfo.timebase.TimeBase));
+}
+
+void PdcClient::AssertReceiverNotRunning() const
+{
+	if( m_receiverRunning ) throw Exception("Not available while the receiver thread is running.");
+}
+
+void PdcClient::StartReceiverThread(PdcEngine* engine)
+{
+	SetReadingData(true);
+	m_receiverStop = false;
+	m_receiverFailed = false;
+	m_receiverConfigChanged = false;
+	if( m_transport == TransportMode::UDP_MULTICAST )
+	{
+		// The feed thread receives for all clients of the group - frames not read yet are dropped
+		if( m_multicastSubscription == 0 ) throw Exception("Not connected");
+		if( m_keepPolarPhasors ) throw Exception("Multicast dataframes are decoded with rectangular phasors only.");
+		ResetRecvBuffer();
+		m_receiverRunning = true;
+		m_multicastFeed->SetDelivering(m_multicastSubscription, true);
+		return;
+	}
+	if( engine != 0 )
+	{
+		m_engineConnection = engine->Attach(this);
+		m_engine = engine;
+	}
+	else
+		m_receiverThread = std::thread(&PdcClient::ReceiverProc, this);
+	m_receiverRunning = true;
+}
+
+void PdcClient::StartReceiver(int queueCapacity, QueueOverflowPolicy policy, PdcEngine* engine)
+{
+	if( m_pdcCfgVer3_isAvailable == false && m_pdcCfgVer2_isAvailable == false ) throw Exception("Configuration must be read first.");
+	AssertReceiverNotRunning();
+	if( !m_projection.empty() ) throw Exception("Not available while a channel projection is set.");
+	if( engine != 0 && policy == QueueOverflowPolicy::BLOCK ) throw Exception("A blocking queue would stall the I/O thread pool.");
+	if( m_transport == TransportMode::UDP_MULTICAST && policy == QueueOverflowPolicy::BLOCK ) throw Exception("A blocking queue would stall the multicast group.");
+
+	m_frameQueue = new DataFrameQueue(queueCapacity, policy, m_datadecodeInfo);
+	try {
+		StartReceiverThread(engine);
+	}
+	catch( ... ) {
+		delete m_frameQueue; m_frameQueue = 0;
+		throw;
+	}
+}
+
+void PdcClient::StartCallbackReceiver(DataFrameHandler handler, void* context, PdcEngine* engine)
+{
+	if( m_pdcCfgVer3_isAvailable == false && m_pdcCfgVer2_isAvailable == false ) throw Exception("Configuration must be read first.");
+	AssertReceiverNotRunning();
+	if( !m_projection.empty() ) throw Exception("Not available while a channel projection is set.");
+
+	m_callbackFrame = C37118PdcFlatDataFrame::CreateByDecodeInfo(m_datadecodeInfo);
+	m_dataFrameHandler = handler;
+	m_dataFrameContext = context;
+	try {
+		StartReceiverThread(engine);
+	}
+	catch( ... ) {
+		m_dataFrameHandler = 0;
+		m_dataFrameContext = 0;
+		throw;
+	}
+}
+
+void PdcClient::StopReceiver()
+{
+	if( !BeginStopReceiver() ) return;
+	WaitReceiverStopped();
+	EndStopReceiver();
+}
+
+bool PdcClient::BeginStopReceiver()
+{
+	if( !m_receiverRunning || m_receiverStopping ) return false;
+	m_receiverStopping = true;
+	m_receiverStop = true;
+	return true;
+}
+
+void PdcClient::WaitReceiverStopped()
+{
+	if( m_transport == TransportMode::UDP_MULTICAST )
+	{
+		if( m_multicastSubscription != 0 ) m_multicastFeed->SetDelivering(m_multicastSubscription, false);
+	}
+	else if( m_engine != 0 )
+	{
+		m_engine->Detach(m_engineConnection);
+		m_engine = 0;
+		m_engineConnection = 0;
+	}
+	else
+		m_receiverThread.join();
+}
+
+void PdcClient::EndStopReceiver()
+{
+	m_receiverRunning = false;
+	m_receiverStopping = false;
+	delete m_frameQueue; m_frameQueue = 0;
+	m_dataFrameHandler = 0;
+	m_dataFrameContext = 0;
+}
+
+DataFrameQueueStats PdcClient::GetReceiveQueueStats() const
+{
+	if( m_frameQueue == 0 ) throw Exception("The receiver thread is not running.");
+	return m_frameQueue->GetStats();
+}
+
+void PdcClient::SetFrameQueuedHandler(FrameQueuedHandler handler, void* context)
+{
+	AssertReceiverNotRunning();
+	m_frameQueuedHandler = handler;
+	m_frameQueuedContext = context;
+	if( m_multicastSubscription != 0 ) m_multicastFeed->SetInboxHandler(m_multicastSubscription, handler, context);
+}
+
+bool PdcClient::DeliverDataFrame()
+{
+	// Decoded with the configuration read before - a PDC reconfigured without dropping the connection sends frames
+	// of another size, which stops the receiver as in DeliverSharedFrame
+	if( m_frameSize != m_datadecodeInfo.DataFrameSize )
+	{
+		m_receiverConfigChanged = true;
+		return false;
+	}
+
+	int offset = 0;
+	if( m_frameQueue == 0 )
+	{
+		// Callback mode: decode into the thread's own frame and hand it over
+		C37118Protocol::ReadDataFrame(m_frame, m_frameSize, &m_datadecodeInfo, &m_callbackFrame, &offset);
+		StampDecoded(&m_callbackFrame.Timestamps);
+		RecordDelivery(&m_callbackFrame.Timestamps, m_callbackFrame.HeaderCommon);
+		m_dataFrameHandler(m_callbackFrame, m_dataFrameContext);
+		return true;
+	}
+
+	// Decode straight into the queue slot - a frame failing to decode leaves it to the next one
+	C37118PdcFlatDataFrame* slot = m_frameQueue->BeginPush(m_receiverStop);
+	if( slot == 0 ) return true;
+	try {
+		C37118Protocol::ReadDataFrame(m_frame, m_frameSize, &m_datadecodeInfo, slot, &offset);
+	}
+	catch( Exception ) {
+		m_frameQueue->RecordDecodeError();
+		return true;
+	}
+	StampDecoded(&slot->Timestamps); // delivered when ReadDataFrame takes it
+	m_frameQueue->CommitPush();
+
+	if( m_frameQueuedHandler != 0 ) m_frameQueuedHandler(m_frameQueuedContext);
+	return true;
+}
+
+bool PdcClient::DeliverSharedFrame(C37118PdcFlatDataFrame& frame, const char* data, int length)
+{
+	if( m_checkCrc && !C37118Protocol::CheckCrc16(data, length) )
+	{
+		++m_crcFailureCount;
+		return true;
+	}
+
+	// Decoded with the configuration last sent to the group, which may be newer than the one this client has read
+	if( length != m_datadecodeInfo.DataFrameSize || !frame.MatchesDecodeInfo(m_datadecodeInfo) )
+	{
+		m_receiverConfigChanged = true;
+		SignalReceiverFailed();
+		return false;
+	}
+
+	if( m_frameQueue == 0 )
+	{
+		RecordDelivery(&frame.Timestamps, frame.HeaderCommon);
+		m_dataFrameHandler(frame, m_dataFrameContext);
+		return true;
+	}
+
+	// Copied into the queue slot - allocated for the same configuration
+	C37118PdcFlatDataFrame* slot = m_frameQueue->BeginPush(m_receiverStop);
+	if( slot == 0 ) return true;
+	*slot = frame;
+	m_frameQueue->CommitPush();
+
+	if( m_frameQueuedHandler != 0 ) m_frameQueuedHandler(m_frameQueuedContext);
+	return true;
+}
+
+bool PdcClient::HandleReceivedFrame(const C37118FrameHeader& header)
+{
+	if( m_checkCrc && !C37118Protocol::CheckCrc16(m_frame, m_frameSize) )
+	{
+		++m_crcFailureCount;
+		return true;
+	}
+
+	// Only dataframes are expected while streaming - frames not matching the configuration are dropped
+	if( header.Sync.FrameType != C37118HdrFrameType::DATA_FRAME ) return true;
+
+	// First dataframe after a reconnect: the frames are decoded with the configuration read before, which cannot
+	// be replaced under the reader - a changed configuration stops the receiver
+	if( m_resumePending )
+	{
+		m_resumePending = false;
+		if( !C37118Protocol::DataFrameMatchesConfig(m_frame, m_frameSize, &m_datadecodeInfo) )
+		{
+			m_receiverConfigChanged = true;
+			return false;
+		}
+		m_reconnectDelayMs = m_reconnectMinDelayMs;
+	}
+
+	try {
+		return DeliverDataFrame();
+	}
+	catch( Exception ) {
+		// Callback mode - the frame is skipped
+	}
+	return true;
+}
+
+void PdcClient::SetAutoReconnect(bool enabled, int minDelayMs, int maxDelayMs)
+{
+	AssertReceiverNotRunning();
+	if( enabled && (minDelayMs <= 0 || maxDelayMs < minDelayMs) ) throw Exception("Invalid reconnect delays");
+	if( enabled && m_transport != TransportMode::TCP ) throw Exception("Automatic reconnect needs the TCP transport");
+
+	m_autoReconnect = enabled;
+	m_reconnectMinDelayMs = minDelayMs;
+	m_reconnectMaxDelayMs = maxDelayMs;
+	m_reconnectDelayMs = minDelayMs;
+}
+
+bool PdcClient::HandleConnectionLost()
+{
+	// Only a running data stream is resumed
+	if( !m_autoReconnect || !m_streaming ) return false;
+	m_tcpClient->Close();
+	ResetRecvBuffer();
+	m_connectionLost = true;
+	m_reconnecting = false;
+
+	// Random delay in [delay/2, delay], so that the clients of a restarted PDC do not all come back at once
+	std::uniform_int_distribution<int> jitter(m_reconnectDelayMs / 2, m_reconnectDelayMs);
+	m_reconnectAt = std::chrono::steady_clock::now() + std::chrono::milliseconds(jitter(m_jitter));
+	m_reconnectDelayMs = m_reconnectDelayMs > m_reconnectMaxDelayMs / 2 ? m_reconnectMaxDelayMs : m_reconnectDelayMs * 2;
+	return true;
+}
+
+PdcClient::ServiceResult PdcClient::AdvanceReconnect()
+{
+	// Never waits: the caller waits for what the result asks for, up to m_reconnectAt
+	if( !m_autoReconnect || !m_streaming )
+	{
+		// Stopped or disabled meanwhile - the loss is final
+		m_tcpClient->Close();
+		m_connectionLost = false;
+		m_reconnecting = false;
+		return ServiceResult::STOPPED;
+	}
+
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+	try {
+		if( !m_reconnecting )
+		{
+			if( now < m_reconnectAt ) return ServiceResult::WAIT_UNTIL;
+			m_reconnecting = true;
+			m_reconnectAt = now + std::chrono::milliseconds(RECONNECT_TIMEOUT_MS);
+			if( !BeginConnect() ) return ServiceResult::WAIT_WRITABLE;
+		}
+		else
+		{
+			// Called at the deadline as well, so the connect may still be in progress
+			if( !m_tcpClient->WaitWritable(0) )
+			{
+				if( now >= m_reconnectAt ) throw SocketTimeout("Unable to reconnect within timeout");
+				return ServiceResult::WAIT_WRITABLE;
+			}
+			if( !ContinueConnect() ) return ServiceResult::WAIT_WRITABLE; // next address of the host
+		}
+
+		// Connected: restart the stream, decoded with the configuration read before
+		m_connectionLost = false;
+		m_reconnecting = false;
+		m_resumePending = true;
+		++m_reconnectCount;
+		SendCommand(C37118CmdType::START_RTD);
+		return ServiceResult::WAIT_READABLE;
+	}
+	catch( Exception ) {
+		HandleConnectionLost(); // schedules the next attempt
+		return ServiceResult::WAIT_UNTIL;
+	}
+}
+
+static int MillisecondsUntil( std::chrono::steady_clock::time_point time )
+{
+	int64_t ms = std::chrono::duration_cast<std::chrono::milliseconds>(time - std::chrono::steady_clock::now()).count();
+	return ms > 0 ? (int)ms : 0;
+}
+
+void PdcClient::WaitForReconnect(std::chrono::steady_clock::time_point deadline)
+{
+	while( true )
+	{
+		ServiceResult result = AdvanceReconnect();
+		if( result == ServiceResult::WAIT_READABLE ) return;
+		if( result == ServiceResult::STOPPED ) throw SocketException("The connection was lost");
+
+		int remainingMs = MillisecondsUntil(deadline);
+		if( remainingMs == 0 ) throw SocketTimeout("Reconnecting to the PDC");
+		int waitMs = MillisecondsUntil(m_reconnectAt);
+		if( waitMs > remainingMs ) waitMs = remainingMs;
+
+		if( result == ServiceResult::WAIT_WRITABLE ) m_tcpClient->WaitWritable(waitMs);
+		else std::this_thread::sleep_for(std::chrono::milliseconds(waitMs));
+	}
+}
+
+void PdcClient::SignalReceiverFailed()
+{
+	m_receiverFailed = true;
+
+	// Wake a reader waiting on the queue
+	if( m_frameQueuedHandler != 0 ) m_frameQueuedHandler(m_frameQueuedContext);
+}
+
+void PdcClient::ReceiverProc()
+{
+	while( !m_receiverStop )
+	{
+		// Short timeouts so that stop requests are seen - a partially received frame stays in the buffer
+		C37118FrameHeader frameHeader;
+		try {
+			if( m_connectionLost ) WaitForReconnect(std::chrono::steady_clock::now() + std::chrono::milliseconds(RECEIVER_POLL_MS));
+			ReadFrameIntoBuffer(&frameHeader, RECEIVER_POLL_MS);
+		}
+		catch( SocketTimeout ) {
+			continue;
+		}
+		catch( ... ) {
+			if( HandleConnectionLost() ) continue;
+			break;
+		}
+		if( !HandleReceivedFrame(frameHeader) ) break;
+	}
+
+	if( !m_receiverStop ) SignalReceiverFailed();
+}
+
+PdcClient::ServiceResult PdcClient::ServiceSocket()
+{
+	// A timer set before the receiver failed may still fire
+	if( m_receiverStop || m_receiverFailed ) return ServiceResult::STOPPED;
+	if( m_connectionLost )
+	{
+		ServiceResult result = AdvanceReconnect();
+		if( result == ServiceResult::STOPPED ) SignalReceiverFailed();
+		return result;
+	}
+
+	// Bounded number of reads per call so that one busy client cannot hold an engine thread. The socket is
+	// level-triggered: data left behind fires it again once it is re-armed.
+	try {
+		for( int i = 0; i < ENGINE_MAX_READS && !m_receiverStop; ++i )
+		{
+			if( ReceiveAvailable() == 0 ) break;
+
+			// Only a partial frame is left in the buffer between calls
+			C37118FrameHeader frameHeader;
+			while( !m_receiverStop && TakeBufferedFrame(&frameHeader) )
+			{
+				if( HandleReceivedFrame(frameHeader) ) continue;
+				SignalReceiverFailed();
+				return ServiceResult::STOPPED;
+			}
+		}
+	}
+	catch( ... ) {
+		if( m_receiverStop ) return ServiceResult::STOPPED;
+		if( HandleConnectionLost() ) return ServiceResult::WAIT_UNTIL;
+		SignalReceiverFailed();
+		return ServiceResult::STOPPED;
+	}
+	return ServiceResult::WAIT_READABLE;
 }
 
 void PdcClient::HandleDataFrame()
 {
-	// Do nothing - handled by ReadDataFrame (the dataframe will be lost)
+	// Nothing to do - ReadDataFrame decodes the dataframe it awaited once dispatching returns, and the
+	// receiver delivers its own dataframes. A dataframe arriving while another frame is awaited is skipped.
 }
 
 
-C37118PdcConfiguration PdcClient::GetPdcConfiguration()
+const C37118PdcConfiguration& PdcClient::GetPdcConfiguration() const
 {
 	if( m_pdcCfgVer2_isAvailable == false ) throw Exception("Configurationframe Ver2 has not been read");
 	return m_pdcConfig;
 }
 
-C37118PdcConfiguration_Ver3 PdcClient::GetPdcConfigurationVer3()
+const C37118PdcConfiguration_Ver3& PdcClient::GetPdcConfigurationVer3() const
 {
 	if( m_pdcCfgVer3_isAvailable == false ) throw Exception("Configurationframe Ver3 has not been read");
 	return m_pdcConfigVer3;
 }
 
-C37118PdcHeaderFrame PdcClient::GetPdcHeaderFrame()
+const C37118PdcHeaderFrame& PdcClient::GetPdcHeaderFrame() const
 {
 	if( m_headerFrame_isAvailable == false ) throw Exception("Header has not been read");
 	return m_headerFrame;
 }
 
-C37118PdcDataFrame PdcClient::GetPdcDataFrame()
+C37118PdcDataFrame PdcClient::GetPdcDataFrame() const
+{
+	if( m_pdcDataFrame_isAvailable == false ) throw Exception("Dataframe has not been read");
+	return m_currDataFrame.ToPdcDataFrame();
+}
+
+const C37118PdcFlatDataFrame& PdcClient::GetPdcFlatDataFrame() const
 {
 	if( m_pdcDataFrame_isAvailable == false ) throw Exception("Dataframe has not been read");
 	return m_currDataFrame;
 }
+
+const C37118PdcProjectedDataFrame& PdcClient::GetProjectedDataFrame() const
+{
+	if( m_projectedFrame_isAvailable == false ) throw Exception("Projected dataframe has not been read");
+	return m_projectedFrame;
+}
@@ -21,14 +21,43 @@
 */
 
 #pragma once
+#include <atomic>
+#include <chrono>
+#include <random>
 #include <string>
+#include <thread>
 #include "TcpClient.h"
+#include "UdpClient.h"
+#include "DataFrameQueue.h"
+#include "LatencyHistogram.h"
+#include "PdcEngine.h"
+#include "MulticastFeed.h"
 #include "../StrongridBase/C37118Protocol.h"
 
 using namespace strongridbase;
 
 namespace strongridclientbase
 {
+	// How frames travel between the PDC and the client (IEEE C37.118.2 annex)
+	enum class TransportMode
+	{
+		TCP = 0,
+		UDP = 1, // commands and all frames over UDP, the PDC answers to the port the commands came from
+		TCP_COMMAND_UDP_DATA = 2, // commands, header and configuration over TCP, dataframes sent to the local UDP port
+		UDP_SPONTANEOUS = 3, // no commands: the PDC sends dataframes and configuration frames to the local UDP port by itself
+		UDP_MULTICAST = 4 // like UDP_SPONTANEOUS, sent to a multicast group (the address and port of the client) - see MulticastFeed
+	};
+
+	// Thrown by ReadDataFrame once a configuration frame cleared a channel projection that no longer fits - the
+	// dataframe has been read in full
+	class ProjectionCleared : public Exception
+	{
+	public:
+		ProjectionCleared(const std::string error) : Exception(error)
+		{
+		}
+	};
+
 	class PdcClient
 	{
 	public:
@@ -36,12 +65,97 @@ namespace strongridclientbase
 		~PdcClient();
 		void CloseConnection();
 
-		C37118PdcDataDecodeInfo GetDecodeInfo() const { return m_datadecodeInfo; }
+		const C37118PdcDataDecodeInfo& GetDecodeInfo() const { return m_datadecodeInfo; }
+
+		int GetSocketDescriptor() const; // the socket read next - with TCP_COMMAND_UDP_DATA the UDP one once data is read, -1 with UDP_MULTICAST
+		bool HasBufferedFrame() const; // a complete frame is already received and can be read without touching the socket
+
+		// Transport used from the next Connect on. localUdpPort is the port the dataframes are received on (0: any free port).
+		// Datagrams are read in batches into the receive buffer and decoded like a stream; each must hold exactly one frame.
+		// With UDP_MULTICAST the clients of a group share its socket, and the dataframes are decoded once for all receivers:
+		// these take rectangular phasors only. multicastInterface selects the network interface (see UdpClient::OpenMulticast).
+		void SetTransport(TransportMode mode, int localUdpPort, const std::string& multicastInterface = "");
+		TransportMode GetTransport() const { return m_transport; }
+		uint32_t GetDroppedDatagramCount() const { return m_droppedDatagramCount; } // not a single complete frame, or larger than a dataframe while streaming
+
+		// Keep phasors of polar PMUs as magnitude/angle instead of converting them to rectangular
+		void SetKeepPolarPhasors(bool keepPolar);
+		bool GetKeepPolarPhasors() const { return m_keepPolarPhasors; }
+
+		// Validate the CRC of every received frame; frames failing the check are dropped and counted
+		void SetCrcCheck(bool enabled);
+		bool GetCrcCheck() const { return m_checkCrc; }
+		uint32_t GetCrcFailureCount() const { return m_crcFailureCount; }
+
+		// Decode only the selected channels in ReadDataFrame (pull path only). Values are laid out in selection order,
+		// phasors taking two. An empty selection decodes the full frame again. A new configuration keeps the selection
+		// while its channels exist, otherwise it is cleared and the next ReadDataFrame throws ProjectionCleared.
+		void SetChannelProjection(const std::vector<C37118ChannelSelector>& channels);
+		const std::vector<C37118ChannelSelector>& GetChannelProjection() const { return m_projection; }
 
-		int GetSocketDescriptor() const;
+		// Receiver mode: a library thread drains the socket and queues decoded dataframes for ReadDataFrame.
+		// Requires the configuration; configuration/header requests are refused while it runs.
+		// With an engine the socket is serviced by its thread pool instead of a thread of the client's own.
+		void StartReceiver(int queueCapacity, QueueOverflowPolicy policy, PdcEngine* engine = 0);
+		void StopReceiver();
+		bool IsReceiverRunning() const { return m_receiverRunning; }
+
+		// StopReceiver in steps, for callers that must not hold their lock while the receiver finishes the frame it is
+		// delivering. BeginStopReceiver returns false when there is no receiver or it is being stopped already;
+		// WaitReceiverStopped only waits and may run concurrently with other calls, which see the receiver running
+		// until EndStopReceiver frees the queue and the handler.
+		bool BeginStopReceiver();
+		void WaitReceiverStopped();
+		void EndStopReceiver();
+		bool HasFrameQueue() const { return m_frameQueue != 0; }
+		DataFrameQueueStats GetReceiveQueueStats() const;
+
+		// Called from the receiver thread each time a dataframe is queued - with UDP_MULTICAST also from the feed thread
+		// each time a frame is received for ReadDataFrame and the other reads
+		typedef void (*FrameQueuedHandler)(void* context);
+		void SetFrameQueuedHandler(FrameQueuedHandler handler, void* context);
+
+		// Callback mode: the receiver thread decodes every dataframe and hands it to 'handler' instead of queueing it.
+		// The frame is only valid during the call.
+		typedef void (*DataFrameHandler)(const C37118PdcFlatDataFrame& frame, void* context);
+		void StartCallbackReceiver(DataFrameHandler handler, void* context, PdcEngine* engine = 0);
+
+		// Reconnect by itself when the connection is lost while the data stream runs, waiting a jittered exponential
+		// backoff (minDelayMs doubling up to maxDelayMs) between attempts. The stream is restarted without reading the
+		// configuration again; the first dataframe must still match it (FRAMESIZE, no STAT configuration change),
+		// otherwise ReadDataFrame reads the configuration again and a receiver stops with an error.
+		// Without a receiver the reconnect is made by ReadDataFrame calls, which time out while it is in progress.
+		void SetAutoReconnect(bool enabled, int minDelayMs, int maxDelayMs);
+		bool GetAutoReconnect() const { return m_autoReconnect; }
+		uint32_t GetReconnectCount() const { return m_reconnectCount; }
+
+		// Latency of every dataframe handed to the application (ReadDataFrame or the callback): from the kernel
+		// receive timestamp of its last bytes, and from its own SOC/FRACSEC. The frames carry the single timestamps.
+		LatencyHistogram& GetWireToApiLatency() { return m_wireLatency; }
+		LatencyHistogram& GetMeasurementToApiLatency() { return m_measurementLatency; }
+
+		// Engine thread: consumes what the socket holds without waiting, and steps an automatic reconnect.
+		// The result tells what to wait for before the next call; WAIT_WRITABLE and WAIT_UNTIL also need a call
+		// at GetServiceDeadline at the latest.
+		enum class ServiceResult { WAIT_READABLE, WAIT_WRITABLE, WAIT_UNTIL, STOPPED };
+		ServiceResult ServiceSocket();
+		std::chrono::steady_clock::time_point GetServiceDeadline() const { return m_reconnectAt; }
+
+		// Multicast feed thread: hands a dataframe decoded for all receivers of the group to this one. 'data' is the
+		// received frame. Returns false if the frame does not match the configuration - the receiver stops.
+		bool DeliverSharedFrame(C37118PdcFlatDataFrame& frame, const char* data, int length);
+
+		// Non-blocking steps for bringing up many clients from one thread (PdcConnector). When BeginConnect returns false,
+		// wait until the socket is writable and call ContinueConnect (false: wait again). After sending a request, feed
+		// ReceiveUntilFrameType each time the socket is readable - it never waits and returns true once a frame of
+		// the type has been handled.
+		bool BeginConnect();
+		bool ContinueConnect();
+		void SendCommand(C37118CmdType cmdType);
+		bool ReceiveUntilFrameType(C37118HdrFrameType targetType);
 
 	public:
-		void Connect();
+		void Connect(int timeoutMs = -1);
 		void ReadConfiguration(int timeoutMs);
 		void ReadConfigurationVer3(int timeoutMs);
 		void ReadHeaderMessage(int timeoutMs);
@@ -49,17 +163,48 @@ namespace strongridclientbase
 		void StopDataStream();
 		void ReadDataFrame(int timeoutMs);
 
-		C37118PdcConfiguration GetPdcConfiguration();
-		C37118PdcConfiguration_Ver3 GetPdcConfigurationVer3();
-		C37118PdcHeaderFrame GetPdcHeaderFrame();
-		C37118PdcDataFrame GetPdcDataFrame();
+		// References stay valid until the next read of the same kind
+		const C37118PdcConfiguration& GetPdcConfiguration() const;
+		const C37118PdcConfiguration_Ver3& GetPdcConfigurationVer3() const;
+		const C37118PdcHeaderFrame& GetPdcHeaderFrame() const;
+		const C37118PdcFlatDataFrame& GetPdcFlatDataFrame() const;
+		const C37118PdcProjectedDataFrame& GetProjectedDataFrame() const;
+		C37118PdcDataFrame GetPdcDataFrame() const; // converts the whole frame to the legacy structure - prefer GetPdcFlatDataFrame
 
 	private:
+		void ReserveRecvSpace(int numBytes);
+		void FillRecvBuffer(int numBytes, int timeoutMs);
+		void ReadFrameIntoBuffer(C37118FrameHeader* header, int timeoutMs);
+		bool TakeBufferedFrame(C37118FrameHeader* header);
+		int ReceiveAvailable();
+		int ReceiveInput(bool wait, int timeoutMs);
+		int ReceiveDatagrams(bool wait, int timeoutMs);
+		int ReceiveMulticast(bool wait, int timeoutMs);
+		void JoinMulticastFeed();
+		void LeaveMulticastFeed();
+		void ResetRecvBuffer();
+		bool UsesUdpInput() const;
+		void SetReadingData(bool readingData);
+		bool DispatchFrame(const C37118FrameHeader& header);
+		void ConsumeFrame(int frameSize, C37118FrameHeader* header);
 		void ProcessInputStreamUntilTargetFrameType(C37118HdrFrameType targetType, int timeoutMs);
 		void HandleHeaderMessage();
 		void HandleConfigurationFrame();
-		void HandleConfigurationFrame_Ver3();
+		bool HandleConfigurationFrame_Ver3();
 		void HandleDataFrame();
+		void ApplyDecodeInfo();
+		void ApplyConfiguration(); // ApplyDecodeInfo for a new configuration
+		void AssertReceiverNotRunning() const;
+		void StartReceiverThread(PdcEngine* engine);
+		void ReceiverProc();
+		bool HandleReceivedFrame(const C37118FrameHeader& header);
+		bool HandleConnectionLost();
+		ServiceResult AdvanceReconnect();
+		void WaitForReconnect(std::chrono::steady_clock::time_point deadline);
+		void SignalReceiverFailed();
+		bool DeliverDataFrame(); // false when the frame does not fit the configuration
+		void StampDecoded(C37118FrameTimestamps* timestamps) const;
+		void RecordDelivery(C37118FrameTimestamps* timestamps, const C37118FrameHeader& header);
 
 	private:
 		C37118FrameHeader CreateGenericHeaderFrame(C37118HdrFrameType cmdType);
@@ -69,19 +214,82 @@ namespace strongridclientbase
 
 	private:
 		TcpClient* m_tcpClient;
-		char* m_buffer;
+		UdpClient* m_udpClient; // 0 with the TCP and UDP_MULTICAST transports
+		MulticastFeed* m_multicastFeed; // while connected with UDP_MULTICAST
+		MulticastSubscription* m_multicastSubscription;
+		std::string m_multicastInterface;
+		std::string m_ipAddress;
+		int m_port;
+		TransportMode m_transport;
+		int m_localUdpPort;
+		bool m_readingData; // dataframes are read rather than command responses - selects the input of TCP_COMMAND_UDP_DATA
+		std::atomic<uint32_t> m_droppedDatagramCount;
+		char* m_buffer; // outgoing frames
+
+		// Received bytes not yet consumed are [m_recvBegin, m_recvEnd); m_frame points at the current frame.
+		// The buffer grows to the largest frames and batches seen, and keeps that size.
+		char* m_recvBuffer;
+		int m_recvCapacity;
+		int m_recvBegin;
+		int m_recvEnd;
+		char* m_frame;
+		int m_frameSize;
+		int64_t m_frameArrivalNs; // kernel receive timestamp of the current frame
+		std::vector<int64_t> m_datagramArrivalNs; // of the frames in the receive buffer when they came as datagrams
+		size_t m_datagramNext;
 		int m_pdcIdCode;
 
 		bool m_pdcCfgVer2_isAvailable;
 		bool m_pdcCfgVer3_isAvailable;
 		bool m_headerFrame_isAvailable;
 		bool m_pdcDataFrame_isAvailable;
+		bool m_projectedFrame_isAvailable;
+		bool m_keepPolarPhasors;
+		std::atomic<bool> m_checkCrc; // read by the receiver thread
+		std::atomic<uint32_t> m_crcFailureCount;
 
 		// Data read from PDC
 		C37118PdcConfiguration m_pdcConfig;
 		C37118PdcConfiguration_Ver3 m_pdcConfigVer3;
+		C37118ConfigurationAssembler_Ver3 m_cfg3Assembler; // CFG-3 continuation frames received so far
 		C37118PdcDataDecodeInfo m_datadecodeInfo;
 		C37118PdcHeaderFrame m_headerFrame;
-		C37118PdcDataFrame m_currDataFrame;
+		C37118PdcFlatDataFrame m_currDataFrame; // allocated once per configuration
+		std::vector<C37118ChannelSelector> m_projection;
+		bool m_projectionCleared; // by a configuration frame, not reported by ReadDataFrame yet
+		C37118PdcProjectedDataFrame m_projectedFrame;
+
+		// Receiver mode - dataframes go either to the queue or to the handler (callback mode)
+		bool m_receiverRunning;
+		bool m_receiverStopping; // between BeginStopReceiver and EndStopReceiver
+		DataFrameQueue* m_frameQueue;
+		std::thread m_receiverThread;
+		PdcEngine* m_engine; // the receiver runs in this engine instead of m_receiverThread
+		EngineConnection* m_engineConnection;
+		std::atomic<bool> m_receiverStop;
+		std::atomic<bool> m_receiverFailed;
+		std::atomic<bool> m_receiverConfigChanged; // stopped since a dataframe did not match the configuration
+		FrameQueuedHandler m_frameQueuedHandler;
+		void* m_frameQueuedContext;
+		DataFrameHandler m_dataFrameHandler;
+		void* m_dataFrameContext;
+		C37118PdcFlatDataFrame m_callbackFrame;
+
+		// Automatic reconnect - stepped by the thread reading the socket
+		bool m_autoReconnect;
+		int m_reconnectMinDelayMs;
+		int m_reconnectMaxDelayMs;
+		int m_reconnectDelayMs; // backoff before the next attempt, doubled by every loss until a stream resumes
+		bool m_connectionLost;
+		bool m_reconnecting; // connect in progress
+		bool m_resumePending; // the first dataframe after a reconnect is checked against the configuration
+		bool m_lastConfigVer3; // which configuration to read again when it changed
+		std::atomic<bool> m_streaming; // START_RTD was sent - restarted after a reconnect
+		std::chrono::steady_clock::time_point m_reconnectAt; // next attempt, or the deadline of the one in progress
+		std::minstd_rand m_jitter;
+		std::atomic<uint32_t> m_reconnectCount;
+
+		LatencyHistogram m_wireLatency;
+		LatencyHistogram m_measurementLatency;
 	};
 }
@@ -0,0 +1,189 @@
+/*
+*  PdcConnector.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <chrono>
+
+#ifdef _WIN32
+#	include <WinSock2.h>    // POLLERR, POLLHUP, POLLIN, POLLOUT, WSAPoll, WSAPOLLFD
+#else
+#	include <cerrno>        // EINTR, errno
+#	include <poll.h>        // POLLERR, POLLHUP, POLLIN, POLLOUT, poll, pollfd
+#	define WSAPoll   poll
+#	define WSAPOLLFD pollfd
+#endif
+
+#include "PdcConnector.h"
+#include "../StrongridBase/common.h"
+
+using namespace strongridbase;
+using namespace strongridclientbase;
+
+PdcConnector::PdcConnector( const std::vector<PdcClient*>& clients, int steps )
+{
+	m_tasks.resize(clients.size());
+	m_results.resize(clients.size());
+	for( size_t i = 0; i < clients.size(); ++i )
+	{
+		m_tasks[i].Client = clients[i];
+		m_tasks[i].Connecting = true;
+		m_tasks[i].Done = false;
+		m_tasks[i].RemainingSteps = steps;
+		m_tasks[i].CurrentStep = 0;
+		m_results[i].Success = false;
+		m_results[i].TimedOut = false;
+	}
+	m_numActive = (int)clients.size();
+}
+
+void PdcConnector::Run( int timeoutMs )
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+	for( int i = 0; i < (int)m_tasks.size(); ++i ) Start(i);
+
+	std::vector<WSAPOLLFD> pollFds;
+	std::vector<int> pollTasks;
+	while( m_numActive > 0 )
+	{
+		// Connecting sockets wait to become writable, the others for the next response
+		pollFds.clear();
+		pollTasks.clear();
+		for( int i = 0; i < (int)m_tasks.size(); ++i )
+		{
+			if( m_tasks[i].Done ) continue;
+			WSAPOLLFD pollFd;
+			pollFd.fd = m_tasks[i].Client->GetSocketDescriptor();
+			pollFd.events = m_tasks[i].Connecting ? POLLOUT : POLLIN;
+			pollFd.revents = 0;
+			pollFds.push_back(pollFd);
+			pollTasks.push_back(i);
+		}
+
+		int64_t remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+		if( remainingMs <= 0 ) break;
+		int ret = WSAPoll(pollFds.data(), (int)pollFds.size(), (int)remainingMs);
+		if( ret == 0 ) continue; // the deadline has passed
+		if( ret < 0 )
+		{
+#ifndef _WIN32
+			if( errno == EINTR ) continue;
+#endif // _WIN32
+			// Polling again would fail the same way without waiting - give up on the clients still in progress
+			FailActive("Unable to wait for the sockets");
+			return;
+		}
+
+		for( size_t k = 0; k < pollFds.size(); ++k )
+			if( pollFds[k].revents != 0 ) Advance(pollTasks[k]);
+	}
+
+	// Whatever is left did not make it in time
+	for( int i = 0; i < (int)m_tasks.size(); ++i )
+	{
+		if( m_tasks[i].Done ) continue;
+		Fail(i, m_tasks[i].Connecting ? "Unable to connect within timeout" : "No response within timeout");
+		m_results[i].TimedOut = true;
+	}
+}
+
+void PdcConnector::FailActive( const std::string& error )
+{
+	for( int i = 0; i < (int)m_tasks.size(); ++i )
+		if( !m_tasks[i].Done ) Fail(i, error);
+}
+
+void PdcConnector::Start( int index )
+{
+	Task& task = m_tasks[index];
+	try {
+		if( !task.Client->BeginConnect() ) return;
+		task.Connecting = false;
+		StartNextStep(index);
+	}
+	catch( Exception e ) {
+		Fail(index, e.ExceptionMessage());
+	}
+}
+
+void PdcConnector::Advance( int index )
+{
+	Task& task = m_tasks[index];
+	try {
+		if( task.Connecting )
+		{
+			if( !task.Client->ContinueConnect() ) return; // trying the next address
+			task.Connecting = false;
+			StartNextStep(index);
+		}
+
+		// A response may already be buffered, so keep going until a step has to wait for the socket
+		while( !task.Done && task.Client->ReceiveUntilFrameType(task.Response) )
+		{
+			task.RemainingSteps &= ~task.CurrentStep;
+			StartNextStep(index);
+		}
+	}
+	catch( Exception e ) {
+		Fail(index, e.ExceptionMessage());
+	}
+}
+
+void PdcConnector::StartNextStep( int index )
+{
+	// Requests are sent one at a time - a PDC is not required to queue commands
+	Task& task = m_tasks[index];
+	if( task.RemainingSteps & READ_HEADER )
+	{
+		task.CurrentStep = READ_HEADER;
+		task.Response = C37118HdrFrameType::HEADER_FRAME;
+		task.Client->SendCommand(C37118CmdType::SEND_HDR_FRAME);
+		return;
+	}
+	if( task.RemainingSteps & READ_CONFIGURATION )
+	{
+		task.CurrentStep = READ_CONFIGURATION;
+		task.Response = C37118HdrFrameType::CONFIGURATION_FRAME_2;
+		task.Client->SendCommand(C37118CmdType::SEND_CFG2_FRAME);
+		return;
+	}
+	if( task.RemainingSteps & READ_CONFIGURATION_VER3 )
+	{
+		task.CurrentStep = READ_CONFIGURATION_VER3;
+		task.Response = C37118HdrFrameType::CONFIGURATION_FRAME_3;
+		task.Client->SendCommand(C37118CmdType::SEND_CFG3_FRAME);
+		return;
+	}
+
+	// No response to wait for
+	if( task.RemainingSteps & START_DATA_STREAM ) task.Client->StartDataStream();
+	task.RemainingSteps = 0;
+	task.Done = true;
+	m_results[index].Success = true;
+	--m_numActive;
+}
+
+void PdcConnector::Fail( int index, const std::string& error )
+{
+	m_tasks[index].Done = true;
+	m_results[index].Error = error;
+	--m_numActive;
+}
@@ -0,0 +1,77 @@
+/*
+*  PdcConnector.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#pragma once
+#include <string>
+#include <vector>
+#include "PdcClient.h"
+
+namespace strongridclientbase
+{
+	struct PdcConnectResult
+	{
+		bool Success;
+		bool TimedOut;
+		std::string Error; // empty on success
+	};
+
+	// Brings up many clients at once from the calling thread: all connects are started without blocking, and each
+	// client then runs its handshake (header, CFG-2, CFG-3, START_RTD as selected) as soon as its previous response
+	// arrives, so the total time is about that of the slowest client instead of the sum. A client that fails or
+	// does not answer in time does not hold up the others.
+	class PdcConnector
+	{
+	public:
+		static const int READ_HEADER = 1;
+		static const int READ_CONFIGURATION = 2;
+		static const int READ_CONFIGURATION_VER3 = 4;
+		static const int START_DATA_STREAM = 8;
+
+		PdcConnector( const std::vector<PdcClient*>& clients, int steps );
+
+		// Returns when every client has finished or failed, or timeoutMs has passed
+		void Run( int timeoutMs );
+		const PdcConnectResult& GetResult( int index ) const { return m_results[index]; }
+
+	private:
+		struct Task
+		{
+			PdcClient* Client;
+			bool Connecting;
+			bool Done;
+			int RemainingSteps;
+			int CurrentStep;
+			C37118HdrFrameType Response; // awaited frame of CurrentStep
+		};
+
+		void Start( int index );
+		void Advance( int index );
+		void StartNextStep( int index );
+		void Fail( int index, const std::string& error );
+		void FailActive( const std::string& error ); // every client not done yet
+
+	private:
+		std::vector<Task> m_tasks;
+		std::vector<PdcConnectResult> m_results;
+		int m_numActive;
+	};
+}
@@ -0,0 +1,416 @@
+/*
+*  PdcEngine.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <algorithm>
+#include <condition_variable>
+
+#ifdef __linux__
+#	include <sys/epoll.h>   // epoll_create1, epoll_ctl, epoll_wait, epoll_event
+#	include <sys/eventfd.h> // eventfd
+#	include <unistd.h>      // close, read, write
+#endif
+
+#include "PdcEngine.h"
+#include "PdcClient.h"
+#include "../StrongridBase/common.h"
+
+using namespace strongridbase;
+using namespace strongridclientbase;
+
+const int ENGINE_MAX_EVENTS = 256;
+const int ENGINE_TASKS_PER_POLL = 16; // tasks run between two looks at the own epoll set
+
+namespace strongridclientbase
+{
+	struct EngineConnection
+	{
+		PdcClient* Client;
+		int SocketFd; // -1 while the client waits to reconnect
+		int Owner; // worker whose epoll set holds the socket
+
+		// Scheduled is set when the socket fires and cleared when the task has run; Detach waits for it
+		std::mutex Lock;
+		std::condition_variable Idle;
+		bool Scheduled;
+		bool Detached;
+	};
+}
+
+#ifdef __linux__
+
+static bool ArmSocket( int epollFd, int op, EngineConnection* connection, uint32_t events )
+{
+	// One-shot: the socket fires once and is re-armed when the task has serviced it
+	epoll_event ev;
+	ev.events = events | EPOLLONESHOT;
+	ev.data.ptr = connection;
+	return epoll_ctl(epollFd, op, connection->SocketFd, &ev) == 0;
+}
+
+static void RearmSocket( int epollFd, EngineConnection* connection, uint32_t events )
+{
+	// The socket of a reconnected client is not in the set yet
+	if( !ArmSocket(epollFd, EPOLL_CTL_MOD, connection, events) ) ArmSocket(epollFd, EPOLL_CTL_ADD, connection, events);
+}
+
+PdcEngine::PdcEngine( int numThreads )
+{
+	if( numThreads <= 0 ) throw Exception("The I/O thread pool needs at least one thread");
+	m_stop = false;
+	m_numQueuedTasks = 0;
+	m_numAttached = 0;
+
+	for( int i = 0; i < numThreads; ++i )
+	{
+		Worker* worker = new Worker();
+		worker->EpollFd = epoll_create1(0);
+		worker->WakeupFd = eventfd(0, EFD_NONBLOCK);
+		worker->Sleeping = false;
+		worker->NumConnections = 0;
+		m_workers.push_back(worker);
+
+		epoll_event ev;
+		ev.events = EPOLLIN;
+		ev.data.ptr = 0; // the wakeup eventfd
+		if( worker->EpollFd < 0 || worker->WakeupFd < 0 || epoll_ctl(worker->EpollFd, EPOLL_CTL_ADD, worker->WakeupFd, &ev) != 0 )
+		{
+			Shutdown();
+			throw Exception("Unable to create the I/O thread pool");
+		}
+	}
+
+	for( int i = 0; i < numThreads; ++i )
+		m_workers[i]->Thread = std::thread(&PdcEngine::WorkerProc, this, i);
+}
+
+PdcEngine::~PdcEngine()
+{
+	Shutdown();
+}
+
+void PdcEngine::Shutdown()
+{
+	m_stop = true;
+	for( std::vector<Worker*>::iterator iter = m_workers.begin(); iter != m_workers.end(); ++iter )
+	{
+		if( !(*iter)->Thread.joinable() ) continue;
+		Wake(**iter);
+		(*iter)->Thread.join();
+	}
+
+	for( std::vector<Worker*>::iterator iter = m_workers.begin(); iter != m_workers.end(); ++iter )
+	{
+		FreeDetached(**iter);
+		if( (*iter)->EpollFd >= 0 ) close((*iter)->EpollFd);
+		if( (*iter)->WakeupFd >= 0 ) close((*iter)->WakeupFd);
+		delete *iter;
+	}
+	m_workers.clear();
+}
+
+EngineConnection* PdcEngine::Attach( PdcClient* client )
+{
+	// The set with the fewest sockets - stealing evens out the rest
+	int owner = 0;
+	for( int i = 1; i < (int)m_workers.size(); ++i )
+		if( m_workers[i]->NumConnections < m_workers[owner]->NumConnections ) owner = i;
+
+	EngineConnection* connection = new EngineConnection();
+	connection->Client = client;
+	connection->SocketFd = client->GetSocketDescriptor();
+	connection->Owner = owner;
+	connection->Scheduled = false;
+	connection->Detached = false;
+
+	if( !ArmSocket(m_workers[owner]->EpollFd, EPOLL_CTL_ADD, connection, EPOLLIN) )
+	{
+		delete connection;
+		throw Exception("Unable to add the socket to the I/O thread pool");
+	}
+	++m_workers[owner]->NumConnections;
+	++m_numAttached;
+	return connection;
+}
+
+void PdcEngine::Detach( EngineConnection* connection )
+{
+	Worker& owner = *m_workers[connection->Owner];
+	{
+		// No new task after this - a queued or running one is waited for (a queued one only releases the connection).
+		// The socket is removed afterwards: a running task may replace it.
+		std::unique_lock<std::mutex> lock(connection->Lock);
+		connection->Detached = true;
+		while( connection->Scheduled ) connection->Idle.wait(lock);
+		if( connection->SocketFd >= 0 ) epoll_ctl(owner.EpollFd, EPOLL_CTL_DEL, connection->SocketFd, 0);
+	}
+
+	// An event or timer the owner collected before the removal may still point at the connection, so the owner frees it
+	{
+		std::lock_guard<std::mutex> lock(owner.TaskLock);
+		for( size_t i = 0; i < owner.Timers.size(); )
+		{
+			if( owner.Timers[i].second == connection ) owner.Timers.erase(owner.Timers.begin() + i);
+			else ++i;
+		}
+		owner.Detached.push_back(connection);
+	}
+	--owner.NumConnections;
+	Wake(owner);
+	--m_numAttached; // last - the engine may be destroyed once nothing is attached
+}
+
+void PdcEngine::WorkerProc( int workerIdx )
+{
+	Worker& worker = *m_workers[workerIdx];
+	while( !m_stop )
+	{
+		// Pick up the ready sockets of the own set - block only when no thread has queued work
+		int numScheduled = CollectReadyClients(worker, m_numQueuedTasks == 0);
+		if( numScheduled > 1 ) WakeIdleWorkers(numScheduled - 1, workerIdx);
+
+		// Own tasks first, then help the others
+		for( int i = 0; i < ENGINE_TASKS_PER_POLL && !m_stop; ++i )
+		{
+			EngineConnection* task = PopTask(worker);
+			if( task == 0 ) task = StealTask(workerIdx);
+			if( task == 0 ) break;
+			RunTask(task);
+		}
+	}
+}
+
+int PdcEngine::CollectReadyClients( Worker& worker, bool block )
+{
+	// Every event of the previous wait has been scheduled or skipped, so the detached connections can go
+	FreeDetached(worker);
+
+	if( block )
+	{
+		// Announce the sleep before the last look at the queues - a thread queueing tasks after it wakes us up
+		worker.Sleeping = true;
+		if( m_numQueuedTasks > 0 || m_stop ) block = false;
+	}
+
+	epoll_event events[ENGINE_MAX_EVENTS];
+	int ret = epoll_wait(worker.EpollFd, events, ENGINE_MAX_EVENTS, block ? GetTimerWaitMs(worker) : 0);
+	worker.Sleeping = false;
+
+	int numScheduled = CollectDueTimers(worker);
+	for( int i = 0; i < ret; ++i )
+	{
+		if( events[i].data.ptr == 0 )
+		{
+			uint64_t count;
+			(void)!read(worker.WakeupFd, &count, sizeof(count));
+		}
+		else if( Schedule(worker, (EngineConnection*)events[i].data.ptr) ) ++numScheduled;
+	}
+	return numScheduled;
+}
+
+int PdcEngine::GetTimerWaitMs( Worker& worker )
+{
+	std::lock_guard<std::mutex> lock(worker.TaskLock);
+	if( worker.Timers.empty() ) return -1;
+
+	std::chrono::steady_clock::time_point next = std::min_element(worker.Timers.begin(), worker.Timers.end())->first;
+	int64_t waitUs = std::chrono::duration_cast<std::chrono::microseconds>(next - std::chrono::steady_clock::now()).count();
+	return waitUs > 0 ? (int)((waitUs + 999) / 1000) : 0; // rounded up - an early wakeup would spin
+}
+
+int PdcEngine::CollectDueTimers( Worker& worker )
+{
+	std::vector<EngineConnection*> due;
+	{
+		std::lock_guard<std::mutex> lock(worker.TaskLock);
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		for( size_t i = 0; i < worker.Timers.size(); )
+		{
+			if( worker.Timers[i].first > now ) { ++i; continue; }
+			due.push_back(worker.Timers[i].second);
+			worker.Timers[i] = worker.Timers.back();
+			worker.Timers.pop_back();
+		}
+	}
+
+	int numScheduled = 0;
+	for( std::vector<EngineConnection*>::iterator iter = due.begin(); iter != due.end(); ++iter )
+		if( Schedule(worker, *iter) ) ++numScheduled;
+	return numScheduled;
+}
+
+void PdcEngine::AddTimer( Worker& worker, EngineConnection* connection, std::chrono::steady_clock::time_point time )
+{
+	{
+		std::lock_guard<std::mutex> lock(worker.TaskLock);
+		worker.Timers.push_back(Timer(time, connection));
+	}
+	Wake(worker); // its wait may have to end earlier
+}
+
+bool PdcEngine::Schedule( Worker& worker, EngineConnection* connection )
+{
+	{
+		// A timer may fire for a connection whose socket fired as well - it is serviced once
+		std::lock_guard<std::mutex> lock(connection->Lock);
+		if( connection->Detached || connection->Scheduled ) return false;
+		connection->Scheduled = true;
+	}
+
+	// Counted first: a thread about to sleep may see the count before the task, never the task without the count
+	++m_numQueuedTasks;
+	std::lock_guard<std::mutex> lock(worker.TaskLock);
+	worker.Tasks.push_back(connection);
+	return true;
+}
+
+EngineConnection* PdcEngine::PopTask( Worker& worker )
+{
+	std::lock_guard<std::mutex> lock(worker.TaskLock);
+	if( worker.Tasks.empty() ) return 0;
+
+	EngineConnection* task = worker.Tasks.front();
+	worker.Tasks.pop_front();
+	--m_numQueuedTasks;
+	return task;
+}
+
+EngineConnection* PdcEngine::StealTask( int thiefIdx )
+{
+	const int numWorkers = (int)m_workers.size();
+	for( int i = 1; i < numWorkers; ++i )
+	{
+		// Take half of the victim's tasks from the back: one to run, the rest to the own deque
+		std::vector<EngineConnection*> stolen;
+		{
+			Worker& victim = *m_workers[(thiefIdx + i) % numWorkers];
+			std::lock_guard<std::mutex> lock(victim.TaskLock);
+			const size_t numToSteal = (victim.Tasks.size() + 1) / 2;
+			for( size_t k = 0; k < numToSteal; ++k ) {
+				stolen.push_back(victim.Tasks.back());
+				victim.Tasks.pop_back();
+			}
+		}
+		if( stolen.empty() ) continue;
+
+		if( stolen.size() > 1 )
+		{
+			Worker& thief = *m_workers[thiefIdx];
+			std::lock_guard<std::mutex> lock(thief.TaskLock);
+			thief.Tasks.insert(thief.Tasks.end(), stolen.begin() + 1, stolen.end());
+		}
+		--m_numQueuedTasks;
+		return stolen.front();
+	}
+	return 0;
+}
+
+void PdcEngine::RunTask( EngineConnection* connection )
+{
+	bool detached;
+	{
+		std::lock_guard<std::mutex> lock(connection->Lock);
+		detached = connection->Detached;
+	}
+
+	// Service without the lock - only this thread touches the client receiver until Scheduled is cleared
+	PdcClient::ServiceResult result = detached ? PdcClient::ServiceResult::STOPPED : connection->Client->ServiceSocket();
+
+	std::lock_guard<std::mutex> lock(connection->Lock);
+	connection->Scheduled = false;
+	if( !connection->Detached )
+	{
+		// A stopped receiver is not re-armed - it reports the failure until it is stopped
+		Worker& owner = *m_workers[connection->Owner];
+		switch( result )
+		{
+		case PdcClient::ServiceResult::WAIT_READABLE:
+			connection->SocketFd = connection->Client->GetSocketDescriptor();
+			RearmSocket(owner.EpollFd, connection, EPOLLIN);
+			break;
+		case PdcClient::ServiceResult::WAIT_WRITABLE: // connecting, up to the deadline
+			connection->SocketFd = connection->Client->GetSocketDescriptor();
+			RearmSocket(owner.EpollFd, connection, EPOLLOUT);
+			AddTimer(owner, connection, connection->Client->GetServiceDeadline());
+			break;
+		case PdcClient::ServiceResult::WAIT_UNTIL: // the socket is closed - its number may be reused by another client
+			connection->SocketFd = -1;
+			AddTimer(owner, connection, connection->Client->GetServiceDeadline());
+			break;
+		case PdcClient::ServiceResult::STOPPED: // the socket is left open, or closed if a reconnect was given up
+			if( connection->Client->GetSocketDescriptor() <= 0 ) connection->SocketFd = -1;
+			break;
+		}
+	}
+	connection->Idle.notify_all();
+}
+
+void PdcEngine::WakeIdleWorkers( int count, int exceptIdx )
+{
+	const int numWorkers = (int)m_workers.size();
+	for( int i = 1; i < numWorkers && count > 0; ++i )
+	{
+		Worker& worker = *m_workers[(exceptIdx + i) % numWorkers];
+		if( !worker.Sleeping ) continue;
+		Wake(worker);
+		--count;
+	}
+}
+
+void PdcEngine::Wake( Worker& worker )
+{
+	uint64_t one = 1;
+	(void)!write(worker.WakeupFd, &one, sizeof(one));
+}
+
+void PdcEngine::FreeDetached( Worker& worker )
+{
+	std::vector<EngineConnection*> detached;
+	{
+		std::lock_guard<std::mutex> lock(worker.TaskLock);
+		detached.swap(worker.Detached);
+	}
+	for( std::vector<EngineConnection*>::iterator iter = detached.begin(); iter != detached.end(); ++iter )
+		delete *iter;
+}
+
+#else
+
+PdcEngine::PdcEngine( int numThreads )
+{
+	throw Exception("The I/O thread pool requires epoll (Linux)");
+}
+
+PdcEngine::~PdcEngine()
+{
+}
+
+EngineConnection* PdcEngine::Attach( PdcClient* client )
+{
+	throw Exception("The I/O thread pool requires epoll (Linux)");
+}
+
+void PdcEngine::Detach( EngineConnection* connection )
+{
+}
+
+#endif
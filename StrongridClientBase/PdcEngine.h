@@ -0,0 +1,93 @@
+/*
+*  PdcEngine.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#pragma once
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace strongridclientbase
+{
+	class PdcClient;
+	struct EngineConnection; // a client attached to the engine
+
+	// Fixed pool of I/O threads running the receivers of many clients, instead of one receiver thread per client.
+	// Every thread owns an epoll set and a client socket is registered one-shot in the set of one thread, so at most
+	// one thread services a client at a time and its frames stay in order. A ready client becomes a task on the
+	// deque of the thread that saw it; threads out of tasks steal from the others before they wait on their own set,
+	// which spreads the decode work when the ready clients are unevenly distributed over the sets. A client that
+	// reconnects by itself waits on a timer of its owner thread between attempts, and its new socket joins the set.
+	// Requires epoll (Linux) - the constructor throws elsewhere.
+	class PdcEngine
+	{
+	public:
+		PdcEngine( int numThreads );
+		~PdcEngine(); // all clients must be detached first
+
+		int GetNumThreads() const { return (int)m_workers.size(); }
+		int GetNumAttached() const { return m_numAttached; }
+
+		// Called by PdcClient when its receiver is started/stopped. Detach returns once no thread uses the client.
+		EngineConnection* Attach( PdcClient* client );
+		void Detach( EngineConnection* connection );
+
+	private:
+		typedef std::pair<std::chrono::steady_clock::time_point, EngineConnection*> Timer;
+
+		struct Worker
+		{
+			std::thread Thread;
+			int EpollFd;
+			int WakeupFd;
+			std::atomic<bool> Sleeping; // blocked in epoll_wait, woken through WakeupFd
+			std::atomic<int> NumConnections;
+
+			std::mutex TaskLock;
+			std::deque<EngineConnection*> Tasks; // owner pops the front, thieves take the back
+			std::vector<EngineConnection*> Detached; // freed by the owner once no epoll event can refer to them
+			std::vector<Timer> Timers; // connections to service at a time rather than on a socket event
+		};
+
+		void Shutdown();
+		void WorkerProc( int workerIdx );
+		int CollectReadyClients( Worker& worker, bool block );
+		int CollectDueTimers( Worker& worker );
+		int GetTimerWaitMs( Worker& worker );
+		void AddTimer( Worker& worker, EngineConnection* connection, std::chrono::steady_clock::time_point time );
+		bool Schedule( Worker& worker, EngineConnection* connection );
+		EngineConnection* PopTask( Worker& worker );
+		EngineConnection* StealTask( int thiefIdx );
+		void RunTask( EngineConnection* connection );
+		void WakeIdleWorkers( int count, int exceptIdx );
+		void Wake( Worker& worker );
+		void FreeDetached( Worker& worker );
+
+	private:
+		std::vector<Worker*> m_workers;
+		std::atomic<bool> m_stop;
+		std::atomic<int> m_numQueuedTasks; // over all deques, lets a thread see stealable work before it sleeps
+		std::atomic<int> m_numAttached;
+	};
+}
@@ -20,20 +20,26 @@
 *
 */
 
-#include <cstring>      // std::memset
+#include <chrono>       // std::chrono::steady_clock
+#include <cstring>      // std::memcpy, std::memset
 #include <sstream>      // std::stringstream
 
 #ifdef _WIN32
-#	include <winerror.h>    // WSAETIMEDOUT
-#	include <WinSock2.h>    // WSAGetLastError, SOCK_STREAM, SOL_SOCKET, SO_RCVTIMEO, connect, recv, send, setsockopt, socket, closesocket
+#	include <winerror.h>    // WSAETIMEDOUT, WSAEWOULDBLOCK
+#	include <WinSock2.h>    // FIONBIO, FIONREAD, WSAGetLastError, WSAPoll, ioctlsocket, SOCK_STREAM, SOL_SOCKET, SO_RCVTIMEO, connect, recv, send, setsockopt, socket, closesocket
 #	include <ws2def.h>      // AF_UNSPEC, addrinfo
 #	include <WS2tcpip.h>    // freeaddrinfo, getaddrinfo
 #else
-#	include <cerrno>        // EAGAIN, EWOULDBLOCK, errno
+#	include <cerrno>        // EAGAIN, EINPROGRESS, EINTR, EWOULDBLOCK, errno
+#	include <fcntl.h>       // F_GETFL, F_SETFL, O_NONBLOCK, fcntl
 #	include <netdb.h>       // addrinfo, freeaddrinfo, getaddrinfo
-#	include <sys/socket.h>  // AF_UNSPEC, SOCK_STREAM, SOL_SOCKET, SO_RCVTIMEO, connect, recv, send, setsockopt, socket
+#	include <poll.h>        // POLLOUT, poll, pollfd
+#	include <sys/socket.h>  // AF_UNSPEC, CMSG_*, MSG_DONTWAIT, SOCK_STREAM, SOL_SOCKET, SO_RCVTIMEO, SO_TIMESTAMPNS, connect, recv, recvmsg, send, setsockopt, socket
+#	include <sys/uio.h>     // iovec
 #	include <unistd.h>      // close
 #	define closesocket  close
+#	define WSAPoll      poll
+#	define WSAPOLLFD    pollfd
 #endif // _WIN32
 
 #include "../StrongridBase/common.h"
@@ -48,12 +54,17 @@ TcpClient::TcpClient(std::string ipAddress, int port)
 	m_ipAddr = ipAddress;
 	m_port = port;
 	m_win32Initialized  = false;
+	m_recvTimeoutMs = -1;
+	m_addrList = 0;
+	m_connectAddr = 0;
+	m_lastReceiveTimeNs = 0;
 	InitializeWindowsSocket();
 }
 
 TcpClient::~TcpClient()
 {
 	Close();
+	FreeAddressList();
 }
 
 int TcpClient::GetSocketDescriptor() const
@@ -61,45 +72,155 @@ int TcpClient::GetSocketDescriptor() const
 	return m_sockfd;
 }
 
-void TcpClient::Connect()
+static void SetBlocking( int sockfd, bool blocking )
 {
-	int sockfd;
-    addrinfo hints, *servinfo, *p;
-    int rv;
+#ifdef _WIN32
+	u_long nonBlocking = blocking ? 0 : 1;
+	ioctlsocket(sockfd, FIONBIO, &nonBlocking);
+#else
+	int flags = fcntl(sockfd, F_GETFL, 0);
+	fcntl(sockfd, F_SETFL, blocking ? (flags & ~O_NONBLOCK) : (flags | O_NONBLOCK));
+#endif // _WIN32
+}
 
+void TcpClient::Connect( int timeoutMs )
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
 
-    std::memset(&hints, 0, sizeof hints);
-    hints.ai_family = AF_UNSPEC;
-    hints.ai_socktype = SOCK_STREAM;
+	bool connected = StartConnect();
+	while( !connected )
+	{
+		int waitMs = -1;
+		if( timeoutMs >= 0 )
+		{
+			int64_t remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			waitMs = remainingMs > 0 ? (int)remainingMs : 0;
+		}
 
+		bool writable;
+		try {
+			writable = WaitWritable(waitMs);
+		}
+		catch( ... ) {
+			Close();
+			FreeAddressList();
+			throw;
+		}
+		if( !writable )
+		{
+			Close();
+			FreeAddressList();
+			throw SocketTimeout("Unable to connect within timeout");
+		}
+		connected = FinishConnect();
+	}
+}
+
+bool TcpClient::StartConnect()
+{
+	Close();
+	FreeAddressList();
+
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof hints);
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_STREAM;
 
 	std::stringstream ss; ss << m_port;
-    if ((rv = getaddrinfo(m_ipAddr.c_str(), ss.str().c_str(), &hints, &servinfo)) != 0)
-        throw Exception("Unable to get address information.");
-
-    // loop through all the results and connect to the first we can
-    for(p = servinfo; p != NULL; p = p->ai_next) {
-        if ((sockfd = socket(p->ai_family, p->ai_socktype,
-                p->ai_protocol)) == -1) {
-            perror("client: socket");
-            continue;
-        }
-
-        if (connect(sockfd, p->ai_addr, p->ai_addrlen) == -1) {
-            closesocket(sockfd);
-            perror("client: connect");
-            continue;
-        }
-
-        break;
-    }
+	if( getaddrinfo(m_ipAddr.c_str(), ss.str().c_str(), &hints, &m_addrList) != 0 )
+	{
+		m_addrList = 0;
+		throw Exception("Unable to get address information.");
+	}
+
+	m_connectAddr = m_addrList;
+	return ConnectNextAddress();
+}
+
+bool TcpClient::ConnectNextAddress()
+{
+	// Loop through the remaining results and start connecting to the first we can
+	for( ; m_connectAddr != NULL; m_connectAddr = m_connectAddr->ai_next )
+	{
+		int sockfd = socket(m_connectAddr->ai_family, m_connectAddr->ai_socktype, m_connectAddr->ai_protocol);
+		if( sockfd == -1 ) continue;
+
+		SetBlocking(sockfd, false);
+		m_sockfd = sockfd;
+		if( connect(sockfd, m_connectAddr->ai_addr, m_connectAddr->ai_addrlen) == 0 ) return CompleteConnect();
+
+#ifdef _WIN32
+		if( WSAGetLastError() == WSAEWOULDBLOCK ) return false;
+#else
+		if( errno == EINPROGRESS ) return false;
+#endif // _WIN32
+		Close();
+	}
+
+	FreeAddressList();
+	throw Exception("Failed to connect to host");
+}
+
+bool TcpClient::FinishConnect()
+{
+	int error = 0;
+	socklen_t errorLength = sizeof(error);
+	if( getsockopt(m_sockfd, SOL_SOCKET, SO_ERROR, (char*)&error, &errorLength) == 0 && error == 0 ) return CompleteConnect();
+
+	// Refused or unreachable - try the next address
+	Close();
+	m_connectAddr = m_connectAddr->ai_next;
+	return ConnectNextAddress();
+}
+
+bool TcpClient::WaitWritable( int timeoutMs )
+{
+	std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(timeoutMs);
+
+	WSAPOLLFD pollFd;
+	pollFd.fd = m_sockfd;
+	pollFd.events = POLLOUT;
+	while( true )
+	{
+		pollFd.revents = 0;
+		int ret = WSAPoll(&pollFd, 1, timeoutMs);
+		if( ret >= 0 ) return ret > 0;
+
+		// The connect is still in progress after a failed poll (SO_ERROR is 0), so it must not be finished
+#ifndef _WIN32
+		if( errno != EINTR )
+#endif // _WIN32
+			throw SocketException("Unable to wait for the connection");
+
+		// Interrupted by a signal - wait for the rest of the timeout
+		if( timeoutMs > 0 )
+		{
+			int64_t remainingMs = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now()).count();
+			timeoutMs = remainingMs > 0 ? (int)remainingMs : 0;
+		}
+	}
+}
 
-    if (p == NULL)
-        throw Exception("Failed to connect to host");
+bool TcpClient::CompleteConnect()
+{
+	// Reads rely on blocking sockets with a receive timeout
+	SetBlocking(m_sockfd, true);
+	FreeAddressList();
+	m_recvTimeoutMs = -1;
 
-    freeaddrinfo(servinfo); // all done with this structure
+#ifdef SO_TIMESTAMPNS
+	// Software receive timestamps: the kernel attaches the arrival time of the data to every read
+	int enable = 1;
+	setsockopt(m_sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+#endif
+	return true;
+}
 
-	m_sockfd = sockfd;
+void TcpClient::FreeAddressList()
+{
+	if( m_addrList != 0 ) freeaddrinfo(m_addrList);
+	m_addrList = 0;
+	m_connectAddr = 0;
 }
 
 void TcpClient::Close()
@@ -125,43 +246,125 @@ int TcpClient::Send( const char* data, int length )
 	return bytesSent;
 }
 
-int TcpClient::Recv( char* refData, int length, int timeoutMs )
+void TcpClient::SetRecvTimeout( int timeoutMs )
 {
-	int bytesReceived = 0;
-	while( bytesReceived < length )
-	{
+	// Only touch the socket when the timeout changes
+	if( timeoutMs == m_recvTimeoutMs ) return;
 
-		// set timeout
 #ifdef _WIN32
-		DWORD dwto = timeoutMs;
-		setsockopt(m_sockfd,SOL_SOCKET, SO_RCVTIMEO , (const char*)&dwto, sizeof(DWORD) );
+	DWORD dwto = timeoutMs;
+	setsockopt(m_sockfd,SOL_SOCKET, SO_RCVTIMEO , (const char*)&dwto, sizeof(DWORD) );
 #else
-		timeval timeout {timeoutMs/1000, timeoutMs%1000 * 1000};  // millisec -> {sec, usec}
-		setsockopt(m_sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+	timeval timeout {timeoutMs/1000, timeoutMs%1000 * 1000};  // millisec -> {sec, usec}
+	setsockopt(m_sockfd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
 #endif // _WIN32
+	m_recvTimeoutMs = timeoutMs;
+}
 
-		// Perform read
-		int retVal = recv(m_sockfd, refData + bytesReceived, length - bytesReceived, 0 );
-		if( retVal <= 0 )
-		{
+int TcpClient::ReceiveStamped( char* refData, int length, int flags )
+{
+#ifdef SO_TIMESTAMPNS
+	iovec iov;
+	iov.iov_base = refData;
+	iov.iov_len = length;
+	char control[CMSG_SPACE(sizeof(timespec))];
+	msghdr msg;
+	std::memset(&msg, 0, sizeof msg);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	msg.msg_control = control;
+	msg.msg_controllen = sizeof control;
+
+	int retVal = recvmsg(m_sockfd, &msg, flags);
+	if( retVal <= 0 ) return retVal;
+
+	// TCP reports the timestamp of the last segment read
+	m_lastReceiveTimeNs = 0;
+	for( cmsghdr* cmsg = CMSG_FIRSTHDR(&msg); cmsg != NULL; cmsg = CMSG_NXTHDR(&msg, cmsg) )
+	{
+		if( cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS ) continue;
+		timespec stamp;
+		std::memcpy(&stamp, CMSG_DATA(cmsg), sizeof stamp);
+		m_lastReceiveTimeNs = (int64_t)stamp.tv_sec * 1000000000 + stamp.tv_nsec;
+	}
+	if( m_lastReceiveTimeNs == 0 ) m_lastReceiveTimeNs = TimeConversionHelper::GetWallClockNs();
+	return retVal;
+#else
+	// No kernel timestamps - the time the read returned is the closest there is
+	int retVal = recv(m_sockfd, refData, length, flags);
+	if( retVal > 0 ) m_lastReceiveTimeNs = TimeConversionHelper::GetWallClockNs();
+	return retVal;
+#endif
+}
+
+int TcpClient::RecvOnce( char* refData, int length )
+{
+	int retVal = ReceiveStamped(refData, length, 0);
 
+	// A clean close sets no error code - errno may still hold the EAGAIN of an earlier timed out read
+	if( retVal == 0 )
+	{
+		Close();
+		throw SocketException("The connection was closed by the peer");
+	}
+	if( retVal < 0 )
+	{
 #ifdef _WIN32
-			if( WSAGetLastError() == WSAETIMEDOUT )
+		if( WSAGetLastError() == WSAETIMEDOUT )
 #else
-			if (errno == EAGAIN || errno == EWOULDBLOCK)
+		if (errno == EAGAIN || errno == EWOULDBLOCK)
 #endif // _WIN32
-				throw SocketTimeout("Unable to read within timeout");
-			else {
-				Close();
-				throw SocketException("An error ocurred while attempting to read data");
-			}
+			throw SocketTimeout("Unable to read within timeout");
+		else {
+			Close();
+			throw SocketException("An error ocurred while attempting to read data");
 		}
-
-		bytesReceived += retVal;
 	}
+	return retVal;
+}
+
+int TcpClient::Recv( char* refData, int length, int timeoutMs )
+{
+	SetRecvTimeout(timeoutMs);
+
+	int bytesReceived = 0;
+	while( bytesReceived < length )
+		bytesReceived += RecvOnce(refData + bytesReceived, length - bytesReceived);
 	return bytesReceived;
 }
 
+int TcpClient::RecvSome( char* refData, int maxLength, int timeoutMs )
+{
+	SetRecvTimeout(timeoutMs);
+	return RecvOnce(refData, maxLength);
+}
+
+int TcpClient::RecvAvailable( char* refData, int maxLength )
+{
+	// The socket is not closed on failure: it may still be registered with an epoll set by its descriptor
+#ifdef _WIN32
+	u_long available = 0;
+	if( ioctlsocket(m_sockfd, FIONREAD, &available) != 0 ) throw SocketException("An error ocurred while attempting to read data");
+	if( available == 0 ) return 0;
+	int retVal = ReceiveStamped(refData, maxLength, 0);
+#else
+	int retVal = ReceiveStamped(refData, maxLength, MSG_DONTWAIT);
+#endif // _WIN32
+
+	if( retVal == 0 ) throw SocketException("The connection was closed by the peer");
+	if( retVal < 0 )
+	{
+#ifdef _WIN32
+		if( WSAGetLastError() == WSAEWOULDBLOCK )
+#else
+		if( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR )
+#endif // _WIN32
+			return 0;
+		throw SocketException("An error ocurred while attempting to read data");
+	}
+	return retVal;
+}
+
 
 void TcpClient::InitializeWindowsSocket()
 {
@@ -21,8 +21,11 @@
 */
 
 #pragma once
+#include <stdint.h>
 #include <string>
 
+struct addrinfo;
+
 namespace strongridclientbase
 {
 	class TcpClient
@@ -33,18 +36,38 @@ namespace strongridclientbase
 
 		 int GetSocketDescriptor() const;
 
-		 void Connect();
+		 void Connect(int timeoutMs = -1); // -1: until the kernel gives up
+
+		 // Non-blocking connect in steps, for connecting many clients from one thread. When StartConnect returns false,
+		 // wait until the socket is writable and call FinishConnect; it returns false when it moved on to the next
+		 // address of the host (wait again). Both throw when no address could be connected.
+		 bool StartConnect();
+		 bool FinishConnect();
+		 bool WaitWritable(int timeoutMs); // true once the socket of StartConnect/FinishConnect can be finished, false on timeout - signals do not cut the wait short
 		 void Close();
 		 int Send(const char* src, int len);
 		 int Recv(char* dest, int len, int timeoutMs);
+		 int RecvSome(char* dest, int maxLen, int timeoutMs); // single recv call, returns as soon as any data is available
+		 int RecvAvailable(char* dest, int maxLen); // never waits: 0 if no data is available, throws if the connection is lost
+		 int64_t GetLastReceiveTime() const { return m_lastReceiveTimeNs; } // ns since 1970 at which the data of the last read arrived
 
 	private:
 		void InitializeWindowsSocket();
+		bool ConnectNextAddress();
+		bool CompleteConnect();
+		void FreeAddressList();
+		void SetRecvTimeout(int timeoutMs);
+		int RecvOnce(char* dest, int len);
+		int ReceiveStamped(char* dest, int len, int flags);
 
 	private:
 		int m_sockfd;
 		std::string m_ipAddr;
 		int m_port;
 		bool m_win32Initialized;
+		int m_recvTimeoutMs; // timeout currently set on the socket, -1 if not set
+		addrinfo* m_addrList; // addresses of the host while connecting
+		addrinfo* m_connectAddr; // the address being connected
+		int64_t m_lastReceiveTimeNs;
 	};
 }
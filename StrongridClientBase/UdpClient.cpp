@@ -0,0 +1,344 @@
+/*
+*  UdpClient.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <cstdlib>      // std::atoi
+#include <cstring>      // std::memcpy, std::memset
+#include <sstream>      // std::stringstream
+
+#ifdef _WIN32
+#	include <winerror.h>    // WSAECONNRESET, WSAEMSGSIZE, WSAEWOULDBLOCK
+#	include <WinSock2.h>    // FIONBIO, WSAGetLastError, WSAPoll, ioctlsocket, SOCK_DGRAM, SOL_SOCKET, SO_RCVBUF, SO_REUSEADDR, bind, recv, sendto, setsockopt, socket, closesocket
+#	include <ws2def.h>      // AF_INET, AF_INET6, addrinfo
+#	include <WS2tcpip.h>    // IPV6_JOIN_GROUP, IP_ADD_MEMBERSHIP, freeaddrinfo, getaddrinfo, inet_pton, ip_mreq, ipv6_mreq, sockaddr_in6
+#else
+#	include <cerrno>        // EAGAIN, EINTR, EWOULDBLOCK, errno
+#	include <fcntl.h>       // F_GETFL, F_SETFL, O_NONBLOCK, fcntl
+#	include <arpa/inet.h>   // inet_pton
+#	include <net/if.h>      // if_nametoindex
+#	include <netdb.h>       // addrinfo, freeaddrinfo, getaddrinfo
+#	include <netinet/in.h>  // INADDR_ANY, IPPROTO_IP, IPPROTO_IPV6, IPV6_JOIN_GROUP, IP_ADD_MEMBERSHIP, in6addr_any, ip_mreq, ipv6_mreq, sockaddr_in, sockaddr_in6
+#	include <poll.h>        // POLLIN, poll, pollfd
+#	include <sys/socket.h>  // AF_INET, AF_INET6, CMSG_*, MSG_DONTWAIT, SOCK_DGRAM, SOL_SOCKET, SO_RCVBUF, SO_REUSEADDR, SO_TIMESTAMPNS, bind, recvmmsg, sendto, setsockopt, socket
+#	include <sys/uio.h>     // iovec
+#	include <unistd.h>      // close
+#	define closesocket  close
+#	define WSAPoll      poll
+#	define WSAPOLLFD    pollfd
+#endif // _WIN32
+
+#include "../StrongridBase/common.h"
+#include "UdpClient.h"
+
+using namespace strongridbase;
+using namespace strongridclientbase;
+
+UdpClient::UdpClient(std::string ipAddress, int port)
+{
+	m_sockfd = 0;
+	m_ipAddr = ipAddress;
+	m_port = port;
+	m_win32Initialized = false;
+	m_remoteAddr = 0;
+	InitializeWindowsSocket();
+}
+
+UdpClient::~UdpClient()
+{
+	Close();
+	FreeAddress();
+}
+
+int UdpClient::GetSocketDescriptor() const
+{
+	return m_sockfd;
+}
+
+void UdpClient::Open( int localPort, int receiveBufferSize )
+{
+	Close();
+	FreeAddress();
+
+	// The local address family follows the PDC address
+	int family = AF_INET;
+	if( !m_ipAddr.empty() )
+	{
+		ResolveRemote();
+		family = m_remoteAddr->ai_family;
+	}
+	CreateSocket(family, receiveBufferSize);
+
+	int bindResult;
+	if( family == AF_INET6 )
+	{
+		sockaddr_in6 local;
+		std::memset(&local, 0, sizeof local);
+		local.sin6_family = AF_INET6;
+		local.sin6_addr = in6addr_any;
+		local.sin6_port = htons((uint16_t)localPort);
+		bindResult = bind(m_sockfd, (const sockaddr*)&local, sizeof local);
+	}
+	else
+	{
+		sockaddr_in local;
+		std::memset(&local, 0, sizeof local);
+		local.sin_family = AF_INET;
+		local.sin_addr.s_addr = htonl(INADDR_ANY);
+		local.sin_port = htons((uint16_t)localPort);
+		bindResult = bind(m_sockfd, (const sockaddr*)&local, sizeof local);
+	}
+	if( bindResult != 0 )
+	{
+		Close();
+		throw Exception("Unable to bind the UDP port");
+	}
+	SetNonBlocking();
+}
+
+void UdpClient::OpenMulticast( const std::string& interfaceAddress, int receiveBufferSize )
+{
+	Close();
+	FreeAddress();
+
+	ResolveRemote();
+	int family = m_remoteAddr->ai_family;
+	CreateSocket(family, receiveBufferSize);
+
+	// Other sockets of this host receive the same group on the same port
+	int reuse = 1;
+	setsockopt(m_sockfd, SOL_SOCKET, SO_REUSEADDR, (const char*)&reuse, sizeof(reuse));
+
+	// Bound to the group address so that other groups sent to the port are not received - Windows only binds
+	// to a local address
+	sockaddr_storage local;
+	std::memset(&local, 0, sizeof local);
+	std::memcpy(&local, m_remoteAddr->ai_addr, m_remoteAddr->ai_addrlen);
+#ifdef _WIN32
+	if( family == AF_INET6 ) ((sockaddr_in6*)&local)->sin6_addr = in6addr_any;
+	else ((sockaddr_in*)&local)->sin_addr.s_addr = htonl(INADDR_ANY);
+#endif // _WIN32
+	if( bind(m_sockfd, (const sockaddr*)&local, (int)m_remoteAddr->ai_addrlen) != 0 )
+	{
+		Close();
+		throw Exception("Unable to bind the UDP port");
+	}
+
+	int joinResult;
+	if( family == AF_INET6 )
+	{
+		// The interface is given by its index, or by its name where the system can look it up
+		ipv6_mreq request;
+		std::memset(&request, 0, sizeof request);
+		request.ipv6mr_multiaddr = ((const sockaddr_in6*)m_remoteAddr->ai_addr)->sin6_addr;
+		if( !interfaceAddress.empty() )
+		{
+			request.ipv6mr_interface = (unsigned int)std::atoi(interfaceAddress.c_str());
+#ifndef _WIN32
+			if( request.ipv6mr_interface == 0 ) request.ipv6mr_interface = if_nametoindex(interfaceAddress.c_str());
+#endif // _WIN32
+			if( request.ipv6mr_interface == 0 )
+			{
+				Close();
+				throw Exception("Unknown network interface");
+			}
+		}
+		joinResult = setsockopt(m_sockfd, IPPROTO_IPV6, IPV6_JOIN_GROUP, (const char*)&request, sizeof request);
+	}
+	else
+	{
+		// The interface is given by its address
+		ip_mreq request;
+		std::memset(&request, 0, sizeof request);
+		request.imr_multiaddr = ((const sockaddr_in*)m_remoteAddr->ai_addr)->sin_addr;
+		request.imr_interface.s_addr = htonl(INADDR_ANY);
+		if( !interfaceAddress.empty() && inet_pton(AF_INET, interfaceAddress.c_str(), &request.imr_interface) != 1 )
+		{
+			Close();
+			throw Exception("Invalid network interface address");
+		}
+		joinResult = setsockopt(m_sockfd, IPPROTO_IP, IP_ADD_MEMBERSHIP, (const char*)&request, sizeof request);
+	}
+	if( joinResult != 0 )
+	{
+		Close();
+		throw Exception("Unable to join the multicast group");
+	}
+	SetNonBlocking();
+}
+
+void UdpClient::ResolveRemote()
+{
+	addrinfo hints;
+	std::memset(&hints, 0, sizeof hints);
+	hints.ai_family = AF_UNSPEC;
+	hints.ai_socktype = SOCK_DGRAM;
+
+	std::stringstream ss; ss << m_port;
+	if( getaddrinfo(m_ipAddr.c_str(), ss.str().c_str(), &hints, &m_remoteAddr) != 0 )
+	{
+		m_remoteAddr = 0;
+		throw Exception("Unable to get address information.");
+	}
+}
+
+void UdpClient::CreateSocket( int family, int receiveBufferSize )
+{
+	int sockfd = socket(family, SOCK_DGRAM, 0);
+	if( sockfd == -1 ) throw Exception("Unable to create UDP socket");
+	m_sockfd = sockfd;
+
+	// Dataframes arrive in bursts that must not overflow the socket while the reader is busy
+	setsockopt(m_sockfd, SOL_SOCKET, SO_RCVBUF, (const char*)&receiveBufferSize, sizeof(receiveBufferSize));
+#ifdef SO_TIMESTAMPNS
+	int enable = 1;
+	setsockopt(m_sockfd, SOL_SOCKET, SO_TIMESTAMPNS, &enable, sizeof(enable));
+#endif
+}
+
+void UdpClient::SetNonBlocking()
+{
+	// Reads never block: waiting is done by RecvBatch
+#ifdef _WIN32
+	u_long nonBlocking = 1;
+	ioctlsocket(m_sockfd, FIONBIO, &nonBlocking);
+#else
+	fcntl(m_sockfd, F_SETFL, fcntl(m_sockfd, F_GETFL, 0) | O_NONBLOCK);
+#endif // _WIN32
+}
+
+void UdpClient::FreeAddress()
+{
+	if( m_remoteAddr != 0 ) freeaddrinfo(m_remoteAddr);
+	m_remoteAddr = 0;
+}
+
+void UdpClient::Close()
+{
+	if( m_sockfd != 0 ) closesocket(m_sockfd);
+	m_sockfd = 0;
+}
+
+int UdpClient::Send( const char* data, int length )
+{
+	if( m_remoteAddr == 0 ) throw Exception("No destination to send to");
+	if( sendto(m_sockfd, data, length, 0, m_remoteAddr->ai_addr, (int)m_remoteAddr->ai_addrlen) != length )
+		throw Exception("Unable to send data!");
+	return length;
+}
+
+int UdpClient::RecvBatch( char* dest, int slotSize, int maxDatagrams, int* lengths, int64_t* arrivalNs, int timeoutMs )
+{
+	WSAPOLLFD pollFd;
+	pollFd.fd = m_sockfd;
+	pollFd.events = POLLIN;
+	pollFd.revents = 0;
+	if( WSAPoll(&pollFd, 1, timeoutMs) == 0 ) throw SocketTimeout("Unable to read within timeout");
+	return RecvBatchAvailable(dest, slotSize, maxDatagrams, lengths, arrivalNs);
+}
+
+#if defined(__linux__) && defined(SO_TIMESTAMPNS)
+
+int UdpClient::RecvBatchAvailable( char* dest, int slotSize, int maxDatagrams, int* lengths, int64_t* arrivalNs )
+{
+	// One system call for the whole batch
+	if( maxDatagrams > MAX_BATCH ) maxDatagrams = MAX_BATCH;
+	mmsghdr msgs[MAX_BATCH];
+	iovec iovs[MAX_BATCH];
+	char control[MAX_BATCH][CMSG_SPACE(sizeof(timespec))];
+	std::memset(msgs, 0, maxDatagrams * sizeof(mmsghdr));
+	for( int i = 0; i < maxDatagrams; ++i )
+	{
+		iovs[i].iov_base = dest + i * slotSize;
+		iovs[i].iov_len = slotSize;
+		msgs[i].msg_hdr.msg_iov = &iovs[i];
+		msgs[i].msg_hdr.msg_iovlen = 1;
+		msgs[i].msg_hdr.msg_control = control[i];
+		msgs[i].msg_hdr.msg_controllen = sizeof control[i];
+	}
+
+	int numDatagrams = recvmmsg(m_sockfd, msgs, maxDatagrams, MSG_DONTWAIT, NULL);
+	if( numDatagrams < 0 )
+	{
+		if( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) return 0;
+		throw SocketException("An error ocurred while attempting to read data");
+	}
+
+	int64_t nowNs = 0;
+	for( int i = 0; i < numDatagrams; ++i )
+	{
+		lengths[i] = (int)msgs[i].msg_len;
+		arrivalNs[i] = 0;
+		for( cmsghdr* cmsg = CMSG_FIRSTHDR(&msgs[i].msg_hdr); cmsg != NULL; cmsg = CMSG_NXTHDR(&msgs[i].msg_hdr, cmsg) )
+		{
+			if( cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_TIMESTAMPNS ) continue;
+			timespec stamp;
+			std::memcpy(&stamp, CMSG_DATA(cmsg), sizeof stamp);
+			arrivalNs[i] = (int64_t)stamp.tv_sec * 1000000000 + stamp.tv_nsec;
+		}
+		if( arrivalNs[i] == 0 )
+		{
+			if( nowNs == 0 ) nowNs = TimeConversionHelper::GetWallClockNs();
+			arrivalNs[i] = nowNs;
+		}
+	}
+	return numDatagrams;
+}
+
+#else
+
+int UdpClient::RecvBatchAvailable( char* dest, int slotSize, int maxDatagrams, int* lengths, int64_t* arrivalNs )
+{
+	// No batched receive - one call per datagram, stamped with the time the read returned
+	int numDatagrams = 0;
+	while( numDatagrams < maxDatagrams )
+	{
+		int retVal = recv(m_sockfd, dest + numDatagrams * slotSize, slotSize, 0);
+		if( retVal < 0 )
+		{
+#ifdef _WIN32
+			int error = WSAGetLastError();
+			if( error == WSAEMSGSIZE ) retVal = slotSize; // truncated
+			else if( error == WSAEWOULDBLOCK || error == WSAECONNRESET ) break;
+#else
+			if( errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) break;
+#endif // _WIN32
+			else throw SocketException("An error ocurred while attempting to read data");
+		}
+		lengths[numDatagrams] = retVal;
+		arrivalNs[numDatagrams] = TimeConversionHelper::GetWallClockNs();
+		++numDatagrams;
+	}
+	return numDatagrams;
+}
+
+#endif
+
+void UdpClient::InitializeWindowsSocket()
+{
+	// Only initialize once
+	if( m_win32Initialized == true ) return;
+	m_win32Initialized = true;
+
+#ifdef _WIN32	// no need to initialize on Unix
+	WSADATA wsaData;
+	if (WSAStartup(MAKEWORD(2,0), &wsaData) != 0) throw Exception("Unable to initialize winsock2!");
+#endif // _WIN32
+}
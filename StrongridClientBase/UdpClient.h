@@ -0,0 +1,73 @@
+/*
+*  UdpClient.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#pragma once
+#include <stdint.h>
+#include <string>
+
+struct addrinfo;
+
+namespace strongridclientbase
+{
+	// Datagram socket receiving the frames of a PDC. Datagrams are read in batches (recvmmsg where available),
+	// each stamped with its kernel receive time. The socket is not connected: the PDC may send from any port.
+	class UdpClient
+	{
+	public:
+		static const int MAX_BATCH = 64; // datagrams per receive call
+
+		UdpClient(std::string ipAddress, int port); // destination of Send - an empty address gives a receive-only socket
+		~UdpClient();
+
+		int GetSocketDescriptor() const;
+
+		// Binds to localPort (0: any free port) with a receive buffer of receiveBufferSize bytes - the kernel may cap it
+		void Open(int localPort, int receiveBufferSize);
+
+		// Joins the multicast group given as address, on its port, shared with the other sockets of the host bound to it.
+		// interfaceAddress selects the network interface (empty: chosen by the system) - its address for IPv4, its
+		// index or name for IPv6. Closing the socket leaves the group.
+		void OpenMulticast(const std::string& interfaceAddress, int receiveBufferSize);
+		void Close();
+		int Send(const char* src, int len);
+
+		// Receive up to maxDatagrams datagrams, datagram 'i' into dest + i * slotSize; lengths[i] receives its length and
+		// arrivalNs[i] its receive time (ns since 1970). A datagram larger than slotSize is truncated.
+		// RecvBatch waits up to timeoutMs (-1: forever) for the first datagram, RecvBatchAvailable never waits.
+		int RecvBatch(char* dest, int slotSize, int maxDatagrams, int* lengths, int64_t* arrivalNs, int timeoutMs);
+		int RecvBatchAvailable(char* dest, int slotSize, int maxDatagrams, int* lengths, int64_t* arrivalNs);
+
+	private:
+		void InitializeWindowsSocket();
+		void FreeAddress();
+		void ResolveRemote();
+		void CreateSocket(int family, int receiveBufferSize);
+		void SetNonBlocking();
+
+	private:
+		int m_sockfd;
+		std::string m_ipAddr;
+		int m_port;
+		bool m_win32Initialized;
+		addrinfo* m_remoteAddr; // destination of Send, or the joined group - 0 if receive-only
+	};
+}
@@ -0,0 +1,245 @@
+/*
+*  ClientHandleTable.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <chrono>
+#include <thread>
+#include "ClientHandleTable.h"
+
+static const uint32_t INDEX_MASK = (1u << ClientHandleTable::INDEX_BITS) - 1;
+static const uint32_t GENERATION_MASK = (1u << ClientHandleTable::GENERATION_BITS) - 1;
+
+static uint32_t GenerationOf( uint64_t state )
+{
+	return (uint32_t)(state >> 32);
+}
+
+static int32_t MakePseudoPdcId( uint32_t index, uint32_t generation )
+{
+	return (int32_t)((generation << ClientHandleTable::INDEX_BITS) | index);
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------
+// ClientHandleTable::Ref
+// ------------------------------------------------------------------------------------------------------------------------
+
+
+PdcClient* ClientHandleTable::Ref::operator->() const
+{
+	return m_slot->Entry.Client;
+}
+
+ClientEntry& ClientHandleTable::Ref::Entry() const
+{
+	return m_slot->Entry;
+}
+
+void ClientHandleTable::Ref::Release()
+{
+	if( m_slot == 0 ) return;
+	if( m_locked ) m_slot->CallLock.unlock();
+	m_slot->State.fetch_sub(1, std::memory_order_release);
+	m_slot = 0;
+	m_locked = false;
+}
+
+void ClientHandleTable::Ref::Unlock()
+{
+	if( m_slot == 0 || !m_locked ) return;
+	m_slot->CallLock.unlock();
+	m_locked = false;
+}
+
+void ClientHandleTable::Ref::Lock()
+{
+	if( m_slot == 0 || m_locked ) return;
+	m_slot->CallLock.lock();
+	m_locked = true;
+}
+
+
+// ------------------------------------------------------------------------------------------------------------------------
+// ClientHandleTable
+// ------------------------------------------------------------------------------------------------------------------------
+
+
+ClientHandleTable::ClientHandleTable()
+{
+	for( int i = 0; i < NUM_SEGMENTS; ++i ) m_segments[i].store(0);
+	m_numSlots.store(1); // index 0 is never used, so no valid pseudoPdcId is 0
+	m_nextShard.store(0);
+}
+
+ClientHandleTable::~ClientHandleTable()
+{
+	for( int i = 0; i < NUM_SEGMENTS; ++i ) delete [] m_segments[i].load();
+}
+
+ClientHandleTable::Slot* ClientHandleTable::SlotAt( uint32_t index ) const
+{
+	Slot* segment = m_segments[index >> SEGMENT_BITS].load(std::memory_order_acquire);
+	if( segment == 0 ) return 0;
+	return &segment[index & (SEGMENT_SIZE - 1)];
+}
+
+uint32_t ClientHandleTable::AllocateFreshSlot()
+{
+	std::lock_guard<std::mutex> lock(m_segmentLock);
+	const uint32_t index = m_numSlots.load(std::memory_order_relaxed);
+	if( index > INDEX_MASK ) return 0;
+
+	// Segments are only ever added - a reader holding a slot pointer never sees it freed
+	const int segmentIdx = index >> SEGMENT_BITS;
+	if( m_segments[segmentIdx].load(std::memory_order_relaxed) == 0 )
+	{
+		Slot* segment = new Slot[SEGMENT_SIZE];
+		for( int i = 0; i < SEGMENT_SIZE; ++i ) {
+			segment[i].State.store(STATE_DEAD, std::memory_order_relaxed);
+			segment[i].Entry.Client = 0;
+			segment[i].Entry.FrameCallback = 0;
+		}
+		m_segments[segmentIdx].store(segment, std::memory_order_release);
+	}
+
+	m_numSlots.store(index + 1, std::memory_order_release);
+	return index;
+}
+
+uint32_t ClientHandleTable::AllocateSlot()
+{
+	// Reuse a free slot of the next shard, else take a new one, else look in the other shards
+	const uint32_t firstShard = m_nextShard.fetch_add(1, std::memory_order_relaxed) % NUM_SHARDS;
+	for( int i = 0; i < NUM_SHARDS; ++i )
+	{
+		Shard& shard = m_shards[(firstShard + i) % NUM_SHARDS];
+		{
+			std::lock_guard<std::mutex> lock(shard.Lock);
+			if( !shard.FreeSlots.empty() )
+			{
+				uint32_t index = shard.FreeSlots.front();
+				shard.FreeSlots.pop_front();
+				return index;
+			}
+		}
+
+		if( i == 0 ) {
+			uint32_t index = AllocateFreshSlot();
+			if( index != 0 ) return index;
+		}
+	}
+	return 0;
+}
+
+void ClientHandleTable::FreeSlot( uint32_t index )
+{
+	Shard& shard = m_shards[index % NUM_SHARDS];
+	std::lock_guard<std::mutex> lock(shard.Lock);
+	shard.FreeSlots.push_back(index);
+}
+
+int32_t ClientHandleTable::Add( const ClientEntry& entry )
+{
+	const uint32_t index = AllocateSlot();
+	if( index == 0 ) return 0;
+
+	// The slot is DEAD, so nobody reads the entry until the flag is cleared below. Stale lookups may hold
+	// transient references, which is why the state is updated with a CAS instead of a store.
+	Slot* slot = SlotAt(index);
+	slot->Entry = entry;
+	uint64_t state = slot->State.load(std::memory_order_relaxed);
+	while( !slot->State.compare_exchange_weak(state, state & ~STATE_DEAD, std::memory_order_release, std::memory_order_relaxed) ) {}
+
+	return MakePseudoPdcId(index, GenerationOf(state));
+}
+
+ClientHandleTable::Slot* ClientHandleTable::AddReference( int32_t pseudoPdcId )
+{
+	if( pseudoPdcId <= 0 ) return 0;
+	const uint32_t index = (uint32_t)pseudoPdcId & INDEX_MASK;
+	const uint32_t generation = (uint32_t)pseudoPdcId >> INDEX_BITS;
+	if( index == 0 || index >= m_numSlots.load(std::memory_order_acquire) ) return 0;
+
+	Slot* slot = SlotAt(index);
+	if( slot == 0 ) return 0;
+
+	// Take the reference first and validate afterwards - no retry loop
+	uint64_t state = slot->State.fetch_add(1, std::memory_order_acquire);
+	if( (state & STATE_DEAD) != 0 || GenerationOf(state) != generation )
+	{
+		slot->State.fetch_sub(1, std::memory_order_release);
+		return 0;
+	}
+	return slot;
+}
+
+ClientHandleTable::Ref ClientHandleTable::Acquire( int32_t pseudoPdcId )
+{
+	Slot* slot = AddReference(pseudoPdcId);
+	if( slot == 0 ) return Ref();
+
+	// The reference keeps the client alive while waiting for the call in another thread to finish
+	slot->CallLock.lock();
+	return Ref(slot, true);
+}
+
+bool ClientHandleTable::Remove( int32_t pseudoPdcId, ClientEntry* removedEntry )
+{
+	// No call lock - the calls holding it are what we wait for below
+	Slot* slot = AddReference(pseudoPdcId);
+	if( slot == 0 ) return false;
+	Ref ref(slot, false);
+
+	// Mark the slot DEAD and bump its generation - only one of several concurrent removers succeeds
+	uint64_t state = slot->State.load(std::memory_order_relaxed);
+	do {
+		if( (state & STATE_DEAD) != 0 ) return false;
+	} while( !slot->State.compare_exchange_weak(state,
+		((uint64_t)((GenerationOf(state) + 1) & GENERATION_MASK) << 32) | STATE_DEAD | (state & STATE_REF_MASK),
+		std::memory_order_acq_rel, std::memory_order_relaxed) );
+
+	// Wait for calls in other threads to finish with the client - only our own reference may remain
+	while( (slot->State.load(std::memory_order_acquire) & STATE_REF_MASK) > 1 )
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+	*removedEntry = slot->Entry;
+	slot->Entry.Client = 0;
+	slot->Entry.FrameCallback = 0;
+	ref.Release();
+
+	FreeSlot((uint32_t)pseudoPdcId & INDEX_MASK);
+	return true;
+}
+
+std::vector<ClientEntry> ClientHandleTable::RemoveAll()
+{
+	std::vector<ClientEntry> entries;
+	const uint32_t numSlots = m_numSlots.load(std::memory_order_acquire);
+	for( uint32_t index = 1; index < numSlots; ++index )
+	{
+		uint64_t state = SlotAt(index)->State.load(std::memory_order_acquire);
+		if( (state & STATE_DEAD) != 0 ) continue;
+
+		ClientEntry entry;
+		if( Remove(MakePseudoPdcId(index, GenerationOf(state)), &entry) ) entries.push_back(entry);
+	}
+	return entries;
+}
@@ -0,0 +1,130 @@
+/*
+*  ClientHandleTable.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#pragma once
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include "../StrongridClientBase/PdcClient.h"
+
+using namespace strongridclientbase;
+
+struct FrameCallbackContext;
+
+// Everything the DLL keeps per pseudoPdcId
+struct ClientEntry
+{
+	PdcClient* Client;
+	FrameCallbackContext* FrameCallback; // registerFrameCallback, 0 if none
+};
+
+// Maps pseudoPdcIds to clients. A pseudoPdcId holds the slot index in the low INDEX_BITS and the generation of
+// the slot above it; the generation is bumped on removal, so the id of a disconnected client is rejected even
+// after its slot has been reused. A lookup takes a reference on the slot with one atomic add (wait-free) and
+// Remove waits until the references of other threads are released before the client can be torn down.
+// Slots live in segments allocated on demand and kept until the table is destroyed, so lookups need no lock.
+// Every slot has its own call lock: Acquire serialises the calls on one client, never calls on different ones.
+class ClientHandleTable
+{
+	struct Slot;
+
+public:
+	static const int INDEX_BITS = 20; // up to 2^20 - 1 concurrent clients
+	static const int GENERATION_BITS = 31 - INDEX_BITS; // pseudoPdcIds stay positive
+
+	// Reference on a live slot (holding its call lock if acquired with Acquire), released when it goes out of scope
+	class Ref
+	{
+	public:
+		Ref() : m_slot(0), m_locked(false) {}
+		Ref( Ref&& other ) : m_slot(other.m_slot), m_locked(other.m_locked) { other.m_slot = 0; other.m_locked = false; }
+		~Ref() { Release(); }
+
+		explicit operator bool() const { return m_slot != 0; }
+		PdcClient* operator->() const;
+		ClientEntry& Entry() const;
+		void Release();
+
+		// Lets other calls on the client run in between while the reference is kept (Remove still waits for it)
+		void Unlock();
+		void Lock();
+
+	private:
+		friend class ClientHandleTable;
+		Ref( Slot* slot, bool locked ) : m_slot(slot), m_locked(locked) {}
+		Ref( const Ref& ) = delete;
+		Ref& operator=( const Ref& ) = delete;
+
+		Slot* m_slot;
+		bool m_locked;
+	};
+
+	ClientHandleTable();
+	~ClientHandleTable();
+
+	// Returns the pseudoPdcId of the new entry, 0 if all slots are in use
+	int32_t Add( const ClientEntry& entry );
+	Ref Acquire( int32_t pseudoPdcId ); // waits for the call lock of the client
+
+	// Invalidates the pseudoPdcId and hands the entry to the caller for teardown. False if it is not valid.
+	bool Remove( int32_t pseudoPdcId, ClientEntry* removedEntry );
+	std::vector<ClientEntry> RemoveAll();
+
+private:
+	static const int SEGMENT_BITS = 10;
+	static const int SEGMENT_SIZE = 1 << SEGMENT_BITS;
+	static const int NUM_SEGMENTS = 1 << (INDEX_BITS - SEGMENT_BITS);
+	static const int NUM_SHARDS = 16;
+
+	// Slot state: generation in the upper 32 bits, DEAD flag and reference count in the lower 32 bits
+	static const uint64_t STATE_DEAD = 0x80000000ull;
+	static const uint64_t STATE_REF_MASK = 0x7FFFFFFFull;
+
+	struct Slot
+	{
+		std::atomic<uint64_t> State;
+		std::mutex CallLock;
+		ClientEntry Entry;
+	};
+
+	// Free slot indices, a slot returns to the shard (index % NUM_SHARDS)
+	struct Shard
+	{
+		std::mutex Lock;
+		std::deque<uint32_t> FreeSlots; // FIFO - spreads reuse of a slot over time
+	};
+
+	Slot* SlotAt( uint32_t index ) const;
+	Slot* AddReference( int32_t pseudoPdcId );
+	uint32_t AllocateSlot();
+	uint32_t AllocateFreshSlot();
+	void FreeSlot( uint32_t index );
+
+private:
+	std::atomic<Slot*> m_segments[NUM_SEGMENTS];
+	std::mutex m_segmentLock;
+	std::atomic<uint32_t> m_numSlots; // indices [1, m_numSlots) have been handed out at least once
+	Shard m_shards[NUM_SHARDS];
+	std::atomic<uint32_t> m_nextShard;
+};
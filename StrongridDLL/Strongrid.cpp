@@ -21,6 +21,7 @@
 */
 
 #include <algorithm>
+#include <atomic>
 #include <cmath>
 #include <cstdint>
 #include <cstring>
@@ -38,8 +39,17 @@
 #	define WSAPOLLFD pollfd
 #endif
 
+#ifdef __linux__
+#	include <sys/epoll.h>   // epoll_create1, epoll_ctl, epoll_wait, epoll_event
+#	include <sys/eventfd.h> // eventfd
+#	include <unistd.h>      // close
+#	define STRONGRID_USE_EPOLL
+#endif
+
 #include "Strongrid.h"
+#include "ClientHandleTable.h"
 #include "../StrongridClientBase/PdcClient.h"
+#include "../StrongridClientBase/PdcConnector.h"
 #include "../StrongridBase/common.h"
 
 using namespace std;
@@ -51,21 +61,113 @@ static const int RETERR_NET_TIMEOUT = 2;
 static const int RETERR_INVALID_INPUT_PHASOR_ARR = 3;
 static const int RETERR_INVALID_INPUT_ANALOG_ARR = 4;
 static const int RETERR_INVALID_INPUT_DIGITAL_ARR = 5;
+static const int RETERR_PROJECTION_CLEARED = 6; // readNextFrame: a new configuration cleared the channel projection
 
 constexpr std::size_t MAX_NAME_LEN = 255;
-static std::mutex s_clientMapLock;
-const int MAXIMUM_CONCURRENT_CLIENTS = 8192;
-static int s_pdcClientCursor = 0;
-static PdcClient* s_pdcClientMap[MAXIMUM_CONCURRENT_CLIENTS]; // maps: index -> PdcClient* [0 => no client]
+static ClientHandleTable s_clients; // maps: pseudopdcid -> PdcClient* and its DLL state
+static std::mutex s_socketPollLock;
 static std::vector<std::pair<int,int>> s_socketPollVector; // Maps: pseudopdcid, socket FD | only contains active clients
 
+// Frame callbacks (registerFrameCallback), one per client - the view arrays are reused for every frame
+struct FrameCallbackContext
+{
+	int32_t PseudoPdcId;
+	frameCallback Callback;
+	void* UserData;
+	int TimeBase;
+	frameView View;
+	std::vector<PmuStatus> Status;
+};
+
+// pseudoPdcId of the frame callback running on this thread, 0 outside callbacks. Stopping its own receiver would
+// wait for the callback itself, so the calls tearing it down are refused from there.
+static thread_local int32_t s_callbackPseudoPdcId = 0;
+
+// I/O thread pool (setIoThreadPool) running the receivers of all clients, 0 if every receiver has its own thread
+static std::mutex s_ioEngineLock;
+static PdcEngine* s_ioEngine = 0;
+
+// Clients holding complete frames in their receive buffer - readable without socket activity
+static std::mutex s_pendingFrameLock;
+static std::vector<int> s_pendingFrameClients;
+
+#ifdef STRONGRID_USE_EPOLL
+// Persistent epoll set of all active client sockets, event data = pseudopdcid.
+// The wakeup eventfd (event data 0) signals frames queued by receiver threads.
+const int EPOLL_MAX_EVENTS = 256;
+static std::mutex s_epollInitLock;
+static std::atomic<int> s_epollFd(-1);
+static std::atomic<int> s_epollWakeupFd(-1);
+
+void EpollAddSocket( int32_t pseudoPdcId, int sockfd )
+{
+	if( s_epollFd < 0 )
+	{
+		// Created by the first client - several threads may connect at once
+		std::lock_guard<std::mutex> lock(s_epollInitLock);
+		if( s_epollFd < 0 )
+		{
+			int wakeupFd = eventfd(0, EFD_NONBLOCK);
+			int epollFd = epoll_create1(0);
+			epoll_event ev;
+			ev.events = EPOLLIN;
+			ev.data.u64 = 0;
+			if( epollFd >= 0 && wakeupFd >= 0 ) epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeupFd, &ev);
+			s_epollWakeupFd = wakeupFd;
+			s_epollFd = epollFd;
+		}
+	}
+	if( s_epollFd < 0 ) return;
+
+	epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.u64 = 0;
+	ev.data.u32 = pseudoPdcId;
+	epoll_ctl(s_epollFd, EPOLL_CTL_ADD, sockfd, &ev);
+}
+
+void EpollRemoveSocket( int sockfd )
+{
+	if( s_epollFd >= 0 ) epoll_ctl(s_epollFd, EPOLL_CTL_DEL, sockfd, 0);
+}
+#endif
+
 
 STRONGRIDIEEEC37118DLL_API void strongrid_library_init()
 {
-	memset(s_pdcClientMap, 0, sizeof(PdcClient*) ); // set all to 0
+	// Nothing to do - the client table is initialised statically
 }
 
 
+int AddConnectedClient( PdcClient* client, int32_t* pseudoPdcId )
+{
+	// Add to client table - the client is freed if it cannot be added
+	ClientEntry entry;
+	entry.Client = client;
+	entry.FrameCallback = 0;
+	const int32_t newPseudoPdcId = s_clients.Add(entry);
+	if( newPseudoPdcId == 0 )
+	{
+		client->CloseConnection();
+		delete client;
+		return RETERR_UNKNOWN_ERR;
+	}
+	*pseudoPdcId = newPseudoPdcId;
+
+	// Add to socket-listener vector
+	s_socketPollLock.lock();
+	{
+		s_socketPollVector.push_back(std::pair<int,int>(newPseudoPdcId,client->GetSocketDescriptor()));
+
+#ifdef STRONGRID_USE_EPOLL
+		EpollAddSocket(newPseudoPdcId, client->GetSocketDescriptor());
+#endif
+	}
+	s_socketPollLock.unlock();
+
+	return RETERR_OK;
+}
+
 STRONGRIDIEEEC37118DLL_API int connectPdc( char *ipAddress,  int32_t port, int32_t pdcId, int32_t* pseudoPdcId )
 {
 	std::string ipAddr = string(ipAddress);
@@ -79,51 +181,224 @@ STRONGRIDIEEEC37118DLL_API int connectPdc( char *ipAddress,  int32_t port, int32
 		return RETERR_UNKNOWN_ERR;
 	}
 
-	s_clientMapLock.lock();
+	return AddConnectedClient(client, pseudoPdcId);
+}
+
+STRONGRIDIEEEC37118DLL_API int connectPdcTransport( char *ipAddress, int32_t port, int32_t pdcId, int32_t transport, int32_t localUdpPort, int32_t* pseudoPdcId )
+{
+	if( transport < TRANSPORT_TCP || transport > TRANSPORT_UDP_SPONTANEOUS || localUdpPort < 0 || localUdpPort > 65535 ) return RETERR_UNKNOWN_ERR;
+
+	std::string ipAddr = string(ipAddress != 0 ? ipAddress : "");
+	PdcClient* client = new PdcClient(ipAddr, port, pdcId);
+	try {
+		client->SetTransport((TransportMode)transport, localUdpPort);
+		client->Connect();
+	}
+	catch(...)
+	{
+		delete client;
+		return RETERR_UNKNOWN_ERR;
+	}
+
+	return AddConnectedClient(client, pseudoPdcId);
+}
+
+void OnFrameQueued( void* context );
+
+STRONGRIDIEEEC37118DLL_API int connectPdcMulticast( char *groupAddress, int32_t port, char *interfaceAddress, int32_t pdcId, int32_t* pseudoPdcId )
+{
+	if( groupAddress == 0 || port <= 0 || port > 65535 ) return RETERR_UNKNOWN_ERR;
+
+	PdcClient* client = new PdcClient(string(groupAddress), port, pdcId);
+	try {
+		client->SetTransport(TransportMode::UDP_MULTICAST, 0, string(interfaceAddress != 0 ? interfaceAddress : ""));
+		client->Connect();
+	}
+	catch(...)
 	{
-		// Find the first available slot in the map
-		while( true )
+		delete client;
+		return RETERR_UNKNOWN_ERR;
+	}
+
+	int result = AddConnectedClient(client, pseudoPdcId);
+	if( result != RETERR_OK ) return result;
+
+	// No socket of its own to poll - the frames the group receives for it mark the client readable
+	ClientHandleTable::Ref ref = s_clients.Acquire(*pseudoPdcId);
+	if( !ref ) return RETERR_UNKNOWN_ERR;
+	ref->SetFrameQueuedHandler(OnFrameQueued, (void*)(intptr_t)*pseudoPdcId);
+	return RETERR_OK;
+}
+
+STRONGRIDIEEEC37118DLL_API int connectPdcs( pdcConnectRequest* requests, int32_t numRequests, int32_t steps, int32_t timeoutMs, int32_t* outNumConnected )
+{
+	if( numRequests < 0 || (numRequests > 0 && requests == 0) || timeoutMs < 0 ) return RETERR_UNKNOWN_ERR;
+	if( (steps & ~(CONNECT_READ_HEADER | CONNECT_READ_CONFIG | CONNECT_READ_CONFIG_VER3 | CONNECT_START_DATA_STREAM)) != 0 ) return RETERR_UNKNOWN_ERR;
+
+	std::vector<PdcClient*> clients;
+	try {
+		for( int i = 0; i < numRequests; ++i ) {
+			requests[i].pseudoPdcId = 0;
+			requests[i].result = RETERR_UNKNOWN_ERR;
+			clients.push_back(new PdcClient(string(requests[i].ipAddress), requests[i].port, requests[i].pdcId));
+		}
+
+		// Connect and handshake all clients at once, from this thread - no lock is held meanwhile
+		PdcConnector connector(clients, steps);
+		connector.Run(timeoutMs);
+
+		int numConnected = 0;
+		for( int i = 0; i < numRequests; ++i )
 		{
-			s_pdcClientCursor = ++s_pdcClientCursor % MAXIMUM_CONCURRENT_CLIENTS;
-			if( s_pdcClientMap[s_pdcClientCursor] == 0 )
-				break;
+			PdcClient* client = clients[i];
+			clients[i] = 0;
+
+			const PdcConnectResult& result = connector.GetResult(i);
+			if( !result.Success )
+			{
+				requests[i].result = result.TimedOut ? RETERR_NET_TIMEOUT : RETERR_UNKNOWN_ERR;
+				delete client;
+				continue;
+			}
+
+			requests[i].result = AddConnectedClient(client, &requests[i].pseudoPdcId);
+			if( requests[i].result == RETERR_OK ) ++numConnected;
 		}
 
-		// Add to client map table
-		s_pdcClientMap[s_pdcClientCursor] = client;
-		*pseudoPdcId = s_pdcClientCursor;
+		if( outNumConnected != 0 ) *outNumConnected = numConnected;
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		for( std::vector<PdcClient*>::iterator iter = clients.begin(); iter != clients.end(); ++iter ) delete *iter;
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+void UpdatePendingFrames( const ClientHandleTable::Ref& client, int32_t pseudoPdcId )
+{
+	// Track whether a read left complete frames behind in the client receive buffer. Checked under the lock:
+	// a frame queued by the receiver thread after the check is then added back by OnFrameQueued.
+	std::lock_guard<std::mutex> lock(s_pendingFrameLock);
+	bool pending = client->HasBufferedFrame();
+	std::vector<int>::iterator iter = std::find(s_pendingFrameClients.begin(), s_pendingFrameClients.end(), pseudoPdcId);
+	if( pending && iter == s_pendingFrameClients.end() ) s_pendingFrameClients.push_back(pseudoPdcId);
+	else if( !pending && iter != s_pendingFrameClients.end() ) s_pendingFrameClients.erase(iter);
+}
 
-		// Add to socket-listener vector
-		s_socketPollVector.push_back(std::pair<int,int>(s_pdcClientCursor,client->GetSocketDescriptor()));
+void OnFrameQueued( void* context )
+{
+	// Receiver thread: mark the client readable and wake pollPdcWithDataWaiting
+	int pseudoPdcId = (int)(intptr_t)context;
+	bool added = false;
+	{
+		std::lock_guard<std::mutex> lock(s_pendingFrameLock);
+		if( std::find(s_pendingFrameClients.begin(), s_pendingFrameClients.end(), pseudoPdcId) == s_pendingFrameClients.end() )
+		{
+			s_pendingFrameClients.push_back(pseudoPdcId);
+			added = true;
+		}
 	}
-	s_clientMapLock.unlock();
 
-	return RETERR_OK;
+#ifdef STRONGRID_USE_EPOLL
+	uint64_t one = 1;
+	if( added && s_epollWakeupFd >= 0 ) (void)!write(s_epollWakeupFd, &one, sizeof(one));
+#endif
+}
+
+void ClearPendingFrames( int32_t pseudoPdcId )
+{
+	std::lock_guard<std::mutex> lock(s_pendingFrameLock);
+	std::vector<int>::iterator iter = std::find(s_pendingFrameClients.begin(), s_pendingFrameClients.end(), pseudoPdcId);
+	if( iter != s_pendingFrameClients.end() ) s_pendingFrameClients.erase(iter);
+}
+
+void RefreshPollSocket( const ClientHandleTable::Ref& client, int32_t pseudoPdcId )
+{
+	// A reconnect replaced the socket of the client - the old one left the epoll set when it was closed
+	std::lock_guard<std::mutex> lock(s_socketPollLock);
+	for( std::vector<std::pair<int,int>>::iterator iter = s_socketPollVector.begin(); iter != s_socketPollVector.end(); ++iter )
+		if( iter->first == pseudoPdcId ) iter->second = client->GetSocketDescriptor();
+
+#ifdef STRONGRID_USE_EPOLL
+	if( client->GetSocketDescriptor() > 0 ) EpollAddSocket(pseudoPdcId, client->GetSocketDescriptor());
+#endif
+}
+
+void SwitchPollSocket( const ClientHandleTable::Ref& client, int32_t pseudoPdcId, int previousSockfd )
+{
+	// TCP commands with UDP data: responses and dataframes are read from different sockets, both stay open
+	if( client->GetTransport() != TransportMode::TCP_COMMAND_UDP_DATA || client->GetSocketDescriptor() == previousSockfd ) return;
+
+#ifdef STRONGRID_USE_EPOLL
+	s_socketPollLock.lock();
+	EpollRemoveSocket(previousSockfd);
+	s_socketPollLock.unlock();
+#endif
+	RefreshPollSocket(client, pseudoPdcId);
+}
+
+void StopReceiverUnlocked( ClientHandleTable::Ref& client )
+{
+	// The call lock is released while waiting, so that a frame callback calling the API for its own pseudoPdcId can
+	// return. The receiver counts as running until it is stopped, so no other call starts or stops it meanwhile.
+	if( !client->BeginStopReceiver() ) return;
+	client.Unlock();
+	try {
+		client->WaitReceiverStopped();
+	}
+	catch( ... ) {
+		client.Lock();
+		throw;
+	}
+	client.Lock();
+	client->EndStopReceiver();
 }
 
-bool PseudoPdcIdIsValidClient( int32_t pseudoPdcId )
+void ShutdownClient( int32_t pseudoPdcId, const ClientEntry& entry )
 {
-	return !(pseudoPdcId > MAXIMUM_CONCURRENT_CLIENTS || pseudoPdcId <= 0 || s_pdcClientMap[pseudoPdcId] == 0);
+	// A running receiver may replace the socket while reconnecting
+	entry.Client->StopReceiver();
+
+	// Drop from 'socket listener' vector
+	s_socketPollLock.lock();
+	{
+		std::vector<std::pair<int,int>>::iterator iterErase;
+		for( iterErase = s_socketPollVector.begin(); iterErase != s_socketPollVector.end(); ++iterErase )
+			if( iterErase->first == pseudoPdcId ) break;
+		if( iterErase != s_socketPollVector.end() ) s_socketPollVector.erase(iterErase);
+
+#ifdef STRONGRID_USE_EPOLL
+		EpollRemoveSocket(entry.Client->GetSocketDescriptor());
+#endif
+	}
+	s_socketPollLock.unlock();
+
+	ClearPendingFrames(pseudoPdcId);
+	delete entry.FrameCallback;
+
+	// Disconnect and free
+	try {
+		entry.Client->CloseConnection();
+	}
+	catch( ... )
+	{
+		delete entry.Client;
+		throw;
+	}
+	delete entry.Client;
 }
 
 STRONGRIDIEEEC37118DLL_API int disconnectPdc(int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	if( pseudoPdcId == s_callbackPseudoPdcId ) return RETERR_UNKNOWN_ERR; // from its own frame callback
+
+	// Invalidates the pseudoPdcId - waits for calls on it in other threads to return
+	ClientEntry entry;
+	if( !s_clients.Remove(pseudoPdcId, &entry) ) return RETERR_UNKNOWN_ERR;
+
 	try {
-		s_clientMapLock.lock();
-		{
-			// Drop from 'socket listener' vector
-			std::vector<std::pair<int,int>>::iterator iterErase;
-			for( iterErase = s_socketPollVector.begin(); iterErase != s_socketPollVector.end(); ++iterErase )
-				if( iterErase->first == pseudoPdcId ) break;
-			s_socketPollVector.erase(iterErase);
-
-			// Disconnect and drop from table
-			s_pdcClientMap[pseudoPdcId]->CloseConnection();
-			delete s_pdcClientMap[pseudoPdcId];
-			s_pdcClientMap[pseudoPdcId] = 0;
-		}
-		s_clientMapLock.unlock();
+		ShutdownClient(pseudoPdcId, entry);
 		return RETERR_OK;
 	}
 	catch( SocketTimeout )
@@ -138,14 +413,19 @@ STRONGRIDIEEEC37118DLL_API int disconnectPdc(int32_t pseudoPdcId)
 
 STRONGRIDIEEEC37118DLL_API int readHeaderData( int32_t timeout, int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
+	int sockfd = client->GetSocketDescriptor();
 	try {
-		s_pdcClientMap[pseudoPdcId]->ReadHeaderMessage(timeout);
+		client->ReadHeaderMessage(timeout);
+		SwitchPollSocket(client, pseudoPdcId, sockfd);
+		UpdatePendingFrames(client, pseudoPdcId);
 		return RETERR_OK;
 	}
 	catch( SocketTimeout )
 	{
+		SwitchPollSocket(client, pseudoPdcId, sockfd);
 		return RETERR_NET_TIMEOUT;
 	}
 	catch( ... )
@@ -156,14 +436,19 @@ STRONGRIDIEEEC37118DLL_API int readHeaderData( int32_t timeout, int32_t pseudoPd
 
 STRONGRIDIEEEC37118DLL_API int readConfiguration(  int32_t timeout, int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
+	int sockfd = client->GetSocketDescriptor();
 	try {
-		s_pdcClientMap[pseudoPdcId]->ReadConfiguration(timeout);
+		client->ReadConfiguration(timeout);
+		SwitchPollSocket(client, pseudoPdcId, sockfd);
+		UpdatePendingFrames(client, pseudoPdcId);
 		return RETERR_OK;
 	}
 	catch( SocketTimeout )
 	{
+		SwitchPollSocket(client, pseudoPdcId, sockfd);
 		return RETERR_NET_TIMEOUT;
 	}
 	catch( ... )
@@ -174,14 +459,19 @@ STRONGRIDIEEEC37118DLL_API int readConfiguration(  int32_t timeout, int32_t pseu
 
 STRONGRIDIEEEC37118DLL_API int readConfiguration_Ver3(  int32_t timeout, int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
+	int sockfd = client->GetSocketDescriptor();
 	try {
-		s_pdcClientMap[pseudoPdcId]->ReadConfigurationVer3(timeout);
+		client->ReadConfigurationVer3(timeout);
+		SwitchPollSocket(client, pseudoPdcId, sockfd);
+		UpdatePendingFrames(client, pseudoPdcId);
 		return RETERR_OK;
 	}
 	catch( SocketTimeout )
 	{
+		SwitchPollSocket(client, pseudoPdcId, sockfd);
 		return RETERR_NET_TIMEOUT;
 	}
 	catch( ... )
@@ -192,10 +482,13 @@ STRONGRIDIEEEC37118DLL_API int readConfiguration_Ver3(  int32_t timeout, int32_t
 
 STRONGRIDIEEEC37118DLL_API int startDataStream( int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
+	int sockfd = client->GetSocketDescriptor();
 	try {
-		s_pdcClientMap[pseudoPdcId]->StartDataStream();
+		client->StartDataStream();
+		SwitchPollSocket(client, pseudoPdcId, sockfd);
 		return RETERR_OK;
 	}
 	catch( ... )
@@ -206,10 +499,11 @@ STRONGRIDIEEEC37118DLL_API int startDataStream( int32_t pseudoPdcId)
 
 STRONGRIDIEEEC37118DLL_API int stopDataStream(int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		s_pdcClientMap[pseudoPdcId]->StopDataStream();
+		client->StopDataStream();
 		return RETERR_OK;
 	}
 	catch( ... )
@@ -220,14 +514,30 @@ STRONGRIDIEEEC37118DLL_API int stopDataStream(int32_t pseudoPdcId)
 
 STRONGRIDIEEEC37118DLL_API int readNextFrame(int32_t timeOut, int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
+	uint32_t numReconnects = client->GetReconnectCount();
+	int sockfd = client->GetSocketDescriptor();
 	try {
-		s_pdcClientMap[pseudoPdcId]->ReadDataFrame(timeOut);
+		client->ReadDataFrame(timeOut);
+		if( client->GetReconnectCount() != numReconnects && !client->IsReceiverRunning() ) RefreshPollSocket(client, pseudoPdcId);
+		SwitchPollSocket(client, pseudoPdcId, sockfd);
+		UpdatePendingFrames(client, pseudoPdcId);
 		return RETERR_OK;
 	}
+	catch( ProjectionCleared )
+	{
+		// The frame has been read in full, as are the following ones
+		if( client->GetReconnectCount() != numReconnects ) RefreshPollSocket(client, pseudoPdcId);
+		SwitchPollSocket(client, pseudoPdcId, sockfd);
+		UpdatePendingFrames(client, pseudoPdcId);
+		return RETERR_PROJECTION_CLEARED;
+	}
 	catch( SocketTimeout )
 	{
+		if( client->GetReconnectCount() != numReconnects && !client->IsReceiverRunning() ) RefreshPollSocket(client, pseudoPdcId);
+		SwitchPollSocket(client, pseudoPdcId, sockfd);
 		return RETERR_NET_TIMEOUT;
 	}
 	catch( ... )
@@ -238,14 +548,32 @@ STRONGRIDIEEEC37118DLL_API int readNextFrame(int32_t timeOut, int32_t pseudoPdcI
 
 STRONGRIDIEEEC37118DLL_API int strongrid_library_cleanup()
 {
+	if( s_callbackPseudoPdcId != 0 ) return RETERR_UNKNOWN_ERR; // from a frame callback
+
 	try {
-		// Traverse the entire clientmap and shutdown/delete every non-null entry
-		for( int i = 0; i < MAXIMUM_CONCURRENT_CLIENTS; ++i )
+		// Remove every client from the table and shutdown/delete it
+		std::vector<ClientEntry> entries = s_clients.RemoveAll();
+		for( std::vector<ClientEntry>::iterator iter = entries.begin(); iter != entries.end(); ++iter )
 		{
-			PdcClient* client = s_pdcClientMap[i];
-			client->CloseConnection();
-			delete client;
+			iter->Client->StopReceiver();
+			iter->Client->CloseConnection();
+			delete iter->Client;
+			delete iter->FrameCallback;
 		}
+		s_socketPollLock.lock();
+		s_socketPollVector.clear();
+		s_socketPollLock.unlock();
+		s_pendingFrameClients.clear();
+
+		std::lock_guard<std::mutex> lock(s_ioEngineLock);
+		delete s_ioEngine;
+		s_ioEngine = 0;
+
+#ifdef STRONGRID_USE_EPOLL
+		if( s_epollFd >= 0 ) close(s_epollFd);
+		if( s_epollWakeupFd >= 0 ) close(s_epollWakeupFd);
+		s_epollFd = s_epollWakeupFd = -1;
+#endif
 	}
 	catch( ... )
 	{
@@ -255,49 +583,99 @@ STRONGRIDIEEEC37118DLL_API int strongrid_library_cleanup()
 	return RETERR_OK;
 }
 
-std::vector<int> CheckPortsForDataToRead(int  timeoutMs)
+int CollectPendingFrames( int32_t* outPseudoPdcIdArr, int arrayLength )
+{
+	std::lock_guard<std::mutex> lock(s_pendingFrameLock);
+	int numOutput = std::min(int(s_pendingFrameClients.size()), arrayLength);
+	std::copy(s_pendingFrameClients.begin(), s_pendingFrameClients.begin() + numOutput, outPseudoPdcIdArr);
+	return numOutput;
+}
+
+void AppendReadyClient( int pseudoPdcId, int32_t* outPseudoPdcIdArr, int numPending, int* numOutput )
 {
+	// Clients with pending frames are already in the output
+	if( std::find(outPseudoPdcIdArr, outPseudoPdcIdArr + numPending, pseudoPdcId) == outPseudoPdcIdArr + numPending )
+		outPseudoPdcIdArr[(*numOutput)++] = pseudoPdcId;
+}
+
+#ifdef STRONGRID_USE_EPOLL
+int CheckPortsForDataToRead_Epoll( int timeoutMs, int32_t* outPseudoPdcIdArr, int arrayLength )
+{
+	int numPending = CollectPendingFrames(outPseudoPdcIdArr, arrayLength);
+	int numOutput = numPending;
+
+	// Wait only if nothing is pending - returns the ready sockets only, no copy of the client list
+	epoll_event events[EPOLL_MAX_EVENTS];
+	bool wokenUp = false;
+	int ret = epoll_wait(s_epollFd, events, std::min(arrayLength - numOutput + 1, EPOLL_MAX_EVENTS), numPending > 0 ? 0 : timeoutMs);
+	for( int i = 0; i < ret; ++i )
+	{
+		if( events[i].data.u32 == 0 ) wokenUp = true;
+		else if( numOutput < arrayLength ) AppendReadyClient(events[i].data.u32, outPseudoPdcIdArr, numPending, &numOutput);
+	}
+
+	// Frames queued by receiver threads while waiting
+	if( wokenUp )
+	{
+		uint64_t count;
+		(void)!read(s_epollWakeupFd, &count, sizeof(count));
+
+		std::lock_guard<std::mutex> lock(s_pendingFrameLock);
+		for( std::vector<int>::iterator iter = s_pendingFrameClients.begin(); iter != s_pendingFrameClients.end() && numOutput < arrayLength; ++iter )
+			if( std::find(outPseudoPdcIdArr, outPseudoPdcIdArr + numOutput, *iter) == outPseudoPdcIdArr + numOutput )
+				outPseudoPdcIdArr[numOutput++] = *iter;
+	}
+
+	return numOutput;
+}
+#endif
+
+int CheckPortsForDataToRead( int timeoutMs, int32_t* outPseudoPdcIdArr, int arrayLength )
+{
+	if( arrayLength <= 0 ) return 0;
+
+#ifdef STRONGRID_USE_EPOLL
+	if( s_epollFd >= 0 ) return CheckPortsForDataToRead_Epoll(timeoutMs, outPseudoPdcIdArr, arrayLength);
+#endif
+
 	// Copy the data into a temporary array to avoid blocking too long
-	s_clientMapLock.lock();
-	const int arrayLength = s_socketPollVector.size();
-	WSAPOLLFD* socketListenArray = new WSAPOLLFD[arrayLength];
-	int* pseudoPdcIdArr = new int[arrayLength];
+	s_socketPollLock.lock();
+	const int numSockets = s_socketPollVector.size();
+	WSAPOLLFD* socketListenArray = new WSAPOLLFD[numSockets];
+	int* pseudoPdcIdArr = new int[numSockets];
 
-	for( int i = 0; i < arrayLength; ++i ) {
+	for( int i = 0; i < numSockets; ++i ) {
 		socketListenArray[i].fd = s_socketPollVector[i].second;
 		socketListenArray[i].events = POLLIN;
 		pseudoPdcIdArr[i] = s_socketPollVector[i].first;
 	}
-	s_clientMapLock.unlock();
+	s_socketPollLock.unlock();
 
-	// Poll for data
-	int ret = WSAPoll(socketListenArray, arrayLength, timeoutMs);
+	// Poll for data - don't wait if buffered frames are pending
+	int numPending = CollectPendingFrames(outPseudoPdcIdArr, arrayLength);
+	int numOutput = numPending;
+	int ret = WSAPoll(socketListenArray, numSockets, numPending > 0 ? 0 : timeoutMs);
 
-	std::vector<int> output;
 	if( ret > 0 )
 	{
-		for( int i = 0; i < arrayLength; ++i )
+		for( int i = 0; i < numSockets && numOutput < arrayLength; ++i )
 		{
-			if( socketListenArray[i].revents & (POLLRDNORM | POLLERR | POLLHUP)  ) output.push_back(pseudoPdcIdArr[i]);
+			if( socketListenArray[i].revents & (POLLRDNORM | POLLERR | POLLHUP)  )
+				AppendReadyClient(pseudoPdcIdArr[i], outPseudoPdcIdArr, numPending, &numOutput);
 		}
 	}
 
 	delete [] socketListenArray;
 	delete [] pseudoPdcIdArr;
 
-	return output;
+	return numOutput;
 }
 
 STRONGRIDIEEEC37118DLL_API int pollPdcWithDataWaiting( int pseudoPdcIdArrayLength, int32_t* outPseudoPdcIdArr, int32_t* outNumPdcWithData, int pollTimeoutMs )
 {
 	try {
-		// Get a list of all sockets available for reading
-		std::vector<int> readsockVec = CheckPortsForDataToRead(pollTimeoutMs);
-
-		// Copy data from result to output arrray
-		for( int i = 0; i < readsockVec.size() && i < pseudoPdcIdArrayLength; ++i )
-			outPseudoPdcIdArr[i] = readsockVec[i];
-		*outNumPdcWithData = std::min(int(readsockVec.size()),pseudoPdcIdArrayLength);
+		// Write the clients available for reading directly to the output array
+		*outNumPdcWithData = CheckPortsForDataToRead(pollTimeoutMs, outPseudoPdcIdArr, pseudoPdcIdArrayLength);
 		return RETERR_OK;
 	}
 	catch( Exception e )
@@ -335,12 +713,26 @@ TimeStatus GetClockStatus(const C37118FracSec& frac)
 	return sts;
 }
 
+void FillPmuStatus(const C37118PmuDataFrameStat& stat, PmuStatus* rdsts)
+{
+	rdsts->dataErrorCode = stat.getDataError();
+	rdsts->pmuSyncFlag = stat.getPmuSyncFlag();
+	rdsts->pmuDataSortingFlag = stat.getDataSortingFlag();
+	rdsts->pmuTriggerFlag = stat.getPmuTriggerFlag();
+	rdsts->configChangeFlag = stat.getConfigChangeFlag();
+	rdsts->dataModifiedFlag = stat.getDataModifiedFlag();
+	rdsts->timeQualityCode = stat.getTimeQualityCode();
+	rdsts->unlockTimeCode = stat.getUnlockTimeCode();
+	rdsts->triggerReasonCode = stat.getTriggerReasonCode();
+}
+
 STRONGRIDIEEEC37118DLL_API int getPdcConfig(pdcConfiguration* outCfg, int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return 1;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcConfiguration& pdcCfg = s_pdcClientMap[pseudoPdcId]->GetPdcConfiguration();
+		const C37118PdcConfiguration& pdcCfg = client->GetPdcConfiguration();
 
 		outCfg->TimeQuality = GetClockStatus(pdcCfg.HeaderCommon.FracSec);
 		outCfg->Timestamp = GetParsedTimestamp(pdcCfg.HeaderCommon.SOC, pdcCfg.HeaderCommon.FracSec.FractionOfSecond,
@@ -358,10 +750,11 @@ STRONGRIDIEEEC37118DLL_API int getPdcConfig(pdcConfiguration* outCfg, int32_t ps
 
 STRONGRIDIEEEC37118DLL_API int getPdcConfig_Ver3(pdcConfiguration* outCfg, int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcConfiguration_Ver3& pdcCfg = s_pdcClientMap[pseudoPdcId]->GetPdcConfigurationVer3();
+		const C37118PdcConfiguration_Ver3& pdcCfg = client->GetPdcConfigurationVer3();
 
 		outCfg->TimeQuality = GetClockStatus(pdcCfg.HeaderCommon.FracSec);
 		outCfg->Timestamp = GetParsedTimestamp(pdcCfg.HeaderCommon.SOC, pdcCfg.HeaderCommon.FracSec.FractionOfSecond,
@@ -379,10 +772,11 @@ STRONGRIDIEEEC37118DLL_API int getPdcConfig_Ver3(pdcConfiguration* outCfg, int32
 
 STRONGRIDIEEEC37118DLL_API int getPmuConfiguration(pmuConfig* pmuconf, int32_t pseudoPdcId, int32_t pmuIndex)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcConfiguration& pdcCfg = s_pdcClientMap[pseudoPdcId]->GetPdcConfiguration();
+		const C37118PdcConfiguration& pdcCfg = client->GetPdcConfiguration();
 		const C37118PmuConfiguration& pmuCfg = pdcCfg.PMUs[pmuIndex];
 
 		pmuconf->pmuid = pmuCfg.IdCode;
@@ -403,10 +797,11 @@ STRONGRIDIEEEC37118DLL_API int getPmuConfiguration(pmuConfig* pmuconf, int32_t p
 
 STRONGRIDIEEEC37118DLL_API int getPmuConfiguration_Ver3(pmuConfig_Ver3* pmuconf, int32_t pseudoPdcId, int32_t pmuIndex)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcConfiguration_Ver3& pdcCfg = s_pdcClientMap[pseudoPdcId]->GetPdcConfigurationVer3();
+		const C37118PdcConfiguration_Ver3& pdcCfg = client->GetPdcConfigurationVer3();
 		const C37118PmuConfiguration_Ver3& pmuCfg = pdcCfg.PMUs[pmuIndex];
 
 		pmuconf->pmuid = pmuCfg.IdCode;
@@ -438,17 +833,18 @@ STRONGRIDIEEEC37118DLL_API int getPmuConfiguration_Ver3(pmuConfig_Ver3* pmuconf,
 
 STRONGRIDIEEEC37118DLL_API int getPhasorConfig( phasorConfig* phasorCfg, int32_t pseudoPdcId, int32_t pmuIndex, int32_t phasorIndex)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcConfiguration& pdcCfg = s_pdcClientMap[pseudoPdcId]->GetPdcConfiguration();
+		const C37118PdcConfiguration& pdcCfg = client->GetPdcConfiguration();
 		const C37118PmuConfiguration& pmuCfg = pdcCfg.PMUs[pmuIndex];
 		const C37118PhasorUnit& phUnit = pmuCfg.PhasorUnit[phasorIndex];
 
 		memset( phasorCfg->name, 0, 256 );
 		strncpy(phasorCfg->name, pmuCfg.phasorChnNames[phasorIndex].c_str(), std::min(pmuCfg.phasorChnNames[phasorIndex].length(), MAX_NAME_LEN) );
 		phasorCfg->type = phUnit.Type;
-		phasorCfg->format = 0;
+		phasorCfg->format = (client->GetKeepPolarPhasors() && pmuCfg.DataFormat.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle) ? 1 : 0;
 		phasorCfg->dataIsScaled = pmuCfg.DataFormat.Bit1_0xPhasorsIsInt_1xPhasorFloat == 1; // if "float" => data is scaled
 		phasorCfg->scalar = phUnit.PhasorScalar;
 
@@ -462,17 +858,18 @@ STRONGRIDIEEEC37118DLL_API int getPhasorConfig( phasorConfig* phasorCfg, int32_t
 
 STRONGRIDIEEEC37118DLL_API int getPhasorConfig_Ver3( phasorConfig_Ver3* phasorCfg, int32_t pseudoPdcId, int32_t pmuIndex, int32_t phasorIndex)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcConfiguration_Ver3& pdcCfg = s_pdcClientMap[pseudoPdcId]->GetPdcConfigurationVer3();
+		const C37118PdcConfiguration_Ver3& pdcCfg = client->GetPdcConfigurationVer3();
 		const C37118PmuConfiguration_Ver3& pmuCfg = pdcCfg.PMUs[pmuIndex];
 		const C37118PhasorScale_Ver3& phUnit = pmuCfg.PhasorScales[phasorIndex];
 
 		memset( phasorCfg->name, 0, 256 );
 		strncpy(phasorCfg->name, pmuCfg.phasorChnNames[phasorIndex].c_str(), std::min(pmuCfg.phasorChnNames[phasorIndex].length(), MAX_NAME_LEN) );
 		phasorCfg->type = phUnit.VoltOrCurrent;
-		phasorCfg->format = 0;
+		phasorCfg->format = (client->GetKeepPolarPhasors() && pmuCfg.DataFormat.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle) ? 1 : 0;
 		phasorCfg->dataIsScaled = pmuCfg.DataFormat.Bit1_0xPhasorsIsInt_1xPhasorFloat == 1; // if "float" => data is scaled
 		phasorCfg->scaling_magnitude = phUnit.ScaleFactorOne_Y;
 		phasorCfg->scaling_angleOffset = phUnit.ScaleFactorTwo_Angle;
@@ -487,10 +884,11 @@ STRONGRIDIEEEC37118DLL_API int getPhasorConfig_Ver3( phasorConfig_Ver3* phasorCf
 
 STRONGRIDIEEEC37118DLL_API int getAnalogConfig( analogConfig *analogCfg, int32_t pseudoPdcId, int32_t pmuIndex, int32_t analogIndex)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcConfiguration& pdcCfg = s_pdcClientMap[pseudoPdcId]->GetPdcConfiguration();
+		const C37118PdcConfiguration& pdcCfg = client->GetPdcConfiguration();
 		const C37118PmuConfiguration& pmuCfg = pdcCfg.PMUs[pmuIndex];
 		const C37118AnalogUnit& angUnit = pmuCfg.AnalogUnit[analogIndex];
 
@@ -510,10 +908,11 @@ STRONGRIDIEEEC37118DLL_API int getAnalogConfig( analogConfig *analogCfg, int32_t
 
 STRONGRIDIEEEC37118DLL_API int getAnalogConfig_Ver3( analogConfig_Ver3 *analogCfg, int32_t pseudoPdcId, int32_t pmuIndex, int32_t analogIndex)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcConfiguration_Ver3& pdcCfg = s_pdcClientMap[pseudoPdcId]->GetPdcConfigurationVer3();
+		const C37118PdcConfiguration_Ver3& pdcCfg = client->GetPdcConfigurationVer3();
 		const C37118PmuConfiguration_Ver3& pmuCfg = pdcCfg.PMUs[pmuIndex];
 		const C37118AnalogScale_Ver3& angScale = pmuCfg.AnalogScales[analogIndex];
 
@@ -533,12 +932,13 @@ STRONGRIDIEEEC37118DLL_API int getAnalogConfig_Ver3( analogConfig_Ver3 *analogCf
 
 STRONGRIDIEEEC37118DLL_API int getDigitalConfig(  digitalConfig* digitalCfg, int32_t pseudoPdcId, int32_t pmuIndex, int32_t digitalIndex )
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
 		const int unitWordIdx = digitalIndex / 16;
 
-		const C37118PdcConfiguration& pdcCfg = s_pdcClientMap[pseudoPdcId]->GetPdcConfiguration();
+		const C37118PdcConfiguration& pdcCfg = client->GetPdcConfiguration();
 		const C37118PmuConfiguration& pmuCfg = pdcCfg.PMUs[pmuIndex];
 		const C37118DigitalUnit& digUnit = pmuCfg.DigitalUnit[unitWordIdx];
 
@@ -559,12 +959,13 @@ STRONGRIDIEEEC37118DLL_API int getDigitalConfig(  digitalConfig* digitalCfg, int
 
 STRONGRIDIEEEC37118DLL_API int getDigitalConfig_Ver3(  digitalConfig* digitalCfg, int32_t pseudoPdcId, int32_t pmuIndex, int32_t digitalIndex )
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
 		const int unitWordIdx = digitalIndex / 16;
 
-		const C37118PdcConfiguration_Ver3& pdcCfg = s_pdcClientMap[pseudoPdcId]->GetPdcConfigurationVer3();
+		const C37118PdcConfiguration_Ver3& pdcCfg = client->GetPdcConfigurationVer3();
 		const C37118PmuConfiguration_Ver3& pmuCfg = pdcCfg.PMUs[pmuIndex];
 		const C37118DigitalUnit& digUnit = pmuCfg.DigitalUnits[unitWordIdx];
 
@@ -586,16 +987,17 @@ STRONGRIDIEEEC37118DLL_API int getDigitalConfig_Ver3(  digitalConfig* digitalCfg
 
 STRONGRIDIEEEC37118DLL_API int getPdcRealData(pdcDataFrame* rd, int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcDataDecodeInfo& decodeInfo = s_pdcClientMap[pseudoPdcId]->GetDecodeInfo();
-		const C37118PdcDataFrame& dataframe = s_pdcClientMap[pseudoPdcId]->GetPdcDataFrame();
+		const C37118PdcDataDecodeInfo& decodeInfo = client->GetDecodeInfo();
+		const C37118PdcFlatDataFrame& dataframe = client->GetPdcFlatDataFrame();
 
 		// PDC portion of realdata
 		rd->TimeQuality = GetClockStatus(dataframe.HeaderCommon.FracSec);
 		rd->Timestamp = GetParsedTimestamp(dataframe.HeaderCommon.SOC, dataframe.HeaderCommon.FracSec.FractionOfSecond, decodeInfo.timebase.TimeBase, &rd->SecondOfCentury);
-		rd->NumPmuInDataFrame = dataframe.pmuDataFrame.size();
+		rd->NumPmuInDataFrame = dataframe.NumPmus();
 
 		return RETERR_OK;
 	}
@@ -607,45 +1009,168 @@ STRONGRIDIEEEC37118DLL_API int getPdcRealData(pdcDataFrame* rd, int32_t pseudoPd
 
 STRONGRIDIEEEC37118DLL_API int getPmuRealData(pmuDataFrame* rd, PmuStatus* rdsts, int32_t pseudoPdcId, int32_t pmuIndex)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcDataDecodeInfo& pdcDecodeInfo = s_pdcClientMap[pseudoPdcId]->GetDecodeInfo();
-		const C37118PmuDataDecodeInfo& pmuDecodeInfo = pdcDecodeInfo.PMUs[pmuIndex];
-		const C37118PdcDataFrame& dataframe = s_pdcClientMap[pseudoPdcId]->GetPdcDataFrame();
-		const C37118PmuDataFrame& pmuDataFrame = dataframe.pmuDataFrame[pmuIndex];
+		const C37118PdcFlatDataFrame& dataframe = client->GetPdcFlatDataFrame();
+		if( pmuIndex < 0 || pmuIndex >= dataframe.NumPmus() ) return RETERR_UNKNOWN_ERR;
 
 		// frequency / delta-frequency
-		rd->frequency = dataframe.pmuDataFrame[pmuIndex].Frequency;
-		rd->deltaFrequency = dataframe.pmuDataFrame[pmuIndex].DeltaFrequency;
+		rd->frequency = dataframe.Frequency[pmuIndex];
+		rd->deltaFrequency = dataframe.DeltaFrequency[pmuIndex];
 
 		// Stat - field
-		rdsts->dataErrorCode = pmuDataFrame.Stat.getDataError();
-		rdsts->pmuSyncFlag = pmuDataFrame.Stat.getPmuSyncFlag();
-		rdsts->pmuDataSortingFlag = pmuDataFrame.Stat.getDataSortingFlag();
-		rdsts->pmuTriggerFlag = pmuDataFrame.Stat.getPmuTriggerFlag();
-		rdsts->configChangeFlag = pmuDataFrame.Stat.getConfigChangeFlag();
-		rdsts->dataModifiedFlag = pmuDataFrame.Stat.getDataModifiedFlag();
-		rdsts->timeQualityCode = pmuDataFrame.Stat.getTimeQualityCode();
-		rdsts->unlockTimeCode = pmuDataFrame.Stat.getUnlockTimeCode();
-		rdsts->triggerReasonCode = pmuDataFrame.Stat.getTriggerReasonCode();
+		FillPmuStatus(dataframe.Stat[pmuIndex], rdsts);
 
 		// Phasors
-		rd->PhasorArrayLength = pmuDecodeInfo.numPhasors;
-		for( int i = 0; i < dataframe.pmuDataFrame[pmuIndex].PhasorValues.size(); ++i ) {
-			rd->phasorValueReal[i] = dataframe.pmuDataFrame[pmuIndex].PhasorValues[i].Real;
-			rd->phasorValueImaginary[i] = dataframe.pmuDataFrame[pmuIndex].PhasorValues[i].Imag;
+		const int phasorOffset = dataframe.PhasorOffset[pmuIndex];
+		rd->PhasorArrayLength = dataframe.NumPhasors(pmuIndex);
+		for( int i = 0; i < rd->PhasorArrayLength; ++i ) {
+			rd->phasorValueReal[i] = dataframe.PhasorReal[phasorOffset + i];
+			rd->phasorValueImaginary[i] = dataframe.PhasorImag[phasorOffset + i];
 		}
 
 		// Analog
-		rd->AnalogArrayLength = pmuDecodeInfo.numAnalogs;
-		for( int i = 0; i < dataframe.pmuDataFrame[pmuIndex].AnalogValues.size(); ++i )
-			rd->analogValueArr[i] = dataframe.pmuDataFrame[pmuIndex].AnalogValues[i].getValueAsFloat();
+		const int analogOffset = dataframe.AnalogOffset[pmuIndex];
+		rd->AnalogArrayLength = dataframe.NumAnalogs(pmuIndex);
+		for( int i = 0; i < rd->AnalogArrayLength; ++i )
+			rd->analogValueArr[i] = dataframe.AnalogValues[analogOffset + i];
 
 		// Digital
-		rd->DigitalArrayLength = pmuDecodeInfo.numDigitals;
-		for( int i = 0; i < dataframe.pmuDataFrame[pmuIndex].DigitalValues.size(); ++i )
-			rd->digitalValueArr[i] = dataframe.pmuDataFrame[pmuIndex].DigitalValues[i] ? 1 : 0;
+		rd->DigitalArrayLength = dataframe.NumDigitals(pmuIndex);
+		ExpandDigitalBits(dataframe.DigitalWords.data() + dataframe.DigitalWordOffset[pmuIndex], rd->DigitalArrayLength, rd->digitalValueArr);
+
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int getPmuDigitalWords( uint16_t* digitalWords, int32_t arrayLength, int32_t* outNumWords, int32_t pseudoPdcId, int32_t pmuIndex )
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		const C37118PdcFlatDataFrame& dataframe = client->GetPdcFlatDataFrame();
+		if( pmuIndex < 0 || pmuIndex >= dataframe.NumPmus() ) return RETERR_UNKNOWN_ERR;
+
+		// The status words as received - no per channel expansion
+		const int numWords = dataframe.DigitalWordOffset[pmuIndex+1] - dataframe.DigitalWordOffset[pmuIndex];
+		if( outNumWords != 0 ) *outNumWords = numWords;
+		if( digitalWords == 0 || arrayLength < numWords ) return RETERR_INVALID_INPUT_DIGITAL_ARR;
+		memcpy(digitalWords, dataframe.DigitalWords.data() + dataframe.DigitalWordOffset[pmuIndex], numWords * sizeof(uint16_t));
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+static uint32_t AlignTo8( uint32_t offset )
+{
+	return (offset + 7) & ~7u;
+}
+
+allPmuDataLayout GetAllPmuDataLayout( const C37118PdcDataDecodeInfo& decodeInfo )
+{
+	allPmuDataLayout layout;
+	layout.numPmus = decodeInfo.PMUs.size();
+	layout.numPhasors = layout.numAnalogs = layout.numDigitals = 0;
+	for( std::vector<C37118PmuDataDecodeInfo>::const_iterator iter = decodeInfo.PMUs.begin(); iter != decodeInfo.PMUs.end(); ++iter )
+	{
+		layout.numPhasors += iter->numPhasors;
+		layout.numAnalogs += iter->numAnalogs;
+		layout.numDigitals += iter->numDigitals;
+	}
+
+	// Every block starts 8-byte aligned
+	uint32_t offset = 0;
+	layout.pdcDataOffset = offset;			offset = AlignTo8(offset + sizeof(pdcDataFrame));
+	layout.statusOffset = offset;			offset = AlignTo8(offset + layout.numPmus * sizeof(PmuStatus));
+	layout.frequencyOffset = offset;		offset = AlignTo8(offset + layout.numPmus * sizeof(float));
+	layout.deltaFrequencyOffset = offset;	offset = AlignTo8(offset + layout.numPmus * sizeof(float));
+	layout.phasorRealOffset = offset;		offset = AlignTo8(offset + layout.numPhasors * sizeof(float));
+	layout.phasorImaginaryOffset = offset;	offset = AlignTo8(offset + layout.numPhasors * sizeof(float));
+	layout.analogOffset = offset;			offset = AlignTo8(offset + layout.numAnalogs * sizeof(float));
+	layout.digitalOffset = offset;			offset = AlignTo8(offset + layout.numDigitals * sizeof(BOOL8_t));
+	layout.bufferSize = offset;
+	return layout;
+}
+
+STRONGRIDIEEEC37118DLL_API int getAllPmuRealDataLayout( allPmuDataLayout* layout, int32_t* pmuPhasorIndex, int32_t* pmuAnalogIndex, int32_t* pmuDigitalIndex, int32_t pmuIndexArrayLength, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		const C37118PdcDataDecodeInfo& decodeInfo = client->GetDecodeInfo();
+		*layout = GetAllPmuDataLayout(decodeInfo);
+
+		// Start index of each PMU in the value arrays
+		if( pmuPhasorIndex == 0 && pmuAnalogIndex == 0 && pmuDigitalIndex == 0 ) return RETERR_OK;
+		if( pmuIndexArrayLength < layout->numPmus + 1 ) return RETERR_UNKNOWN_ERR;
+
+		int32_t phasorIndex = 0, analogIndex = 0, digitalIndex = 0;
+		for( int i = 0; i <= layout->numPmus; ++i )
+		{
+			if( pmuPhasorIndex != 0 ) pmuPhasorIndex[i] = phasorIndex;
+			if( pmuAnalogIndex != 0 ) pmuAnalogIndex[i] = analogIndex;
+			if( pmuDigitalIndex != 0 ) pmuDigitalIndex[i] = digitalIndex;
+			if( i == layout->numPmus ) break;
+			phasorIndex += decodeInfo.PMUs[i].numPhasors;
+			analogIndex += decodeInfo.PMUs[i].numAnalogs;
+			digitalIndex += decodeInfo.PMUs[i].numDigitals;
+		}
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int getAllPmuRealData( void* buffer, uint32_t bufferSize, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		const C37118PdcDataDecodeInfo& decodeInfo = client->GetDecodeInfo();
+		const C37118PdcFlatDataFrame& dataframe = client->GetPdcFlatDataFrame();
+
+		allPmuDataLayout layout = GetAllPmuDataLayout(decodeInfo);
+		if( bufferSize < layout.bufferSize || !dataframe.MatchesDecodeInfo(decodeInfo) ) return RETERR_UNKNOWN_ERR;
+		char* out = (char*)buffer;
+
+		// PDC portion of realdata
+		pdcDataFrame* pdcData = (pdcDataFrame*)(out + layout.pdcDataOffset);
+		pdcData->TimeQuality = GetClockStatus(dataframe.HeaderCommon.FracSec);
+		pdcData->Timestamp = GetParsedTimestamp(dataframe.HeaderCommon.SOC, dataframe.HeaderCommon.FracSec.FractionOfSecond, decodeInfo.timebase.TimeBase, &pdcData->SecondOfCentury);
+		pdcData->NumPmuInDataFrame = layout.numPmus;
+
+		// Per PMU values
+		PmuStatus* status = (PmuStatus*)(out + layout.statusOffset);
+		for( int i = 0; i < layout.numPmus; ++i )
+			FillPmuStatus(dataframe.Stat[i], &status[i]);
+		memcpy(out + layout.frequencyOffset, dataframe.Frequency.data(), layout.numPmus * sizeof(float));
+		memcpy(out + layout.deltaFrequencyOffset, dataframe.DeltaFrequency.data(), layout.numPmus * sizeof(float));
+
+		// Channel values are stored back to back in the frame already
+		memcpy(out + layout.phasorRealOffset, dataframe.PhasorReal.data(), layout.numPhasors * sizeof(float));
+		memcpy(out + layout.phasorImaginaryOffset, dataframe.PhasorImag.data(), layout.numPhasors * sizeof(float));
+		memcpy(out + layout.analogOffset, dataframe.AnalogValues.data(), layout.numAnalogs * sizeof(float));
+
+		BOOL8_t* digital = (BOOL8_t*)(out + layout.digitalOffset);
+		for( int iPmu = 0; iPmu < layout.numPmus; ++iPmu )
+		{
+			ExpandDigitalBits(dataframe.DigitalWords.data() + dataframe.DigitalWordOffset[iPmu], dataframe.NumDigitals(iPmu), digital);
+			digital += dataframe.NumDigitals(iPmu);
+		}
 
 		return RETERR_OK;
 	}
@@ -657,10 +1182,11 @@ STRONGRIDIEEEC37118DLL_API int getPmuRealData(pmuDataFrame* rd, PmuStatus* rdsts
 
 STRONGRIDIEEEC37118DLL_API int getHeaderMsg( char* msg, int maxMsgLength, int32_t pseudoPdcId)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcHeaderFrame& hdr = s_pdcClientMap[pseudoPdcId]->GetPdcHeaderFrame();
+		const C37118PdcHeaderFrame& hdr = client->GetPdcHeaderFrame();
 
 		memset(msg, 0, maxMsgLength);
 		strncpy(msg, hdr.HeaderMessage.c_str(), std::min(std::size_t(maxMsgLength), hdr.HeaderMessage.length()));	msg[maxMsgLength - 1] = 0;
@@ -672,6 +1198,361 @@ STRONGRIDIEEEC37118DLL_API int getHeaderMsg( char* msg, int maxMsgLength, int32_
 	}
 }
 
+STRONGRIDIEEEC37118DLL_API int setKeepPolarPhasors( BOOL8_t keepPolar, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		client->SetKeepPolarPhasors(keepPolar != 0);
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int setCrcCheck( BOOL8_t enabled, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		client->SetCrcCheck(enabled != 0);
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int getCrcFailureCount( uint32_t* numCrcFailures, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		*numCrcFailures = client->GetCrcFailureCount();
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int getDroppedDatagramCount( uint32_t* numDropped, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		*numDropped = client->GetDroppedDatagramCount();
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int setAutoReconnect( BOOL8_t enabled, int32_t minDelayMs, int32_t maxDelayMs, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		client->SetAutoReconnect(enabled != 0, minDelayMs, maxDelayMs);
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int getReconnectCount( uint32_t* numReconnects, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		*numReconnects = client->GetReconnectCount();
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+static void FillFrameTimestamps( const C37118FrameTimestamps& src, frameTimestamps* dest )
+{
+	dest->arrivalNs = src.ArrivalNs;
+	dest->decodedNs = src.DecodedNs;
+	dest->deliveredNs = src.DeliveredNs;
+}
+
+STRONGRIDIEEEC37118DLL_API int getFrameTimestamps( frameTimestamps* timestamps, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		// With a channel projection only the projected frame is read
+		if( client->GetChannelProjection().empty() ) FillFrameTimestamps(client->GetPdcFlatDataFrame().Timestamps, timestamps);
+		else FillFrameTimestamps(client->GetProjectedDataFrame().Timestamps, timestamps);
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int getLatencyHistogram( latencyHistogram* histogram, int32_t kind, BOOL8_t reset, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+	if( kind != LATENCY_WIRE_TO_API && kind != LATENCY_MEASUREMENT_TO_API ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		LatencyHistogram& source = kind == LATENCY_WIRE_TO_API ? client->GetWireToApiLatency() : client->GetMeasurementToApiLatency();
+		LatencyHistogramStats stats = source.GetStats();
+		if( reset ) source.Reset();
+
+		histogram->numSamples = stats.NumSamples;
+		histogram->numNegative = stats.NumNegative;
+		histogram->minUs = stats.MinNs / 1000.0;
+		histogram->maxUs = stats.MaxNs / 1000.0;
+		histogram->meanUs = stats.NumSamples != 0 ? stats.SumNs / 1000.0 / stats.NumSamples : 0.0;
+		for( int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; ++i ) histogram->buckets[i] = stats.Buckets[i];
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int setReceiverMode( BOOL8_t enabled, int32_t queueCapacity, int32_t overflowPolicy, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+	if( overflowPolicy < RECEIVER_DROP_OLDEST || overflowPolicy > RECEIVER_BLOCK || queueCapacity <= 0 ) return RETERR_UNKNOWN_ERR;
+	if( pseudoPdcId == s_callbackPseudoPdcId ) return RETERR_UNKNOWN_ERR; // from its own frame callback
+
+	try {
+		if( (enabled != 0) == client->HasFrameQueue() ) return RETERR_OK;
+		if( client.Entry().FrameCallback != 0 ) return RETERR_UNKNOWN_ERR; // frame callback registered
+
+		if( enabled )
+		{
+			// The receiver thread owns the socket - readiness is signalled by queued frames instead
+#ifdef STRONGRID_USE_EPOLL
+			EpollRemoveSocket(client->GetSocketDescriptor());
+#endif
+			client->SetFrameQueuedHandler(OnFrameQueued, (void*)(intptr_t)pseudoPdcId);
+			std::lock_guard<std::mutex> lock(s_ioEngineLock);
+			client->StartReceiver(queueCapacity, (QueueOverflowPolicy)overflowPolicy, s_ioEngine);
+		}
+		else
+		{
+			StopReceiverUnlocked(client);
+			if( client->GetTransport() != TransportMode::UDP_MULTICAST ) client->SetFrameQueuedHandler(0, 0); // still told about received frames
+			RefreshPollSocket(client, pseudoPdcId);
+		}
+		UpdatePendingFrames(client, pseudoPdcId);
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+void OnDataFrame( const C37118PdcFlatDataFrame& frame, void* context )
+{
+	// Receiver thread: point the view at the decoded frame and hand it to the application
+	FrameCallbackContext* ctx = (FrameCallbackContext*)context;
+	frameView& view = ctx->View;
+
+	view.pdcData.TimeQuality = GetClockStatus(frame.HeaderCommon.FracSec);
+	view.pdcData.Timestamp = GetParsedTimestamp(frame.HeaderCommon.SOC, frame.HeaderCommon.FracSec.FractionOfSecond, ctx->TimeBase, &view.pdcData.SecondOfCentury);
+	view.pdcData.NumPmuInDataFrame = frame.NumPmus();
+
+	view.numPmus = frame.NumPmus();
+	for( int i = 0; i < view.numPmus; ++i )
+		FillPmuStatus(frame.Stat[i], &ctx->Status[i]);
+	view.status = ctx->Status.data();
+	view.frequency = frame.Frequency.data();
+	view.deltaFrequency = frame.DeltaFrequency.data();
+	view.phasorOffset = frame.PhasorOffset.data();
+	view.phasorValueReal = frame.PhasorReal.data();
+	view.phasorValueImaginary = frame.PhasorImag.data();
+	view.analogOffset = frame.AnalogOffset.data();
+	view.analogValues = frame.AnalogValues.data();
+	view.digitalWordOffset = frame.DigitalWordOffset.data();
+	view.digitalWords = frame.DigitalWords.data();
+	FillFrameTimestamps(frame.Timestamps, &view.timestamps);
+
+	const int32_t outerPseudoPdcId = s_callbackPseudoPdcId;
+	s_callbackPseudoPdcId = ctx->PseudoPdcId;
+	ctx->Callback(&view, ctx->UserData);
+	s_callbackPseudoPdcId = outerPseudoPdcId;
+}
+
+STRONGRIDIEEEC37118DLL_API int registerFrameCallback( int32_t pseudoPdcId, frameCallback fn, void* userData)
+{
+	if( pseudoPdcId == s_callbackPseudoPdcId ) return RETERR_UNKNOWN_ERR; // from its own frame callback
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+
+		// Replace or remove a registered callback - taken out of the entry before the receiver is stopped
+		FrameCallbackContext* registered = client.Entry().FrameCallback;
+		if( registered != 0 )
+		{
+			client.Entry().FrameCallback = 0;
+			try {
+				StopReceiverUnlocked(client);
+			}
+			catch( ... ) {
+				client.Entry().FrameCallback = registered;
+				throw;
+			}
+			delete registered;
+			RefreshPollSocket(client, pseudoPdcId);
+		}
+		if( fn == 0 ) return RETERR_OK;
+		if( client->IsReceiverRunning() ) return RETERR_UNKNOWN_ERR; // receiver mode (setReceiverMode) is enabled
+
+		const C37118PdcDataDecodeInfo& decodeInfo = client->GetDecodeInfo();
+		FrameCallbackContext* ctx = new FrameCallbackContext();
+		ctx->PseudoPdcId = pseudoPdcId;
+		ctx->Callback = fn;
+		ctx->UserData = userData;
+		ctx->TimeBase = decodeInfo.timebase.TimeBase;
+		ctx->View.pseudoPdcId = pseudoPdcId;
+		ctx->Status.resize(decodeInfo.PMUs.size());
+
+		// The receiver thread owns the socket from now on
+#ifdef STRONGRID_USE_EPOLL
+		EpollRemoveSocket(client->GetSocketDescriptor());
+#endif
+		try {
+			std::lock_guard<std::mutex> lock(s_ioEngineLock);
+			client->StartCallbackReceiver(OnDataFrame, ctx, s_ioEngine);
+		}
+		catch( ... ) {
+			delete ctx;
+			RefreshPollSocket(client, pseudoPdcId);
+			throw;
+		}
+		client.Entry().FrameCallback = ctx;
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int setIoThreadPool( int32_t numThreads)
+{
+	if( numThreads < 0 ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		// The pool cannot be replaced under running receivers - they hold on to it until stopped
+		std::lock_guard<std::mutex> lock(s_ioEngineLock);
+		if( s_ioEngine != 0 && s_ioEngine->GetNumThreads() == numThreads ) return RETERR_OK;
+		if( s_ioEngine != 0 && s_ioEngine->GetNumAttached() > 0 ) return RETERR_UNKNOWN_ERR;
+
+		delete s_ioEngine;
+		s_ioEngine = 0;
+		if( numThreads > 0 ) s_ioEngine = new PdcEngine(numThreads);
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int getReceiveQueueStats( receiveQueueStats* stats, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		DataFrameQueueStats queueStats = client->GetReceiveQueueStats();
+		stats->capacity = queueStats.Capacity;
+		stats->depth = queueStats.Depth;
+		stats->maxDepth = queueStats.MaxDepth;
+		stats->numReceived = queueStats.NumEnqueued;
+		stats->numDropped = queueStats.NumDropped;
+		stats->numDecodeErrors = queueStats.NumDecodeErrors;
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int setChannelProjection( const channelSelector* channels, int32_t numChannels, int32_t* outNumValues, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+	if( numChannels < 0 || (numChannels > 0 && channels == 0) ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		std::vector<C37118ChannelSelector> projection(numChannels);
+		for( int i = 0; i < numChannels; ++i ) {
+			projection[i].PmuIndex = channels[i].pmuIndex;
+			projection[i].Kind = (C37118ChannelKind)channels[i].kind;
+			projection[i].ChannelIndex = channels[i].channelIndex;
+		}
+
+		client->SetChannelProjection(projection);
+		if( outNumValues != 0 ) *outNumValues = client->GetDecodeInfo().NumProjectedValues;
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
+STRONGRIDIEEEC37118DLL_API int getProjectedRealData( pdcDataFrame* pdcData, float* values, int32_t numValues, int32_t pseudoPdcId)
+{
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
+
+	try {
+		const C37118PdcDataDecodeInfo& decodeInfo = client->GetDecodeInfo();
+		const C37118PdcProjectedDataFrame& dataframe = client->GetProjectedDataFrame();
+		if( numValues < (int)dataframe.Values.size() ) return RETERR_UNKNOWN_ERR;
+
+		// PDC portion of realdata
+		if( pdcData != 0 ) {
+			pdcData->TimeQuality = GetClockStatus(dataframe.HeaderCommon.FracSec);
+			pdcData->Timestamp = GetParsedTimestamp(dataframe.HeaderCommon.SOC, dataframe.HeaderCommon.FracSec.FractionOfSecond, decodeInfo.timebase.TimeBase, &pdcData->SecondOfCentury);
+			pdcData->NumPmuInDataFrame = decodeInfo.PMUs.size();
+		}
+
+		memcpy(values, dataframe.Values.data(), dataframe.Values.size() * sizeof(float));
+		return RETERR_OK;
+	}
+	catch( ... )
+	{
+		return RETERR_UNKNOWN_ERR;
+	}
+}
+
 // ------------------------------------------------------------------------------------------------------------------------------------
 // ------------- LABVIEW SPECIFIC FUNCTIONS / NO ARRAYS WITHIN STRUCTURES
 // ------------------------------------------------------------------------------------------------------------------------------------
@@ -682,47 +1563,39 @@ STRONGRIDIEEEC37118DLL_API int getPmuRealDataLabview(noArraysPmuDataFrame* rd, P
 															uint16_t DigitalArrayLength, uint8_t* digitalValueArr,
 															int32_t pseudoPdcId, int32_t pmuIndex)
 {
-	if( PseudoPdcIdIsValidClient(pseudoPdcId) == false) return RETERR_UNKNOWN_ERR;
+	ClientHandleTable::Ref client = s_clients.Acquire(pseudoPdcId);
+	if( !client ) return RETERR_UNKNOWN_ERR;
 
 	try {
-		const C37118PdcDataDecodeInfo& pdcDecodeInfo = s_pdcClientMap[pseudoPdcId]->GetDecodeInfo();
-		const C37118PmuDataDecodeInfo& pmuDecodeInfo = pdcDecodeInfo.PMUs[pmuIndex];
-		const C37118PdcDataFrame& dataframe = s_pdcClientMap[pseudoPdcId]->GetPdcDataFrame();
-		const C37118PmuDataFrame& pmuDataFrame = dataframe.pmuDataFrame[pmuIndex];
+		const C37118PdcFlatDataFrame& dataframe = client->GetPdcFlatDataFrame();
+		if( pmuIndex < 0 || pmuIndex >= dataframe.NumPmus() ) return RETERR_UNKNOWN_ERR;
 
 		// Validate input arrays
-		if( PhasorArrayLength < pmuDecodeInfo.numPhasors ) return RETERR_INVALID_INPUT_PHASOR_ARR;
-		if( AnalogArrayLength < pmuDecodeInfo.numAnalogs ) return RETERR_INVALID_INPUT_ANALOG_ARR;
-		if( DigitalArrayLength < pmuDecodeInfo.numDigitals ) return RETERR_INVALID_INPUT_DIGITAL_ARR;
+		if( PhasorArrayLength < dataframe.NumPhasors(pmuIndex) ) return RETERR_INVALID_INPUT_PHASOR_ARR;
+		if( AnalogArrayLength < dataframe.NumAnalogs(pmuIndex) ) return RETERR_INVALID_INPUT_ANALOG_ARR;
+		if( DigitalArrayLength < dataframe.NumDigitals(pmuIndex) ) return RETERR_INVALID_INPUT_DIGITAL_ARR;
 
 		// frequency / delta-frequency
-		rd->frequency = dataframe.pmuDataFrame[pmuIndex].Frequency;
-		rd->deltaFrequency = dataframe.pmuDataFrame[pmuIndex].DeltaFrequency;
+		rd->frequency = dataframe.Frequency[pmuIndex];
+		rd->deltaFrequency = dataframe.DeltaFrequency[pmuIndex];
 
 		// Stat - field
-		rdsts->dataErrorCode = pmuDataFrame.Stat.getDataError();
-		rdsts->pmuSyncFlag = pmuDataFrame.Stat.getPmuSyncFlag();
-		rdsts->pmuDataSortingFlag = pmuDataFrame.Stat.getDataSortingFlag();
-		rdsts->pmuTriggerFlag = pmuDataFrame.Stat.getPmuTriggerFlag();
-		rdsts->configChangeFlag = pmuDataFrame.Stat.getConfigChangeFlag();
-		rdsts->dataModifiedFlag = pmuDataFrame.Stat.getDataModifiedFlag();
-		rdsts->timeQualityCode = pmuDataFrame.Stat.getTimeQualityCode();
-		rdsts->unlockTimeCode = pmuDataFrame.Stat.getUnlockTimeCode();
-		rdsts->triggerReasonCode = pmuDataFrame.Stat.getTriggerReasonCode();
+		FillPmuStatus(dataframe.Stat[pmuIndex], rdsts);
 
 		// Phasors
-		for( int i = 0; i < dataframe.pmuDataFrame[pmuIndex].PhasorValues.size(); ++i ) {
-			phasorValueReal[i] = dataframe.pmuDataFrame[pmuIndex].PhasorValues[i].Real;
-			phasorValueImaginary[i] = dataframe.pmuDataFrame[pmuIndex].PhasorValues[i].Imag;
+		const int phasorOffset = dataframe.PhasorOffset[pmuIndex];
+		for( int i = 0; i < dataframe.NumPhasors(pmuIndex); ++i ) {
+			phasorValueReal[i] = dataframe.PhasorReal[phasorOffset + i];
+			phasorValueImaginary[i] = dataframe.PhasorImag[phasorOffset + i];
 		}
 
 		// Analog
-		for( int i = 0; i < dataframe.pmuDataFrame[pmuIndex].AnalogValues.size(); ++i )
-			analogValueArr[i] = dataframe.pmuDataFrame[pmuIndex].AnalogValues[i].getValueAsFloat();
+		const int analogOffset = dataframe.AnalogOffset[pmuIndex];
+		for( int i = 0; i < dataframe.NumAnalogs(pmuIndex); ++i )
+			analogValueArr[i] = dataframe.AnalogValues[analogOffset + i];
 
 		// Digital
-		for( int i = 0; i < dataframe.pmuDataFrame[pmuIndex].DigitalValues.size(); ++i )
-			digitalValueArr[i] = dataframe.pmuDataFrame[pmuIndex].DigitalValues[i] ? 1 : 0;
+		ExpandDigitalBits(dataframe.DigitalWords.data() + dataframe.DigitalWordOffset[pmuIndex], dataframe.NumDigitals(pmuIndex), digitalValueArr);
 
 		return RETERR_OK;
 	}
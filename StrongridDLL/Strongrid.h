@@ -170,8 +170,8 @@ typedef struct
 	float			deltaFrequency;
 
 	uint16_t		PhasorArrayLength;
-	float*			phasorValueReal;
-	float*			phasorValueImaginary;
+	float*			phasorValueReal;		// magnitude if the phasor format is polar (see phasorConfig)
+	float*			phasorValueImaginary;	// angle (radians) if the phasor format is polar
 
 	uint16_t		AnalogArrayLength;
 	float*			analogValueArr;
@@ -192,7 +192,7 @@ typedef struct
 {
 	char*		    name;  // INPUT ARRAY MUST BE >= 256 in length
 	uint8_t			type; // 0 == voltage, 1 == current
-	uint8_t			format; // 0 = rectangular, 1 = polar | NOTE: currently this version is always in 'rectangular'
+	uint8_t			format; // 0 = rectangular, 1 = polar (magnitude/angle in radians) | polar only when enabled by setKeepPolarPhasors
 	BOOL8_t			dataIsScaled;	// True if scaled - false if not
 	float			scalar;
 
@@ -201,7 +201,7 @@ typedef struct
 typedef struct
 {
 	uint8_t			type; // 0 == voltage, 1 == current
-	uint8_t			format; // 0 = rectangular, 1 = polar | NOTE: currently this version is always in 'rectangular'
+	uint8_t			format; // 0 = rectangular, 1 = polar (magnitude/angle in radians) | polar only when enabled by setKeepPolarPhasors
 	BOOL8_t			dataIsScaled;	// True if scaled - false if not
 	float			scalar;
 
@@ -211,7 +211,7 @@ typedef struct
 {
 	char*		    name;  // INPUT ARRAY MUST BE >= 256 in length
 	uint8_t			type; // 0 == voltage, 1 == current
-	uint8_t			format; // 0 = rectangular, 1 = polar | NOTE: currently this version is always in 'rectangular'
+	uint8_t			format; // 0 = rectangular, 1 = polar (magnitude/angle in radians) | polar only when enabled by setKeepPolarPhasors
 	BOOL8_t			dataIsScaled;	// True if scaled - false if not
 	float			scaling_magnitude;
 	float			scaling_angleOffset;
@@ -271,10 +271,143 @@ typedef struct
 	BOOL8_t		isValidBit;  // Bit is valid
 }noArraysDigitalConfig;
 
+// Overflow policy of the receiver mode queue (setReceiverMode)
+#define RECEIVER_DROP_OLDEST	0	// discard the oldest queued frame
+#define RECEIVER_DROP_NEWEST	1	// discard the frame just received
+#define RECEIVER_BLOCK			2	// stop reading the socket until the application catches up
+
+typedef struct
+{
+	uint32_t		capacity;		// queue capacity (the requested capacity rounded up to a power of two)
+	uint32_t		depth;			// frames currently queued
+	uint32_t		maxDepth;		// highest depth seen since the receiver was started
+	uint64_t		numReceived;	// frames queued since the receiver was started
+	uint64_t		numDropped;		// frames dropped by the overflow policy
+	uint64_t		numDecodeErrors;	// dataframes discarded since they could not be decoded
+}receiveQueueStats;
+
+// Local times of a dataframe in nanoseconds since 1970, 0 if not known
+typedef struct
+{
+	int64_t			arrivalNs;		// kernel receive timestamp of the frame's last bytes
+	int64_t			decodedNs;		// decoding finished
+	int64_t			deliveredNs;	// handed to the application (readNextFrame or the frame callback)
+}frameTimestamps;
+
+// Latency histograms of a client (getLatencyHistogram)
+#define LATENCY_WIRE_TO_API			0	// deliveredNs - arrivalNs
+#define LATENCY_MEASUREMENT_TO_API	1	// deliveredNs - the frame's SOC/FRACSEC, includes the PMU/PDC and network delay
+#define LATENCY_HISTOGRAM_BUCKETS	32
+
+typedef struct
+{
+	uint64_t		numSamples;
+	uint64_t		numNegative;	// not in the buckets: delivered before the start time (unsynchronised clocks)
+	double			minUs;
+	double			maxUs;
+	double			meanUs;
+	uint64_t		buckets[LATENCY_HISTOGRAM_BUCKETS];	// 0: below 1 us, i: [2^(i-1), 2^i) us, the last one also holds everything above
+}latencyHistogram;
+
+// Decoded dataframe passed to a frame callback (registerFrameCallback). The values of all PMUs are stored
+// back to back: the values of PMU 'i' start at index xxxOffset[i] and end before xxxOffset[i+1].
+// Digital channel 'd' of PMU 'i' is bit (d % 16) of digitalWords[digitalWordOffset[i] + d / 16].
+// All pointers are owned by the library and only valid during the callback.
+typedef struct
+{
+	int32_t				pseudoPdcId;
+	pdcDataFrame		pdcData;
+
+	int32_t				numPmus;
+	const PmuStatus*	status;				// [numPmus]
+	const float*		frequency;			// [numPmus]
+	const float*		deltaFrequency;		// [numPmus]
+
+	const int32_t*		phasorOffset;		// [numPmus + 1]
+	const float*		phasorValueReal;	// magnitude if the phasor format is polar (see phasorConfig)
+	const float*		phasorValueImaginary;	// angle (radians) if the phasor format is polar
+
+	const int32_t*		analogOffset;		// [numPmus + 1]
+	const float*		analogValues;
+
+	const int32_t*		digitalWordOffset;	// [numPmus + 1]
+	const uint16_t*		digitalWords;
+
+	frameTimestamps		timestamps;
+}frameView;
+
+typedef void (*frameCallback)(const frameView* frame, void* userData);
+
+// Layout of the buffer filled by getAllPmuRealData. Offsets are in bytes from the start of the buffer,
+// which must be 8-byte aligned. The values of all PMUs are stored back to back, see getAllPmuRealDataLayout.
+typedef struct
+{
+	uint32_t		bufferSize;				// bytes required
+	int32_t			numPmus;
+	int32_t			numPhasors;				// total over all PMUs
+	int32_t			numAnalogs;
+	int32_t			numDigitals;
+
+	uint32_t		pdcDataOffset;			// pdcDataFrame
+	uint32_t		statusOffset;			// PmuStatus[numPmus]
+	uint32_t		frequencyOffset;		// float[numPmus]
+	uint32_t		deltaFrequencyOffset;	// float[numPmus]
+	uint32_t		phasorRealOffset;		// float[numPhasors]
+	uint32_t		phasorImaginaryOffset;	// float[numPhasors]
+	uint32_t		analogOffset;			// float[numAnalogs]
+	uint32_t		digitalOffset;			// BOOL8_t[numDigitals]
+}allPmuDataLayout;
+
+// Channel kinds of a channel projection (setChannelProjection)
+#define CHANNEL_KIND_PHASOR			0	// two values: real/imaginary (magnitude/angle if polar phasors are kept)
+#define CHANNEL_KIND_ANALOG			1
+#define CHANNEL_KIND_DIGITAL		2	// 0 or 1
+#define CHANNEL_KIND_FREQUENCY		3
+#define CHANNEL_KIND_DELTA_FREQUENCY	4
+#define CHANNEL_KIND_STAT			5	// the raw STAT word
+
+typedef struct
+{
+	int32_t			pmuIndex;
+	int32_t			kind;			// CHANNEL_KIND_xxx
+	int32_t			channelIndex;	// phasor/analog/digital index within the PMU, ignored for the other kinds
+}channelSelector;
+
+// Transports of connectPdcTransport
+#define TRANSPORT_TCP					0
+#define TRANSPORT_UDP					1	// commands and all frames over UDP
+#define TRANSPORT_TCP_COMMAND_UDP_DATA	2	// commands, header and configuration over TCP, dataframes to the local UDP port
+#define TRANSPORT_UDP_SPONTANEOUS		3	// no commands, the PMU/PDC sends to the local UDP port by itself
+
+// Steps done by connectPdcs after connecting, can be combined
+#define CONNECT_READ_HEADER			1	// readHeaderData
+#define CONNECT_READ_CONFIG			2	// readConfiguration
+#define CONNECT_READ_CONFIG_VER3	4	// readConfiguration_Ver3
+#define CONNECT_START_DATA_STREAM	8	// startDataStream
+
+typedef struct
+{
+	char*			ipAddress;
+	int32_t			port;
+	int32_t			pdcId;
+	int32_t			pseudoPdcId;	// out: the connected PMU/PDC, 0 on failure
+	int32_t			result;			// out: 0 = connected and all steps done, 1 = failed, 2 = timeout
+}pdcConnectRequest;
+
 STRONGRIDIEEEC37118DLL_API void strongrid_library_init();
 
 STRONGRIDIEEEC37118DLL_API int connectPdc( char *ipAddress,  int port, int32_t pdcId,  int32_t* pseudoPdcId);
 
+// Connects numRequests PMU/PDCs at once and runs the selected steps on all of them; the results are reported per request
+STRONGRIDIEEEC37118DLL_API int connectPdcs( pdcConnectRequest* requests, int32_t numRequests, int32_t steps, int32_t timeoutMs, int32_t* outNumConnected);
+
+// Like connectPdc with another transport (TRANSPORT_xxx); dataframes are received on localUdpPort (0: any free port)
+STRONGRIDIEEEC37118DLL_API int connectPdcTransport( char *ipAddress, int port, int32_t pdcId, int32_t transport, int32_t localUdpPort, int32_t* pseudoPdcId);
+
+// Receives the PMU/PDC pdcId from a multicast group (no commands), on a socket shared with the other handles of the group;
+// interfaceAddress selects the network interface (0 or empty: chosen by the system). Dataframes are decoded once for all handles in receiver or callback mode.
+STRONGRIDIEEEC37118DLL_API int connectPdcMulticast( char *groupAddress, int32_t port, char *interfaceAddress, int32_t pdcId, int32_t* pseudoPdcId);
+
 STRONGRIDIEEEC37118DLL_API int disconnectPdc( int32_t pseudoPdcId);
 
 STRONGRIDIEEEC37118DLL_API int readHeaderData( int32_t timeoutMs, int32_t pseudoPdcId);
@@ -321,8 +454,54 @@ STRONGRIDIEEEC37118DLL_API int getPdcRealData(pdcDataFrame* rd, int32_t pseudoPd
 
 STRONGRIDIEEEC37118DLL_API int getPmuRealData(pmuDataFrame* rd, PmuStatus* status, int32_t pseudoPdcId, int32_t pmuIndex);
 
+// Digital channels of a PMU as the packed status words of the dataframe: channel 'd' is bit (d % 16) of digitalWords[d / 16]
+STRONGRIDIEEEC37118DLL_API int getPmuDigitalWords(uint16_t* digitalWords, int32_t arrayLength, int32_t* outNumWords, int32_t pseudoPdcId, int32_t pmuIndex);
+
 STRONGRIDIEEEC37118DLL_API int getHeaderMsg( char* msg, int maxMsgLength, int32_t pseudoPdcId);
 
+// pmuPhasorIndex/pmuAnalogIndex/pmuDigitalIndex (may be NULL) receive numPmus + 1 start indices of each PMU in the value arrays
+STRONGRIDIEEEC37118DLL_API int getAllPmuRealDataLayout( allPmuDataLayout* layout, int32_t* pmuPhasorIndex, int32_t* pmuAnalogIndex, int32_t* pmuDigitalIndex, int32_t pmuIndexArrayLength, int32_t pseudoPdcId);
+
+STRONGRIDIEEEC37118DLL_API int getAllPmuRealData( void* buffer, uint32_t bufferSize, int32_t pseudoPdcId);
+
+STRONGRIDIEEEC37118DLL_API int setKeepPolarPhasors( BOOL8_t keepPolar, int32_t pseudoPdcId);
+
+STRONGRIDIEEEC37118DLL_API int setCrcCheck( BOOL8_t enabled, int32_t pseudoPdcId);
+
+STRONGRIDIEEEC37118DLL_API int getCrcFailureCount( uint32_t* numCrcFailures, int32_t pseudoPdcId);
+
+STRONGRIDIEEEC37118DLL_API int getDroppedDatagramCount( uint32_t* numDropped, int32_t pseudoPdcId);
+
+// Reconnect and restart the data stream by itself after a lost connection, waiting minDelayMs..maxDelayMs (jittered, doubling) between attempts
+STRONGRIDIEEEC37118DLL_API int setAutoReconnect( BOOL8_t enabled, int32_t minDelayMs, int32_t maxDelayMs, int32_t pseudoPdcId);
+
+STRONGRIDIEEEC37118DLL_API int getReconnectCount( uint32_t* numReconnects, int32_t pseudoPdcId);
+
+// Timestamps of the frame last read by readNextFrame
+STRONGRIDIEEEC37118DLL_API int getFrameTimestamps( frameTimestamps* timestamps, int32_t pseudoPdcId);
+
+// kind: LATENCY_xxx. reset = 1 clears the histogram after reading it
+STRONGRIDIEEEC37118DLL_API int getLatencyHistogram( latencyHistogram* histogram, int32_t kind, BOOL8_t reset, int32_t pseudoPdcId);
+
+STRONGRIDIEEEC37118DLL_API int setReceiverMode( BOOL8_t enabled, int32_t queueCapacity, int32_t overflowPolicy, int32_t pseudoPdcId);
+
+STRONGRIDIEEEC37118DLL_API int getReceiveQueueStats( receiveQueueStats* stats, int32_t pseudoPdcId);
+
+// fn runs on a library thread. Inside it the getters may be called for any pseudoPdcId, its own included (getPdcConfig,
+// getPmuConfiguration, getPhasorConfig, getCrcFailureCount, ...), as may the calls on other clients. disconnectPdc,
+// registerFrameCallback and setReceiverMode for its own pseudoPdcId and strongrid_library_cleanup fail, since they
+// would wait for the callback to return; readNextFrame and the configuration/header reads fail while fn is registered.
+STRONGRIDIEEEC37118DLL_API int registerFrameCallback( int32_t pseudoPdcId, frameCallback fn, void* userData);
+
+// Run the receivers (setReceiverMode, registerFrameCallback) started afterwards on a shared pool of numThreads threads. 0 = one thread per client.
+STRONGRIDIEEEC37118DLL_API int setIoThreadPool( int32_t numThreads);
+
+// Decode only the selected channels in readNextFrame; read them with getProjectedRealData. numChannels = 0 clears the projection.
+// A new configuration keeps the projection while its channels exist, otherwise clears it (readNextFrame then returns 6 once).
+STRONGRIDIEEEC37118DLL_API int setChannelProjection( const channelSelector* channels, int32_t numChannels, int32_t* outNumValues, int32_t pseudoPdcId);
+
+STRONGRIDIEEEC37118DLL_API int getProjectedRealData( pdcDataFrame* pdcData, float* values, int32_t numValues, int32_t pseudoPdcId);
+
 // --------------------- LABVIEW COMPATABILITY FUNCTIONS: All char* arrays must be 256 bytes, or longer  --------------------------
 
 STRONGRIDIEEEC37118DLL_API int getPmuRealDataLabview(noArraysPmuDataFrame* rd, PmuStatus* status,
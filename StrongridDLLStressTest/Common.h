@@ -51,4 +51,19 @@ namespace stresstest
 		std::string PdcId;
 		int Version;
 	};
+
+	// Connects 1, 2, 4 .. maxThreads clients to an in-process PMU/PDC, one thread each, and prints how the throughput
+	// scales; fails when the efficiency of a step drops below minEfficiency (ScalingTest.cpp)
+	int RunScalingTest( int maxThreads, int secondsPerPhase, double minEfficiency );
+
+	// Connects numConnections clients with frame callbacks running on an I/O thread pool to an in-process PMU/PDC sending
+	// framesPerSecond frames to each, and prints the frame rate and the library CPU time per frame (ScalingTest.cpp)
+	int RunIoPoolTest( int numThreads, int numConnections, int framesPerSecond, int seconds );
+
+	// Decodes dataframes of synthetic configurations with the decode plan and the per-value decoder it replaced, and prints the time per frame (DecodeBenchmark.cpp)
+	int RunDecodeBenchmark( int iterations );
+
+	// Reads the data stream of an in-process PMU/PDC (TRANSPORT_TCP, TRANSPORT_UDP or TRANSPORT_UDP_SPONTANEOUS), checks
+	// every frame and prints the frame rate and the losses (LoopbackTest.cpp)
+	int RunLoopbackTest( int transport, int framesPerSecond, int seconds, int localUdpPort );
 }
@@ -0,0 +1,251 @@
+/*
+*  DecodeBenchmark.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "../StrongridBase/C37118Protocol.h"
+#include "Common.h"
+
+using namespace std;
+using namespace strongridbase;
+
+namespace stresstest
+{
+	// Dataframe decoding on synthetic configurations, without network: the decode plan (C37118Protocol::ReadDataFrame
+	// into a flat frame) against the flat decoder it replaced, which tests the FORMAT bits for every value, and
+	// against the object decoder (ReadDataFrame returning a C37118PdcDataFrame).
+	struct DecodeCase
+	{
+		const char* Name;
+		int NumPmus;
+		int NumPhasors;
+		int NumAnalogs;
+		int NumDigWords;
+		int Format; // FORMAT bits, -1: each PMU takes the next of the 16 combinations
+	};
+
+	static const DecodeCase DECODE_CASES[] =
+	{
+		{ "16 PMU x 7ph/5an float rect",  16,  7,   5, 1, 0xE },
+		{ "16 PMU x 7ph/5an int polar",   16,  7,   5, 1, 0x1 },
+		{ "40 PMU x 32ph/100an float",    40, 32, 100, 2, 0xE },
+		{ "200 PMU x 8ph/8an mixed",     200,  8,   8, 1, -1 },
+		{ "500 PMU x 1ph/0an mixed",     500,  1,   0, 0, -1 },
+	};
+
+	static C37118PdcDataDecodeInfo CreateDecodeInfo( const DecodeCase& decodeCase )
+	{
+		C37118PdcDataDecodeInfo info;
+		info.timebase.TimeBase = 1000000;
+		info.KeepPolarPhasors = false;
+		for( int iPmu = 0; iPmu < decodeCase.NumPmus; ++iPmu )
+		{
+			const int format = decodeCase.Format >= 0 ? decodeCase.Format : iPmu % 16;
+			C37118PmuDataDecodeInfo pmu;
+			pmu.numPhasors = decodeCase.NumPhasors;
+			pmu.numAnalogs = decodeCase.NumAnalogs;
+			pmu.numDigitals = decodeCase.NumDigWords * 16;
+			pmu.DataFormat.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle = (format & 1) != 0;
+			pmu.DataFormat.Bit1_0xPhasorsIsInt_1xPhasorFloat = (format & 2) != 0;
+			pmu.DataFormat.Bit2_0xAnalogIsInt_1xAnalogIsFloat = (format & 4) != 0;
+			pmu.DataFormat.Bit3_0xFreqIsInt_1xFreqIsFloat = (format & 8) != 0;
+			info.PMUs.push_back(pmu);
+		}
+		C37118Protocol::BuildDecodePlan(&info);
+		return info;
+	}
+
+	static std::vector<char> CreateDataFrame( const C37118PdcDataDecodeInfo& info )
+	{
+		C37118PdcDataFrame frame;
+		frame.HeaderCommon.Sync.LeadIn = (char)0xAA;
+		frame.HeaderCommon.Sync.FrameType = C37118HdrFrameType::DATA_FRAME;
+		frame.HeaderCommon.Sync.Version = 1;
+		frame.HeaderCommon.IdCode = 1;
+		frame.HeaderCommon.SOC = 1500000000;
+		frame.HeaderCommon.FracSec.FractionOfSecond = 0;
+		frame.HeaderCommon.FracSec.TimeQuality = 0;
+		for( std::vector<C37118PmuDataDecodeInfo>::const_iterator pmu = info.PMUs.begin(); pmu != info.PMUs.end(); ++pmu )
+		{
+			const C37118PmuFormat& fmt = pmu->DataFormat;
+			C37118PmuDataFrame data;
+			data.Frequency = 50.0f;
+			data.DeltaFrequency = 0.5f;
+			for( int i = 0; i < pmu->numPhasors; ++i )
+			{
+				if( fmt.Bit1_0xPhasorsIsInt_1xPhasorFloat )
+					data.PhasorValues.push_back(fmt.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle
+						? C37118PmuDataFramePhasorRealImag::CreateByPolarMag(230.0f + i, 0.1f * i)
+						: C37118PmuDataFramePhasorRealImag::CreateByRealImag(100.0f + i, -50.0f + i));
+				else
+					data.PhasorValues.push_back(fmt.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle
+						? C37118PmuDataFramePhasorRealImag::CreateByPolarMag((uint16_t)(2300 + i), (int16_t)(1000 * i))
+						: C37118PmuDataFramePhasorRealImag::CreateByRealImag((int16_t)(1000 + i), (int16_t)(-500 + i)));
+			}
+			for( int i = 0; i < pmu->numAnalogs; ++i )
+				data.AnalogValues.push_back(fmt.Bit2_0xAnalogIsInt_1xAnalogIsFloat ? C37118PmuDataFrameAnalog::CreateByFloat(0.5f * i) : C37118PmuDataFrameAnalog::CreateByInt16((int16_t)(10 * i)));
+			for( int i = 0; i < pmu->numDigitals / 16; ++i )
+				data.DigitalWords.push_back((uint16_t)(0x5A5A + i));
+			frame.pmuDataFrame.push_back(data);
+		}
+
+		std::vector<char> buffer(info.DataFrameSize);
+		int offset = 0;
+		C37118Protocol::WriteDataFrame(buffer.data(), (int)buffer.size(), &info, &frame, &offset);
+		return buffer;
+	}
+
+	// The flat decoder the plan replaced: one pass over the PMUs, testing the FORMAT bits for every value
+	static void DecodePerValue( const char* data, const C37118PdcDataDecodeInfo& info, C37118PdcFlatDataFrame* outFrame )
+	{
+		UncheckedBigEndianReader in(data, info.DataFrameSize, 14);
+		for( int iPmu = 0; iPmu < (int)info.PMUs.size(); ++iPmu )
+		{
+			const C37118PmuFormat& fmt = info.PMUs[iPmu].DataFormat;
+			outFrame->Stat[iPmu] = C37118PmuDataFrameStat(in.Read<uint16_t>());
+
+			float* real = outFrame->PhasorReal.data() + outFrame->PhasorOffset[iPmu];
+			float* imag = outFrame->PhasorImag.data() + outFrame->PhasorOffset[iPmu];
+			for( int i = 0; i < info.PMUs[iPmu].numPhasors; ++i )
+			{
+				C37118PmuDataFramePhasorRealImag ph;
+				if( fmt.Bit1_0xPhasorsIsInt_1xPhasorFloat )
+				{
+					float a = in.Read<float>();
+					float b = in.Read<float>();
+					ph = fmt.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle ? C37118PmuDataFramePhasorRealImag::CreateByPolarMag(a, b) : C37118PmuDataFramePhasorRealImag::CreateByRealImag(a, b);
+				}
+				else if( fmt.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle )
+				{
+					uint16_t mag = in.Read<uint16_t>();
+					ph = C37118PmuDataFramePhasorRealImag::CreateByPolarMag(mag, in.Read<int16_t>());
+				}
+				else
+				{
+					int16_t a = in.Read<int16_t>();
+					ph = C37118PmuDataFramePhasorRealImag::CreateByRealImag(a, in.Read<int16_t>());
+				}
+				real[i] = ph.Real;
+				imag[i] = ph.Imag;
+			}
+
+			if( fmt.Bit3_0xFreqIsInt_1xFreqIsFloat ) {
+				outFrame->Frequency[iPmu] = in.Read<float>();
+				outFrame->DeltaFrequency[iPmu] = in.Read<float>();
+			}
+			else {
+				outFrame->Frequency[iPmu] = in.Read<int16_t>();
+				outFrame->DeltaFrequency[iPmu] = (float)in.Read<int16_t>() / 100.0f;
+			}
+
+			float* analog = outFrame->AnalogValues.data() + outFrame->AnalogOffset[iPmu];
+			for( int i = 0; i < info.PMUs[iPmu].numAnalogs; ++i )
+				analog[i] = fmt.Bit2_0xAnalogIsInt_1xAnalogIsFloat ? in.Read<float>() : (float)in.Read<int16_t>();
+
+			uint16_t* digWords = outFrame->DigitalWords.data() + outFrame->DigitalWordOffset[iPmu];
+			for( int i = outFrame->DigitalWordOffset[iPmu]; i < outFrame->DigitalWordOffset[iPmu+1]; ++i )
+				*digWords++ = in.Read<uint16_t>();
+		}
+		outFrame->CRC16 = in.Read<uint16_t>();
+	}
+
+	static bool SamePhasors( const C37118PdcFlatDataFrame& a, const C37118PdcFlatDataFrame& b )
+	{
+		if( a.PhasorReal.size() != b.PhasorReal.size() || a.PhasorImag.size() != b.PhasorImag.size() || a.PhasorReal.size() != a.PhasorImag.size() ) return false;
+
+		// The plan converts polar phasors with its own sincos, which SimdKernels.h bounds to 1e-7 of the magnitude;
+		// the other 1e-7 is left for the rounding of the products on both sides
+		for( size_t i = 0; i < a.PhasorReal.size(); ++i )
+		{
+			const double tolerance = 2.0e-7 * std::hypot((double)b.PhasorReal[i], (double)b.PhasorImag[i]);
+			if( std::fabs((double)a.PhasorReal[i] - b.PhasorReal[i]) > tolerance || std::fabs((double)a.PhasorImag[i] - b.PhasorImag[i]) > tolerance ) return false;
+		}
+		return true;
+	}
+
+	// Best time of 'runs' runs of 'iterations' calls, in microseconds per call
+	template<typename Decode>
+	static double BestMicroseconds( int runs, int iterations, Decode decode )
+	{
+		double best = 1.0e30;
+		for( int run = 0; run < runs; ++run )
+		{
+			std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+			for( int i = 0; i < iterations; ++i ) decode();
+			double us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / iterations;
+			if( us < best ) best = us;
+		}
+		return best;
+	}
+
+	int RunDecodeBenchmark( int iterations )
+	{
+		static const int RUNS = 7;
+
+		cout << "Dataframe decoding, us/frame (best of " << RUNS << " runs of " << iterations << " frames)" << endl << endl;
+		cout << left << setw(32) << "configuration" << right << setw(10) << "bytes" << setw(12) << "per-value" << setw(10) << "plan"
+			<< setw(10) << "speedup" << setw(10) << "objects" << endl;
+
+		int numMismatches = 0;
+		for( size_t iCase = 0; iCase < sizeof(DECODE_CASES) / sizeof(DECODE_CASES[0]); ++iCase )
+		{
+			const DecodeCase& decodeCase = DECODE_CASES[iCase];
+			C37118PdcDataDecodeInfo info = CreateDecodeInfo(decodeCase);
+			std::vector<char> frame = CreateDataFrame(info);
+
+			C37118PdcFlatDataFrame planFrame = C37118PdcFlatDataFrame::CreateByDecodeInfo(info);
+			C37118PdcFlatDataFrame perValueFrame = C37118PdcFlatDataFrame::CreateByDecodeInfo(info);
+
+			double perValueUs = BestMicroseconds(RUNS, iterations, [&]() {
+				DecodePerValue(frame.data(), info, &perValueFrame);
+			});
+			double planUs = BestMicroseconds(RUNS, iterations, [&]() {
+				int offset = 0;
+				C37118Protocol::ReadDataFrame(frame.data(), (int)frame.size(), &info, &planFrame, &offset);
+			});
+			double objectsUs = BestMicroseconds(RUNS, iterations / 10 + 1, [&]() {
+				int offset = 0;
+				C37118Protocol::ReadDataFrame(frame.data(), (int)frame.size(), &info, &offset);
+			});
+
+			// Both flat decoders must agree
+			if( !SamePhasors(planFrame, perValueFrame)
+				|| planFrame.AnalogValues != perValueFrame.AnalogValues || planFrame.Frequency != perValueFrame.Frequency
+				|| planFrame.DigitalWords != perValueFrame.DigitalWords || planFrame.CRC16 != perValueFrame.CRC16 )
+			{
+				cout << decodeCase.Name << ": the decoders disagree" << endl;
+				++numMismatches;
+			}
+
+			cout << left << setw(32) << decodeCase.Name << right << setw(10) << frame.size()
+				<< fixed << setprecision(2) << setw(12) << perValueUs << setw(10) << planUs
+				<< setw(9) << perValueUs / planUs << "x" << setw(10) << objectsUs << endl;
+		}
+
+		return numMismatches == 0 ? 0 : 1;
+	}
+}
@@ -0,0 +1,604 @@
+/*
+*  LoopbackPdc.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#ifdef _WIN32
+#	include <WinSock2.h>    // WSAPoll, accept, bind, closesocket, listen, recv, recvfrom, send, sendto, setsockopt, socket
+#	include <WS2tcpip.h>    // socklen_t
+#	include <Windows.h>     // GetProcessTimes, GetThreadTimes
+#else
+#	include <arpa/inet.h>   // htonl, htons, ntohs
+#	include <netinet/in.h>  // INADDR_LOOPBACK, sockaddr_in
+#	include <netinet/tcp.h> // TCP_NODELAY
+#	include <poll.h>        // poll, pollfd
+#	include <sys/socket.h>  // accept, bind, getsockname, listen, recv, recvfrom, send, sendto, setsockopt, socket
+#	include <sys/time.h>    // timeval
+#	include <time.h>        // clock_gettime
+#	include <unistd.h>      // close
+#endif
+
+#include "../StrongridBase/C37118Protocol.h"
+#include "Common.h"
+#include "LoopbackPdc.h"
+
+using namespace strongridbase;
+
+#ifdef _WIN32
+#	define poll WSAPoll
+	static void CloseSocket( int sock ) { closesocket(sock); }
+	static const int SEND_FLAGS = 0;
+#else
+	static void CloseSocket( int sock ) { close(sock); }
+#	ifdef MSG_NOSIGNAL
+	static const int SEND_FLAGS = MSG_NOSIGNAL; // a closed connection is an error, not a signal
+#	else
+	static const int SEND_FLAGS = 0;
+#	endif
+#endif
+
+// A sender that cannot get rid of a frame rechecks the stop flag this often
+static const int SEND_TIMEOUT_MS = 100;
+
+namespace stresstest
+{
+	struct LoopbackPdc::Connection
+	{
+		Connection() : Id(0), Socket(-1), OwnsSocket(false), AddressLength(0), Streaming(false) { memset(&Address, 0, sizeof(Address)); }
+		~Connection() { if( OwnsSocket ) CloseSocket(Socket); }
+
+		uint64_t Id;
+		int Socket;
+		bool OwnsSocket; // TCP - the UDP connections share the socket of the PMU/PDC
+		sockaddr_in Address; // UDP destination
+		socklen_t AddressLength;
+		std::atomic<bool> Streaming;
+		std::mutex SendLock; // frames of the control thread and of a sender must not interleave
+		std::vector<char> Received; // TCP command bytes not yet handled
+	};
+
+	static sockaddr_in LoopbackAddress( int port )
+	{
+		sockaddr_in addr;
+		memset(&addr, 0, sizeof(addr));
+		addr.sin_family = AF_INET;
+		addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+		addr.sin_port = htons((uint16_t)port);
+		return addr;
+	}
+
+	LoopbackPdc::LoopbackPdc( int transport, const LoopbackPdcConfig& config, int spontaneousPort ) :
+		m_transport(transport), m_config(config), m_socket(-1), m_port(0), m_sequenceOffset(0), m_nextConnectionId(0),
+		m_stopControl(false), m_stopSenders(false), m_framesSent(0), m_senderCpuNs(0)
+	{
+		if( transport != TRANSPORT_TCP && transport != TRANSPORT_UDP && transport != TRANSPORT_UDP_SPONTANEOUS ) throw Exception("LoopbackPdc: unsupported transport");
+		if( config.NumPmus < 1 || config.NumAnalogs < 1 ) throw Exception("LoopbackPdc: at least one PMU with one analog is needed");
+
+#ifdef _WIN32
+		WSADATA wsaData;
+		if( WSAStartup(MAKEWORD(2, 2), &wsaData) != 0 ) throw Exception("LoopbackPdc: WSAStartup failed");
+#endif
+		BuildFrames();
+
+		// Bound to any free port of the loopback interface
+		m_socket = (int)socket(AF_INET, transport == TRANSPORT_TCP ? SOCK_STREAM : SOCK_DGRAM, 0);
+		if( m_socket < 0 ) throw Exception("LoopbackPdc: unable to create a socket");
+		sockaddr_in addr = LoopbackAddress(0);
+		socklen_t addrLength = sizeof(addr);
+		if( bind(m_socket, (sockaddr*)&addr, sizeof(addr)) != 0 || getsockname(m_socket, (sockaddr*)&addr, &addrLength) != 0 ||
+			(transport == TRANSPORT_TCP && listen(m_socket, SOMAXCONN) != 0) )
+		{
+			CloseSocket(m_socket);
+			throw Exception("LoopbackPdc: unable to bind a socket");
+		}
+		m_port = ntohs(addr.sin_port);
+
+		// A large send buffer lets the datagrams of a burst queue in the receive buffer of the client
+		if( transport != TRANSPORT_TCP ) {
+			int bufferSize = 4 * 1024 * 1024;
+			setsockopt(m_socket, SOL_SOCKET, SO_SNDBUF, (const char*)&bufferSize, sizeof(bufferSize));
+		}
+
+		// The spontaneous stream needs no command
+		if( transport == TRANSPORT_UDP_SPONTANEOUS ) {
+			ConnectionPtr conn(new Connection());
+			conn->Socket = m_socket;
+			conn->Address = LoopbackAddress(spontaneousPort);
+			conn->AddressLength = sizeof(conn->Address);
+			conn->Streaming = true;
+			m_connections.push_back(conn);
+		}
+		else {
+			m_controlThread = std::thread(&LoopbackPdc::ControlProc, this);
+		}
+	}
+
+	LoopbackPdc::~LoopbackPdc()
+	{
+		Stop();
+		m_stopControl = true;
+		if( m_controlThread.joinable() ) m_controlThread.join();
+		m_connections.clear();
+		CloseSocket(m_socket);
+#ifdef _WIN32
+		WSACleanup();
+#endif
+	}
+
+	int LoopbackPdc::NumStreaming() const
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		int numStreaming = 0;
+		for( std::vector<ConnectionPtr>::const_iterator iter = m_connections.begin(); iter != m_connections.end(); ++iter )
+			if( (*iter)->Streaming ) ++numStreaming;
+		return numStreaming;
+	}
+
+	void LoopbackPdc::BuildFrames()
+	{
+		const LoopbackPdcConfig& cfg = m_config;
+		const uint32_t soc = (uint32_t)std::chrono::duration_cast<std::chrono::seconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+
+		// Configuration frame 2
+		C37118PdcConfiguration pdcConfig;
+		C37118ConfigBuilder builder(&pdcConfig.Storage);
+		pdcConfig.HeaderCommon.Sync.LeadIn = (char)0xAA;
+		pdcConfig.HeaderCommon.Sync.FrameType = CONFIGURATION_FRAME_2;
+		pdcConfig.HeaderCommon.Sync.Version = 1;
+		pdcConfig.HeaderCommon.IdCode = (uint16_t)cfg.PdcId;
+		pdcConfig.HeaderCommon.SOC = soc;
+		pdcConfig.HeaderCommon.FracSec.FractionOfSecond = 0;
+		pdcConfig.HeaderCommon.FracSec.TimeQuality = 0;
+		pdcConfig.TimeBase.Flags = 0;
+		pdcConfig.TimeBase.TimeBase = 1000000;
+		pdcConfig.DataRate = C37118DataRate::CreateByFramesPerSecond((float)cfg.DataRate);
+
+		std::vector<C37118Name> phasorNames, analogNames, digitalNames;
+		for( int i = 0; i < cfg.NumPhasors; ++i ) phasorNames.push_back(builder.AddName("PHASOR_" + std::to_string(i)));
+		for( int i = 0; i < cfg.NumAnalogs; ++i ) analogNames.push_back(builder.AddName("ANALOG_" + std::to_string(i)));
+		for( int i = 0; i < 16 * cfg.NumDigWords; ++i ) digitalNames.push_back(builder.AddName("DIGITAL_" + std::to_string(i)));
+
+		C37118PhasorUnit* phasorUnits = builder.NewArray<C37118PhasorUnit>(cfg.NumPhasors);
+		C37118AnalogUnit* analogUnits = builder.NewArray<C37118AnalogUnit>(cfg.NumAnalogs);
+		C37118DigitalUnit* digitalUnits = builder.NewArray<C37118DigitalUnit>(cfg.NumDigWords);
+		C37118Name* phasorNameArray = builder.NewArray<C37118Name>(cfg.NumPhasors);
+		C37118Name* analogNameArray = builder.NewArray<C37118Name>(cfg.NumAnalogs);
+		C37118Name* digitalNameArray = builder.NewArray<C37118Name>(16 * cfg.NumDigWords);
+		for( int i = 0; i < cfg.NumPhasors; ++i ) { phasorUnits[i] = C37118PhasorUnit(0, 1); phasorNameArray[i] = phasorNames[i]; }
+		for( int i = 0; i < cfg.NumAnalogs; ++i ) { analogUnits[i] = C37118AnalogUnit(0, 1); analogNameArray[i] = analogNames[i]; }
+		for( int i = 0; i < cfg.NumDigWords; ++i ) digitalUnits[i] = C37118DigitalUnit(0, 0xFFFF);
+		for( int i = 0; i < 16 * cfg.NumDigWords; ++i ) digitalNameArray[i] = digitalNames[i];
+
+		C37118PmuConfiguration* pmus = builder.NewArray<C37118PmuConfiguration>(cfg.NumPmus);
+		for( int iPmu = 0; iPmu < cfg.NumPmus; ++iPmu )
+		{
+			C37118PmuConfiguration& pmu = pmus[iPmu];
+			pmu.StationName = builder.AddName("LOOPBACK_" + std::to_string(iPmu));
+			pmu.IdCode = (uint16_t)(iPmu + 1);
+			pmu.DataFormat.Bit0_0xPhasorFormatRect_1xMagnitudeAndAngle = false;
+			pmu.DataFormat.Bit1_0xPhasorsIsInt_1xPhasorFloat = true;
+			pmu.DataFormat.Bit2_0xAnalogIsInt_1xAnalogIsFloat = true;
+			pmu.DataFormat.Bit3_0xFreqIsInt_1xFreqIsFloat = true;
+			pmu.phasorChnNames = C37118Array<C37118Name>(phasorNameArray, cfg.NumPhasors);
+			pmu.analogChnNames = C37118Array<C37118Name>(analogNameArray, cfg.NumAnalogs);
+			pmu.digitalChnNames = C37118Array<C37118Name>(digitalNameArray, 16 * cfg.NumDigWords);
+			pmu.PhasorUnit = C37118Array<C37118PhasorUnit>(phasorUnits, cfg.NumPhasors);
+			pmu.AnalogUnit = C37118Array<C37118AnalogUnit>(analogUnits, cfg.NumAnalogs);
+			pmu.DigitalUnit = C37118Array<C37118DigitalUnit>(digitalUnits, cfg.NumDigWords);
+			pmu.NomFreqCode.Bit0_1xFreqIs50_0xFreqIs60 = true;
+			pmu.ConfChangeCnt = 0;
+		}
+		pdcConfig.PMUs = C37118Array<C37118PmuConfiguration>(pmus, cfg.NumPmus);
+
+		std::vector<char> buffer(0x10000);
+		int offset = 0;
+		C37118Protocol::WriteConfigurationFrame(buffer.data(), (int)buffer.size(), &pdcConfig, &offset);
+		m_configFrame.assign(buffer.begin(), buffer.begin() + offset);
+
+		// Header frame
+		C37118PdcHeaderFrame header;
+		header.Header = pdcConfig.HeaderCommon;
+		header.Header.Sync.FrameType = HEADER_FRAME;
+		header.HeaderMessage = "StrongridDLLStressTest loopback PMU/PDC";
+		offset = 0;
+		C37118Protocol::WriteHeaderFrame(buffer.data(), (int)buffer.size(), &header, &offset);
+		m_headerFrame.assign(buffer.begin(), buffer.begin() + offset);
+
+		// Dataframe - only the timestamp, the sequence number and the CRC change from frame to frame
+		C37118PdcDataDecodeInfo decodeInfo = C37118Protocol::CreateDecodeInfoByPdcConfig(pdcConfig);
+		C37118PdcDataFrame dataFrame;
+		dataFrame.HeaderCommon = pdcConfig.HeaderCommon;
+		dataFrame.HeaderCommon.Sync.FrameType = DATA_FRAME;
+		for( int iPmu = 0; iPmu < cfg.NumPmus; ++iPmu )
+		{
+			C37118PmuDataFrame pmu;
+			pmu.Frequency = FrequencyValue(iPmu);
+			pmu.DeltaFrequency = 0.0f;
+			for( int i = 0; i < cfg.NumPhasors; ++i ) pmu.PhasorValues.push_back(C37118PmuDataFramePhasorRealImag::CreateByRealImag(PhasorValue(iPmu, i), -PhasorValue(iPmu, i)));
+			for( int i = 0; i < cfg.NumAnalogs; ++i ) pmu.AnalogValues.push_back(C37118PmuDataFrameAnalog::CreateByFloat(AnalogValue(iPmu, i)));
+			for( int i = 0; i < cfg.NumDigWords; ++i ) pmu.DigitalWords.push_back(DigitalWord(iPmu, i));
+			dataFrame.pmuDataFrame.push_back(pmu);
+		}
+		offset = 0;
+		C37118Protocol::WriteDataFrame(buffer.data(), (int)buffer.size(), &decodeInfo, &dataFrame, &offset);
+		m_dataFrame.assign(buffer.begin(), buffer.begin() + offset);
+
+		// STAT, PHASORS, FREQ/DFREQ, then ANALOG
+		m_sequenceOffset = decodeInfo.DecodePlan[0].ByteOffset + 2 + 8 * cfg.NumPhasors + 8;
+	}
+
+	void LoopbackPdc::StampDataFrame( std::vector<char>* frame, uint32_t sequence ) const
+	{
+		// Time of sending, in microseconds (TIME_BASE)
+		const int64_t nowUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+		char* data = frame->data();
+		StoreBigEndian<uint32_t>(data + 6, (uint32_t)(nowUs / 1000000));
+		StoreBigEndian<uint32_t>(data + 10, (uint32_t)(nowUs % 1000000));
+		StoreBigEndian<float>(data + m_sequenceOffset, (float)(sequence & 0xFFFFFF)); // exact as a float
+		StoreBigEndian<uint16_t>(data + frame->size() - 2, C37118Protocol::CalcCrc16(data, (int)frame->size() - 2));
+	}
+
+
+	// ------------------------------------------------------------------------------------------------------------------------
+	// Commands
+	// ------------------------------------------------------------------------------------------------------------------------
+
+
+	void LoopbackPdc::ControlProc()
+	{
+		std::vector<pollfd> fds;
+		std::vector<ConnectionPtr> polled;
+		while( !m_stopControl )
+		{
+			fds.clear();
+			polled.clear();
+			pollfd listener = { (decltype(pollfd().fd))m_socket, POLLIN, 0 };
+			fds.push_back(listener);
+			if( m_transport == TRANSPORT_TCP ) {
+				std::lock_guard<std::mutex> lock(m_lock);
+				for( std::vector<ConnectionPtr>::iterator iter = m_connections.begin(); iter != m_connections.end(); ++iter ) {
+					pollfd fd = { (decltype(pollfd().fd))(*iter)->Socket, POLLIN, 0 };
+					fds.push_back(fd);
+					polled.push_back(*iter);
+				}
+			}
+
+			if( poll(fds.data(), (unsigned long)fds.size(), SEND_TIMEOUT_MS) <= 0 ) continue;
+
+			if( fds[0].revents != 0 ) {
+				if( m_transport == TRANSPORT_TCP ) AcceptConnection();
+				else ReadUdpCommand();
+			}
+			for( size_t i = 1; i < fds.size(); ++i )
+				if( fds[i].revents != 0 ) ReadTcpCommands(polled[i-1]);
+		}
+	}
+
+	void LoopbackPdc::AcceptConnection()
+	{
+		int sock = (int)accept(m_socket, 0, 0);
+		if( sock < 0 ) return;
+
+		// Frames go out as soon as they are written; sends give up after a while so that Stop is never held up
+		int noDelay = 1;
+		setsockopt(sock, IPPROTO_TCP, TCP_NODELAY, (const char*)&noDelay, sizeof(noDelay));
+#ifdef _WIN32
+		DWORD timeout = SEND_TIMEOUT_MS;
+#else
+		timeval timeout = { 0, SEND_TIMEOUT_MS * 1000 };
+#endif
+		setsockopt(sock, SOL_SOCKET, SO_SNDTIMEO, (const char*)&timeout, sizeof(timeout));
+
+		ConnectionPtr conn(new Connection());
+		conn->Socket = sock;
+		conn->OwnsSocket = true;
+
+		std::lock_guard<std::mutex> lock(m_lock);
+		conn->Id = m_nextConnectionId++;
+		m_connections.push_back(conn);
+	}
+
+	void LoopbackPdc::ReadTcpCommands( const ConnectionPtr& conn )
+	{
+		char buffer[4096];
+		int received = (int)recv(conn->Socket, buffer, sizeof(buffer), 0);
+		if( received <= 0 ) {
+			RemoveConnection(conn);
+			return;
+		}
+		conn->Received.insert(conn->Received.end(), buffer, buffer + received);
+
+		// Every complete frame is a command
+		while( conn->Received.size() >= 4 )
+		{
+			const int frameSize = LoadBigEndian<uint16_t>(conn->Received.data() + 2);
+			if( frameSize < 4 ) { RemoveConnection(conn); return; }
+			if( (int)conn->Received.size() < frameSize ) break;
+			HandleCommand(conn, conn->Received.data(), frameSize);
+			conn->Received.erase(conn->Received.begin(), conn->Received.begin() + frameSize);
+		}
+	}
+
+	void LoopbackPdc::ReadUdpCommand()
+	{
+		char buffer[4096];
+		sockaddr_in from;
+		socklen_t fromLength = sizeof(from);
+		int received = (int)recvfrom(m_socket, buffer, sizeof(buffer), 0, (sockaddr*)&from, &fromLength);
+		if( received <= 0 ) return;
+
+		// A client is known by the address its commands come from
+		ConnectionPtr conn;
+		{
+			std::lock_guard<std::mutex> lock(m_lock);
+			for( std::vector<ConnectionPtr>::iterator iter = m_connections.begin(); iter != m_connections.end(); ++iter )
+				if( (*iter)->Address.sin_port == from.sin_port && (*iter)->Address.sin_addr.s_addr == from.sin_addr.s_addr ) conn = *iter;
+			if( !conn ) {
+				conn.reset(new Connection());
+				conn->Id = m_nextConnectionId++;
+				conn->Socket = m_socket;
+				conn->Address = from;
+				conn->AddressLength = fromLength;
+				m_connections.push_back(conn);
+			}
+		}
+		HandleCommand(conn, buffer, received);
+	}
+
+	void LoopbackPdc::HandleCommand( const ConnectionPtr& conn, const char* frame, int length )
+	{
+		C37118CommandFrame cmd;
+		try {
+			int offset = 0;
+			cmd = C37118Protocol::ReadCommandFrame((char*)frame, length, &offset);
+		}
+		catch( strongridbase::Exception )
+		{
+			return; // not a command frame
+		}
+
+		switch( cmd.CmdType )
+		{
+		case SEND_CFG2_FRAME: SendFrame(conn, m_configFrame.data(), (int)m_configFrame.size()); break;
+		case SEND_HDR_FRAME: SendFrame(conn, m_headerFrame.data(), (int)m_headerFrame.size()); break;
+		case START_RTD: conn->Streaming = true; break;
+		case KILL_RTD: conn->Streaming = false; break;
+		default: break; // configuration frames 1 and 3 are not supported
+		}
+	}
+
+	bool LoopbackPdc::SendFrame( const ConnectionPtr& conn, const char* frame, int length )
+	{
+		std::lock_guard<std::mutex> lock(conn->SendLock);
+		if( conn->OwnsSocket == false ) {
+			// UDP: a datagram per frame, lost when the client does not keep up
+			sendto(conn->Socket, frame, length, 0, (const sockaddr*)&conn->Address, conn->AddressLength);
+			return true;
+		}
+
+		// TCP: the whole frame, or nothing more on this connection
+		int sent = 0;
+		while( sent < length )
+		{
+			int ret = (int)send(conn->Socket, frame + sent, length - sent, SEND_FLAGS);
+			if( ret > 0 ) { sent += ret; continue; }
+#ifdef _WIN32
+			const bool timedOut = ret < 0 && WSAGetLastError() == WSAETIMEDOUT;
+#else
+			const bool timedOut = ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR);
+#endif
+			if( !timedOut || m_stopSenders || m_stopControl ) {
+				conn->Streaming = false;
+				return false;
+			}
+		}
+		return true;
+	}
+
+	void LoopbackPdc::RemoveConnection( const ConnectionPtr& conn )
+	{
+		conn->Streaming = false;
+		std::lock_guard<std::mutex> lock(m_lock);
+		for( std::vector<ConnectionPtr>::iterator iter = m_connections.begin(); iter != m_connections.end(); ++iter )
+		{
+			if( *iter == conn ) {
+				m_connections.erase(iter);
+				break;
+			}
+		}
+	}
+
+
+	// ------------------------------------------------------------------------------------------------------------------------
+	// Data stream
+	// ------------------------------------------------------------------------------------------------------------------------
+
+
+	void LoopbackPdc::Start( int framesPerSecond, int numSenderThreads )
+	{
+		Stop();
+
+		// The CPU time of earlier senders is kept
+		for( size_t i = 0; i < m_runningCpuNs.size(); ++i ) m_senderCpuNs += m_runningCpuNs[i];
+		std::vector<std::atomic<uint64_t>> runningCpuNs(numSenderThreads);
+		for( int i = 0; i < numSenderThreads; ++i ) runningCpuNs[i] = 0;
+		m_runningCpuNs.swap(runningCpuNs);
+
+		m_stopSenders = false;
+		for( int i = 0; i < numSenderThreads; ++i )
+			m_senders.push_back(std::thread(&LoopbackPdc::SenderProc, this, i, numSenderThreads, framesPerSecond));
+	}
+
+	void LoopbackPdc::Stop()
+	{
+		m_stopSenders = true;
+		for( std::vector<std::thread>::iterator iter = m_senders.begin(); iter != m_senders.end(); ++iter ) iter->join();
+		m_senders.clear();
+	}
+
+	double LoopbackPdc::SenderCpuSeconds() const
+	{
+		uint64_t cpuNs = m_senderCpuNs;
+		for( size_t i = 0; i < m_runningCpuNs.size(); ++i ) cpuNs += m_runningCpuNs[i];
+		return cpuNs * 1.0e-9;
+	}
+
+	void LoopbackPdc::SenderProc( int senderIdx, int numSenders, int framesPerSecond )
+	{
+		std::vector<char> frame = m_dataFrame;
+		std::vector<ConnectionPtr> targets;
+		uint32_t sequence = 0;
+
+		const std::chrono::nanoseconds period(framesPerSecond > 0 ? 1000000000LL / framesPerSecond : 0);
+		std::chrono::steady_clock::time_point nextRound = std::chrono::steady_clock::now();
+		std::chrono::steady_clock::time_point nextConfig = nextRound;
+		std::chrono::steady_clock::time_point nextCpuUpdate = nextRound;
+		while( !m_stopSenders )
+		{
+			// This sender's share of the streaming connections
+			targets.clear();
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				for( std::vector<ConnectionPtr>::iterator iter = m_connections.begin(); iter != m_connections.end(); ++iter )
+					if( (int)((*iter)->Id % numSenders) == senderIdx && (*iter)->Streaming ) targets.push_back(*iter);
+			}
+
+			std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+			if( targets.empty() ) {
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				nextRound = now;
+				continue;
+			}
+
+			// A spontaneous PMU/PDC repeats its configuration once per second
+			if( m_transport == TRANSPORT_UDP_SPONTANEOUS && now >= nextConfig ) {
+				SendFrame(targets[0], m_configFrame.data(), (int)m_configFrame.size());
+				nextConfig = now + std::chrono::seconds(1);
+			}
+
+			// All connections of a round get the same frame
+			StampDataFrame(&frame, sequence++);
+			uint64_t numSent = 0;
+			for( std::vector<ConnectionPtr>::iterator iter = targets.begin(); iter != targets.end() && !m_stopSenders; ++iter )
+				if( SendFrame(*iter, frame.data(), (int)frame.size()) ) ++numSent;
+			m_framesSent += numSent;
+
+			if( now >= nextCpuUpdate ) {
+				m_runningCpuNs[senderIdx] = (uint64_t)(ThreadCpuSeconds() * 1.0e9);
+				nextCpuUpdate = now + std::chrono::seconds(1);
+			}
+
+			// Paced: a round every period, late rounds are not made up for by bursts
+			if( framesPerSecond > 0 ) {
+				nextRound += period;
+				now = std::chrono::steady_clock::now();
+				if( nextRound > now ) std::this_thread::sleep_until(nextRound);
+				else if( now - nextRound > std::chrono::seconds(1) ) nextRound = now;
+			}
+		}
+		m_runningCpuNs[senderIdx] = (uint64_t)(ThreadCpuSeconds() * 1.0e9);
+	}
+
+
+	// ------------------------------------------------------------------------------------------------------------------------
+	// Verification
+	// ------------------------------------------------------------------------------------------------------------------------
+
+
+	bool LoopbackPdc::CheckAllPmuRealData( const char* buffer, const allPmuDataLayout& layout, uint32_t* outSequence ) const
+	{
+		const LoopbackPdcConfig& cfg = m_config;
+		if( layout.numPmus != cfg.NumPmus || layout.numPhasors != cfg.NumPmus * cfg.NumPhasors || layout.numAnalogs != cfg.NumPmus * cfg.NumAnalogs ) return false;
+
+		const float* frequency = (const float*)(buffer + layout.frequencyOffset);
+		const float* real = (const float*)(buffer + layout.phasorRealOffset);
+		const float* imag = (const float*)(buffer + layout.phasorImaginaryOffset);
+		const float* analog = (const float*)(buffer + layout.analogOffset);
+		const BOOL8_t* digital = (const BOOL8_t*)(buffer + layout.digitalOffset);
+		for( int iPmu = 0; iPmu < cfg.NumPmus; ++iPmu )
+		{
+			if( frequency[iPmu] != FrequencyValue(iPmu) ) return false;
+			for( int i = 0; i < cfg.NumPhasors; ++i )
+				if( real[iPmu * cfg.NumPhasors + i] != PhasorValue(iPmu, i) || imag[iPmu * cfg.NumPhasors + i] != -PhasorValue(iPmu, i) ) return false;
+			for( int i = (iPmu == 0 ? 1 : 0); i < cfg.NumAnalogs; ++i )
+				if( analog[iPmu * cfg.NumAnalogs + i] != AnalogValue(iPmu, i) ) return false;
+			for( int i = 0; i < 16 * cfg.NumDigWords; ++i )
+				if( (digital[iPmu * 16 * cfg.NumDigWords + i] != 0) != (((DigitalWord(iPmu, i / 16) >> (i % 16)) & 1) != 0) ) return false;
+		}
+		*outSequence = (uint32_t)analog[0];
+		return true;
+	}
+
+	bool LoopbackPdc::CheckFrameView( const frameView* frame, uint32_t* outSequence ) const
+	{
+		const LoopbackPdcConfig& cfg = m_config;
+		if( frame->numPmus != cfg.NumPmus ) return false;
+
+		for( int iPmu = 0; iPmu < cfg.NumPmus; ++iPmu )
+		{
+			if( frame->frequency[iPmu] != FrequencyValue(iPmu) ) return false;
+			if( frame->phasorOffset[iPmu+1] - frame->phasorOffset[iPmu] != cfg.NumPhasors || frame->analogOffset[iPmu+1] - frame->analogOffset[iPmu] != cfg.NumAnalogs ) return false;
+			for( int i = 0; i < cfg.NumPhasors; ++i )
+				if( frame->phasorValueReal[frame->phasorOffset[iPmu] + i] != PhasorValue(iPmu, i) || frame->phasorValueImaginary[frame->phasorOffset[iPmu] + i] != -PhasorValue(iPmu, i) ) return false;
+			for( int i = (iPmu == 0 ? 1 : 0); i < cfg.NumAnalogs; ++i )
+				if( frame->analogValues[frame->analogOffset[iPmu] + i] != AnalogValue(iPmu, i) ) return false;
+			for( int i = 0; i < cfg.NumDigWords; ++i )
+				if( frame->digitalWords[frame->digitalWordOffset[iPmu] + i] != DigitalWord(iPmu, i) ) return false;
+		}
+		*outSequence = (uint32_t)frame->analogValues[0];
+		return true;
+	}
+
+
+	// ------------------------------------------------------------------------------------------------------------------------
+	// CPU time
+	// ------------------------------------------------------------------------------------------------------------------------
+
+
+	double ThreadCpuSeconds()
+	{
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+		return ((((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) + (((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime)) * 1.0e-7;
+#else
+		timespec ts;
+		clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+#endif
+	}
+
+	double ProcessCpuSeconds()
+	{
+#ifdef _WIN32
+		FILETIME creation, exit, kernel, user;
+		GetProcessTimes(GetCurrentProcess(), &creation, &exit, &kernel, &user);
+		return ((((uint64_t)kernel.dwHighDateTime << 32) | kernel.dwLowDateTime) + (((uint64_t)user.dwHighDateTime << 32) | user.dwLowDateTime)) * 1.0e-7;
+#else
+		timespec ts;
+		clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+		return ts.tv_sec + ts.tv_nsec * 1.0e-9;
+#endif
+	}
+}
@@ -0,0 +1,122 @@
+/*
+*  LoopbackPdc.h
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../StrongridDLL/Strongrid.h"
+
+namespace stresstest
+{
+	// Synthetic configuration sent by a LoopbackPdc: every PMU has the same channels, float rectangular phasors
+	struct LoopbackPdcConfig
+	{
+		LoopbackPdcConfig() : PdcId(1), NumPmus(10), NumPhasors(8), NumAnalogs(4), NumDigWords(1), DataRate(50) {}
+
+		int PdcId;
+		int NumPmus;
+		int NumPhasors;
+		int NumAnalogs; // at least 1 - analog 0 of PMU 0 carries the sequence number of the frame
+		int NumDigWords;
+		int DataRate; // DATA_RATE of the configuration frame
+	};
+
+	// In-process PMU/PDC for the stress tests: sends a configuration frame 2 and dataframes of a synthetic
+	// configuration over the loopback interface, so that the receive paths can be run and measured without a PMU/PDC.
+	//  - TRANSPORT_TCP: accepts any number of connections on Port() and answers their commands
+	//  - TRANSPORT_UDP: answers the commands arriving at the UDP port Port(), sending to the address they came from
+	//  - TRANSPORT_UDP_SPONTANEOUS: sends the configuration once per second and the dataframes to a local UDP port
+	// Dataframes are only sent between Start and Stop, to the connections that have been sent START_RTD.
+	class LoopbackPdc
+	{
+	public:
+		LoopbackPdc( int transport, const LoopbackPdcConfig& config, int spontaneousPort = 0 );
+		~LoopbackPdc();
+
+		int Port() const { return m_port; }
+		int NumStreaming() const; // connections that have been sent START_RTD
+
+		// Sends a dataframe to every streaming connection framesPerSecond times per second (0: as fast as the
+		// sockets take them). The connections are shared out between numSenderThreads threads.
+		void Start( int framesPerSecond, int numSenderThreads );
+		void Stop();
+
+		uint64_t FramesSent() const { return m_framesSent; }
+		double SenderCpuSeconds() const; // CPU time of the sender threads, up to now
+
+		// Checks the values of a frame from getAllPmuRealData, and returns its sequence number
+		bool CheckAllPmuRealData( const char* buffer, const allPmuDataLayout& layout, uint32_t* outSequence ) const;
+		bool CheckFrameView( const frameView* frame, uint32_t* outSequence ) const; // same for a frame callback
+
+	private:
+		struct Connection;
+		typedef std::shared_ptr<Connection> ConnectionPtr;
+
+		void BuildFrames();
+		void ControlProc();
+		void AcceptConnection();
+		void ReadTcpCommands( const ConnectionPtr& conn );
+		void ReadUdpCommand();
+		void HandleCommand( const ConnectionPtr& conn, const char* frame, int length );
+		void SenderProc( int senderIdx, int numSenders, int framesPerSecond );
+		void StampDataFrame( std::vector<char>* frame, uint32_t sequence ) const;
+		bool SendFrame( const ConnectionPtr& conn, const char* frame, int length );
+		void RemoveConnection( const ConnectionPtr& conn );
+
+		float PhasorValue( int pmuIdx, int phasorIdx ) const { return (float)(pmuIdx * 1000 + phasorIdx); }
+		float AnalogValue( int pmuIdx, int analogIdx ) const { return (float)(pmuIdx * 1000 + 500 + analogIdx); }
+		float FrequencyValue( int pmuIdx ) const { return 50.0f + 0.001f * pmuIdx; }
+		uint16_t DigitalWord( int pmuIdx, int wordIdx ) const { return (uint16_t)(0xA5A5 ^ (pmuIdx * 7 + wordIdx)); }
+
+	private:
+		const int m_transport;
+		const LoopbackPdcConfig m_config;
+		int m_socket; // TCP listener / UDP socket
+		int m_port;
+
+		std::vector<char> m_configFrame;
+		std::vector<char> m_headerFrame;
+		std::vector<char> m_dataFrame;
+		int m_sequenceOffset; // of analog 0 of PMU 0 in the dataframe
+
+		mutable std::mutex m_lock; // m_connections
+		std::vector<ConnectionPtr> m_connections;
+		uint64_t m_nextConnectionId;
+
+		std::thread m_controlThread;
+		std::vector<std::thread> m_senders;
+		std::atomic<bool> m_stopControl;
+		std::atomic<bool> m_stopSenders;
+		std::atomic<uint64_t> m_framesSent;
+		std::atomic<uint64_t> m_senderCpuNs; // of the sender threads that have finished
+		std::vector<std::atomic<uint64_t>> m_runningCpuNs; // of the running sender threads, updated once per second
+	};
+
+	// CPU time of the calling thread, and of the whole process, in seconds
+	double ThreadCpuSeconds();
+	double ProcessCpuSeconds();
+}
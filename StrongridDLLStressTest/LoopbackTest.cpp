@@ -0,0 +1,125 @@
+/*
+*  LoopbackTest.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include "../StrongridDLL/Strongrid.h"
+#include "Common.h"
+#include "LoopbackPdc.h"
+
+using namespace std;
+
+static const int TIMEOUT_MS = 5000;
+
+namespace stresstest
+{
+	static const char* TransportName( int transport )
+	{
+		switch( transport )
+		{
+		case TRANSPORT_TCP: return "TCP";
+		case TRANSPORT_UDP: return "UDP, commanded";
+		case TRANSPORT_UDP_SPONTANEOUS: return "UDP, spontaneous";
+		default: return "?";
+		}
+	}
+
+	// One client reads the stream of a LoopbackPdc with readNextFrame and checks every frame
+	int RunLoopbackTest( int transport, int framesPerSecond, int seconds, int localUdpPort )
+	{
+		strongrid_library_init();
+
+		LoopbackPdcConfig config;
+		LoopbackPdc pdc(transport, config, localUdpPort);
+
+		cout << "Loopback test: " << TransportName(transport) << ", " << config.NumPmus << " PMUs x " << config.NumPhasors << " phasors, ";
+		if( framesPerSecond > 0 ) cout << framesPerSecond << " frames/s, ";
+		else cout << "as fast as possible, ";
+		cout << seconds << "s" << endl << endl;
+
+		// The spontaneous stream (with its configuration) runs before the client is there, the others start on START_RTD
+		pdc.Start(framesPerSecond, 1);
+
+		int32_t pseudoPdcId;
+		if( ::connectPdcTransport((char*)"127.0.0.1", pdc.Port(), config.PdcId, transport, transport == TRANSPORT_UDP_SPONTANEOUS ? localUdpPort : 0, &pseudoPdcId) != 0 ) throw Exception("connectPdcTransport failed");
+		if( ::readConfiguration(TIMEOUT_MS, pseudoPdcId) != 0 ) throw Exception("readConfiguration failed");
+		if( ::startDataStream(pseudoPdcId) != 0 ) throw Exception("startDataStream failed");
+
+		allPmuDataLayout layout;
+		if( ::getAllPmuRealDataLayout(&layout, 0, 0, 0, 0, pseudoPdcId) != 0 ) throw Exception("getAllPmuRealDataLayout failed");
+		std::vector<double> buffer(layout.bufferSize / sizeof(double) + 1);
+
+		uint64_t numFrames = 0, numLost = 0, numOutOfOrder = 0, numBadValues = 0, numTimeouts = 0;
+		uint32_t lastSequence = 0;
+		const uint64_t sentAtStart = pdc.FramesSent();
+		const double cpuAtStart = ProcessCpuSeconds() - pdc.SenderCpuSeconds();
+		const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+		const std::chrono::steady_clock::time_point end = start + std::chrono::seconds(seconds);
+		while( std::chrono::steady_clock::now() < end )
+		{
+			int retval = ::readNextFrame(TIMEOUT_MS, pseudoPdcId);
+			if( retval == 2 ) { ++numTimeouts; continue; }
+			if( retval != 0 ) throw Exception("readNextFrame failed");
+			if( ::getAllPmuRealData(buffer.data(), layout.bufferSize, pseudoPdcId) != 0 ) throw Exception("getAllPmuRealData failed");
+
+			// The sequence number counts the frames sent, modulo 2^24
+			uint32_t sequence;
+			if( !pdc.CheckAllPmuRealData((const char*)buffer.data(), layout, &sequence) ) { ++numBadValues; continue; }
+			if( numFrames > 0 ) {
+				const uint32_t step = (sequence - lastSequence) & 0xFFFFFF;
+				if( step == 0 || step > 0x800000 ) ++numOutOfOrder;
+				else numLost += step - 1;
+			}
+			lastSequence = sequence;
+			++numFrames;
+		}
+		const double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		const double libraryCpu = ProcessCpuSeconds() - pdc.SenderCpuSeconds() - cpuAtStart;
+		const uint64_t numSent = pdc.FramesSent() - sentAtStart;
+		pdc.Stop();
+
+		uint32_t numDropped = 0;
+		::getDroppedDatagramCount(&numDropped, pseudoPdcId);
+		::disconnectPdc(pseudoPdcId);
+		strongrid_library_cleanup();
+
+		cout << fixed << setprecision(0)
+			<< "frames sent:        " << numSent << " (" << numSent / elapsed << "/s)" << endl
+			<< "frames received:    " << numFrames << " (" << numFrames / elapsed << "/s)" << endl
+			<< "lost (by sequence): " << numLost << endl
+			<< "out of order:       " << numOutOfOrder << endl
+			<< "wrong values:       " << numBadValues << endl
+			<< "read timeouts:      " << numTimeouts << endl
+			<< "dropped datagrams:  " << numDropped << " (the repeated configuration frames of a spontaneous stream are among them)" << endl
+			<< setprecision(2)
+			<< "client CPU:         " << (numFrames > 0 ? libraryCpu * 1.0e6 / numFrames : 0.0) << " us/frame (process CPU without the sender thread)" << endl;
+
+		// Datagrams may be lost, TCP frames may not
+		const bool passed = numFrames > 0 && numBadValues == 0 && numOutOfOrder == 0 && (transport != TRANSPORT_TCP || numLost == 0);
+		cout << (passed ? "PASSED" : "FAILED") << endl;
+		return passed ? 0 : 1;
+	}
+}
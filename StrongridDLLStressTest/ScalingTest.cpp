@@ -0,0 +1,264 @@
+/*
+*  ScalingTest.cpp
+*
+*  Copyright (C) 2017 Luigi Vanfretti
+*
+*  This file is part of StrongridDLL.
+*
+*  StrongridDLL is free software: you can redistribute it and/or modify
+*  it under the terms of the GNU General Public License as published by
+*  the Free Software Foundation, either version 3 of the License, or
+*  (at your option) any later version.
+*
+*  StrongridDLL is distributed in the hope that it will be useful,
+*  but WITHOUT ANY WARRANTY; without even the implied warranty of
+*  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*  GNU General Public License for more details.
+*
+*  You should have received a copy of the GNU General Public License
+*  along with StrongridDLL.  If not, see <http://www.gnu.org/licenses/>.
+*
+*/
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "../StrongridDLL/Strongrid.h"
+#include "Common.h"
+#include "LoopbackPdc.h"
+
+using namespace std;
+
+static const int TIMEOUT_MS = 30000;
+
+namespace stresstest
+{
+	// Every thread owns one connection to an in-process PMU/PDC and services only that one, as in the thread-per-PDC
+	// model. Calls on different pseudoPdcIds never wait for each other, so the work done per CPU second of a thread
+	// should not drop as threads are added, and the aggregate rates should grow linearly while there are cores for
+	// every reader and sender thread.
+	struct ScalingResult
+	{
+		double FramesPerSecond;	// readNextFrame + getAllPmuRealData per received frame
+		double FramesPerCpuSecond;	// the same per CPU second of the reader threads
+		double GetsPerSecond;		// getPdcRealData + getAllPmuRealData on the last frame, no network
+		double GetsPerCpuSecond;
+	};
+
+	static void ConnectClients( const PdcConfig& config, int numClients, std::vector<int32_t>* pseudoPdcIds )
+	{
+		for( int i = 0; i < numClients; ++i )
+		{
+			int32_t pseudoPdcId;
+			if( ::connectPdc((char*)config.IP.c_str(), config.Port, atoi(config.PdcId.c_str()), &pseudoPdcId) != 0 ) throw Exception("connectPdc failed");
+			pseudoPdcIds->push_back(pseudoPdcId);
+
+			int retval = config.Version == 2 ? ::readConfiguration_Ver3(TIMEOUT_MS, pseudoPdcId) : ::readConfiguration(TIMEOUT_MS, pseudoPdcId);
+			if( retval != 0 ) throw Exception("readConfiguration failed");
+			if( ::startDataStream(pseudoPdcId) != 0 ) throw Exception("startDataStream failed");
+		}
+	}
+
+	static ScalingResult RunStep( LoopbackPdc& pdc, int numThreads, int secondsPerPhase )
+	{
+		// One sender thread per connection, sending as fast as the reader takes the frames
+		pdc.Start(0, numThreads);
+		std::vector<int32_t> pseudoPdcIds;
+		ConnectClients(PdcConfig("127.0.0.1", pdc.Port(), "1", 1), numThreads, &pseudoPdcIds);
+
+		std::atomic<bool> stopFlag(false);
+		std::atomic<bool> getPhase(false);
+		std::atomic<uint64_t> numFrames(0);
+		std::atomic<uint64_t> numGets(0);
+		std::atomic<uint64_t> frameCpuNs(0);
+		std::atomic<uint64_t> getCpuNs(0);
+		std::atomic<int> numErrors(0);
+
+		std::vector<std::thread> threads;
+		for( int i = 0; i < numThreads; ++i )
+		{
+			threads.push_back(std::thread([&, i]()
+			{
+				const int32_t pseudoPdcId = pseudoPdcIds[i];
+				allPmuDataLayout layout;
+				if( ::getAllPmuRealDataLayout(&layout, 0, 0, 0, 0, pseudoPdcId) != 0 ) { ++numErrors; return; }
+				std::vector<double> buffer(layout.bufferSize / sizeof(double) + 1);
+
+				// Phase 1: read and decode the data stream
+				uint64_t frames = 0;
+				const double cpuStart = ThreadCpuSeconds();
+				while( !getPhase )
+				{
+					if( ::readNextFrame(TIMEOUT_MS, pseudoPdcId) != 0 ) { ++numErrors; return; }
+					if( ::getAllPmuRealData(buffer.data(), layout.bufferSize, pseudoPdcId) != 0 ) { ++numErrors; return; }
+					++frames;
+				}
+				const double cpuFrames = ThreadCpuSeconds();
+				numFrames += frames;
+				frameCpuNs += (uint64_t)((cpuFrames - cpuStart) * 1.0e9);
+
+				// Phase 2: getter calls only
+				uint64_t gets = 0;
+				pdcDataFrame pdcData;
+				while( !stopFlag )
+				{
+					if( ::getPdcRealData(&pdcData, pseudoPdcId) != 0 ) { ++numErrors; return; }
+					if( ::getAllPmuRealData(buffer.data(), layout.bufferSize, pseudoPdcId) != 0 ) { ++numErrors; return; }
+					++gets;
+				}
+				numGets += gets;
+				getCpuNs += (uint64_t)((ThreadCpuSeconds() - cpuFrames) * 1.0e9);
+			}));
+		}
+
+		std::this_thread::sleep_for(std::chrono::seconds(secondsPerPhase));
+		getPhase = true;
+		std::this_thread::sleep_for(std::chrono::seconds(secondsPerPhase));
+		stopFlag = true;
+		for( std::vector<std::thread>::iterator iter = threads.begin(); iter != threads.end(); ++iter ) iter->join();
+
+		pdc.Stop();
+		for( std::vector<int32_t>::iterator iter = pseudoPdcIds.begin(); iter != pseudoPdcIds.end(); ++iter ) ::disconnectPdc(*iter);
+		if( numErrors > 0 ) throw Exception("API call failed during the scaling test");
+
+		ScalingResult result;
+		result.FramesPerSecond = (double)numFrames / secondsPerPhase;
+		result.FramesPerCpuSecond = frameCpuNs > 0 ? numFrames * 1.0e9 / frameCpuNs : 0.0;
+		result.GetsPerSecond = (double)numGets / secondsPerPhase;
+		result.GetsPerCpuSecond = getCpuNs > 0 ? numGets * 1.0e9 / getCpuNs : 0.0;
+		return result;
+	}
+
+	static void PrintEfficiency( double efficiency, bool measurable )
+	{
+		if( measurable ) cout << setw(8) << fixed << setprecision(2) << efficiency;
+		else cout << setw(8) << "-";
+	}
+
+	int RunScalingTest( int maxThreads, int secondsPerPhase, double minEfficiency )
+	{
+		strongrid_library_init();
+
+		LoopbackPdcConfig pdcConfig;
+		LoopbackPdc pdc(TRANSPORT_TCP, pdcConfig);
+		const int numCores = (int)std::thread::hardware_concurrency();
+
+		cout << "Scaling test: in-process PMU/PDC (TCP, " << pdcConfig.NumPmus << " PMUs x " << pdcConfig.NumPhasors << " phasors), " << numCores << " cores" << endl;
+		cout << "One connection per thread, " << secondsPerPhase << "s per phase, minimum efficiency " << setprecision(2) << fixed << minEfficiency << endl << endl;
+		cout << setw(8) << "threads"
+			<< setw(12) << "frames/s" << setw(8) << "cpu" << setw(8) << "wall"
+			<< setw(12) << "gets/s" << setw(8) << "cpu" << setw(8) << "wall" << endl;
+
+		// Efficiency relative to perfectly linear scaling (1.00 = linear). cpu: work per CPU second of a reader
+		// thread, wall: aggregate rate, only where every thread has a core (the frame phase also runs a sender
+		// per connection).
+		ScalingResult baseline;
+		double worst = 1.0;
+		for( int numThreads = 1; numThreads <= maxThreads; numThreads *= 2 )
+		{
+			ScalingResult result = RunStep(pdc, numThreads, secondsPerPhase);
+			if( numThreads == 1 ) baseline = result;
+
+			const double frameCpuEfficiency = result.FramesPerCpuSecond / baseline.FramesPerCpuSecond;
+			const double frameWallEfficiency = result.FramesPerSecond / (baseline.FramesPerSecond * numThreads);
+			const double getCpuEfficiency = result.GetsPerCpuSecond / baseline.GetsPerCpuSecond;
+			const double getWallEfficiency = result.GetsPerSecond / (baseline.GetsPerSecond * numThreads);
+			const bool frameWallMeasurable = 2 * numThreads <= numCores;
+			const bool getWallMeasurable = numThreads <= numCores;
+
+			worst = std::min(worst, std::min(frameCpuEfficiency, getCpuEfficiency));
+			if( frameWallMeasurable ) worst = std::min(worst, frameWallEfficiency);
+			if( getWallMeasurable ) worst = std::min(worst, getWallEfficiency);
+
+			cout << setw(8) << numThreads << setw(12) << setprecision(0) << result.FramesPerSecond;
+			PrintEfficiency(frameCpuEfficiency, true);
+			PrintEfficiency(frameWallEfficiency, frameWallMeasurable);
+			cout << setw(12) << setprecision(0) << result.GetsPerSecond;
+			PrintEfficiency(getCpuEfficiency, true);
+			PrintEfficiency(getWallEfficiency, getWallMeasurable);
+			cout << endl;
+		}
+
+		strongrid_library_cleanup();
+
+		const bool passed = worst >= minEfficiency;
+		cout << endl << "lowest efficiency: " << setprecision(2) << worst << endl << (passed ? "PASSED" : "FAILED") << endl;
+		return passed ? 0 : 1;
+	}
+
+	static void OnPoolFrame( const frameView*, void* userData )
+	{
+		++*(std::atomic<uint64_t>*)userData;
+	}
+
+	static uint64_t SumFrames( const std::vector<std::atomic<uint64_t>>& numFrames )
+	{
+		uint64_t sum = 0;
+		for( std::vector<std::atomic<uint64_t>>::const_iterator iter = numFrames.begin(); iter != numFrames.end(); ++iter ) sum += *iter;
+		return sum;
+	}
+
+	int RunIoPoolTest( int numThreads, int numConnections, int framesPerSecond, int seconds )
+	{
+		strongrid_library_init();
+		if( ::setIoThreadPool(numThreads) != 0 ) throw Exception("setIoThreadPool failed");
+
+		// Every connection of the in-process PMU/PDC gets framesPerSecond frames, sent by one thread per core
+		LoopbackPdcConfig pdcConfig;
+		LoopbackPdc pdc(TRANSPORT_TCP, pdcConfig);
+		const int numSenders = std::max(1, (int)std::thread::hardware_concurrency());
+		pdc.Start(framesPerSecond, numSenders);
+
+		cout << "I/O pool test: in-process PMU/PDC (TCP, " << pdcConfig.NumPmus << " PMUs x " << pdcConfig.NumPhasors << " phasors), "
+			<< std::thread::hardware_concurrency() << " cores" << endl;
+		cout << numConnections << " connections at " << framesPerSecond << " frames/s on " << numThreads << " pool threads, "
+			<< numSenders << " sender threads, " << seconds << "s" << endl << endl;
+
+		// Every connection delivers its frames to a callback run by the pool
+		std::vector<std::atomic<uint64_t>> numFrames(numConnections);
+		for( int i = 0; i < numConnections; ++i ) numFrames[i] = 0;
+
+		std::vector<int32_t> pseudoPdcIds;
+		ConnectClients(PdcConfig("127.0.0.1", pdc.Port(), "1", 1), numConnections, &pseudoPdcIds);
+		for( int i = 0; i < numConnections; ++i )
+			if( ::registerFrameCallback(pseudoPdcIds[i], OnPoolFrame, &numFrames[i]) != 0 ) throw Exception("registerFrameCallback failed");
+
+		// Skip the frames buffered while connecting
+		std::this_thread::sleep_for(std::chrono::seconds(1));
+		const uint64_t startFrames = SumFrames(numFrames);
+		const uint64_t startSent = pdc.FramesSent();
+		const double startCpu = ProcessCpuSeconds() - pdc.SenderCpuSeconds();
+		std::this_thread::sleep_for(std::chrono::seconds(seconds));
+		const uint64_t received = SumFrames(numFrames) - startFrames;
+		const uint64_t sent = pdc.FramesSent() - startSent;
+		const double libraryCpu = ProcessCpuSeconds() - pdc.SenderCpuSeconds() - startCpu;
+
+		pdc.Stop();
+		for( std::vector<int32_t>::iterator iter = pseudoPdcIds.begin(); iter != pseudoPdcIds.end(); ++iter ) ::disconnectPdc(*iter);
+		::setIoThreadPool(0);
+		strongrid_library_cleanup();
+
+		// The library CPU time is that of the process without the senders; per frame it tells how many cores the
+		// target rate takes where the sender does not compete for them
+		const double target = (double)framesPerSecond * numConnections;
+		const double cpuPerFrame = received > 0 ? libraryCpu / received : 0.0;
+		cout << fixed << setprecision(0)
+			<< "target:       " << target << " frames/s" << endl
+			<< "sent:         " << sent / (double)seconds << " frames/s" << endl
+			<< "received:     " << received / (double)seconds << " frames/s" << endl
+			<< setprecision(2)
+			<< "library CPU:  " << cpuPerFrame * 1.0e6 << " us/frame, " << cpuPerFrame * target << " cores at the target rate" << endl;
+
+		// The target counts as reached at 95% of the rate, the pacing of the senders loses a little
+		const bool passed = received >= 0.95 * target * seconds;
+		cout << (passed ? "PASSED" : "FAILED: the target rate was not reached") << endl;
+		return passed ? 0 : 1;
+	}
+}
@@ -38,6 +38,9 @@ using namespace std;
 using namespace stresstest;
 
 static const int TIMEOUT_MS = 30000;
+static const int RECONNECT_MIN_DELAY_MS = 1000;
+static const int RECONNECT_MAX_DELAY_MS = 30000;
+static const int MAX_READ_TIMEOUTS = 40; // consecutive readNextFrame timeouts before the connection is set up again
 
 
 static bool WRITE_OUTPUT_TO_FILE = true;
@@ -168,6 +171,7 @@ std::string getLogTs()
 void ReadFrameLoopProc(int pseudoPdcId, ostream& strout, const std::vector<PmuState*>& pmuConfigurationMap  )
 {
 	int pseudoPdcIdArray[1024];
+	int numTimeouts = 0;
 
 	// Read frame loop
 	//for( int numIterations = 0; numIterations < 50 * 10 && SHUTDOWN_FLAG == false; ++numIterations )
@@ -178,10 +182,13 @@ void ReadFrameLoopProc(int pseudoPdcId, ostream& strout, const std::vector<PmuSt
 		// TMP DEBUG - test threadpooling base function
 		int pdcWithData = 0;
 		memset(pseudoPdcIdArray,0,sizeof(int)*1024);
-		AssertIsZero( pollPdcWithDataWaiting(1024, pseudoPdcIdArray, &pdcWithData, 30000) );
+		AssertIsZero( pollPdcWithDataWaiting(1024, pseudoPdcIdArray, &pdcWithData, 1500) );
 
-		// Read next frame
-		AssertIsZero(::readNextFrame(1500, pseudoPdcId));
+		// Read next frame - times out while the library reconnects a lost connection
+		int retval = ::readNextFrame(1500, pseudoPdcId);
+		if( retval == 2 && ++numTimeouts < MAX_READ_TIMEOUTS ) continue;
+		AssertIsZero(retval);
+		numTimeouts = 0;
 
 		// Get PDC data
 		pdcDataFrame pdcData;
@@ -402,6 +409,7 @@ void pdcThreadProc_Ver3(PdcConfig* pdccfgraw)
 
 			strout << getLogTs() << "\nStarting datastream..." << endl;
 			AssertIsZero(::startDataStream(pseudoPdcId));
+			AssertIsZero(::setAutoReconnect(1, RECONNECT_MIN_DELAY_MS, RECONNECT_MAX_DELAY_MS, pseudoPdcId));
 
 			// Ender shared-readframe loop
 			ReadFrameLoopProc(pseudoPdcId, strout, pmuList );
@@ -571,6 +579,7 @@ void pdcThreadProc(PdcConfig* pdccfgraw)
 
 			strout << getLogTs() << "\nStarting datastream..." << endl;
 			AssertIsZero(::startDataStream(pseudoPdcId));
+			AssertIsZero(::setAutoReconnect(1, RECONNECT_MIN_DELAY_MS, RECONNECT_MAX_DELAY_MS, pseudoPdcId));
 
 			// Ender shared-readframe loop
 			ReadFrameLoopProc(pseudoPdcId, strout, pmuList );
@@ -605,6 +614,52 @@ int main(int argc, char *argv[])
 		string PdcId =  "1000";
 		int Version =   1;
 
+	// Throughput scaling over threads against an in-process PMU/PDC: StrongridDLLStressTest scaling <maxThreads> [secondsPerPhase] [minEfficiency]
+	if( argc >= 3 && string(argv[1]) == "scaling" )
+	{
+		try {
+			return RunScalingTest(atoi(argv[2]), argc >= 4 ? atoi(argv[3]) : 5, argc >= 5 ? atof(argv[4]) : 0.75);
+		}
+		catch( Exception e )
+		{
+			cout << "An error has ocurred: " << e.ErrorMessage() << endl;
+			return 1;
+		}
+	}
+
+	// Many connections on a few threads against an in-process PMU/PDC: StrongridDLLStressTest pool <numThreads> <numConnections> [framesPerSecond] [seconds]
+	if( argc >= 4 && string(argv[1]) == "pool" )
+	{
+		try {
+			return RunIoPoolTest(atoi(argv[2]), atoi(argv[3]), argc >= 5 ? atoi(argv[4]) : 60, argc >= 6 ? atoi(argv[5]) : 5);
+		}
+		catch( Exception e )
+		{
+			cout << "An error has ocurred: " << e.ErrorMessage() << endl;
+			return 1;
+		}
+	}
+
+	// In-process PMU/PDC: StrongridDLLStressTest loopback <tcp|udp|spontaneous> [framesPerSecond (0: as fast as possible)] [seconds] [localUdpPort]
+	if( argc >= 3 && string(argv[1]) == "loopback" )
+	{
+		try {
+			const string transport = argv[2];
+			if( transport != "tcp" && transport != "udp" && transport != "spontaneous" ) throw Exception("Unknown transport " + transport);
+			return RunLoopbackTest(transport == "tcp" ? TRANSPORT_TCP : transport == "udp" ? TRANSPORT_UDP : TRANSPORT_UDP_SPONTANEOUS,
+				argc >= 4 ? atoi(argv[3]) : 5000, argc >= 5 ? atoi(argv[4]) : 5, argc >= 6 ? atoi(argv[5]) : 4713);
+		}
+		catch( Exception e )
+		{
+			cout << "An error has ocurred: " << e.ErrorMessage() << endl;
+			return 1;
+		}
+	}
+
+	// Dataframe decoding without network, decode plan against the per-value decoder: StrongridDLLStressTest decode [iterations]
+	if( argc >= 2 && string(argv[1]) == "decode" )
+		return RunDecodeBenchmark(argc >= 3 ? atoi(argv[2]) : 20000);
+
 	try {
 		PdcConfig config(IP, Port, PdcId, Version);
 